@@ -6,9 +6,13 @@
 #include "event_bus.hpp"
 #include "tool_manager.hpp"
 #include "dispatcher.hpp"
+#include "http.hpp"
+#include "metrics.hpp"
 #include "prompt.hpp"
 #include "skill.hpp"
+#include "trace.hpp"
 #include "util.hpp"
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <unordered_set>
@@ -28,6 +32,39 @@ static std::string strip_memory_context(const std::string& text) {
     return text.substr(content_start);
 }
 
+// Cached provider responses for history-keyed replay
+static std::string encode_chat_response(const ChatResponse& response) {
+    nlohmann::json j = nlohmann::json::object();
+    if (response.content) j["content"] = *response.content;
+    nlohmann::json calls = nlohmann::json::array();
+    for (const auto& tc : response.tool_calls) {
+        calls.push_back({{"id", tc.id}, {"name", tc.name}, {"arguments", tc.arguments}});
+    }
+    j["tool_calls"] = std::move(calls);
+    return j.dump();
+}
+
+static bool decode_chat_response(const std::string& data, ChatResponse& out) {
+    auto j = nlohmann::json::parse(data, nullptr, false);
+    if (!j.is_object() || !j.contains("tool_calls") || !j["tool_calls"].is_array())
+        return false;
+    out = ChatResponse{};
+    if (j.contains("content") && j["content"].is_string())
+        out.content = j["content"].get<std::string>();
+    for (const auto& tc : j["tool_calls"]) {
+        out.tool_calls.push_back(ToolCall{tc.value("id", ""), tc.value("name", ""),
+                                          tc.value("arguments", "")});
+    }
+    return true;
+}
+
+static Role role_from_string(const std::string& s) {
+    if (s == "system") return Role::System;
+    if (s == "assistant") return Role::Assistant;
+    if (s == "tool") return Role::Tool;
+    return Role::User;
+}
+
 bool Agent::has_active_memory() const {
     return memory_ && memory_->backend_name() != "none";
 }
@@ -50,9 +87,13 @@ Agent::Agent(std::unique_ptr<Provider> provider,
     // Create response cache if enabled
     if (memory_ && config_.memory.response_cache) {
         std::string cache_path = expand_home("~/.ptrclaw/response_cache.json");
-        response_cache_ = std::make_unique<ResponseCache>(
+        response_cache_ = ResponseCache::shared(
             cache_path, config_.memory.cache_ttl, config_.memory.cache_max_entries);
+        for (const auto& [category, ttl] : config_.memory.cache_category_ttl) {
+            response_cache_->set_category_ttl(category, ttl);
+        }
     }
+    publish_status();
 }
 
 Agent::~Agent() {
@@ -95,6 +136,7 @@ void Agent::inject_system_prompt() {
         }
     }
     history_.insert(history_.begin(), ChatMessage{Role::System, prompt, {}, {}});
+    history_changed(0);
     system_prompt_injected_ = true;
 }
 
@@ -105,18 +147,34 @@ bool Agent::is_hatched() const {
 void Agent::start_hatch() {
     hatching_ = true;
     history_.clear();
+    history_changed(0);
     system_prompt_injected_ = false;
     last_prompt_tokens_.reset();
+    publish_status();
 }
 
 std::string Agent::process(const std::string& user_message) {
+    // Whatever path the turn exits through, readers see its final state
+    struct StatusRefresh {
+        Agent& agent;
+        ~StatusRefresh() { agent.publish_status(); }
+    } status_refresh{*this};
+    TraceSpan turn_span("turn", session_id_);
+    ScopedTimer turn_timer(metrics().turn_seconds.unlabeled());
+
     if (!system_prompt_injected_) {
         inject_system_prompt();
     }
 
+    // Everything from here on is rolled back if the turn is cancelled
+    const size_t turn_start = history_.size();
+    HttpAbortScope abort_scope(turn_token_.get());
+
     // Enrich user message with recalled memory context (skip during hatching)
     std::string enriched_message = user_message;
     if (!hatching_) {
+        TraceSpan span("memory_enrich", session_id_, "memory");
+        ScopedTimer recall_timer(metrics().memory_recall_seconds.unlabeled());
         enriched_message = memory_enrich(memory_.get(), user_message,
                                           config_.memory.recall_limit,
                                           config_.memory.enrich_depth);
@@ -141,7 +199,9 @@ std::string Agent::process(const std::string& user_message) {
         if (!history_.empty() && history_[0].role == Role::System) {
             sys_prompt = history_[0].content;
         }
-        auto cached = response_cache_->get(model_, sys_prompt, enriched_message);
+        auto cached = response_cache_->get(model_, sys_prompt, enriched_message,
+                                           user_message);
+        metrics().response_cache.labels(metric_label("result", cached ? "hit" : "miss")).inc();
         if (cached) {
             history_.push_back(ChatMessage{Role::Assistant, *cached, {}, {}});
             // Cached responses have no provider usage payload — fall back to heuristic.
@@ -153,61 +213,109 @@ std::string Agent::process(const std::string& user_message) {
 
     while (iterations < config_.agent.max_tool_iterations) {
         iterations++;
+        if (is_cancelled(turn_token_)) return stop_turn(turn_start, stream_started);
+        publish_status();
 
-        // Emit ProviderRequest event
-        if (event_bus_) {
-            ProviderRequestEvent ev;
-            ev.session_id = session_id_;
-            ev.model = model_;
-            ev.message_count = history_.size();
-            ev.tool_count = tool_specs.size();
-            event_bus_->publish(ev);
+        // At temperature 0 a provider call is a function of the history it
+        // sees, so repeated workflows (e.g. cron jobs) replay from the cache
+        ChatResponse response;
+        std::optional<uint64_t> replay_key;
+        bool replayed = false;
+        if (response_cache_ && !hatching_ && config_.temperature <= 0.0) {
+            replay_key = provider_call_key(tool_specs);
+            if (auto cached = response_cache_->get(*replay_key)) {
+                replayed = decode_chat_response(*cached, response);
+            }
         }
+        if (replayed) {
+            metrics().response_cache.labels(metric_label("result", "replay")).inc();
+        } else {
+            // Emit ProviderRequest event
+            if (event_bus_) {
+                ProviderRequestEvent ev;
+                ev.session_id = session_id_;
+                ev.model = model_;
+                ev.message_count = history_.size();
+                ev.tool_count = tool_specs.size();
+                event_bus_->publish(ev);
+            }
 
-        ChatResponse response;
-        try {
-            if (provider_->supports_streaming() && !config_.agent.disable_streaming) {
-                response = provider_->chat_stream(
-                    history_, tool_specs, model_, config_.temperature,
-                    [this, &stream_started](const std::string& delta) -> bool {
-                        // During hatching, consume stream silently (no events)
-                        if (hatching_) return true;
-                        if (event_bus_) {
-                            if (!stream_started) {
-                                StreamStartEvent ev;
+            auto& ttfb = metrics().provider_ttfb_seconds.labels(metric_label("model", model_));
+            auto request_start = std::chrono::steady_clock::now();
+            bool first_token = true;
+            bool failed = false;
+            std::string provider_error;
+            auto observe_ttfb = [&] {
+                if (!first_token) return;
+                first_token = false;
+                ttfb.observe(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - request_start).count());
+            };
+            try {
+                if (provider_->supports_streaming() && !config_.agent.disable_streaming) {
+                    static Counter& chunks = metrics().stream_chunks.unlabeled();
+                    response = provider_->chat_stream(
+                        history_, tool_specs, model_, config_.temperature,
+                        [this, &stream_started, &observe_ttfb](
+                                const std::string& delta) -> bool {
+                            observe_ttfb();
+                            chunks.inc();
+                            // During hatching, consume stream silently (no events)
+                            if (hatching_) return !is_cancelled(turn_token_);
+                            if (event_bus_) {
+                                if (!stream_started) {
+                                    StreamStartEvent ev;
+                                    ev.session_id = session_id_;
+                                    ev.model = model_;
+                                    event_bus_->publish(ev);
+                                    stream_started = true;
+                                }
+                                StreamChunkEvent ev;
                                 ev.session_id = session_id_;
-                                ev.model = model_;
+                                ev.delta = delta;
                                 event_bus_->publish(ev);
-                                stream_started = true;
                             }
-                            StreamChunkEvent ev;
-                            ev.session_id = session_id_;
-                            ev.delta = delta;
-                            event_bus_->publish(ev);
-                        }
-                        return true;
-                    });
-            } else {
-                response = provider_->chat(history_, tool_specs, model_,
-                                           config_.temperature);
+                            return !is_cancelled(turn_token_);
+                        });
+                } else {
+                    response = provider_->chat(history_, tool_specs, model_,
+                                               config_.temperature);
+                }
+            } catch (const std::exception& e) {
+                provider_error = e.what();
+                failed = true;
             }
-        } catch (const std::exception& e) {
-            return std::string("Error calling provider: ") + e.what();
-        }
+            bool cancelled = is_cancelled(turn_token_);
 
-        // Track actual prompt token usage when provider reports it.
-        if (response.usage.prompt_tokens > 0) {
-            last_prompt_tokens_ = response.usage.prompt_tokens;
-        }
+            // Emit ProviderResponse event, for failed and stopped calls too
+            if (event_bus_) {
+                ProviderResponseEvent ev;
+                ev.session_id = session_id_;
+                ev.model = model_;
+                ev.failed = failed || cancelled;
+                if (!ev.failed) {
+                    ev.has_tool_calls = response.has_tool_calls();
+                    ev.usage = response.usage;
+                }
+                event_bus_->publish(ev);
+            }
+            if (cancelled) return stop_turn(turn_start, stream_started);
+            if (failed) return "Error calling provider: " + provider_error;
+            observe_ttfb(); // non-streaming, or a tool-call-only stream
 
-        // Emit ProviderResponse event
-        if (event_bus_) {
-            ProviderResponseEvent ev;
-            ev.session_id = session_id_;
-            ev.model = model_;
-            ev.has_tool_calls = response.has_tool_calls();
-            ev.usage = response.usage;
-            event_bus_->publish(ev);
+            // Track actual prompt token usage when provider reports it.
+            if (response.usage.prompt_tokens > 0) {
+                last_prompt_tokens_ = response.usage.prompt_tokens;
+            }
+            auto& tokens = metrics().provider_tokens;
+            tokens.labels(metric_labels("model", model_, "direction", "in"))
+                .inc(response.usage.prompt_tokens);
+            tokens.labels(metric_labels("model", model_, "direction", "out"))
+                .inc(response.usage.completion_tokens);
+
+            if (replay_key) {
+                response_cache_->put(*replay_key, encode_chat_response(response));
+            }
         }
 
         // Append assistant message (encode tool_calls in name field for round-tripping)
@@ -257,7 +365,18 @@ std::string Agent::process(const std::string& user_message) {
                     [&collector](const ToolCallResultEvent& ev) {
                         collector.on_result(ev);
                     }));
+            uint64_t progress_sub_id = subscribe<ToolCallProgressEvent>(*event_bus_,
+                std::function<void(const ToolCallProgressEvent&)>(
+                    [&collector](const ToolCallProgressEvent& ev) {
+                        collector.on_progress(ev);
+                    }));
 
+            // Results share what is left before compact_history kicks in. Past
+            // the threshold the budget is 1 rather than 0 (unknown), so
+            // results are held to tool_output_min_tokens.
+            uint32_t used = estimated_tokens();
+            uint32_t threshold = compaction_threshold();
+            uint32_t token_budget = threshold > used ? threshold - used : 1;
             for (const auto& call : response.tool_calls) {
                 ToolCallRequestEvent ev;
                 ev.session_id = session_id_;
@@ -265,12 +384,22 @@ std::string Agent::process(const std::string& user_message) {
                 ev.tool_name = call.name;
                 ev.tool_call_id = call.id;
                 ev.arguments_json = call.arguments;
+                ev.token_budget = token_budget;
+                ev.batch_size = static_cast<uint32_t>(response.tool_calls.size());
                 event_bus_->publish(ev);
             }
 
             auto timeout = std::chrono::seconds(config_.agent.tool_timeout);
-            bool completed = collector.wait(timeout);
+            bool completed = collector.wait(timeout, turn_token_);
             event_bus_->unsubscribe(sub_id);
+            event_bus_->unsubscribe(progress_sub_id);
+
+            if (!completed && is_cancelled(turn_token_)) {
+                ToolCallCancelEvent cancel_ev;
+                cancel_ev.batch_id = batch_id;
+                event_bus_->publish(cancel_ev);
+                return stop_turn(turn_start, stream_started);
+            }
 
             if (!completed) {
                 std::cerr << "[tool] timeout: " << collector.missing()
@@ -293,6 +422,12 @@ std::string Agent::process(const std::string& user_message) {
                         timeout_ev.success = false;
                         timeout_ev.output = "Tool call timed out after "
                             + std::to_string(config_.agent.tool_timeout) + "s";
+                        std::string partial = collector.partial_output(call.id);
+                        if (!partial.empty()) {
+                            timeout_ev.output += ". Output so far (last "
+                                + std::to_string(BatchCollector::kMaxPartialBytes)
+                                + " bytes at most):\n" + partial;
+                        }
                         collector.on_result(timeout_ev);
                     }
                 }
@@ -300,9 +435,10 @@ std::string Agent::process(const std::string& user_message) {
 
             for (const auto& r : collector.results()) {
                 if (provider_->supports_native_tools()) {
-                    history_.push_back(
-                        format_tool_result_message(r.tool_call_id, r.tool_name,
-                                                    r.success, r.output));
+                    auto msg = format_tool_result_message(r.tool_call_id, r.tool_name,
+                                                          r.success, r.output);
+                    if (r.memoized) refer_to_earlier_result(msg, r.memo_of);
+                    history_.push_back(std::move(msg));
                 } else {
                     xml_results += format_tool_results_xml(r.tool_name,
                                                             r.success, r.output);
@@ -351,6 +487,7 @@ std::string Agent::process(const std::string& user_message) {
 
             hatching_ = false;
             history_.clear();
+            history_changed(0);
             system_prompt_injected_ = false;
             return final_content;
         }
@@ -366,13 +503,17 @@ std::string Agent::process(const std::string& user_message) {
         }
     }
 
-    // Populate response cache (keyed on enriched message to match lookup above)
-    if (response_cache_ && !final_content.empty()) {
+    // Populate response cache (keyed on enriched message to match lookup above).
+    // At temperature 0 a turn that ran tools is replayed call by call instead,
+    // so its tools execute again rather than being skipped by a turn-level hit.
+    bool replays_calls = config_.temperature <= 0.0 && iterations > 1;
+    if (response_cache_ && !final_content.empty() && !replays_calls) {
         std::string sys_prompt;
         if (!history_.empty() && history_[0].role == Role::System) {
             sys_prompt = history_[0].content;
         }
-        response_cache_->put(model_, sys_prompt, enriched_message, final_content);
+        response_cache_->put(model_, sys_prompt, enriched_message, final_content,
+                             user_message);
     }
 
     // Synthesize knowledge from conversation
@@ -384,6 +525,72 @@ std::string Agent::process(const std::string& user_message) {
     return final_content;
 }
 
+uint64_t Agent::history_hash() {
+    if (history_hashes_.size() > history_.size()) {
+        history_hashes_.resize(history_.size());
+    }
+    // Only messages appended since the last call are hashed
+    uint64_t hash = history_hashes_.empty() ? kFnvOffset : history_hashes_.back();
+    for (size_t i = history_hashes_.size(); i < history_.size(); i++) {
+        const auto& msg = history_[i];
+        // Length-prefixed fields, so no two histories serialize the same
+        std::string header = std::to_string(static_cast<int>(msg.role)) + ":" +
+                             std::to_string(msg.content.size()) + ":";
+        hash = fnv1a(header, hash);
+        hash = fnv1a(msg.content, hash);
+        for (const auto* field : {&msg.name, &msg.tool_call_id}) {
+            hash = fnv1a(*field ? ":" + std::to_string((*field)->size()) + ":" + **field
+                                : std::string(":-"), hash);
+        }
+        history_hashes_.push_back(hash);
+    }
+    return hash;
+}
+
+void Agent::history_changed(size_t from) {
+    if (history_hashes_.size() > from) history_hashes_.resize(from);
+}
+
+uint64_t Agent::provider_call_key(const std::vector<ToolSpec>& tool_specs) {
+    uint64_t key = fnv1a(model_, history_hash());
+    for (const auto& spec : tool_specs) {
+        key = fnv1a(spec.name, key);
+        key = fnv1a(spec.parameters_json, key);
+    }
+    return key;
+}
+
+void Agent::refer_to_earlier_result(ChatMessage& msg, const std::string& memo_of) const {
+    std::string reference = "[Same result as tool call " + memo_of + " above]";
+    if (msg.content.size() <= reference.size()) return;
+    for (auto it = history_.rbegin(); it != history_.rend(); ++it) {
+        if (it->role != Role::Tool || it->tool_call_id != memo_of) continue;
+        // Still in history verbatim (not compacted away): point at it
+        if (it->content == msg.content) msg.content = std::move(reference);
+        return;
+    }
+}
+
+std::string Agent::stop_turn(size_t turn_start, bool stream_started) {
+    // Roll back the partial turn so history never holds a tool call
+    // without its results
+    if (history_.size() > turn_start) {
+        history_.erase(history_.begin() + static_cast<std::ptrdiff_t>(turn_start),
+                       history_.end());
+        history_changed(turn_start);
+    }
+    last_prompt_tokens_.reset();
+
+    if (event_bus_ && stream_started) {
+        StreamEndEvent ev;
+        ev.session_id = session_id_;
+        event_bus_->publish(ev);
+    }
+    std::cerr << "[agent] Turn cancelled"
+              << (session_id_.empty() ? "" : " for " + session_id_) << "\n";
+    return kStoppedReply;
+}
+
 uint32_t Agent::estimated_tokens() const {
     // Prefer real provider-reported prompt usage when available.
     if (last_prompt_tokens_) {
@@ -397,16 +604,97 @@ uint32_t Agent::estimated_tokens() const {
     return total;
 }
 
+Agent::Status Agent::status() const {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    return status_;
+}
+
+void Agent::publish_status() {
+    Status s{provider_->provider_name(), model_, history_.size(), estimated_tokens()};
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_ = std::move(s);
+}
+
+size_t Agent::history_bytes() const {
+    size_t total = 0;
+    for (const auto& msg : history_) {
+        total += sizeof(ChatMessage) + msg.content.size();
+        if (msg.name) total += msg.name->size();
+        if (msg.tool_call_id) total += msg.tool_call_id->size();
+    }
+    return total;
+}
+
 void Agent::clear_history() {
     history_.clear();
+    history_changed(0);
     system_prompt_injected_ = false;
     last_prompt_tokens_.reset();
+    publish_status();
+}
+
+nlohmann::json Agent::snapshot() const {
+    nlohmann::json history = nlohmann::json::array();
+    for (const auto& msg : history_) {
+        if (msg.role == Role::System) continue; // rebuilt on restore
+        nlohmann::json m = {{"role", role_to_string(msg.role)}, {"content", msg.content}};
+        if (msg.name) m["name"] = *msg.name;
+        if (msg.tool_call_id) m["tool_call_id"] = *msg.tool_call_id;
+        history.push_back(std::move(m));
+    }
+    return {
+        {"version", 1},
+        {"provider", provider_->provider_name()},
+        {"model", model_},
+        {"active_skill", active_skill_name_},
+        {"turns_since_synthesis", turns_since_synthesis_},
+        {"hatching", hatching_},
+        {"history", std::move(history)}
+    };
+}
+
+void Agent::restore(const nlohmann::json& snap) {
+    if (!snap.is_object()) return;
+
+    history_.clear();
+    history_changed(0);
+    system_prompt_injected_ = false;
+    last_prompt_tokens_.reset();
+
+    if (snap.contains("history") && snap["history"].is_array()) {
+        for (const auto& m : snap["history"]) {
+            if (!m.is_object() || !m.contains("content") || !m["content"].is_string())
+                continue;
+            ChatMessage msg{role_from_string(m.value("role", "user")),
+                            m["content"].get<std::string>(), {}, {}};
+            if (msg.role == Role::System) continue;
+            if (m.contains("name") && m["name"].is_string())
+                msg.name = m["name"].get<std::string>();
+            if (m.contains("tool_call_id") && m["tool_call_id"].is_string())
+                msg.tool_call_id = m["tool_call_id"].get<std::string>();
+            history_.push_back(std::move(msg));
+        }
+    }
+    if (snap.contains("model") && snap["model"].is_string())
+        model_ = snap["model"].get<std::string>();
+    if (snap.contains("active_skill") && snap["active_skill"].is_string()) {
+        auto name = snap["active_skill"].get<std::string>();
+        // Skill may have been removed while the session was hibernated
+        active_skill_name_ = find_skill(name) ? name : "";
+    }
+    if (snap.contains("turns_since_synthesis") &&
+        snap["turns_since_synthesis"].is_number_unsigned())
+        turns_since_synthesis_ = snap["turns_since_synthesis"].get<uint32_t>();
+    if (snap.contains("hatching") && snap["hatching"].is_boolean())
+        hatching_ = snap["hatching"].get<bool>();
+    publish_status();
 }
 
 void Agent::invalidate_system_prompt() {
     if (system_prompt_injected_ && !history_.empty()) {
         if (history_[0].role == Role::System) {
             history_.erase(history_.begin());
+            history_changed(0);
         }
         system_prompt_injected_ = false;
     }
@@ -415,11 +703,13 @@ void Agent::invalidate_system_prompt() {
 void Agent::set_model(const std::string& model) {
     model_ = model;
     invalidate_system_prompt();
+    publish_status();
 }
 
 void Agent::set_provider(std::unique_ptr<Provider> provider) {
     provider_ = std::move(provider);
     invalidate_system_prompt();
+    publish_status();
 }
 
 std::string Agent::provider_name() const {
@@ -501,7 +791,7 @@ void Agent::on_skill_request(const SkillRequestEvent& req) {
     event_bus_->publish(resp);
 }
 
-void Agent::set_response_cache(std::unique_ptr<ResponseCache> cache) {
+void Agent::set_response_cache(std::shared_ptr<ResponseCache> cache) {
     response_cache_ = std::move(cache);
 }
 
@@ -512,10 +802,17 @@ void Agent::set_embedder(Embedder* embedder) {
                               config_.memory.embeddings.text_weight,
                               config_.memory.embeddings.vector_weight);
     }
+    if (response_cache_ && config_.memory.semantic_cache) {
+        SemanticCacheOptions options;
+        options.threshold = config_.memory.semantic_cache_threshold;
+        options.near_hit = config_.memory.semantic_cache_near_hit;
+        response_cache_->set_embedder(embedder_, options);
+    }
 }
 
 void Agent::run_synthesis() {
     if (!has_active_memory() || !config_.memory.synthesis) return;
+    TraceSpan span("synthesis", session_id_, "memory");
 
     // Collect recent user+assistant messages for synthesis
     // Strip [Memory context] blocks from user messages so the synthesis LLM
@@ -581,12 +878,13 @@ void Agent::maybe_synthesize() {
     run_synthesis();
 }
 
-void Agent::compact_history() {
-    uint32_t tokens = estimated_tokens();
-    auto threshold = static_cast<uint32_t>(config_.agent.token_limit * 0.75);
+uint32_t Agent::compaction_threshold() const {
+    return static_cast<uint32_t>(config_.agent.token_limit * 0.75);
+}
 
+void Agent::compact_history() {
     bool should_compact = history_.size() > config_.agent.max_history_messages ||
-                          tokens > threshold;
+                          estimated_tokens() > compaction_threshold();
 
     if (!should_compact || history_.size() <= 12) return;
 
@@ -647,6 +945,7 @@ void Agent::compact_history() {
     }
 
     history_ = std::move(compacted);
+    history_changed(0);
     std::cerr << "[compact] History compacted to " << history_.size() << " messages\n";
 
     // Run memory hygiene when compaction triggers
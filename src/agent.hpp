@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 namespace ptrclaw {
 
@@ -25,9 +26,31 @@ public:
     // Process a user message and return the assistant's final text reply
     std::string process(const std::string& user_message);
 
+    // Reply returned by process() when its turn was cancelled
+    static constexpr const char* kStoppedReply = "[Stopped]";
+
+    // Cooperative cancellation for process(): checked between provider calls
+    // and tool batches, and installed as the thread's HTTP abort flag so an
+    // in-flight provider request aborts too. A cancelled turn is rolled back.
+    void set_cancellation_token(CancellationToken token) { turn_token_ = std::move(token); }
+
     // Get current history size
     size_t history_size() const { return history_.size(); }
 
+    // Consistent view of the agent for commands that run concurrently with
+    // process() on another thread (/status, /models). Refreshed at every
+    // tool-loop iteration boundary and after each mutation.
+    struct Status {
+        std::string provider;
+        std::string model;
+        size_t history_size = 0;
+        uint32_t estimated_tokens = 0;
+    };
+    Status status() const;
+
+    // Approximate heap footprint of the history (message text bytes)
+    size_t history_bytes() const;
+
     // Get estimated token usage
     uint32_t estimated_tokens() const;
 
@@ -53,7 +76,7 @@ public:
     Memory* memory() const { return memory_.get(); }
 
     // Response cache
-    void set_response_cache(std::unique_ptr<ResponseCache> cache);
+    void set_response_cache(std::shared_ptr<ResponseCache> cache);
 
     // Embedder for vector search (non-owning, caller retains ownership)
     void set_embedder(Embedder* embedder);
@@ -70,19 +93,42 @@ public:
     void start_hatch();
     bool hatching() const { return hatching_; }
 
+    // Hibernation: compact snapshot of conversational state (history without
+    // the system prompt, active skill, model/provider, synthesis counter).
+    // restore() re-injects the system prompt lazily on the next process().
+    nlohmann::json snapshot() const;
+    void restore(const nlohmann::json& snap);
+
+    // Rolling FNV-1a hash of the full history. Kept per message, so only
+    // messages appended since the last call are hashed.
+    uint64_t history_hash();
+
 private:
     bool has_active_memory() const;
     void compact_history();
+    // Estimated tokens above which compact_history() shrinks the history
+    uint32_t compaction_threshold() const;
+    std::string stop_turn(size_t turn_start, bool stream_started);
     void inject_system_prompt();
     void invalidate_system_prompt();
+    void publish_status();
     const SkillDef* find_skill(const std::string& name) const;
     void run_synthesis();
     void maybe_synthesize();
     void on_tools_available(const std::vector<ToolSpec>& specs);
     void on_skill_request(const SkillRequestEvent& req);
+    // Drop rolling hashes from message `from` on; called wherever history_
+    // changes other than by appending
+    void history_changed(size_t from);
+    // Cache key for a provider call: history, model and offered tools
+    uint64_t provider_call_key(const std::vector<ToolSpec>& tool_specs);
+    // Replace a memoized tool result with a reference to the identical
+    // earlier result, if that is still in history
+    void refer_to_earlier_result(ChatMessage& msg, const std::string& memo_of) const;
 
     std::unique_ptr<Provider> provider_;
     std::vector<ChatMessage> history_;
+    std::vector<uint64_t> history_hashes_;  // [i] covers history_[0..i]
     std::vector<ToolSpec> cached_tool_specs_;
     Config config_;
     std::string model_;
@@ -94,13 +140,16 @@ private:
     std::string channel_;
     std::string binary_path_;
     std::unique_ptr<Memory> memory_;
-    std::unique_ptr<ResponseCache> response_cache_;
+    std::shared_ptr<ResponseCache> response_cache_;  // shared by all sessions
     Embedder* embedder_ = nullptr;
     uint32_t turns_since_synthesis_ = 0;
     bool hatching_ = false;
     std::vector<SkillDef> available_skills_;
     std::string active_skill_name_;
     std::optional<uint32_t> last_prompt_tokens_;
+    CancellationToken turn_token_;
+    mutable std::mutex status_mutex_;
+    Status status_;
 };
 
 } // namespace ptrclaw
@@ -0,0 +1,90 @@
+#include "aho_corasick.hpp"
+#include <cctype>
+#include <stdexcept>
+
+namespace ptrclaw {
+
+AhoCorasick::AhoCorasick(const std::vector<std::string_view>& patterns, bool ignore_case) {
+    auto fold = [ignore_case](char c) {
+        auto b = static_cast<uint8_t>(c);
+        return ignore_case ? static_cast<uint8_t>(std::tolower(b)) : b;
+    };
+
+    // Byte classes: 0 for bytes no pattern uses, then one per distinct byte
+    for (auto pattern : patterns) {
+        if (pattern.empty()) throw std::invalid_argument("AhoCorasick: empty pattern");
+        for (char c : pattern) {
+            uint8_t b = fold(c);
+            if (byte_class_[b] != 0) continue;
+            if (num_classes_ == 256) throw std::invalid_argument("AhoCorasick: too many byte classes");
+            byte_class_[b] = static_cast<uint8_t>(num_classes_++);
+        }
+    }
+    if (ignore_case) {
+        for (int b = 'A'; b <= 'Z'; b++) byte_class_[b] = byte_class_[std::tolower(b)];
+    }
+
+    // Trie; trie[state * classes + class] is 0 where there is no edge
+    // (the root is never a child, so 0 is free to mean "none")
+    std::vector<uint32_t> trie(num_classes_, 0);
+    std::vector<std::vector<uint32_t>> own(1);
+    lengths_.reserve(patterns.size());
+    for (uint32_t p = 0; p < patterns.size(); p++) {
+        uint32_t state = 0;
+        for (char c : patterns[p]) {
+            size_t slot = static_cast<size_t>(state) * num_classes_ + byte_class_[fold(c)];
+            if (trie[slot] == 0) {
+                trie[slot] = static_cast<uint32_t>(own.size());
+                own.emplace_back();
+                trie.resize(trie.size() + num_classes_, 0);
+            }
+            state = trie[slot];
+        }
+        own[state].push_back(p);
+        lengths_.push_back(static_cast<uint32_t>(patterns[p].size()));
+    }
+
+    // Breadth-first: each state's failure link is shallower, so its
+    // transitions and outputs are complete by the time they are copied
+    auto states = static_cast<uint32_t>(own.size());
+    delta_.assign(static_cast<size_t>(states) * num_classes_, 0);
+    std::vector<uint32_t> fail(states, 0);
+    std::vector<std::vector<uint32_t>> outputs(states);
+    std::vector<uint32_t> queue;
+    queue.reserve(states);
+
+    for (uint32_t c = 0; c < num_classes_; c++) {
+        uint32_t child = trie[c];
+        delta_[c] = child;
+        if (child != 0) queue.push_back(child);
+    }
+    outputs[0] = own[0];
+
+    for (size_t head = 0; head < queue.size(); head++) {
+        uint32_t state = queue[head];
+        outputs[state] = own[state];
+        const auto& inherited = outputs[fail[state]];
+        outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+
+        for (uint32_t c = 0; c < num_classes_; c++) {
+            uint32_t child = trie[static_cast<size_t>(state) * num_classes_ + c];
+            uint32_t via_fail = delta_[static_cast<size_t>(fail[state]) * num_classes_ + c];
+            if (child != 0) {
+                fail[child] = via_fail;
+                delta_[static_cast<size_t>(state) * num_classes_ + c] = child;
+                queue.push_back(child);
+            } else {
+                delta_[static_cast<size_t>(state) * num_classes_ + c] = via_fail;
+            }
+        }
+    }
+
+    out_begin_.reserve(states + 1);
+    for (const auto& out : outputs) {
+        out_begin_.push_back(static_cast<uint32_t>(out_.size()));
+        out_.insert(out_.end(), out.begin(), out.end());
+    }
+    out_begin_.push_back(static_cast<uint32_t>(out_.size()));
+}
+
+} // namespace ptrclaw
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ptrclaw {
+
+// Multi-pattern matcher: finds every occurrence of every pattern in one
+// left-to-right pass, whatever the number of patterns. Build once (e.g. as
+// a function-local static) and share; scanning is const and thread-safe.
+//
+// The automaton is a full DFA over byte classes (each byte that occurs in
+// a pattern gets a class, all other bytes share one), so scanning costs one
+// table lookup per input byte.
+class AhoCorasick {
+public:
+    explicit AhoCorasick(const std::vector<std::string_view>& patterns,
+                         bool ignore_case = false);
+
+    // Calls on_match(pattern_index, begin_offset) for each occurrence, in
+    // order of where it ends. Returns true as soon as on_match does.
+    template <typename OnMatch>
+    bool scan(std::string_view text, OnMatch&& on_match) const {
+        uint32_t state = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            state = delta_[state * num_classes_ + byte_class_[static_cast<uint8_t>(text[i])]];
+            for (uint32_t k = out_begin_[state]; k < out_begin_[state + 1]; k++) {
+                uint32_t pattern = out_[k];
+                if (on_match(pattern, i + 1 - lengths_[pattern])) return true;
+            }
+        }
+        return false;
+    }
+
+    // True if any pattern occurs in `text`
+    bool contains_any(std::string_view text) const {
+        return scan(text, [](uint32_t, size_t) { return true; });
+    }
+
+    size_t pattern_count() const { return lengths_.size(); }
+
+private:
+    std::array<uint8_t, 256> byte_class_{};
+    uint32_t num_classes_ = 1;
+    std::vector<uint32_t> delta_;       // state * num_classes_ + class -> state
+    std::vector<uint32_t> out_begin_;   // state -> first entry in out_
+    std::vector<uint32_t> out_;         // patterns ending at each state
+    std::vector<uint32_t> lengths_;     // pattern -> length
+};
+
+} // namespace ptrclaw
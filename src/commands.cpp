@@ -13,20 +13,21 @@
 namespace ptrclaw {
 
 std::string cmd_status(const Agent& agent) {
-    return "Provider: " + agent.provider_name() + "\n"
-        + "Model: " + agent.model() + "\n"
-        + "History: " + std::to_string(agent.history_size()) + " messages\n"
-        + "Estimated tokens: " + std::to_string(agent.estimated_tokens()) + "\n";
+    auto status = agent.status();
+    return "Provider: " + status.provider + "\n"
+        + "Model: " + status.model + "\n"
+        + "History: " + std::to_string(status.history_size) + " messages\n"
+        + "Estimated tokens: " + std::to_string(status.estimated_tokens) + "\n";
 }
 
 std::string cmd_models(const Agent& agent, const Config& config) {
-    std::string auth_mode = auth_mode_label(
-        agent.provider_name(), agent.model(), config);
-    std::string result = "Current: " + agent.provider_name()
-        + " \xe2\x80\x94 " + agent.model()
+    auto status = agent.status();
+    std::string auth_mode = auth_mode_label(status.provider, status.model, config);
+    std::string result = "Current: " + status.provider
+        + " \xe2\x80\x94 " + status.model
         + " (" + auth_mode + ")\n\nProviders:\n";
 
-    auto infos = list_providers(config, agent.provider_name());
+    auto infos = list_providers(config, status.provider);
     for (const auto& info : infos) {
         result += "  " + info.name + " \xe2\x80\x94 ";
         if (info.has_api_key) result += "API key";
@@ -179,6 +180,9 @@ std::string cmd_help(bool dev, bool channel) {
         result += "  /soul            Show current soul/identity data\n";
     }
     result += "  /hatch           Create or re-create assistant identity\n";
+    if (channel) {
+        result += "  /stop            Cancel the reply in progress\n";
+    }
     if (!channel) {
         result +=
             "  /onboard         Run setup wizard\n"
@@ -36,7 +36,20 @@ nlohmann::json Config::defaults_json() {
             {"token_limit", 128000},
             {"disable_streaming", false},
             {"tee_mode", "off"},
-            {"tool_timeout", 120}
+            {"tool_timeout", 120},
+            {"interrupt", false},
+            {"tool_memo_entries", 256},
+            {"tool_output_min_tokens", 1000},
+            {"tool_output_max_tokens", 16000},
+            {"tool_workers", 8},
+            {"tool_queue", 256},
+            {"tool_class_limits", {{"shell", 1}, {"write", 1}}},
+            {"shell_persistent", false},
+            {"shell_cpu_seconds", 0},
+            {"shell_memory_mb", 0},
+            {"shell_open_files", 0},
+            {"shell_output_bytes", 67108864},
+            {"shell_cgroup", ""}
         }},
         {"channels", {
             {"telegram", {{"bot_token", ""}, {"allow_from", nlohmann::json::array()}, {"reply_in_private", true}, {"proxy", ""}}},
@@ -54,6 +67,10 @@ nlohmann::json Config::defaults_json() {
             {"response_cache", false},
             {"cache_ttl", 3600},
             {"cache_max_entries", 100},
+            {"cache_category_ttl", {{"realtime", 600}}},
+            {"semantic_cache", false},
+            {"semantic_cache_threshold", 0.95},
+            {"semantic_cache_near_hit", 0.85},
             {"enrich_depth", 1},
             {"synthesis", true},
             {"synthesis_interval", 5},
@@ -68,6 +85,23 @@ nlohmann::json Config::defaults_json() {
                 {"text_weight", 0.4},
                 {"vector_weight", 0.6}
             }}
+        }},
+        {"sessions", {
+            {"max_idle_seconds", 3600},
+            {"max_resident", 0},
+            {"memory_budget_bytes", 0},
+            {"hibernate", true},
+            {"hibernate_dir", ""},
+            {"workers", 4},
+            {"coalesce_ms", 0}
+        }},
+        {"trace", {
+            {"enabled", false},
+            {"path", "~/.ptrclaw/trace.json"}
+        }},
+        {"metrics", {
+            {"enabled", false},
+            {"listen", "127.0.0.1:9464"}
         }}
     };
 }
@@ -169,6 +203,37 @@ Config Config::load() {
         }
         if (a.contains("tool_timeout") && a["tool_timeout"].is_number_unsigned())
             cfg.agent.tool_timeout = a["tool_timeout"].get<uint32_t>();
+        if (a.contains("interrupt") && a["interrupt"].is_boolean())
+            cfg.agent.interrupt = a["interrupt"].get<bool>();
+        if (a.contains("tool_memo_entries") && a["tool_memo_entries"].is_number_unsigned())
+            cfg.agent.tool_memo_entries = a["tool_memo_entries"].get<uint32_t>();
+        if (a.contains("tool_output_min_tokens") && a["tool_output_min_tokens"].is_number_unsigned())
+            cfg.agent.tool_output_min_tokens = a["tool_output_min_tokens"].get<uint32_t>();
+        if (a.contains("tool_output_max_tokens") && a["tool_output_max_tokens"].is_number_unsigned())
+            cfg.agent.tool_output_max_tokens = a["tool_output_max_tokens"].get<uint32_t>();
+        if (a.contains("tool_workers") && a["tool_workers"].is_number_unsigned())
+            cfg.agent.tool_workers = a["tool_workers"].get<uint32_t>();
+        if (a.contains("tool_queue") && a["tool_queue"].is_number_unsigned())
+            cfg.agent.tool_queue = a["tool_queue"].get<uint32_t>();
+        if (a.contains("tool_class_limits") && a["tool_class_limits"].is_object()) {
+            cfg.agent.tool_class_limits.clear();
+            for (auto& [cls, limit] : a["tool_class_limits"].items()) {
+                if (limit.is_number_unsigned())
+                    cfg.agent.tool_class_limits[cls] = limit.get<uint32_t>();
+            }
+        }
+        if (a.contains("shell_persistent") && a["shell_persistent"].is_boolean())
+            cfg.agent.shell_persistent = a["shell_persistent"].get<bool>();
+        if (a.contains("shell_cpu_seconds") && a["shell_cpu_seconds"].is_number_unsigned())
+            cfg.agent.shell_cpu_seconds = a["shell_cpu_seconds"].get<uint32_t>();
+        if (a.contains("shell_memory_mb") && a["shell_memory_mb"].is_number_unsigned())
+            cfg.agent.shell_memory_mb = a["shell_memory_mb"].get<uint32_t>();
+        if (a.contains("shell_open_files") && a["shell_open_files"].is_number_unsigned())
+            cfg.agent.shell_open_files = a["shell_open_files"].get<uint32_t>();
+        if (a.contains("shell_output_bytes") && a["shell_output_bytes"].is_number_unsigned())
+            cfg.agent.shell_output_bytes = a["shell_output_bytes"].get<uint64_t>();
+        if (a.contains("shell_cgroup") && a["shell_cgroup"].is_string())
+            cfg.agent.shell_cgroup = a["shell_cgroup"].get<std::string>();
     }
 
     // Channel configurations — store raw JSON per channel name
@@ -198,6 +263,19 @@ Config Config::load() {
             cfg.memory.cache_ttl = m["cache_ttl"].get<uint32_t>();
         if (m.contains("cache_max_entries") && m["cache_max_entries"].is_number_unsigned())
             cfg.memory.cache_max_entries = m["cache_max_entries"].get<uint32_t>();
+        if (m.contains("cache_category_ttl") && m["cache_category_ttl"].is_object()) {
+            cfg.memory.cache_category_ttl.clear();
+            for (auto& [category, ttl] : m["cache_category_ttl"].items()) {
+                if (ttl.is_number_unsigned())
+                    cfg.memory.cache_category_ttl[category] = ttl.get<uint32_t>();
+            }
+        }
+        if (m.contains("semantic_cache") && m["semantic_cache"].is_boolean())
+            cfg.memory.semantic_cache = m["semantic_cache"].get<bool>();
+        if (m.contains("semantic_cache_threshold") && m["semantic_cache_threshold"].is_number())
+            cfg.memory.semantic_cache_threshold = m["semantic_cache_threshold"].get<double>();
+        if (m.contains("semantic_cache_near_hit") && m["semantic_cache_near_hit"].is_number())
+            cfg.memory.semantic_cache_near_hit = m["semantic_cache_near_hit"].get<double>();
         if (m.contains("enrich_depth") && m["enrich_depth"].is_number_unsigned())
             cfg.memory.enrich_depth = m["enrich_depth"].get<uint32_t>();
         if (m.contains("synthesis") && m["synthesis"].is_boolean())
@@ -227,6 +305,43 @@ Config Config::load() {
         }
     }
 
+    // Session lifecycle configuration
+    if (j.contains("sessions") && j["sessions"].is_object()) {
+        auto& s = j["sessions"];
+        if (s.contains("max_idle_seconds") && s["max_idle_seconds"].is_number_unsigned())
+            cfg.sessions.max_idle_seconds = s["max_idle_seconds"].get<uint32_t>();
+        if (s.contains("max_resident") && s["max_resident"].is_number_unsigned())
+            cfg.sessions.max_resident = s["max_resident"].get<uint32_t>();
+        if (s.contains("memory_budget_bytes") && s["memory_budget_bytes"].is_number_unsigned())
+            cfg.sessions.memory_budget_bytes = s["memory_budget_bytes"].get<uint64_t>();
+        if (s.contains("hibernate") && s["hibernate"].is_boolean())
+            cfg.sessions.hibernate = s["hibernate"].get<bool>();
+        if (s.contains("hibernate_dir") && s["hibernate_dir"].is_string())
+            cfg.sessions.hibernate_dir = s["hibernate_dir"].get<std::string>();
+        if (s.contains("workers") && s["workers"].is_number_unsigned())
+            cfg.sessions.workers = s["workers"].get<uint32_t>();
+        if (s.contains("coalesce_ms") && s["coalesce_ms"].is_number_unsigned())
+            cfg.sessions.coalesce_ms = s["coalesce_ms"].get<uint32_t>();
+    }
+
+    // Turn timeline tracing
+    if (j.contains("trace") && j["trace"].is_object()) {
+        auto& t = j["trace"];
+        if (t.contains("enabled") && t["enabled"].is_boolean())
+            cfg.trace.enabled = t["enabled"].get<bool>();
+        if (t.contains("path") && t["path"].is_string())
+            cfg.trace.path = t["path"].get<std::string>();
+    }
+
+    // Prometheus metrics endpoint
+    if (j.contains("metrics") && j["metrics"].is_object()) {
+        auto& m = j["metrics"];
+        if (m.contains("enabled") && m["enabled"].is_boolean())
+            cfg.metrics.enabled = m["enabled"].get<bool>();
+        if (m.contains("listen") && m["listen"].is_string())
+            cfg.metrics.listen = m["listen"].get<std::string>();
+    }
+
     // Environment variables always override config file
     if (const char* v = std::getenv("ANTHROPIC_API_KEY"))
         cfg.providers["anthropic"].api_key = v;
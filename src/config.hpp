@@ -28,6 +28,42 @@ struct AgentConfig {
     bool disable_streaming = false;
     std::string tee_mode = "off";  // "off", "failures", "always"
     uint32_t tool_timeout = 120;   // seconds, 0 = no timeout
+    bool interrupt = false;        // new message cancels the in-flight turn
+    uint32_t tool_memo_entries = 256;  // memoized pure tool results, 0 = off
+    // Bounds on one tool result's share of the free context, in tokens
+    uint32_t tool_output_min_tokens = 1000;
+    uint32_t tool_output_max_tokens = 16000;
+    uint32_t tool_workers = 8;         // shared tool pool threads
+    uint32_t tool_queue = 256;         // queued calls before publishers block, 0 = unbounded
+    // Per-session running limit by Tool::concurrency_class(), 0 = unlimited
+    std::unordered_map<std::string, uint32_t> tool_class_limits = {{"shell", 1}, {"write", 1}};
+    bool shell_persistent = false;     // one long-lived shell per session
+    // Per-command shell budgets, 0 / empty = none
+    uint32_t shell_cpu_seconds = 0;
+    uint32_t shell_memory_mb = 0;
+    uint32_t shell_open_files = 0;
+    uint64_t shell_output_bytes = 64ull << 20;
+    std::string shell_cgroup;          // cgroup v2 directory to run commands in
+};
+
+struct SessionConfig {
+    uint32_t max_idle_seconds = 3600;  // idle time before a session leaves RAM
+    uint32_t max_resident = 0;         // 0 = unlimited in-memory sessions
+    uint64_t memory_budget_bytes = 0;  // 0 = unlimited; sum of history bytes
+    bool hibernate = true;             // snapshot evicted sessions to disk
+    std::string hibernate_dir;         // empty = ~/.ptrclaw/sessions
+    uint32_t workers = 4;              // channel-mode turn worker threads
+    uint32_t coalesce_ms = 0;          // 0 = off; merge bursts into one turn
+};
+
+struct TraceConfig {
+    bool enabled = false;                          // or --trace FILE
+    std::string path = "~/.ptrclaw/trace.json";    // Chrome/Perfetto JSON
+};
+
+struct MetricsConfig {
+    bool enabled = false;                   // serve GET /metrics
+    std::string listen = "127.0.0.1:9464";  // host:port
 };
 
 struct EmbeddingConfig {
@@ -52,6 +88,11 @@ struct MemoryConfig {
     bool response_cache = false;
     uint32_t cache_ttl = 3600;
     uint32_t cache_max_entries = 100;
+    // Per-category TTL overrides (see cache_category()); others use cache_ttl
+    std::unordered_map<std::string, uint32_t> cache_category_ttl = {{"realtime", 600}};
+    bool semantic_cache = false;             // match paraphrases via embeddings
+    double semantic_cache_threshold = 0.95;  // cosine similarity for a hit
+    double semantic_cache_near_hit = 0.85;   // log misses above this for tuning
     uint32_t enrich_depth = 1;          // 0 = flat, 1 = follow links
     bool synthesis = true;
     uint32_t synthesis_interval = 5;    // synthesize every N user messages
@@ -73,6 +114,9 @@ struct Config {
     AgentConfig agent;
     std::unordered_map<std::string, nlohmann::json> channels;
     MemoryConfig memory;
+    SessionConfig sessions;
+    TraceConfig trace;
+    MetricsConfig metrics;
 
     // Load from ~/.ptrclaw/config.json + env vars
     static Config load();
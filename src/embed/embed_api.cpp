@@ -125,7 +125,6 @@ struct PtrClawHandle_ {
 // ── Background event loop (mirrors run_channel in main.cpp) ─────
 
 static void embed_loop(PtrClawHandle_* h) {
-    uint32_t poll_count = 0;
     while (!h->shutdown.load()) {
         auto messages = h->channel->poll_updates();
         for (auto& msg : messages) {
@@ -134,9 +133,7 @@ static void embed_loop(PtrClawHandle_* h) {
             ev.message = std::move(msg);
             h->bus->publish(ev);
         }
-        if (++poll_count % 100 == 0) {
-            h->sessions->evict_idle(3600);
-        }
+        h->sessions->evict_idle();
     }
 }
 
@@ -11,8 +11,11 @@ namespace ptrclaw {
 // Tag-based event dispatch — no RTTI, no dynamic_cast.
 // Events are stack-allocated structs; never deleted through base pointer.
 
+enum class EventId : uint8_t;
+
 struct Event {
     const char* type_tag;
+    EventId type_id;  // indexes EventBus subscriber lists
 };
 
 // ── Event tags ──────────────────────────────────────────────────
@@ -33,60 +36,105 @@ namespace event_tags {
     constexpr const char* SkillRequest     = "SkillRequest";
     constexpr const char* SkillResponse    = "SkillResponse";
     constexpr const char* StreamEnd        = "StreamEnd";
+    constexpr const char* ToolCallProgress = "ToolCallProgress";
+    constexpr const char* TurnStart        = "TurnStart";
 } // namespace event_tags
 
+// ── Event IDs ───────────────────────────────────────────────────
+// Dense compile-time IDs, one per tag, so dispatch is an array index.
+
+enum class EventId : uint8_t {
+    MessageReceived,
+    MessageReady,
+    ProviderRequest,
+    ProviderResponse,
+    ToolCallRequest,
+    ToolCallResult,
+    SessionCreated,
+    SessionEvicted,
+    StreamStart,
+    StreamChunk,
+    ToolsAvailable,
+    ToolCallCancel,
+    SkillRequest,
+    SkillResponse,
+    StreamEnd,
+    ToolCallProgress,
+    TurnStart,
+    Count
+};
+
+constexpr size_t kEventIdCount = static_cast<size_t>(EventId::Count);
+
+// Map a tag string to its ID (EventId::Count if unknown)
+EventId event_id_from_tag(const std::string& tag);
+
 // ── Event structs ───────────────────────────────────────────────
 
 struct MessageReceivedEvent : Event {
     static constexpr const char* TAG = event_tags::MessageReceived;
+    static constexpr EventId ID = EventId::MessageReceived;
     std::string session_id;
     ChannelMessage message;
 
-    MessageReceivedEvent() { type_tag = TAG; }
+    MessageReceivedEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct MessageReadyEvent : Event {
     static constexpr const char* TAG = event_tags::MessageReady;
+    static constexpr EventId ID = EventId::MessageReady;
     std::string session_id;
     std::string reply_target;
     std::string content;
+    uint64_t turn_id = 0;  // TurnStartEvent this answers; 0 for command replies
 
-    MessageReadyEvent() { type_tag = TAG; }
+    MessageReadyEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct ProviderRequestEvent : Event {
     static constexpr const char* TAG = event_tags::ProviderRequest;
+    static constexpr EventId ID = EventId::ProviderRequest;
     std::string session_id;
     std::string model;
     size_t message_count = 0;
     size_t tool_count = 0;
 
-    ProviderRequestEvent() { type_tag = TAG; }
+    ProviderRequestEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct ProviderResponseEvent : Event {
     static constexpr const char* TAG = event_tags::ProviderResponse;
+    static constexpr EventId ID = EventId::ProviderResponse;
     std::string session_id;
     std::string model;
     bool has_tool_calls = false;
     TokenUsage usage;
+    // The call threw or the turn was stopped: no response (every
+    // ProviderRequestEvent is followed by one of these either way)
+    bool failed = false;
 
-    ProviderResponseEvent() { type_tag = TAG; }
+    ProviderResponseEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct ToolCallRequestEvent : Event {
     static constexpr const char* TAG = event_tags::ToolCallRequest;
+    static constexpr EventId ID = EventId::ToolCallRequest;
     std::string session_id;
     std::string batch_id;
     std::string tool_name;
     std::string tool_call_id;
     std::string arguments_json;
+    // Context tokens left for the results of the whole batch (0 = unknown,
+    // use the default output limits) and the number of calls sharing them
+    uint32_t token_budget = 0;
+    uint32_t batch_size = 1;
 
-    ToolCallRequestEvent() { type_tag = TAG; }
+    ToolCallRequestEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct ToolCallResultEvent : Event {
     static constexpr const char* TAG = event_tags::ToolCallResult;
+    static constexpr EventId ID = EventId::ToolCallResult;
     std::string session_id;
     std::string batch_id;
     std::string tool_call_id;
@@ -95,80 +143,121 @@ struct ToolCallResultEvent : Event {
     std::string output;
     uint32_t raw_tokens = 0;
     uint32_t filtered_tokens = 0;
+    bool memoized = false;     // served from ToolManager's memo, not executed
+    std::string memo_of;       // tool_call_id that originally produced it
+
+    ToolCallResultEvent() { type_tag = TAG; type_id = ID; }
+};
+
+// Output produced so far by a running tool call, published at most every
+// ToolManager::kProgressIntervalMs. `delta` is new since the previous event
+// (only its last ToolManager::kMaxProgressBytes when more was produced).
+struct ToolCallProgressEvent : Event {
+    static constexpr const char* TAG = event_tags::ToolCallProgress;
+    static constexpr EventId ID = EventId::ToolCallProgress;
+    std::string session_id;
+    std::string batch_id;
+    std::string tool_call_id;
+    std::string tool_name;
+    std::string delta;
+    uint64_t total_bytes = 0;   // output reported so far, including delta
+    uint32_t elapsed_ms = 0;    // since the call started
 
-    ToolCallResultEvent() { type_tag = TAG; }
+    ToolCallProgressEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct ToolCallCancelEvent : Event {
     static constexpr const char* TAG = event_tags::ToolCallCancel;
+    static constexpr EventId ID = EventId::ToolCallCancel;
     std::string batch_id;  // cancel all tool calls in this batch
 
-    ToolCallCancelEvent() { type_tag = TAG; }
+    ToolCallCancelEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct ToolsAvailableEvent : Event {
     static constexpr const char* TAG = event_tags::ToolsAvailable;
+    static constexpr EventId ID = EventId::ToolsAvailable;
     std::string session_id;
     std::vector<ToolSpec> specs;
 
-    ToolsAvailableEvent() { type_tag = TAG; }
+    ToolsAvailableEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct SessionCreatedEvent : Event {
     static constexpr const char* TAG = event_tags::SessionCreated;
+    static constexpr EventId ID = EventId::SessionCreated;
     std::string session_id;
 
-    SessionCreatedEvent() { type_tag = TAG; }
+    SessionCreatedEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct SessionEvictedEvent : Event {
     static constexpr const char* TAG = event_tags::SessionEvicted;
+    static constexpr EventId ID = EventId::SessionEvicted;
     std::string session_id;
 
-    SessionEvictedEvent() { type_tag = TAG; }
+    SessionEvictedEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct StreamStartEvent : Event {
     static constexpr const char* TAG = event_tags::StreamStart;
+    static constexpr EventId ID = EventId::StreamStart;
     std::string session_id;
     std::string model;
 
-    StreamStartEvent() { type_tag = TAG; }
+    StreamStartEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct StreamChunkEvent : Event {
     static constexpr const char* TAG = event_tags::StreamChunk;
+    static constexpr EventId ID = EventId::StreamChunk;
     std::string session_id;
     std::string delta;
 
-    StreamChunkEvent() { type_tag = TAG; }
+    StreamChunkEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct SkillRequestEvent : Event {
     static constexpr const char* TAG = event_tags::SkillRequest;
+    static constexpr EventId ID = EventId::SkillRequest;
     std::string session_id;
     std::string request_id;  // correlate with response
     std::string action;      // "activate", "deactivate", "list"
     std::string name;        // skill name (for activate)
 
-    SkillRequestEvent() { type_tag = TAG; }
+    SkillRequestEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct SkillResponseEvent : Event {
     static constexpr const char* TAG = event_tags::SkillResponse;
+    static constexpr EventId ID = EventId::SkillResponse;
     std::string request_id;
     bool success = false;
     std::string message;
     std::vector<std::string> available_skills;
 
-    SkillResponseEvent() { type_tag = TAG; }
+    SkillResponseEvent() { type_tag = TAG; type_id = ID; }
 };
 
 struct StreamEndEvent : Event {
     static constexpr const char* TAG = event_tags::StreamEnd;
+    static constexpr EventId ID = EventId::StreamEnd;
     std::string session_id;
 
-    StreamEndEvent() { type_tag = TAG; }
+    StreamEndEvent() { type_tag = TAG; type_id = ID; }
+};
+
+// A message (or a coalesced burst of them) starts running through the
+// agent. Published on the thread that runs the turn, before any of its
+// stream or tool events; the turn's reply carries the same turn_id.
+struct TurnStartEvent : Event {
+    static constexpr const char* TAG = event_tags::TurnStart;
+    static constexpr EventId ID = EventId::TurnStart;
+    std::string session_id;
+    std::string reply_target;
+    uint64_t turn_id = 0;
+
+    TurnStartEvent() { type_tag = TAG; type_id = ID; }
 };
 
 } // namespace ptrclaw
@@ -1,54 +1,313 @@
 #include "event_bus.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <iostream>
 
 namespace ptrclaw {
 
-uint64_t EventBus::subscribe(const std::string& tag, EventHandler handler) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    uint64_t id = next_id_++;
-    handlers_[tag].push_back(Subscription{id, std::move(handler)});
-    return id;
+// Indexed by EventId — keep in the same order as the enum
+static constexpr std::array<const char*, kEventIdCount> kEventTags = {
+    event_tags::MessageReceived,
+    event_tags::MessageReady,
+    event_tags::ProviderRequest,
+    event_tags::ProviderResponse,
+    event_tags::ToolCallRequest,
+    event_tags::ToolCallResult,
+    event_tags::SessionCreated,
+    event_tags::SessionEvicted,
+    event_tags::StreamStart,
+    event_tags::StreamChunk,
+    event_tags::ToolsAvailable,
+    event_tags::ToolCallCancel,
+    event_tags::SkillRequest,
+    event_tags::SkillResponse,
+    event_tags::StreamEnd,
+    event_tags::ToolCallProgress,
+    event_tags::TurnStart,
+};
+
+EventId event_id_from_tag(const std::string& tag) {
+    for (size_t i = 0; i < kEventTags.size(); i++) {
+        if (tag == kEventTags[i]) return static_cast<EventId>(i);
+    }
+    return EventId::Count;
 }
 
-bool EventBus::unsubscribe(uint64_t id) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& [tag, subs] : handlers_) {
-        for (auto it = subs.begin(); it != subs.end(); ++it) {
-            if (it->id == id) {
-                subs.erase(it);
-                return true;
+// Subscription IDs carry their event type in the low byte
+static constexpr unsigned kTypeBits = 8;
+static_assert(kEventIdCount < (1u << kTypeBits), "EventId must fit the ID's type byte");
+
+// ── AsyncQueue ──────────────────────────────────────────────────
+
+AsyncQueue::AsyncQueue(AsyncOptions options)
+    : options_(options)
+{
+    if (options_.capacity == 0) options_.capacity = 1;
+    stats_.capacity = options_.capacity;
+    if (!options_.name.empty()) {
+        auto& m = metrics();
+        std::string label = metric_label("subscriber", options_.name);
+        depth_gauge_ = &m.event_queue_depth.labels(label);
+        auto events = [&](const char* result) {
+            return &m.event_queue_events.labels(
+                metric_labels("subscriber", options_.name, "result", result));
+        };
+        delivered_counter_ = events("delivered");
+        dropped_counter_ = events("dropped");
+        coalesced_counter_ = events("coalesced");
+    }
+    worker_ = std::thread([this] { run(); });
+}
+
+AsyncQueue::~AsyncQueue() {
+    close();
+    if (worker_.joinable()) worker_.join();
+}
+
+void AsyncQueue::push(AsyncTask task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) return;
+
+    // Only the latest event per key matters; replace it where it waits
+    if (options_.overflow == OverflowPolicy::CoalesceByKey) {
+        for (auto& queued : queue_) {
+            if (queued.key == task.key) {
+                queued.run = std::move(task.run);
+                stats_.coalesced++;
+                if (coalesced_counter_) coalesced_counter_->inc();
+                return;
             }
         }
     }
-    return false;
+
+    if (queue_.size() >= options_.capacity) {
+        if (options_.overflow == OverflowPolicy::Block) {
+            not_full_.wait(lock, [this] {
+                return closed_ || queue_.size() < options_.capacity;
+            });
+            if (closed_) return;
+        } else {
+            queue_.pop_front();
+            stats_.dropped++;
+            if (dropped_counter_) dropped_counter_->inc();
+            add_depth(-1);
+        }
+    }
+
+    queue_.push_back(std::move(task));
+    add_depth(1);
+    not_empty_.notify_one();
 }
 
-void EventBus::publish(const Event& event) {
-    // Copy handlers out under lock, then call without lock held.
-    std::vector<EventHandler> to_call;
+void AsyncQueue::close() {
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto it = handlers_.find(event.type_tag);
-        if (it == handlers_.end()) return;
-        to_call.reserve(it->second.size());
-        for (const auto& sub : it->second) {
-            to_call.push_back(sub.handler);
+        closed_ = true;
+        add_depth(-static_cast<int64_t>(queue_.size()));
+        queue_.clear();
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+}
+
+void AsyncQueue::wait_finished() {
+    if (std::this_thread::get_id() == worker_.get_id()) return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopped_.wait(lock, [this] { return finished_.load(); });
+}
+
+void AsyncQueue::add_depth(int64_t n) {
+    if (depth_gauge_ && n != 0) depth_gauge_->add(n);
+}
+
+AsyncStats AsyncQueue::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AsyncStats s = stats_;
+    s.depth = queue_.size();
+    return s;
+}
+
+void AsyncQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+        if (closed_) break;
+        AsyncTask task = std::move(queue_.front());
+        queue_.pop_front();
+        add_depth(-1);
+        not_full_.notify_one();
+        lock.unlock();
+        try {
+            task.run();
+        } catch (const std::exception& e) {
+            std::cerr << "[event_bus] Async handler threw: " << e.what() << "\n";
+        } catch (...) {
+            std::cerr << "[event_bus] Async handler threw\n";
         }
+        lock.lock();
+        stats_.delivered++;
+        if (delivered_counter_) delivered_counter_->inc();
+    }
+    finished_ = true;
+    stopped_.notify_all();
+}
+
+// ── EventBus ────────────────────────────────────────────────────
+
+EventBus::~EventBus() {
+    {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        for (auto& [id, queue] : async_queues_) queue->close();
+    }
+    for (auto& slot : lists_) delete slot.load();
+    for (const auto* list : retired_) delete list;
+}
+
+uint64_t EventBus::subscribe(EventId type, EventHandler handler) {
+    auto index = static_cast<size_t>(type);
+    if (index >= kEventIdCount) return 0;
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    uint64_t id = (next_seq_++ << kTypeBits) | index;
+    const auto* current = lists_[index].load(std::memory_order_acquire);
+    auto* next = current ? new SubscriberList(*current) : new SubscriberList();
+    next->push_back(Subscription{id, std::move(handler)});
+    replace_list(index, next);
+    return id;
+}
+
+uint64_t EventBus::subscribe(const std::string& tag, EventHandler handler) {
+    return subscribe(event_id_from_tag(tag), std::move(handler));
+}
+
+uint64_t EventBus::subscribe_async(EventId type,
+                                   std::function<AsyncTask(const Event&)> capture,
+                                   AsyncOptions options) {
+    if (static_cast<size_t>(type) >= kEventIdCount) return 0;
+    auto queue = std::make_shared<AsyncQueue>(options);
+    uint64_t id = subscribe(type, [queue, c = std::move(capture)](const Event& e) {
+        queue->push(c(e));
+    });
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    async_queues_[id] = std::move(queue);
+    return id;
+}
+
+std::optional<AsyncStats> EventBus::async_stats(uint64_t id) const {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto it = async_queues_.find(id);
+    if (it == async_queues_.end()) return std::nullopt;
+    return it->second->stats();
+}
+
+std::shared_ptr<AsyncQueue> EventBus::close_async(uint64_t id) {
+    // Drop queues whose worker has exited; joining those is immediate
+    closed_queues_.erase(
+        std::remove_if(closed_queues_.begin(), closed_queues_.end(),
+                       [](const auto& q) { return q->finished(); }),
+        closed_queues_.end());
+
+    auto it = async_queues_.find(id);
+    if (it == async_queues_.end()) return nullptr;
+    auto queue = std::move(it->second);
+    async_queues_.erase(it);
+    queue->close();
+    closed_queues_.push_back(queue);
+    return queue;
+}
+
+bool EventBus::unsubscribe(uint64_t id) {
+    auto index = static_cast<size_t>(id & ((1u << kTypeBits) - 1));
+    if (index >= kEventIdCount) return false;
+
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    const auto* current = lists_[index].load(std::memory_order_acquire);
+    if (!current) return false;
+    auto* next = new SubscriberList();
+    next->reserve(current->size());
+    for (const auto& sub : *current) {
+        if (sub.id != id) next->push_back(sub);
+    }
+    if (next->size() == current->size()) {
+        delete next;
+        return false;
+    }
+    if (next->empty()) {
+        delete next;
+        next = nullptr;
     }
-    for (const auto& handler : to_call) {
-        handler(event);
+    replace_list(index, next);
+    auto queue = close_async(id);
+    lock.unlock();
+    // Outside write_mutex_: the handler may itself subscribe or unsubscribe
+    if (queue) queue->wait_finished();
+    return true;
+}
+
+void EventBus::publish(const Event& event) {
+    auto index = static_cast<size_t>(event.type_id);
+    if (index >= kEventIdCount) return;
+
+    // The reader count pins every snapshot loaded while it is non-zero;
+    // the last reader out frees snapshots retired in the meantime
+    struct ReadGuard {
+        EventBus& bus;
+        explicit ReadGuard(EventBus& b) : bus(b) { bus.readers_.fetch_add(1); }
+        ~ReadGuard() {
+            if (bus.readers_.fetch_sub(1) == 1 &&
+                bus.has_retired_.load(std::memory_order_acquire)) {
+                std::unique_lock<std::mutex> lock(bus.write_mutex_, std::try_to_lock);
+                if (lock.owns_lock()) bus.reclaim();
+            }
+        }
+    } guard(*this);
+
+    const auto* list = lists_[index].load();
+    if (!list) return;
+    for (const auto& sub : *list) {
+        sub.handler(event);
     }
 }
 
 void EventBus::clear() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    handlers_.clear();
+    std::unique_lock<std::mutex> lock(write_mutex_);
+    for (size_t i = 0; i < kEventIdCount; i++) {
+        replace_list(i, nullptr);
+    }
+    std::vector<uint64_t> ids;
+    ids.reserve(async_queues_.size());
+    for (const auto& [id, queue] : async_queues_) ids.push_back(id);
+    std::vector<std::shared_ptr<AsyncQueue>> closed;
+    for (uint64_t id : ids) closed.push_back(close_async(id));
+    lock.unlock();
+    for (auto& queue : closed) queue->wait_finished();
 }
 
 size_t EventBus::subscriber_count(const std::string& tag) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = handlers_.find(tag);
-    if (it == handlers_.end()) return 0;
-    return it->second.size();
+    auto index = static_cast<size_t>(event_id_from_tag(tag));
+    if (index >= kEventIdCount) return 0;
+    // Snapshots are only freed under write_mutex_
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const auto* list = lists_[index].load(std::memory_order_acquire);
+    return list ? list->size() : 0;
+}
+
+void EventBus::replace_list(size_t type, const SubscriberList* next) {
+    const auto* prev = lists_[type].exchange(next);
+    if (prev) {
+        retired_.push_back(prev);
+        has_retired_.store(true, std::memory_order_release);
+    }
+    reclaim();
+}
+
+void EventBus::reclaim() {
+    // Every snapshot in retired_ was unlinked before this check, so a
+    // publish() that starts after it can only see current snapshots
+    if (retired_.empty() || readers_.load() != 0) return;
+    for (const auto* list : retired_) delete list;
+    retired_.clear();
+    has_retired_.store(false, std::memory_order_release);
 }
 
 } // namespace ptrclaw
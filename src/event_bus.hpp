@@ -1,29 +1,142 @@
 #pragma once
 #include "event.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <vector>
 #include <functional>
-#include <unordered_map>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <cstdint>
 
 namespace ptrclaw {
 
+class Counter;
+class Gauge;
+
 using EventHandler = std::function<void(const Event&)>;
 
+// ── Async subscriptions ─────────────────────────────────────────
+
+// What an async subscription does when its queue is full
+enum class OverflowPolicy {
+    Block,          // publisher waits for room (lossless)
+    DropOldest,     // discard the oldest queued event
+    CoalesceByKey,  // replace a queued event with the same key in place;
+                    // when full and no key matches, drops the oldest.
+                    // Needs a key function.
+};
+
+struct AsyncOptions {
+    size_t capacity = 256;
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    // Subscriber label for the ptrclaw_event_queue_* metrics; unnamed
+    // queues are not exported
+    std::string name;
+};
+
+struct AsyncStats {
+    size_t depth = 0;          // events currently queued
+    size_t capacity = 0;
+    uint64_t delivered = 0;    // handler invocations completed
+    uint64_t dropped = 0;      // discarded by DropOldest (or its fallback)
+    uint64_t coalesced = 0;    // replaced in place by CoalesceByKey
+};
+
+// A captured event: `run` delivers the copy, `key` drives coalescing
+struct AsyncTask {
+    std::string key;
+    std::function<void()> run;
+};
+
+// Bounded queue drained by its own thread. One per async subscription.
+class AsyncQueue {
+public:
+    explicit AsyncQueue(AsyncOptions options);
+    ~AsyncQueue();
+    AsyncQueue(const AsyncQueue&) = delete;
+    AsyncQueue& operator=(const AsyncQueue&) = delete;
+
+    void push(AsyncTask task);
+    // Stop accepting events, discard pending ones and wake the worker
+    void close();
+    AsyncStats stats() const;
+    // True once the worker thread has exited (joining is then immediate)
+    bool finished() const { return finished_.load(); }
+    // Wait for a closed queue's worker to exit, so its handler is no longer
+    // running. Returns at once when called from the worker itself.
+    void wait_finished();
+
+private:
+    void run();
+    void add_depth(int64_t n);
+
+    AsyncOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::condition_variable stopped_;
+    std::deque<AsyncTask> queue_;
+    AsyncStats stats_;
+    // Exported copies of stats_ (null for unnamed queues)
+    Gauge* depth_gauge_ = nullptr;
+    Counter* delivered_counter_ = nullptr;
+    Counter* dropped_counter_ = nullptr;
+    Counter* coalesced_counter_ = nullptr;
+    bool closed_ = false;
+    std::atomic<bool> finished_{false};
+    std::thread worker_;
+};
+
+// Subscriber lists are copy-on-write snapshots indexed by EventId.
+// publish() takes no lock and allocates nothing: it loads the current
+// snapshot and calls through it. subscribe/unsubscribe (rare) build a new
+// snapshot under a writer mutex; replaced snapshots are freed once no
+// publish() that may still be reading them is in flight.
 class EventBus {
 public:
-    // Subscribe to events with a given tag. Returns a subscription ID.
+    EventBus() = default;
+    ~EventBus();
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    // Subscribe to events of a given type. Returns a subscription ID.
+    uint64_t subscribe(EventId type, EventHandler handler);
+
+    // Subscribe by tag string. Returns 0 if the tag is unknown.
     uint64_t subscribe(const std::string& tag, EventHandler handler);
 
-    // Unsubscribe by ID. Returns true if found and removed.
+    // Asynchronous subscription: `capture` copies the event on the
+    // publisher's thread, the copy is delivered on the subscription's own
+    // thread. With OverflowPolicy::Block a handler must not publish an
+    // event of its own type, or it can wait on itself. For CoalesceByKey,
+    // `capture` sets each task's key.
+    uint64_t subscribe_async(EventId type,
+                             std::function<AsyncTask(const Event&)> capture,
+                             AsyncOptions options = {});
+
+    // Queue counters for an async subscription (nullopt if not async)
+    std::optional<AsyncStats> async_stats(uint64_t id) const;
+
+    // Unsubscribe by ID. Returns true if found and removed. The event type
+    // is encoded in the ID, so only that type's list is touched. An async
+    // subscription's queued events are discarded and, unless called from
+    // its own handler, this waits for a running handler to return.
     bool unsubscribe(uint64_t id);
 
     // Publish an event synchronously. Handlers called in registration order.
-    // Mutex is released before calling handlers to avoid deadlocks.
+    // Handlers may subscribe/unsubscribe/publish re-entrantly; changes take
+    // effect from the next publish.
     void publish(const Event& event);
 
-    // Remove all subscriptions.
+    // Remove all subscriptions (waiting for async handlers as unsubscribe
+    // does).
     void clear();
 
     // Number of subscriptions for a given tag (0 if none).
@@ -34,18 +147,58 @@ private:
         uint64_t id;
         EventHandler handler;
     };
+    using SubscriberList = std::vector<Subscription>;
 
-    mutable std::mutex mutex_;
-    std::unordered_map<std::string, std::vector<Subscription>> handlers_;
-    uint64_t next_id_ = 1;
+    // Swap in a new snapshot for `type` and retire the old one.
+    // Caller holds write_mutex_.
+    void replace_list(size_t type, const SubscriberList* next);
+    // Free retired snapshots if no publish() is in flight.
+    // Caller holds write_mutex_.
+    void reclaim();
+    // Close an async subscription's queue and return it (null if `id` is
+    // not async). Caller holds write_mutex_.
+    std::shared_ptr<AsyncQueue> close_async(uint64_t id);
+
+    std::array<std::atomic<const SubscriberList*>, kEventIdCount> lists_{};
+    std::atomic<uint32_t> readers_{0};        // publish() calls in flight
+    std::atomic<bool> has_retired_{false};
+
+    mutable std::mutex write_mutex_;
+    std::vector<const SubscriberList*> retired_;
+    uint64_t next_seq_ = 1;
+    std::unordered_map<uint64_t, std::shared_ptr<AsyncQueue>> async_queues_;
+    // Closed queues are kept until their worker exits, so a handler that
+    // unsubscribes itself never ends up joining its own thread
+    std::vector<std::shared_ptr<AsyncQueue>> closed_queues_;
 };
 
+
 // Type-safe subscribe helper: auto-casts Event& to the concrete type.
 template<typename E>
 uint64_t subscribe(EventBus& bus, std::function<void(const E&)> handler) {
-    return bus.subscribe(E::TAG, [h = std::move(handler)](const Event& e) {
+    return bus.subscribe(E::ID, [h = std::move(handler)](const Event& e) {
         h(static_cast<const E&>(e));
     });
 }
 
+// Typed async subscribe. `key` is only consulted by CoalesceByKey, which
+// throws std::invalid_argument without one.
+template<typename E>
+uint64_t subscribe_async(EventBus& bus, std::function<void(const E&)> handler,
+                         AsyncOptions options = {},
+                         std::function<std::string(const E&)> key = {}) {
+    if (options.overflow == OverflowPolicy::CoalesceByKey && !key) {
+        throw std::invalid_argument("subscribe_async: CoalesceByKey needs a key function");
+    }
+    auto h = std::make_shared<std::function<void(const E&)>>(std::move(handler));
+    return bus.subscribe_async(E::ID,
+        [h, k = std::move(key)](const Event& e) {
+            auto copy = std::make_shared<E>(static_cast<const E&>(e));
+            AsyncTask task;
+            if (k) task.key = k(*copy);
+            task.run = [h, copy] { (*h)(*copy); };
+            return task;
+        }, options);
+}
+
 } // namespace ptrclaw
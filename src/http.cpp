@@ -6,6 +6,7 @@
 namespace ptrclaw {
 
 static const std::atomic<bool>* g_http_abort_flag = nullptr;
+static thread_local const std::atomic<bool>* t_http_abort_flag = nullptr;
 
 void http_init() {
     curl_global_init(CURL_GLOBAL_ALL);
@@ -19,17 +20,29 @@ void http_set_abort_flag(const std::atomic<bool>* flag) {
     g_http_abort_flag = flag;
 }
 
+void http_set_thread_abort_flag(const std::atomic<bool>* flag) {
+    t_http_abort_flag = flag;
+}
+
+const std::atomic<bool>* http_thread_abort_flag() {
+    return t_http_abort_flag;
+}
+
 // Called by curl ~once per second; return non-zero to abort the transfer.
+// Runs on the thread that called curl_easy_perform, so the thread-local
+// flag is the one installed by the caller.
 static int abort_progress_cb(void* /*clientp*/,
                               curl_off_t /*dltotal*/, curl_off_t /*dlnow*/,
                               curl_off_t /*ultotal*/, curl_off_t /*ulnow*/) {
     if (g_http_abort_flag && g_http_abort_flag->load(std::memory_order_relaxed))
         return 1;
+    if (t_http_abort_flag && t_http_abort_flag->load(std::memory_order_relaxed))
+        return 1;
     return 0;
 }
 
 static void apply_abort_hook(CURL* curl) {
-    if (g_http_abort_flag) {
+    if (g_http_abort_flag || t_http_abort_flag) {
         curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
         curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, abort_progress_cb);
     }
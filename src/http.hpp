@@ -18,6 +18,24 @@ void http_cleanup();
 // When the flag becomes true, in-flight HTTP requests abort promptly.
 void http_set_abort_flag(const std::atomic<bool>* flag);
 
+// Per-thread abort flag, checked in addition to the global one. Lets a
+// single session cancel its own in-flight provider call (see /stop).
+void http_set_thread_abort_flag(const std::atomic<bool>* flag);
+const std::atomic<bool>* http_thread_abort_flag();
+
+// RAII: install a thread abort flag for the current scope.
+class HttpAbortScope {
+public:
+    explicit HttpAbortScope(const std::atomic<bool>* flag)
+        : prev_(http_thread_abort_flag()) { http_set_thread_abort_flag(flag); }
+    ~HttpAbortScope() { http_set_thread_abort_flag(prev_); }
+    HttpAbortScope(const HttpAbortScope&) = delete;
+    HttpAbortScope& operator=(const HttpAbortScope&) = delete;
+
+private:
+    const std::atomic<bool>* prev_;
+};
+
 using Header = std::pair<std::string, std::string>;
 
 struct HttpResponse {
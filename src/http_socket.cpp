@@ -47,6 +47,10 @@
 namespace ptrclaw {
 
 static const std::atomic<bool>* g_socket_abort_flag = nullptr;
+static thread_local const std::atomic<bool>* t_socket_abort_flag = nullptr;
+
+// Receive timeout used as the abort polling interval for blocking reads
+static constexpr long kAbortPollMs = 100;
 
 void http_init() {}
 void http_cleanup() {}
@@ -55,6 +59,21 @@ void http_set_abort_flag(const std::atomic<bool>* flag) {
     g_socket_abort_flag = flag;
 }
 
+void http_set_thread_abort_flag(const std::atomic<bool>* flag) {
+    t_socket_abort_flag = flag;
+}
+
+const std::atomic<bool>* http_thread_abort_flag() {
+    return t_socket_abort_flag;
+}
+
+static bool abort_requested() {
+    return (g_socket_abort_flag &&
+            g_socket_abort_flag->load(std::memory_order_relaxed)) ||
+           (t_socket_abort_flag &&
+            t_socket_abort_flag->load(std::memory_order_relaxed));
+}
+
 // ── URL parsing ────────────────────────────────────────────────
 
 struct ParsedUrl {
@@ -100,6 +119,12 @@ static void set_socket_timeout(int fd, long secs) {
     setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
 }
 
+static void set_socket_timeout_ms(int fd, long ms) {
+    struct timeval tv{ms / 1000, static_cast<suseconds_t>((ms % 1000) * 1000)};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
 // Non-blocking TCP connect with timeout.  Sets fd on success.
 static bool connect_tcp(int& fd, const ParsedUrl& url, long timeout_secs) {
     struct addrinfo hints{};
@@ -148,9 +173,7 @@ static bool connect_tcp(int& fd, const ParsedUrl& url, long timeout_secs) {
 // EAGAIN loops back so the caller can check abort.
 static ssize_t plain_read(int fd, char* buf, size_t len) {
     while (true) {
-        if (g_socket_abort_flag &&
-            g_socket_abort_flag->load(std::memory_order_relaxed))
-            return -1;
+        if (abort_requested()) return -1;
         ssize_t n = ::recv(fd, buf, len, 0);
         if (n > 0) return n;
         if (n == 0) return 0;
@@ -291,16 +314,14 @@ struct Connection {
             tls_active_ = true;
         }
 
-        set_socket_timeout(fd, 1);
+        set_socket_timeout_ms(fd, kAbortPollMs);
         return true;
     }
 
     ssize_t read_some(char* buf, size_t len) {
         if (!tls_active_) return plain_read(fd, buf, len);
         while (true) {
-            if (g_socket_abort_flag &&
-                g_socket_abort_flag->load(std::memory_order_relaxed))
-                return -1;
+            if (abort_requested()) return -1;
             int n = mbedtls_ssl_read(&ssl_, reinterpret_cast<unsigned char*>(buf),
                                       len);
             if (n > 0) return n;
@@ -368,16 +389,14 @@ struct Connection {
             if (SSL_connect(ssl) != 1) return false;
         }
 
-        set_socket_timeout(fd, 1);
+        set_socket_timeout_ms(fd, kAbortPollMs);
         return true;
     }
 
     ssize_t read_some(char* buf, size_t len) {
         if (!ssl) return plain_read(fd, buf, len);
         while (true) {
-            if (g_socket_abort_flag &&
-                g_socket_abort_flag->load(std::memory_order_relaxed))
-                return -1;
+            if (abort_requested()) return -1;
             ssize_t n = SSL_read(ssl, buf, static_cast<int>(len));
             if (n > 0) return n;
             if (n == 0) return 0;
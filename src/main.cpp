@@ -10,11 +10,17 @@
 #include "tool_manager.hpp"
 #include "session.hpp"
 #include "stream_relay.hpp"
+#include "trace.hpp"
 #include "onboard.hpp"
 #include "util.hpp"
 #ifdef PTRCLAW_HAS_EMBEDDINGS
 #include "embedder.hpp"
 #endif
+#ifdef PTRCLAW_HAS_METRICS
+#include "metrics.hpp"
+#include "channels/webhook_server.hpp"
+#endif
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <cstring>
@@ -87,6 +93,7 @@ static void print_usage() {
               << "  --provider NAME      Use specific provider (anthropic, openai, ollama, openrouter)\n"
               << "  --model NAME         Use specific model\n"
               << "  --dev                Enable developer-only commands (e.g. /soul)\n"
+              << "  --trace FILE         Write a Chrome/Perfetto trace of agent turns\n"
               << "  -h, --help           Show this help\n"
               << "\n"
               << "Interactive commands:\n"
@@ -124,6 +131,7 @@ int main(int argc, char* argv[]) try {
     std::string model_name;
     std::string channel_name;
     std::string notify_spec;
+    std::string trace_path;
     bool dev_mode = false;
 
     for (int i = 1; i < argc; i++) {
@@ -142,6 +150,8 @@ int main(int argc, char* argv[]) try {
             channel_name = argv[++i];
         } else if (std::strcmp(argv[i], "--dev") == 0) {
             dev_mode = true;
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
         } else {
             std::cerr << "Unknown option: " << argv[i] << "\n";
             print_usage();
@@ -178,6 +188,10 @@ int main(int argc, char* argv[]) try {
     if (!model_name.empty()) {
         config.model = model_name;
     }
+    if (!trace_path.empty()) {
+        config.trace.enabled = true;
+        config.trace.path = trace_path;
+    }
 
     ptrclaw::PlatformHttpClient http_client;
 
@@ -190,6 +204,40 @@ int main(int argc, char* argv[]) try {
 
     // ── Shared infrastructure for all modes ─────────────────────────
     ptrclaw::EventBus bus;
+
+    // Declared before sessions so it outlives them and sees their last events
+    std::unique_ptr<ptrclaw::TraceRecorder> tracer;
+    if (config.trace.enabled) {
+        tracer = std::make_unique<ptrclaw::TraceRecorder>(
+            ptrclaw::expand_home(config.trace.path));
+        if (tracer->is_open()) {
+            tracer->attach(bus);
+            tracer->install();
+        }
+    }
+
+#ifdef PTRCLAW_HAS_METRICS
+    std::unique_ptr<ptrclaw::WebhookServer> metrics_server;
+    if (config.metrics.enabled) {
+        metrics_server = std::make_unique<ptrclaw::WebhookServer>(
+            config.metrics.listen, 0,
+            [](const ptrclaw::WebhookRequest& req) -> ptrclaw::WebhookResponse {
+                if (req.method != "GET" || req.path != "/metrics") {
+                    return {404, "text/plain", "Not Found"};
+                }
+                return {200, "text/plain; version=0.0.4",
+                        ptrclaw::metrics().registry.render()};
+            });
+        std::string error;
+        if (metrics_server->start(error)) {
+            std::cerr << "[metrics] Serving /metrics on " << config.metrics.listen << "\n";
+        } else {
+            std::cerr << "[metrics] " << error << "\n";
+            metrics_server.reset();
+        }
+    }
+#endif
+
     ptrclaw::SessionManager sessions(config, http_client);
     sessions.set_binary_path(binary_path);
     sessions.set_event_bus(&bus);
@@ -244,8 +292,9 @@ int main(int argc, char* argv[]) try {
         // SessionManager subscribes last — runs after channel handler sets up
         // typing + stream state
         sessions.subscribe_events();
+        // Turns run on workers so /stop can reach an in-flight turn
+        sessions.start_workers(std::max<uint32_t>(1, config.sessions.workers));
 
-        uint32_t poll_count = 0;
         std::cerr << "[" << channel_name << "] Bot started. Polling for messages...\n";
 
         while (!g_shutdown.load()) {
@@ -257,13 +306,13 @@ int main(int argc, char* argv[]) try {
                 bus.publish(ev);
             }
 
-            // Periodic session eviction
-            if (++poll_count % 100 == 0) {
-                sessions.evict_idle(3600);
-            }
+            // Idle eviction is O(expired) via the session timer wheel,
+            // so it is cheap enough to run on every poll iteration
+            sessions.evict_idle();
         }
 
         std::cerr << "[" << channel_name << "] Shutting down.\n";
+        sessions.stop_workers(); // before relay goes out of scope
         return 0;
     }
 
@@ -56,6 +56,11 @@ public:
     // Count entries, optionally filtered by category.
     virtual uint32_t count(std::optional<MemoryCategory> category_filter) = 0;
 
+    // Changes on every write (store/upsert, forget, import, purge, link,
+    // unlink), including writes through other connections to a shared
+    // store. Recall results are reused only while it is unchanged.
+    virtual uint64_t generation() = 0;
+
     // Export all entries as a JSON string.
     virtual std::string snapshot_export() = 0;
 
@@ -23,6 +23,7 @@ protected:
     double knowledge_survival_chance_ = 0.05;
     std::mt19937 rng_{std::random_device{}()};
     std::uniform_real_distribution<double> dist_{0.0, 1.0};
+    uint64_t generation_ = 0;  // writes through this instance, under mutex_
 
 public:
     void set_embedder(Embedder* embedder, double tw = 0.4,
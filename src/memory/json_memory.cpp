@@ -179,6 +179,7 @@ std::string JsonMemory::store(const std::string& key, const std::string& content
         entry.timestamp = now;
         entry.last_accessed = now;
         entry.session_id = session_id;
+        generation_++;
         save();
         return entry.id;
     }
@@ -194,6 +195,7 @@ std::string JsonMemory::store(const std::string& key, const std::string& content
     entry.session_id = session_id;
     key_index_[key] = entries_.size();
     entries_.push_back(std::move(entry));
+    generation_++;
     save();
     return entries_.back().id;
 }
@@ -315,6 +317,7 @@ bool JsonMemory::forget(const std::string& key) {
     embeddings_.erase(key);
     entries_.erase(entries_.begin() + static_cast<ptrdiff_t>(idx_it->second));
     rebuild_index();
+    generation_++;
     save();
     return true;
 }
@@ -331,6 +334,12 @@ uint32_t JsonMemory::count(std::optional<MemoryCategory> category_filter) {
     return n;
 }
 
+uint64_t JsonMemory::generation() {
+    // Loaded once, so only writes through this instance change what it returns
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+}
+
 std::string JsonMemory::snapshot_export() {
     std::lock_guard<std::mutex> lock(mutex_);
 
@@ -364,7 +373,10 @@ uint32_t JsonMemory::snapshot_import(const std::string& json_str) {
             imported++;
         }
 
-        if (imported > 0) save();
+        if (imported > 0) {
+            generation_++;
+            save();
+        }
     } catch (...) { // NOLINT(bugprone-empty-catch)
     }
     return imported;
@@ -424,6 +436,7 @@ uint32_t JsonMemory::hygiene_purge(uint32_t max_age_seconds) {
             remove_links_to(purged_keys);
             rebuild_index();
         }
+        generation_++;
         save();
     }
 
@@ -449,6 +462,7 @@ bool JsonMemory::link(const std::string& from_key, const std::string& to_key) {
         to_entry.links.push_back(from_key);
     }
 
+    generation_++;
     save();
     return true;
 }
@@ -469,6 +483,7 @@ bool JsonMemory::unlink(const std::string& from_key, const std::string& to_key)
     if (fit != from_links.end()) from_links.erase(fit);
     if (tit != to_links.end()) to_links.erase(tit);
 
+    generation_++;
     save();
     return true;
 }
@@ -27,6 +27,8 @@ public:
 
     uint32_t count(std::optional<MemoryCategory> category_filter) override;
 
+    uint64_t generation() override;
+
     std::string snapshot_export() override;
 
     uint32_t snapshot_import(const std::string& json_str) override;
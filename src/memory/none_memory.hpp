@@ -21,6 +21,8 @@ public:
 
     uint32_t count(std::optional<MemoryCategory>) override { return 0; }
 
+    uint64_t generation() override { return 0; }
+
     std::string snapshot_export() override { return "[]"; }
 
     uint32_t snapshot_import(const std::string&) override { return 0; }
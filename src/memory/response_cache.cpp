@@ -1,16 +1,115 @@
 #include "response_cache.hpp"
+#include "../metrics.hpp"
 #include "../util.hpp"
 #include <nlohmann/json.hpp>
+#include <array>
+#include <cctype>
 #include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
 #include <algorithm>
 
 namespace ptrclaw {
 
+std::string cache_category(const std::string& query) {
+    static const std::array<const char*, 14> kRealtime = {
+        "today", "tonight", "tomorrow", "yesterday", "right now", "currently",
+        "latest", "weather", "forecast", "news", "price", "stock", "score",
+        "time is it",
+    };
+    std::string lower = query;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    for (const char* word : kRealtime) {
+        if (lower.find(word) != std::string::npos) return "realtime";
+    }
+    return "default";
+}
+
+// Semantic matches never cross models or system prompts
+static uint64_t compute_scope(const std::string& model, const std::string& system_prompt) {
+    return fnv1a(system_prompt, fnv1a(model) ^ 0x01);
+}
+
+static std::string preview(const std::string& text) {
+    constexpr size_t kMax = 60;
+    std::string out = text.size() > kMax ? text.substr(0, kMax) + "..." : text;
+    std::replace(out.begin(), out.end(), '\n', ' ');
+    return out;
+}
+
+static bool expired(const CacheEntry& entry, uint64_t now) {
+    return (now - entry.timestamp) > entry.ttl;
+}
+
+static nlohmann::json entry_to_json(uint64_t key, const CacheEntry& entry) {
+    nlohmann::json item = {
+        {"key_hash",    key},
+        {"response",    entry.response},
+        {"timestamp",   entry.timestamp},
+        {"ttl",         entry.ttl},
+        {"scope",       entry.scope}
+    };
+    if (!entry.embedding.empty()) {
+        item["query"] = entry.query;
+        item["embedding"] = entry.embedding;
+    }
+    return item;
+}
+
+static CacheEntry entry_from_json(const nlohmann::json& item, uint32_t default_ttl) {
+    CacheEntry entry;
+    entry.response = item.value("response", std::string{});
+    entry.timestamp = item.value("timestamp", uint64_t{0});
+    entry.last_access = item.value("last_access", entry.timestamp);
+    entry.ttl = item.value("ttl", default_ttl);
+    entry.scope = item.value("scope", uint64_t{0});
+    entry.query = item.value("query", std::string{});
+    if (item.contains("embedding") && item["embedding"].is_array()) {
+        entry.embedding = item["embedding"].get<Embedding>();
+    }
+    return entry;
+}
+
 ResponseCache::ResponseCache(const std::string& path, uint32_t ttl_seconds, uint32_t max_entries)
     : path_(path), ttl_seconds_(ttl_seconds), max_entries_(max_entries) {
     load();
 }
 
+std::shared_ptr<ResponseCache> ResponseCache::shared(const std::string& path,
+                                                     uint32_t ttl_seconds,
+                                                     uint32_t max_entries) {
+    static std::mutex registry_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<ResponseCache>> registry;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto& slot = registry[path];
+    auto cache = slot.lock();
+    if (!cache) {
+        cache = std::make_shared<ResponseCache>(path, ttl_seconds, max_entries);
+        slot = cache;
+    }
+    return cache;
+}
+
+void ResponseCache::set_embedder(Embedder* embedder, SemanticCacheOptions options) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    embedder_ = embedder;
+    semantic_ = options;
+}
+
+void ResponseCache::set_category_ttl(const std::string& category, uint32_t ttl_seconds) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    category_ttl_[category] = ttl_seconds;
+}
+
+uint32_t ResponseCache::ttl_for(const std::string& query) const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    if (category_ttl_.empty()) return ttl_seconds_;
+    auto it = category_ttl_.find(cache_category(query));
+    return it != category_ttl_.end() ? it->second : ttl_seconds_;
+}
+
 uint64_t ResponseCache::compute_key(const std::string& model,
                                     const std::string& system_prompt,
                                     const std::string& user_message) const {
@@ -44,121 +143,363 @@ uint64_t ResponseCache::compute_key(const std::string& model,
     return hash;
 }
 
+// ── Lookup ───────────────────────────────────────────────────
+
+std::optional<std::string> ResponseCache::get(uint64_t key) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.nodes.find(key);
+    if (it == shard.nodes.end()) return std::nullopt;
+    uint64_t now = epoch_seconds();
+    if (expired(it->second.entry, now)) {
+        erase(shard, key);
+        return std::nullopt;
+    }
+    Node& node = it->second;
+    node.entry.last_access = now;
+    node.tick = ++tick_;
+    shard.lru.splice(shard.lru.begin(), shard.lru, node.lru_pos);
+    return node.entry.response;
+}
+
 std::optional<std::string> ResponseCache::get(const std::string& model,
                                                const std::string& system_prompt,
-                                               const std::string& user_message) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
+                                               const std::string& user_message,
+                                               const std::string& query) {
     uint64_t key = compute_key(model, system_prompt, user_message);
-    auto it = entries_.find(key);
-    if (it == entries_.end()) return std::nullopt;
+    if (auto hit = get(key)) return hit;
 
-    uint64_t now = epoch_seconds();
-    if ((now - it->second.timestamp) > ttl_seconds_) {
-        entries_.erase(it);
+    Embedder* embedder = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        embedder = embedder_;
+    }
+    if (!embedder) return std::nullopt;
+    return semantic_get(*embedder, key, compute_scope(model, system_prompt),
+                        query.empty() ? user_message : query);
+}
+
+std::optional<std::string> ResponseCache::semantic_get(Embedder& embedder, uint64_t key,
+                                                       uint64_t scope,
+                                                       const std::string& query) {
+    // Embedding is a network call: never under a lock
+    Embedding embedding;
+    try {
+        embedding = embedder.embed(query);
+    } catch (const std::exception& e) {
+        std::cerr << "[cache] Embedding failed: " << e.what() << "\n";
         return std::nullopt;
     }
+    if (embedding.empty()) return std::nullopt;
 
-    it->second.last_access = now;
-    return it->second.response;
+    SemanticCacheOptions options;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        options = semantic_;
+    }
+
+    uint64_t now = epoch_seconds();
+    uint64_t best_key = 0;
+    double best_sim = -1.0;
+    std::string best_response;
+    std::string best_query;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [k, node] : shard.nodes) {
+            const CacheEntry& entry = node.entry;
+            if (entry.scope != scope || entry.embedding.empty()) continue;
+            if (expired(entry, now)) continue;
+            double sim = cosine_similarity(embedding, entry.embedding);
+            if (sim > best_sim) {
+                best_sim = sim;
+                best_key = k;
+                best_response = entry.response;
+                best_query = entry.query;
+            }
+        }
+    }
+
+    if (best_sim >= options.threshold) {
+        Shard& shard = shard_for(best_key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.nodes.find(best_key);
+        if (it != shard.nodes.end()) {
+            it->second.entry.last_access = now;
+            it->second.tick = ++tick_;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru_pos);
+        }
+        metrics().response_cache.labels(metric_label("result", "semantic_hit")).inc();
+        return best_response;
+    }
+    if (best_sim >= options.near_hit) {
+        metrics().response_cache.labels(metric_label("result", "near_hit")).inc();
+        std::cerr << "[cache] Near hit " << best_sim << " (threshold "
+                  << options.threshold << "): \"" << preview(query)
+                  << "\" ~ \"" << preview(best_query) << "\"\n";
+    }
+
+    // Keep the embedding for the put() that normally follows this miss
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    constexpr size_t kMaxPending = 64;
+    if (shard.pending.size() >= kMaxPending) shard.pending.clear();
+    shard.pending[key] = std::move(embedding);
+    return std::nullopt;
 }
 
+// ── Insertion and eviction ───────────────────────────────────
+
 void ResponseCache::put(const std::string& model,
                         const std::string& system_prompt,
                         const std::string& user_message,
-                        const std::string& response) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
+                        const std::string& response,
+                        const std::string& query) {
     uint64_t key = compute_key(model, system_prompt, user_message);
-    uint64_t now = epoch_seconds();
+    const std::string& text = query.empty() ? user_message : query;
+    Shard& shard = shard_for(key);
+
+    Embedding embedding;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.pending.find(key);
+        if (it != shard.pending.end()) {
+            embedding = std::move(it->second);
+            shard.pending.erase(it);
+        }
+    }
+    Embedder* embedder = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        embedder = embedder_;
+    }
+    if (embedder && embedding.empty()) {
+        try {
+            embedding = embedder->embed(text);
+        } catch (const std::exception& e) {
+            std::cerr << "[cache] Embedding failed: " << e.what() << "\n";
+        }
+    }
 
-    entries_[key] = CacheEntry{response, now, now};
+    uint64_t now = epoch_seconds();
+    CacheEntry entry;
+    entry.response = response;
+    entry.timestamp = now;
+    entry.last_access = now;
+    entry.ttl = ttl_for(text);
+    entry.scope = compute_scope(model, system_prompt);
+    if (!embedding.empty()) {
+        entry.query = text;
+        entry.embedding = std::move(embedding);
+    }
 
-    evict();
-    save();
+    store(key, std::move(entry));
 }
 
-void ResponseCache::evict() {
-    // Must be called with mutex_ already held.
-
+void ResponseCache::put(uint64_t key, const std::string& response) {
     uint64_t now = epoch_seconds();
+    CacheEntry entry;
+    entry.response = response;
+    entry.timestamp = now;
+    entry.last_access = now;
+    entry.ttl = ttl_seconds_;
+    store(key, std::move(entry));
+}
 
-    // Remove TTL-expired entries first.
-    for (auto it = entries_.begin(); it != entries_.end(); ) {
-        if ((now - it->second.timestamp) > ttl_seconds_) {
-            it = entries_.erase(it);
-        } else {
-            ++it;
-        }
+void ResponseCache::store(uint64_t key, CacheEntry entry) {
+    std::string line = entry_to_json(key, entry).dump();
+    {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        insert(shard, key, std::move(entry));
     }
+    append_log(line);
+    evict_over_capacity();
+}
 
-    // If still over capacity, evict by oldest last_access.
-    if (entries_.size() > max_entries_) {
-        // Collect keys sorted by last_access ascending.
-        std::vector<std::pair<uint64_t, uint64_t>> key_access; // {last_access, key}
-        key_access.reserve(entries_.size());
-        for (const auto& [key, entry] : entries_) {
-            key_access.emplace_back(entry.last_access, key);
-        }
+void ResponseCache::insert(Shard& shard, uint64_t key, CacheEntry entry) {
+    auto it = shard.nodes.find(key);
+    if (it == shard.nodes.end()) {
+        shard.lru.push_front(key);
+        it = shard.nodes.emplace(key, Node{}).first;
+        it->second.lru_pos = shard.lru.begin();
+        count_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru_pos);
+    }
+    it->second.entry = std::move(entry);
+    it->second.tick = ++tick_;
+}
 
-        size_t to_remove = entries_.size() - max_entries_;
-        auto nth = key_access.begin() + static_cast<ptrdiff_t>(to_remove);
-        std::nth_element(key_access.begin(), nth, key_access.end());
+void ResponseCache::erase(Shard& shard, uint64_t key) {
+    auto it = shard.nodes.find(key);
+    if (it == shard.nodes.end()) return;
+    shard.lru.erase(it->second.lru_pos);
+    shard.nodes.erase(it);
+    count_.fetch_sub(1, std::memory_order_relaxed);
+}
 
-        for (auto it = key_access.begin(); it != nth; ++it) {
-            entries_.erase(it->second);
+void ResponseCache::evict_over_capacity() {
+    while (count_.load(std::memory_order_relaxed) > max_entries_) {
+        // The global LRU entry is the oldest of the shard tails
+        Shard* victim_shard = nullptr;
+        uint64_t victim_key = 0;
+        uint64_t oldest = UINT64_MAX;
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.lru.empty()) continue;
+            uint64_t tail = shard.lru.back();
+            uint64_t tick = shard.nodes.at(tail).tick;
+            if (tick < oldest) {
+                oldest = tick;
+                victim_shard = &shard;
+                victim_key = tail;
+            }
+        }
+        if (!victim_shard) return;
+        {
+            std::lock_guard<std::mutex> lock(victim_shard->mutex);
+            // Touched or removed since the scan: rescan
+            if (victim_shard->lru.empty() || victim_shard->lru.back() != victim_key) continue;
+            erase(*victim_shard, victim_key);
         }
+        append_log(nlohmann::json{{"op", "del"}, {"key_hash", victim_key}}.dump());
     }
 }
 
 uint32_t ResponseCache::size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return static_cast<uint32_t>(entries_.size());
+    return count_.load(std::memory_order_relaxed);
 }
 
 void ResponseCache::clear() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    entries_.clear();
-    save();
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count_.fetch_sub(static_cast<uint32_t>(shard.nodes.size()),
+                         std::memory_order_relaxed);
+        shard.nodes.clear();
+        shard.lru.clear();
+        shard.pending.clear();
+    }
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    compact_locked();
+}
+
+// ── Persistence ──────────────────────────────────────────────
+
+size_t ResponseCache::log_lines() const {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    return log_lines_;
 }
 
 void ResponseCache::load() {
     std::ifstream file(path_);
-    if (!file.is_open()) return;
-
-    try {
-        nlohmann::json j = nlohmann::json::parse(file);
-        if (!j.is_array()) return;
-
-        entries_.clear();
-        for (const auto& item : j) {
-            uint64_t key        = item.value("key_hash",    uint64_t{0});
-            std::string resp    = item.value("response",    std::string{});
-            uint64_t ts         = item.value("timestamp",   uint64_t{0});
-            uint64_t la         = item.value("last_access", uint64_t{0});
-
-            if (key == 0) continue;
-            entries_[key] = CacheEntry{std::move(resp), ts, la};
+    bool needs_compaction = false;
+    if (file.is_open()) {
+        std::string content((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+        file.close();
+        uint64_t now = epoch_seconds();
+        auto apply = [&](const nlohmann::json& item) {
+            uint64_t key = item.value("key_hash", uint64_t{0});
+            if (key == 0) return;
+            Shard& shard = shard_for(key);
+            if (item.value("op", std::string{}) == "del") {
+                erase(shard, key);
+                return;
+            }
+            CacheEntry entry = entry_from_json(item, ttl_seconds_);
+            if (expired(entry, now)) {
+                erase(shard, key);
+                return;
+            }
+            insert(shard, key, std::move(entry));
+        };
+
+        size_t first = content.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && content[first] == '[') {
+            // Legacy format: one JSON array rewritten on every put
+            try {
+                auto j = nlohmann::json::parse(content);
+                if (j.is_array()) {
+                    for (const auto& item : j) apply(item);
+                }
+            } catch (...) { // NOLINT(bugprone-empty-catch)
+                // Corrupt file — start fresh.
+            }
+            needs_compaction = true;
+        } else {
+            size_t pos = 0;
+            while (pos < content.size()) {
+                size_t end = content.find('\n', pos);
+                if (end == std::string::npos) end = content.size();
+                std::string_view line(content.data() + pos, end - pos);
+                pos = end + 1;
+                if (line.empty()) continue;
+                log_lines_++;
+                // A torn last line from a crash is skipped
+                auto item = nlohmann::json::parse(line.begin(), line.end(), nullptr, false);
+                if (item.is_object()) apply(item);
+            }
         }
-    } catch (...) { // NOLINT(bugprone-empty-catch)
-        // Corrupt file — start fresh.
+    }
+    // Load order is recency order: trim without logging, compaction follows
+    while (count_.load(std::memory_order_relaxed) > max_entries_) {
+        uint64_t oldest = UINT64_MAX;
+        Shard* victim = nullptr;
+        for (auto& shard : shards_) {
+            if (shard.lru.empty()) continue;
+            uint64_t tick = shard.nodes.at(shard.lru.back()).tick;
+            if (tick < oldest) {
+                oldest = tick;
+                victim = &shard;
+            }
+        }
+        if (!victim) break;
+        erase(*victim, victim->lru.back());
+        needs_compaction = true;
+    }
+
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    if (needs_compaction || log_lines_ > 2 * static_cast<size_t>(size())) {
+        compact_locked();
+    } else {
+        log_.open(path_, std::ios::app);
     }
 }
 
-void ResponseCache::save() {
-    // Must be called with mutex_ already held.
+void ResponseCache::append_log(const std::string& line) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    if (!log_.is_open()) return;
+    log_ << line << '\n';
+    log_.flush();
+    log_lines_++;
+    constexpr size_t kMinCompactLines = 64;
+    if (log_lines_ > std::max(kMinCompactLines, 2 * static_cast<size_t>(size()))) {
+        compact_locked();
+    }
+}
 
-    nlohmann::json j = nlohmann::json::array();
-    for (const auto& [key, entry] : entries_) {
-        j.push_back({
-            {"key_hash",    key},
-            {"response",    entry.response},
-            {"timestamp",   entry.timestamp},
-            {"last_access", entry.last_access}
-        });
+void ResponseCache::compact_locked() {
+    // Live entries, oldest first, so replaying the log restores LRU order
+    std::vector<std::pair<uint64_t, std::string>> lines;
+    lines.reserve(size());
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [key, node] : shard.nodes) {
+            lines.emplace_back(node.tick, entry_to_json(key, node.entry).dump());
+        }
+    }
+    std::sort(lines.begin(), lines.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::string content;
+    for (const auto& [tick, line] : lines) {
+        content += line;
+        content += '\n';
     }
 
-    atomic_write_file(path_, j.dump(2));
+    log_.close();
+    atomic_write_file(path_, content);
+    log_.open(path_, std::ios::app);
+    log_lines_ = lines.size();
 }
 
 } // namespace ptrclaw
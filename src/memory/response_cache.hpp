@@ -1,4 +1,10 @@
 #pragma once
+#include "../embedder.hpp"
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -10,41 +16,131 @@ namespace ptrclaw {
 
 struct CacheEntry {
     std::string response;
-    uint64_t timestamp;
-    uint64_t last_access;
+    uint64_t timestamp = 0;
+    uint64_t last_access = 0;
+    uint32_t ttl = 0;            // seconds; from the entry's category
+    uint64_t scope = 0;          // hash of (model, system prompt)
+    std::string query;           // text the embedding was computed from
+    Embedding embedding;         // empty unless the semantic layer is on
 };
 
+// Semantic lookup: on an exact-key miss, the query is embedded and compared
+// against cached entries with the same model and system prompt.
+struct SemanticCacheOptions {
+    double threshold = 0.95;     // cosine similarity needed for a hit
+    double near_hit = 0.85;      // misses at or above this are logged
+};
+
+// Coarse query category used to pick a TTL. "realtime" questions (weather,
+// news, prices, "today"...) go stale quickly; everything else is "default".
+std::string cache_category(const std::string& query);
+
+// LLM response cache, safe to share between sessions.
+//
+// Entries are spread over kShards independently locked shards, each with
+// its own LRU list; a global recency tick makes capacity eviction exact
+// LRU across shards at O(kShards) per eviction. Persistence is an
+// append-only JSONL log (one line per put or eviction) that is compacted
+// to the live entries once it grows to twice their number. A legacy
+// JSON-array cache file at the same path is migrated on load.
 class ResponseCache {
 public:
+    static constexpr size_t kShards = 16;
+
     ResponseCache(const std::string& path, uint32_t ttl_seconds, uint32_t max_entries);
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    // Process-wide instance for `path`, created on first use. Later callers
+    // get the same cache; ttl_seconds/max_entries come from the first one.
+    static std::shared_ptr<ResponseCache> shared(const std::string& path,
+                                                 uint32_t ttl_seconds,
+                                                 uint32_t max_entries);
+
+    // Enable the semantic layer. Pass nullptr to disable.
+    void set_embedder(Embedder* embedder, SemanticCacheOptions options = {});
+
+    // Override the TTL for a cache_category() (others use ttl_seconds)
+    void set_category_ttl(const std::string& category, uint32_t ttl_seconds);
 
     // Look up cached response. Returns nullopt on miss.
+    // `query` is the text used for semantic matching and categorisation
+    // (defaults to user_message); pass the raw message when user_message
+    // carries extra context such as recalled memories.
     std::optional<std::string> get(const std::string& model,
                                    const std::string& system_prompt,
-                                   const std::string& user_message);
+                                   const std::string& user_message,
+                                   const std::string& query = {});
 
     // Store a response in the cache.
     void put(const std::string& model,
              const std::string& system_prompt,
              const std::string& user_message,
-             const std::string& response);
+             const std::string& response,
+             const std::string& query = {});
+
+    // Exact lookup/store under a caller-computed key, bypassing the
+    // model/prompt/message hashing and the semantic layer. Used for
+    // per-call replay keyed by the agent's rolling history hash.
+    std::optional<std::string> get(uint64_t key);
+    void put(uint64_t key, const std::string& response);
 
     uint32_t size() const;
     void clear();
 
+    // Lines in the persistence log (for tests and diagnostics)
+    size_t log_lines() const;
+
 private:
+    struct Node {
+        CacheEntry entry;
+        std::list<uint64_t>::iterator lru_pos;
+        uint64_t tick = 0;       // global recency, larger = more recent
+    };
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Node> nodes;
+        std::list<uint64_t> lru;                       // front = most recent
+        std::unordered_map<uint64_t, Embedding> pending; // from missed lookups
+    };
+
     uint64_t compute_key(const std::string& model,
                          const std::string& system_prompt,
                          const std::string& user_message) const;
-    void evict();
+    Shard& shard_for(uint64_t key) { return shards_[(key ^ (key >> 32)) % kShards]; }
+    std::optional<std::string> semantic_get(Embedder& embedder, uint64_t key,
+                                            uint64_t scope, const std::string& query);
+    uint32_t ttl_for(const std::string& query) const;
+    // Insert, log and evict
+    void store(uint64_t key, CacheEntry entry);
+    // Insert or replace. Caller holds shard.mutex.
+    void insert(Shard& shard, uint64_t key, CacheEntry entry);
+    // Caller holds shard.mutex.
+    void erase(Shard& shard, uint64_t key);
+    // Drop least recently used entries until size() <= max_entries_
+    void evict_over_capacity();
+
     void load();
-    void save();
+    void append_log(const std::string& line);
+    // Rewrite the log with only live entries. Caller holds log_mutex_.
+    void compact_locked();
 
     std::string path_;
     uint32_t ttl_seconds_;
     uint32_t max_entries_;
-    std::unordered_map<uint64_t, CacheEntry> entries_;
-    mutable std::mutex mutex_;
+
+    std::array<Shard, kShards> shards_;
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint64_t> tick_{0};
+
+    mutable std::mutex config_mutex_;
+    std::unordered_map<std::string, uint32_t> category_ttl_;
+    Embedder* embedder_ = nullptr;
+    SemanticCacheOptions semantic_;
+
+    mutable std::mutex log_mutex_;
+    std::ofstream log_;
+    size_t log_lines_ = 0;
 };
 
 } // namespace ptrclaw
@@ -303,6 +303,7 @@ std::string SqliteMemory::store(const std::string& key, const std::string& conte
     }
 
     std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
 
     // Check if key already exists to reuse its id
     std::string existing_id;
@@ -626,6 +627,7 @@ std::vector<MemoryEntry> SqliteMemory::list(std::optional<MemoryCategory> catego
 
 bool SqliteMemory::forget(const std::string& key) {
     std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
 
     // Delete links referencing this key
     {
@@ -649,6 +651,19 @@ bool SqliteMemory::forget(const std::string& key) {
     return sqlite3_changes(db_) > 0;
 }
 
+uint64_t SqliteMemory::generation() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // data_version changes when another connection commits; writes made
+    // through this one are counted in generation_
+    int64_t data_version = 0;
+    StmtGuard g;
+    if (sqlite3_prepare_v2(db_, "PRAGMA data_version;", -1, &g.stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(g.stmt) == SQLITE_ROW) {
+        data_version = sqlite3_column_int64(g.stmt, 0);
+    }
+    return (static_cast<uint64_t>(data_version) << 32) + generation_;
+}
+
 uint32_t SqliteMemory::count(std::optional<MemoryCategory> category_filter) {
     std::lock_guard<std::mutex> lock(mutex_);
 
@@ -698,6 +713,7 @@ std::string SqliteMemory::snapshot_export() {
 
 uint32_t SqliteMemory::snapshot_import(const std::string& json_str) {
     std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
 
     uint32_t imported = 0;
     try {
@@ -750,6 +766,7 @@ uint32_t SqliteMemory::snapshot_import(const std::string& json_str) {
 
 uint32_t SqliteMemory::hygiene_purge(uint32_t max_age_seconds) {
     std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
 
     auto now = static_cast<int64_t>(epoch_seconds());
     auto conv_cutoff = now - static_cast<int64_t>(max_age_seconds);
@@ -877,6 +894,7 @@ uint32_t SqliteMemory::hygiene_purge(uint32_t max_age_seconds) {
 
 bool SqliteMemory::link(const std::string& from_key, const std::string& to_key) {
     std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
 
     // Verify both keys exist
     auto key_exists = [this](const std::string& key) -> bool {
@@ -912,6 +930,7 @@ bool SqliteMemory::link(const std::string& from_key, const std::string& to_key)
 
 bool SqliteMemory::unlink(const std::string& from_key, const std::string& to_key) {
     std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
 
     const char* sql = "DELETE FROM memory_links WHERE "
                       "(from_key = ? AND to_key = ?) OR (from_key = ? AND to_key = ?);";
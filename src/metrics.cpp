@@ -0,0 +1,254 @@
+#include "metrics.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+namespace ptrclaw {
+
+// ── Histogram ───────────────────────────────────────────────────
+
+void Histogram::observe(double v) {
+    const auto& b = *bounds_;
+    size_t i = 0;
+    while (i < b.size() && v > b[i]) i++;
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);  // i == size() is +Inf
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_micros_.fetch_add(static_cast<int64_t>(std::llround(v * 1e6)),
+                          std::memory_order_relaxed);
+}
+
+double Histogram::sum() const {
+    return static_cast<double>(sum_micros_.load(std::memory_order_relaxed)) / 1e6;
+}
+
+// ── Labels ──────────────────────────────────────────────────────
+
+std::string metric_label(const std::string& name, const std::string& value) {
+    std::string out = name;
+    out += "=\"";
+    for (char c : value) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"':  out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default:   out += c;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+std::string metric_labels(const std::string& name1, const std::string& value1,
+                          const std::string& name2, const std::string& value2) {
+    return metric_label(name1, value1) + "," + metric_label(name2, value2);
+}
+
+// ── Rendering ───────────────────────────────────────────────────
+
+static std::string format_number(double v) {
+    if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+    // Shortest form that round-trips, so bounds render as 0.1 not 0.1000…01
+    std::array<char, 32> buf{};
+    for (int precision = 15; precision <= 17; precision++) {
+        std::snprintf(buf.data(), buf.size(), "%.*g", precision, v);
+        if (std::strtod(buf.data(), nullptr) == v) break;
+    }
+    return buf.data();
+}
+
+// name{labels,extra} value
+static void render_sample(std::string& out, const std::string& name,
+                          const std::string& labels, const std::string& extra,
+                          const std::string& value) {
+    out += name;
+    if (!labels.empty() || !extra.empty()) {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extra.empty()) out += ',';
+        out += extra;
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+static void render_metric(std::string& out, const std::string& name,
+                          const std::string& labels, const Counter& c) {
+    render_sample(out, name, labels, "", std::to_string(c.value()));
+}
+
+static void render_metric(std::string& out, const std::string& name,
+                          const std::string& labels, const Gauge& g) {
+    render_sample(out, name, labels, "", std::to_string(g.value()));
+}
+
+static void render_metric(std::string& out, const std::string& name,
+                          const std::string& labels, const Histogram& h) {
+    const auto& bounds = h.bounds();
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= bounds.size(); i++) {
+        cumulative += h.bucket(i);
+        double le = i < bounds.size() ? bounds[i] : INFINITY;
+        render_sample(out, name + "_bucket", labels,
+                      metric_label("le", format_number(le)), std::to_string(cumulative));
+    }
+    render_sample(out, name + "_sum", labels, "", format_number(h.sum()));
+    render_sample(out, name + "_count", labels, "", std::to_string(h.count()));
+}
+
+// ── MetricFamily ────────────────────────────────────────────────
+
+template<typename M>
+void MetricFamily<M>::init(M& /*metric*/) {}
+
+template<>
+void MetricFamily<Histogram>::init(Histogram& metric) {
+    metric.set_bounds(&bounds_);
+}
+
+template<typename M>
+M& MetricFamily<M>::labels(const std::string& rendered) {
+    uint64_t hash = std::hash<std::string>{}(rendered);
+    for (size_t probe = 0; probe < kSlots; probe++) {
+        Slot& slot = slots_[(hash + probe) % kSlots];
+        int state = slot.state.load(std::memory_order_acquire);
+        if (state == 0) {
+            int expected = 0;
+            if (slot.state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+                slot.hash = hash;
+                slot.labels = rendered;
+                init(slot.metric);
+                slot.state.store(2, std::memory_order_release);
+                return slot.metric;
+            }
+            state = expected;
+        }
+        // Another thread is publishing this slot; it becomes ready shortly
+        while (state == 1) {
+            std::this_thread::yield();
+            state = slot.state.load(std::memory_order_acquire);
+        }
+        if (slot.hash == hash && slot.labels == rendered) return slot.metric;
+    }
+    return overflow_;
+}
+
+template<typename M>
+void MetricFamily<M>::render(std::string& out) const {
+    out += "# HELP " + name_ + " " + help_ + "\n";
+    out += "# TYPE " + name_ + " " + type_ + "\n";
+    size_t ready = 0;
+    for (const auto& slot : slots_) {
+        if (slot.state.load(std::memory_order_acquire) != 2) continue;
+        render_metric(out, name_, slot.labels, slot.metric);
+        ready++;
+    }
+    // The overflow child can only receive updates once the table is full
+    if (ready == kSlots) {
+        render_metric(out, name_, metric_label("overflow", "true"), overflow_);
+    }
+}
+
+template class MetricFamily<Counter>;
+template class MetricFamily<Gauge>;
+template class MetricFamily<Histogram>;
+
+// ── MetricsRegistry ─────────────────────────────────────────────
+
+MetricFamily<Counter>& MetricsRegistry::counter(const std::string& name,
+                                                const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto family = std::make_unique<MetricFamily<Counter>>(name, help, "counter");
+    auto& ref = *family;
+    families_.push_back(std::move(family));
+    return ref;
+}
+
+MetricFamily<Gauge>& MetricsRegistry::gauge(const std::string& name,
+                                            const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto family = std::make_unique<MetricFamily<Gauge>>(name, help, "gauge");
+    auto& ref = *family;
+    families_.push_back(std::move(family));
+    return ref;
+}
+
+MetricFamily<Histogram>& MetricsRegistry::histogram(const std::string& name,
+                                                    const std::string& help,
+                                                    std::vector<double> bounds) {
+    if (bounds.size() >= Histogram::kMaxBuckets) bounds.resize(Histogram::kMaxBuckets - 1);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto family = std::make_unique<MetricFamily<Histogram>>(
+        name, help, "histogram", std::move(bounds));
+    auto& ref = *family;
+    families_.push_back(std::move(family));
+    return ref;
+}
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    for (const auto& family : families_) family->render(out);
+    return out;
+}
+
+// ── Process-wide metrics ────────────────────────────────────────
+
+static const std::vector<double> kLatencyBounds = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120};
+
+static const std::vector<double> kMemoryBounds = {
+    1 << 20, 4 << 20, 16 << 20, 64 << 20, 256 << 20, 1 << 30, 4.0 * (1 << 30)};
+
+Metrics::Metrics()
+    : turn_seconds(registry.histogram("ptrclaw_turn_seconds",
+          "Wall time of one agent turn, from user message to final reply",
+          kLatencyBounds))
+    , provider_ttfb_seconds(registry.histogram("ptrclaw_provider_ttfb_seconds",
+          "Time from provider request to the first streamed token (or full reply)",
+          kLatencyBounds))
+    , provider_tokens(registry.counter("ptrclaw_provider_tokens_total",
+          "Tokens reported by the provider, by model and direction (in/out)"))
+    , stream_chunks(registry.counter("ptrclaw_stream_chunks_total",
+          "Streamed text deltas received from providers"))
+    , tool_seconds(registry.histogram("ptrclaw_tool_seconds",
+          "Tool execution time, including output filtering", kLatencyBounds))
+    , tool_output_tokens(registry.counter("ptrclaw_tool_output_tokens_total",
+          "Estimated tool output tokens before (raw) and after (filtered) filtering"))
+    , tool_memo(registry.counter("ptrclaw_tool_memo_total",
+          "Memoized tool lookups by result (hit/miss)"))
+    , tool_pool_queued(registry.gauge("ptrclaw_tool_pool_queued",
+          "Tool calls waiting for a worker or a concurrency-class slot"))
+    , tool_pool_running(registry.gauge("ptrclaw_tool_pool_running",
+          "Tool calls running on the shared tool pool"))
+    , tool_pool_wait_seconds(registry.histogram("ptrclaw_tool_pool_wait_seconds",
+          "Time tool calls spent queued before starting", kLatencyBounds))
+    , shell_cpu_seconds(registry.histogram("ptrclaw_shell_cpu_seconds",
+          "CPU time of finished shell commands, by mode (user/sys)", kLatencyBounds))
+    , shell_max_rss_bytes(registry.histogram("ptrclaw_shell_max_rss_bytes",
+          "Peak resident set size of finished shell commands", kMemoryBounds))
+    , shell_limit_kills(registry.counter("ptrclaw_shell_limit_kills_total",
+          "Shell commands killed for exceeding a limit (cpu/output)"))
+    , sessions_resident(registry.gauge("ptrclaw_sessions_resident",
+          "Sessions with an agent loaded in memory"))
+    , queued_messages(registry.gauge("ptrclaw_session_queue_depth",
+          "Messages waiting in session lanes"))
+    , response_cache(registry.counter("ptrclaw_response_cache_total",
+          "Response cache lookups by result (hit/miss)"))
+    , memory_recall_seconds(registry.histogram("ptrclaw_memory_recall_seconds",
+          "Time spent recalling memories to enrich a user message", kLatencyBounds))
+    , event_queue_depth(registry.gauge("ptrclaw_event_queue_depth",
+          "Events waiting in async event bus subscriptions"))
+    , event_queue_events(registry.counter("ptrclaw_event_queue_events_total",
+          "Async subscription events by result (delivered/dropped/coalesced)"))
+{}
+
+Metrics& metrics() {
+    static Metrics instance;
+    return instance;
+}
+
+} // namespace ptrclaw
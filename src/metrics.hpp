@@ -0,0 +1,180 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ptrclaw {
+
+// ── Metric types ────────────────────────────────────────────────
+// Every update is a relaxed atomic op, cheap enough for per-token events.
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+public:
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// Fixed-bucket histogram. The sum is kept in micro-units so it can be an
+// integer atomic.
+class Histogram {
+public:
+    static constexpr size_t kMaxBuckets = 16;
+
+    void set_bounds(const std::vector<double>* bounds) { bounds_ = bounds; }
+    void observe(double v);
+
+    const std::vector<double>& bounds() const { return *bounds_; }
+    uint64_t bucket(size_t i) const { return buckets_[i].load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const;
+
+private:
+    const std::vector<double>* bounds_ = nullptr;
+    std::array<std::atomic<uint64_t>, kMaxBuckets> buckets_{};  // non-cumulative
+    std::atomic<uint64_t> count_{0};
+    std::atomic<int64_t> sum_micros_{0};
+};
+
+// ── Families ────────────────────────────────────────────────────
+
+// Render one label pair with Prometheus escaping: name="value"
+std::string metric_label(const std::string& name, const std::string& value);
+std::string metric_labels(const std::string& name1, const std::string& value1,
+                          const std::string& name2, const std::string& value2);
+
+class MetricFamilyBase {
+public:
+    MetricFamilyBase(std::string name, std::string help, const char* type)
+        : name_(std::move(name)), help_(std::move(help)), type_(type) {}
+    virtual ~MetricFamilyBase() = default;
+    MetricFamilyBase(const MetricFamilyBase&) = delete;
+    MetricFamilyBase& operator=(const MetricFamilyBase&) = delete;
+
+    virtual void render(std::string& out) const = 0;
+
+protected:
+    std::string name_;
+    std::string help_;
+    const char* type_;
+};
+
+// A metric name plus its children, one per rendered label set. Children
+// live in a fixed open-addressed table: lookup is lock-free and insertion
+// claims an empty slot with a CAS. Once the table is full, new label sets
+// share a single overflow child labelled with overflow="true".
+template<typename M>
+class MetricFamily : public MetricFamilyBase {
+public:
+    static constexpr size_t kSlots = 128;
+
+    MetricFamily(std::string name, std::string help, const char* type,
+                 std::vector<double> bounds = {})
+        : MetricFamilyBase(std::move(name), std::move(help), type)
+        , bounds_(std::move(bounds))
+    {
+        init(overflow_);
+    }
+
+    // Child for a pre-rendered label set (see metric_label); "" = no labels
+    M& labels(const std::string& rendered);
+    M& unlabeled() { return labels(""); }
+
+    void render(std::string& out) const override;
+
+private:
+    struct Slot {
+        std::atomic<int> state{0};  // 0 empty, 1 claimed, 2 ready
+        uint64_t hash = 0;
+        std::string labels;
+        M metric;
+    };
+
+    void init(M& metric);
+
+    std::vector<double> bounds_;
+    std::array<Slot, kSlots> slots_;
+    M overflow_;
+};
+
+// ── Registry ────────────────────────────────────────────────────
+
+// Families register once at startup (under a mutex); updates never lock.
+class MetricsRegistry {
+public:
+    MetricFamily<Counter>& counter(const std::string& name, const std::string& help);
+    MetricFamily<Gauge>& gauge(const std::string& name, const std::string& help);
+    MetricFamily<Histogram>& histogram(const std::string& name, const std::string& help,
+                                       std::vector<double> bounds);
+
+    // Prometheus text exposition format 0.0.4
+    std::string render() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<MetricFamilyBase>> families_;
+};
+
+// Process-wide metrics. Always on: instrumented code updates these whether
+// or not the /metrics endpoint is served.
+struct Metrics {
+    MetricsRegistry registry;
+
+    MetricFamily<Histogram>& turn_seconds;
+    MetricFamily<Histogram>& provider_ttfb_seconds;   // {model}
+    MetricFamily<Counter>& provider_tokens;           // {model, direction}
+    MetricFamily<Counter>& stream_chunks;
+    MetricFamily<Histogram>& tool_seconds;            // {tool}
+    MetricFamily<Counter>& tool_output_tokens;        // {tool, stage}
+    MetricFamily<Counter>& tool_memo;                 // {tool, result}
+    MetricFamily<Gauge>& tool_pool_queued;            // {class}
+    MetricFamily<Gauge>& tool_pool_running;           // {class}
+    MetricFamily<Histogram>& tool_pool_wait_seconds;  // {class}
+    MetricFamily<Histogram>& shell_cpu_seconds;       // {mode}
+    MetricFamily<Histogram>& shell_max_rss_bytes;
+    MetricFamily<Counter>& shell_limit_kills;         // {limit}
+    MetricFamily<Gauge>& sessions_resident;
+    MetricFamily<Gauge>& queued_messages;
+    MetricFamily<Counter>& response_cache;            // {result}
+    MetricFamily<Histogram>& memory_recall_seconds;
+    MetricFamily<Gauge>& event_queue_depth;           // {subscriber}
+    MetricFamily<Counter>& event_queue_events;        // {subscriber, result}
+
+    Metrics();
+};
+
+Metrics& metrics();
+
+// Observe elapsed wall time into a histogram when the scope ends
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& h)
+        : histogram_(h), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        histogram_.observe(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace ptrclaw
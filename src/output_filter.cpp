@@ -1,6 +1,9 @@
 #include "output_filter.hpp"
+#include "aho_corasick.hpp"
+#include "text_scan.hpp"
 #include "util.hpp"
 #include <algorithm>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <nlohmann/json.hpp>
@@ -11,11 +14,59 @@
 
 namespace ptrclaw {
 
-std::string strip_ansi_codes(const std::string& input) {
+// ── Line stream ─────────────────────────────────────────────────
+// Filters pass lines along as string_views. Lines a stage keeps point into
+// the one input buffer; only lines a stage rewrites or adds are allocated,
+// in a LineArena whose strings never move (std::deque keeps references
+// stable). Each stage is one pass over the previous stage's lines, and the
+// last stage writes the result string.
+
+using Lines = std::vector<std::string_view>;
+
+class LineArena {
+public:
+    std::string_view add(std::string line) {
+        owned_.push_back(std::move(line));
+        return owned_.back();
+    }
+
+private:
+    std::deque<std::string> owned_;
+};
+
+// Split on '\n'; a trailing newline does not start another line
+static Lines split_lines(std::string_view text) {
+    Lines lines;
+    split_lines_into(text, lines);
+    return lines;
+}
+
+static std::string join_lines(const Lines& lines) {
+    size_t size = lines.empty() ? 0 : lines.size() - 1;
+    for (auto line : lines) size += line.size();
     std::string result;
-    result.reserve(input.size());
+    result.reserve(size);
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (i > 0) result += '\n';
+        result.append(lines[i]);
+    }
+    return result;
+}
 
-    size_t i = 0;
+// Lines of a string a stage produced as a whole
+static Lines own_lines(std::string text, LineArena& arena) {
+    return split_lines(arena.add(std::move(text)));
+}
+
+// Returns `input` itself when it has no escape sequence; otherwise the
+// stripped text, built in `scratch`
+static std::string_view strip_ansi_view(std::string_view input, std::string& scratch) {
+    size_t i = find_byte(input, '\033');
+    if (i == std::string_view::npos) return input;
+
+    scratch.clear();
+    scratch.reserve(input.size());
+    scratch.append(input.substr(0, i));
     while (i < input.size()) {
         if (input[i] == '\033' && i + 1 < input.size() && input[i + 1] == '[') {
             // Skip ESC [ ... <final byte>
@@ -25,36 +76,36 @@ std::string strip_ansi_codes(const std::string& input) {
             }
             if (i < input.size()) i++; // skip final byte
         } else {
-            result += input[i];
-            i++;
+            size_t next = find_byte(input, '\033', i + 1);
+            if (next == std::string_view::npos) next = input.size();
+            scratch.append(input.substr(i, next - i));
+            i = next;
         }
     }
-    return result;
+    return scratch;
 }
 
-std::string filter_tool_output(const std::string& output,
-                               const OutputFilterConfig& config) {
-    if (output.empty()) return output;
-
-    std::string cleaned = config.strip_ansi ? strip_ansi_codes(output) : output;
+std::string strip_ansi_codes(const std::string& input) {
+    std::string scratch;
+    std::string_view stripped = strip_ansi_view(input, scratch);
+    if (stripped.data() == input.data()) return input;
+    return scratch;
+}
 
-    // Split into lines, apply per-line and total limits
-    std::ostringstream result;
+// Generic limits, written straight into the result: blank-line collapsing,
+// per-line length, line count and total size
+static std::string finish_lines(const Lines& lines, const OutputFilterConfig& config) {
+    std::string result;
     uint32_t line_count = 0;
     uint32_t total_chars = 0;
     bool prev_blank = false;
-    bool truncated = false;
+    size_t shown = lines.size();
 
-    size_t pos = 0;
-    while (pos < cleaned.size()) {
-        // Find end of line
-        size_t eol = cleaned.find('\n', pos);
-        size_t line_end = (eol != std::string::npos) ? eol : cleaned.size();
-        std::string line = cleaned.substr(pos, line_end - pos);
-        pos = (eol != std::string::npos) ? eol + 1 : cleaned.size();
+    for (size_t i = 0; i < lines.size(); i++) {
+        std::string_view line = lines[i];
 
         // Collapse consecutive blank lines
-        bool is_blank = line.find_first_not_of(" \t\r") == std::string::npos;
+        bool is_blank = skip_blanks(line) == line.size();
         if (config.collapse_blank_lines && is_blank) {
             if (prev_blank) continue;
             prev_blank = true;
@@ -63,66 +114,49 @@ std::string filter_tool_output(const std::string& output,
         }
 
         // Truncate long lines
-        if (config.max_line_length > 0 && line.size() > config.max_line_length) {
-            line = line.substr(0, config.max_line_length) + "...";
-        }
+        bool cut = config.max_line_length > 0 && line.size() > config.max_line_length;
+        if (cut) line = line.substr(0, config.max_line_length);
+        size_t line_size = line.size() + (cut ? 3 : 0);
 
         // Check limits
-        if (config.max_lines > 0 && line_count >= config.max_lines) {
-            truncated = true;
-            break;
-        }
-        if (config.max_total_chars > 0 &&
-            total_chars + line.size() + 1 > config.max_total_chars) {
-            truncated = true;
+        if ((config.max_lines > 0 && line_count >= config.max_lines) ||
+            (config.max_total_chars > 0 &&
+             total_chars + line_size + 1 > config.max_total_chars)) {
+            shown = i;
             break;
         }
 
-        if (line_count > 0) result << '\n';
-        result << line;
-        total_chars += line.size() + 1;
+        if (line_count > 0) result += '\n';
+        result.append(line);
+        if (cut) result += "...";
+        total_chars += static_cast<uint32_t>(line_size + 1);
         line_count++;
     }
 
-    if (truncated) {
-        // Count remaining lines
-        uint32_t remaining = 0;
-        while (pos < cleaned.size()) {
-            if (cleaned[pos] == '\n') remaining++;
-            pos++;
-        }
-        if (remaining > 0 || line_count < cleaned.size()) {
-            result << "\n[..." << remaining << " more lines truncated]";
-        }
+    if (shown < lines.size()) {
+        result += "\n[..." + std::to_string(lines.size() - shown) + " more lines truncated]";
     }
-
-    return result.str();
+    return result;
 }
 
-// ── Helper: split string into lines ─────────────────────────────
-
-static std::vector<std::string> split_lines(const std::string& text) {
-    std::vector<std::string> lines;
-    size_t pos = 0;
-    while (pos < text.size()) {
-        size_t eol = text.find('\n', pos);
-        if (eol == std::string::npos) {
-            lines.push_back(text.substr(pos));
-            break;
-        }
-        lines.push_back(text.substr(pos, eol - pos));
-        pos = eol + 1;
-    }
-    return lines;
+OutputFilterConfig filter_config_for_tokens(uint32_t tokens) {
+    OutputFilterConfig config;
+    // estimate_tokens() counts 4 chars per token; the defaults allow 100
+    // chars per line on average
+    uint64_t chars = std::min<uint64_t>(static_cast<uint64_t>(tokens) * 4, UINT32_MAX);
+    config.max_total_chars = static_cast<uint32_t>(chars);
+    config.max_lines = std::max<uint32_t>(20, config.max_total_chars / 100);
+    return config;
 }
 
-static std::string join_lines(const std::vector<std::string>& lines) {
-    std::string result;
-    for (size_t i = 0; i < lines.size(); i++) {
-        if (i > 0) result += '\n';
-        result += lines[i];
-    }
-    return result;
+std::string filter_tool_output(const std::string& output,
+                               const OutputFilterConfig& config) {
+    if (output.empty()) return output;
+
+    std::string scratch;
+    std::string_view cleaned = config.strip_ansi ? strip_ansi_view(output, scratch)
+                                                 : std::string_view(output);
+    return finish_lines(split_lines(cleaned), config);
 }
 
 // ── Command classifier ──────────────────────────────────────────
@@ -133,135 +167,141 @@ enum class ShellCommandType {
     GitHubCli, EnvVars, DepFile, Other
 };
 
-static bool starts_with(const std::string& s, const std::string& prefix) {
+static bool starts_with(std::string_view s, std::string_view prefix) {
     return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
 }
 
-static bool contains(const std::string& s, const std::string& needle) {
-    return s.find(needle) != std::string::npos;
-}
-
-static bool contains_icase(const std::string& s, const std::string& needle) {
-    if (needle.size() > s.size()) return false;
-    auto it = std::search(s.begin(), s.end(), needle.begin(), needle.end(),
-                          [](char a, char b) {
-                              return std::tolower(static_cast<unsigned char>(a)) ==
-                                     std::tolower(static_cast<unsigned char>(b));
-                          });
-    return it != s.end();
+static bool contains(std::string_view s, std::string_view needle) {
+    return s.find(needle) != std::string_view::npos;
 }
 
-static ShellCommandType classify_command(const std::string& command) {
-    // Trim leading whitespace / env vars for matching
-    std::string cmd = command;
-    size_t start = cmd.find_first_not_of(" \t");
-    if (start != std::string::npos) cmd = cmd.substr(start);
-
-    if (starts_with(cmd, "git diff") || contains(cmd, "| git diff")) return ShellCommandType::GitDiff;
-    if (starts_with(cmd, "git status")) return ShellCommandType::GitStatus;
-    if (starts_with(cmd, "git log") || starts_with(cmd, "git shortlog")) return ShellCommandType::GitLog;
-    // Git operations (add, commit, push, pull, fetch, clone, merge, rebase, checkout)
-    if (starts_with(cmd, "git add") || starts_with(cmd, "git commit") ||
-        starts_with(cmd, "git push") || starts_with(cmd, "git pull") ||
-        starts_with(cmd, "git fetch") || starts_with(cmd, "git clone") ||
-        starts_with(cmd, "git merge") || starts_with(cmd, "git rebase") ||
-        starts_with(cmd, "git checkout") || starts_with(cmd, "git switch")) {
-        return ShellCommandType::GitOps;
-    }
-
-    // Test runners
-    if (contains(cmd, "pytest") || contains(cmd, "cargo test") ||
-        contains(cmd, "npm test") || contains(cmd, "npx jest") ||
-        contains(cmd, "go test") || contains(cmd, "make test") ||
-        contains(cmd, "ctest")) {
-        return ShellCommandType::TestRunner;
-    }
-
-    // Build tools (make without test/check suffixes — those are caught above)
-    if ((starts_with(cmd, "make") && !contains(cmd, "test") && !contains(cmd, "check")) ||
-        starts_with(cmd, "cmake --build") ||
-        starts_with(cmd, "cargo build") || starts_with(cmd, "cargo clippy") ||
-        starts_with(cmd, "npm run build") || starts_with(cmd, "go build") ||
-        starts_with(cmd, "ninja") || starts_with(cmd, "meson compile")) {
-        return ShellCommandType::BuildLog;
-    }
-
-    // Linters (after build tools — cargo clippy is caught above, which is fine)
-    if (starts_with(cmd, "eslint") || contains(cmd, "npx eslint") ||
-        starts_with(cmd, "tsc") || contains(cmd, "npx tsc") ||
-        starts_with(cmd, "ruff ") || starts_with(cmd, "pylint") ||
-        starts_with(cmd, "flake8") || starts_with(cmd, "mypy") ||
-        starts_with(cmd, "golangci-lint") ||
-        starts_with(cmd, "biome ") || contains(cmd, "npx biome")) {
-        return ShellCommandType::Linter;
-    }
-
-    // Directory listing tools
-    if (starts_with(cmd, "tree") || starts_with(cmd, "find ") ||
-        starts_with(cmd, "ls -") || starts_with(cmd, "fd ")) {
-        return ShellCommandType::DirListing;
-    }
-
-    // Search/grep tools
-    if (starts_with(cmd, "grep ") || starts_with(cmd, "rg ") ||
-        starts_with(cmd, "ag ") || starts_with(cmd, "ack ") ||
-        starts_with(cmd, "git grep")) {
-        return ShellCommandType::SearchResult;
-    }
+// Rules are tried in order and the first that matches picks the filter.
+// A pattern starting with '^' must match at the start of the command
+// (after leading blanks); any other may match anywhere in it. To support
+// another tool, add its patterns here.
+struct CommandRule {
+    ShellCommandType type;
+    std::vector<std::string_view> any;       // one of these must match
+    std::vector<std::string_view> also_any;  // if given, one of these too
+    std::vector<std::string_view> none;      // and none of these
+};
 
-    // HTTP clients
-    if (starts_with(cmd, "curl ") || starts_with(cmd, "wget ") ||
-        starts_with(cmd, "http ") || starts_with(cmd, "https ")) {
-        return ShellCommandType::HttpResponse;
-    }
+static std::vector<CommandRule> command_rules() {
+    using T = ShellCommandType;
+    return {
+        {T::GitDiff,   {"^git diff", "| git diff"}, {}, {}},
+        {T::GitStatus, {"^git status"}, {}, {}},
+        {T::GitLog,    {"^git log", "^git shortlog"}, {}, {}},
+        {T::GitOps,    {"^git add", "^git commit", "^git push", "^git pull", "^git fetch",
+                        "^git clone", "^git merge", "^git rebase", "^git checkout",
+                        "^git switch"}, {}, {}},
+        {T::TestRunner, {"pytest", "cargo test", "npm test", "npx jest", "go test",
+                         "make test", "ctest"}, {}, {}},
+        // make without test/check targets (those are test runs)
+        {T::BuildLog,  {"^make"}, {}, {"test", "check"}},
+        {T::BuildLog,  {"^cmake --build", "^cargo build", "^cargo clippy", "^npm run build",
+                        "^go build", "^ninja", "^meson compile"}, {}, {}},
+        {T::Linter,    {"^eslint", "npx eslint", "^tsc", "npx tsc", "^ruff ", "^pylint",
+                        "^flake8", "^mypy", "^golangci-lint", "^biome ", "npx biome"}, {}, {}},
+        {T::DirListing,   {"^tree", "^find ", "^ls -", "^fd "}, {}, {}},
+        {T::SearchResult, {"^grep ", "^rg ", "^ag ", "^ack ", "^git grep"}, {}, {}},
+        {T::HttpResponse, {"^curl ", "^wget ", "^http ", "^https "}, {}, {}},
+        {T::ContainerOps, {"^docker ", "^podman ", "^kubectl ", "^k "}, {}, {}},
+        {T::PackageManager, {"^npm ", "^pnpm "}, {"list", "ls", "outdated"}, {}},
+        {T::PackageManager, {"^yarn "}, {"list", "why"}, {}},
+        {T::PackageManager, {"^pip "}, {"list", "freeze"}, {}},
+        {T::PackageManager, {"^cargo tree"}, {}, {}},
+        {T::PackageManager, {"^gem ", "^brew "}, {"list"}, {}},
+        {T::GitHubCli, {"^gh "}, {}, {}},
+        {T::EnvVars,   {"^env", "^printenv", "^set ", "^export"}, {}, {}},
+        // Dependency file reads (cat package.json, cat Cargo.toml, etc.)
+        {T::DepFile,   {"^cat "}, {"package.json", "Cargo.toml", "requirements.txt",
+                                   "pyproject.toml", "go.mod", "Gemfile", "build.gradle",
+                                   "pom.xml"}, {}},
+    };
+}
 
-    // Container/orchestration
-    if (starts_with(cmd, "docker ") || starts_with(cmd, "podman ") ||
-        starts_with(cmd, "kubectl ") || starts_with(cmd, "k ")) {
-        return ShellCommandType::ContainerOps;
+// The rule table compiled into one automaton over all of its patterns, so
+// a command is scanned once however many rules there are
+class CommandClassifier {
+public:
+    explicit CommandClassifier(const std::vector<CommandRule>& rules)
+        : compiled_(compile(rules)), matcher_(texts_) {}
+
+    ShellCommandType classify(std::string_view cmd) const {
+        // Per pattern: bit 0 = seen anywhere, bit 1 = seen at the start
+        std::vector<uint8_t> seen(texts_.size(), 0);
+        matcher_.scan(cmd, [&](uint32_t pattern, size_t begin) {
+            seen[pattern] |= begin == 0 ? 3 : 1;
+            return false;
+        });
+        auto matched = [&](const Pattern& p) { return (seen[p.index] & (p.anchored ? 2 : 1)) != 0; };
+        auto any_of = [&](const std::vector<Pattern>& ps) {
+            return std::any_of(ps.begin(), ps.end(), matched);
+        };
+
+        for (const auto& rule : compiled_) {
+            if (any_of(rule.any) && (rule.also_any.empty() || any_of(rule.also_any)) &&
+                !any_of(rule.none)) {
+                return rule.type;
+            }
+        }
+        return ShellCommandType::Other;
     }
 
-    // Package managers
-    if ((starts_with(cmd, "npm ") && (contains(cmd, "list") || contains(cmd, "ls") || contains(cmd, "outdated"))) ||
-        (starts_with(cmd, "pnpm ") && (contains(cmd, "list") || contains(cmd, "ls") || contains(cmd, "outdated"))) ||
-        (starts_with(cmd, "yarn ") && (contains(cmd, "list") || contains(cmd, "why"))) ||
-        (starts_with(cmd, "pip ") && (contains(cmd, "list") || contains(cmd, "freeze"))) ||
-        starts_with(cmd, "cargo tree") ||
-        (starts_with(cmd, "gem ") && contains(cmd, "list")) ||
-        (starts_with(cmd, "brew ") && contains(cmd, "list"))) {
-        return ShellCommandType::PackageManager;
-    }
+private:
+    struct Pattern {
+        uint32_t index;  // into texts_
+        bool anchored;
+    };
+    struct Rule {
+        ShellCommandType type;
+        std::vector<Pattern> any, also_any, none;
+    };
 
-    // GitHub CLI
-    if (starts_with(cmd, "gh ")) {
-        return ShellCommandType::GitHubCli;
-    }
+    std::vector<Rule> compile(const std::vector<CommandRule>& rules) {
+        auto intern = [this](std::string_view pattern) {
+            bool anchored = !pattern.empty() && pattern[0] == '^';
+            if (anchored) pattern.remove_prefix(1);
+            auto it = std::find(texts_.begin(), texts_.end(), pattern);
+            if (it == texts_.end()) it = texts_.insert(texts_.end(), pattern);
+            return Pattern{static_cast<uint32_t>(it - texts_.begin()), anchored};
+        };
+        auto intern_all = [&](const std::vector<std::string_view>& patterns) {
+            std::vector<Pattern> out;
+            for (auto p : patterns) out.push_back(intern(p));
+            return out;
+        };
+        std::vector<Rule> compiled;
+        for (const auto& rule : rules) {
+            compiled.push_back({rule.type, intern_all(rule.any), intern_all(rule.also_any),
+                                intern_all(rule.none)});
+        }
+        return compiled;
+    }
+
+    std::vector<std::string_view> texts_;  // distinct patterns, '^' stripped
+    std::vector<Rule> compiled_;
+    AhoCorasick matcher_;
+};
 
-    // Environment variables
-    if (starts_with(cmd, "env") || starts_with(cmd, "printenv") ||
-        starts_with(cmd, "set ") || starts_with(cmd, "export")) {
-        return ShellCommandType::EnvVars;
-    }
+static ShellCommandType classify_command(std::string_view command) {
+    static const CommandClassifier classifier(command_rules());
 
-    // Dependency file reads (cat package.json, cat Cargo.toml, etc.)
-    if (starts_with(cmd, "cat ") &&
-        (contains(cmd, "package.json") || contains(cmd, "Cargo.toml") ||
-         contains(cmd, "requirements.txt") || contains(cmd, "pyproject.toml") ||
-         contains(cmd, "go.mod") || contains(cmd, "Gemfile") ||
-         contains(cmd, "build.gradle") || contains(cmd, "pom.xml"))) {
-        return ShellCommandType::DepFile;
-    }
-
-    return ShellCommandType::Other;
+    // Leading whitespace does not count against '^' patterns
+    size_t start = command.find_first_not_of(" \t");
+    if (start != std::string_view::npos) command.remove_prefix(start);
+    return classifier.classify(command);
 }
 
 // ── Per-command filters ─────────────────────────────────────────
+// Each takes the lines of the previous stage and returns the lines to
+// keep; returning `lines` as-is means "leave the output alone".
 
-static std::string filter_git_diff(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> kept;
+static Lines filter_git_diff(const Lines& lines) {
+    Lines kept;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         if (line.empty()) continue;
 
         // Always keep: diff headers, file markers, hunk headers, changes, stats
@@ -290,32 +330,30 @@ static std::string filter_git_diff(const std::string& output) {
         // Drop context lines (lines starting with space in unified diff)
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
-static std::string filter_git_status(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> kept;
+static Lines filter_git_status(const Lines& lines) {
+    Lines kept;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         // Drop hint lines from git status
         if (contains(line, "(use \"git")) continue;
 
         kept.push_back(line);
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
-static std::string filter_test_output(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> kept;
+static Lines filter_test_output(const Lines& lines) {
+    Lines kept;
 
     // Two passes: collect failure lines and summary, with context
     std::vector<bool> keep(lines.size(), false);
 
     for (size_t i = 0; i < lines.size(); i++) {
-        const auto& line = lines[i];
+        auto line = lines[i];
 
         // Failure indicators
         if (contains(line, "FAIL") || contains(line, "FAILED") ||
@@ -356,20 +394,17 @@ static std::string filter_test_output(const std::string& output) {
     if (kept.empty()) {
         // Find and return just the last few lines (likely summary)
         size_t start = lines.size() > 5 ? lines.size() - 5 : 0;
-        for (size_t i = start; i < lines.size(); i++) {
-            kept.push_back(lines[i]);
-        }
+        kept.assign(lines.begin() + static_cast<std::ptrdiff_t>(start), lines.end());
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
-static std::string filter_build_log(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> kept;
+static Lines filter_build_log(const Lines& lines) {
+    Lines kept;
 
     for (size_t i = 0; i < lines.size(); i++) {
-        const auto& line = lines[i];
+        auto line = lines[i];
 
         // Keep error and warning lines + 1 line before for file context
         if (contains(line, "error") || contains(line, "Error") ||
@@ -422,22 +457,23 @@ static std::string filter_build_log(const std::string& output) {
         }
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
+static bool group_diagnostic_lines(Lines& lines, LineArena& arena);
+
 // ── Linter output filter ────────────────────────────────────────
 // Groups linter diagnostics by rule/message pattern. Keeps first occurrence
 // of each unique message, collapses duplicates with file list.
 
-static std::string filter_linter_output(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 5) return output;
+static Lines filter_linter_output(const Lines& lines, LineArena& arena) {
+    if (lines.size() < 5) return lines;
 
     // Group repeated diagnostics, then strip remaining noise
-    std::string grouped = group_diagnostics(output);
-    auto glines = split_lines(grouped);
-    std::vector<std::string> kept;
-    for (const auto& line : glines) {
+    Lines grouped = lines;
+    group_diagnostic_lines(grouped, arena);
+    Lines kept;
+    for (auto line : grouped) {
         // ESLint/biome: skip per-file summary lines with 0 issues
         // Match "✓ 0 problems" style lines but not "5 problems (0 errors, 5 warnings)"
         if (starts_with(line, "✓") && contains(line, "0 problems")) continue;
@@ -448,7 +484,7 @@ static std::string filter_linter_output(const std::string& output) {
     }
 
     // Keep summary line at end if present
-    return join_lines(kept);
+    return kept;
 }
 
 // ── Search result filter ────────────────────────────────────────
@@ -456,16 +492,16 @@ static std::string filter_linter_output(const std::string& output) {
 // Shortens long paths and centers match content in a window.
 
 // Shorten long paths: src/components/deeply/nested/file.cpp -> src/.../nested/file.cpp
-static std::string compact_path(const std::string& path) {
-    if (path.size() <= 50) return path;
+static std::string compact_path(std::string_view path) {
+    if (path.size() <= 50) return std::string(path);
     auto last_slash = path.rfind('/');
-    if (last_slash == std::string::npos || last_slash == 0) return path;
+    if (last_slash == std::string_view::npos || last_slash == 0) return std::string(path);
     auto second_last = path.rfind('/', last_slash - 1);
-    if (second_last == std::string::npos || second_last == 0) return path;
+    if (second_last == std::string_view::npos || second_last == 0) return std::string(path);
     auto first_slash = path.find('/');
-    if (first_slash >= second_last) return path;
-    return path.substr(0, first_slash + 1) + "..." +
-           path.substr(second_last);
+    if (first_slash >= second_last) return std::string(path);
+    return std::string(path.substr(0, first_slash + 1)) + "..." +
+           std::string(path.substr(second_last));
 }
 
 // Truncate match content to ~80 chars, centering around the non-path portion.
@@ -480,26 +516,26 @@ static std::string truncate_match_content(const std::string& line, size_t conten
     return prefix + content;
 }
 
-static std::string filter_search_results(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 10) return output;
+static Lines filter_search_results(const Lines& lines, LineArena& arena) {
+    if (lines.size() < 10) return lines;
 
     // Group matches by file prefix (file:line:content or file-line-content)
-    std::unordered_map<std::string, std::vector<size_t>> file_matches;
-    std::vector<std::string> non_match_lines;
-    std::vector<std::string> file_order;
+    std::unordered_map<std::string_view, std::vector<size_t>> file_matches;
+    Lines non_match_lines;
+    std::vector<std::string_view> file_order;
     constexpr uint32_t max_matches_per_file = 5;
 
     for (size_t i = 0; i < lines.size(); i++) {
-        const auto& line = lines[i];
+        auto line = lines[i];
         // Detect file:line: pattern (grep -n style)
         auto colon1 = line.find(':');
-        if (colon1 != std::string::npos && colon1 > 0 && colon1 < line.size() - 1) {
+        if (colon1 != std::string_view::npos && colon1 > 0 && colon1 < line.size() - 1) {
             auto colon2 = line.find(':', colon1 + 1);
-            if (colon2 != std::string::npos) {
-                std::string file = line.substr(0, colon1);
+            if (colon2 != std::string_view::npos) {
+                auto file = line.substr(0, colon1);
                 // Verify it looks like a file path (has / or .)
-                if (file.find('/') != std::string::npos || file.find('.') != std::string::npos) {
+                if (file.find('/') != std::string_view::npos ||
+                    file.find('.') != std::string_view::npos) {
                     if (file_matches.find(file) == file_matches.end()) {
                         file_order.push_back(file);
                     }
@@ -513,50 +549,50 @@ static std::string filter_search_results(const std::string& output) {
     }
 
     // If no file grouping detected, return original
-    if (file_matches.empty()) return output;
+    if (file_matches.empty()) return lines;
 
-    std::vector<std::string> result;
+    Lines result;
     result.reserve(non_match_lines.size() + file_order.size());
-    for (const auto& nl : non_match_lines) {
+    for (auto nl : non_match_lines) {
         result.push_back(nl);
     }
 
-    for (const auto& file : file_order) {
+    for (auto file : file_order) {
         const auto& indices = file_matches[file];
         std::string short_path = compact_path(file);
         uint32_t shown = 0;
         for (size_t idx : indices) {
             if (shown < max_matches_per_file) {
-                const auto& line = lines[idx];
+                auto line = lines[idx];
                 // Rebuild line with shortened path + truncated content
                 auto colon1 = line.find(':');
-                std::string rebuilt = short_path + line.substr(colon1);
-                result.push_back(truncate_match_content(rebuilt, short_path.size()));
+                std::string rebuilt = short_path + std::string(line.substr(colon1));
+                result.push_back(arena.add(truncate_match_content(rebuilt, short_path.size())));
                 shown++;
             }
         }
         if (indices.size() > max_matches_per_file) {
-            result.push_back("  [..." + std::to_string(indices.size() - max_matches_per_file) +
-                             " more matches in " + short_path + "]");
+            result.push_back(arena.add("  [..." +
+                std::to_string(indices.size() - max_matches_per_file) +
+                " more matches in " + short_path + "]"));
         }
     }
 
     uint32_t total = 0;
     for (const auto& [f, idxs] : file_matches) total += static_cast<uint32_t>(idxs.size());
-    result.push_back("[" + std::to_string(total) + " matches in " +
-                     std::to_string(file_matches.size()) + " files]");
+    result.push_back(arena.add("[" + std::to_string(total) + " matches in " +
+                               std::to_string(file_matches.size()) + " files]"));
 
-    return join_lines(result);
+    return result;
 }
 
 // ── HTTP response filter ────────────────────────────────────────
 // Strips verbose headers from curl/wget output, keeps status + body.
 
-static std::string filter_http_response(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.empty()) return output;
+static Lines filter_http_response(const Lines& lines, LineArena& arena) {
+    if (lines.empty()) return lines;
 
-    std::vector<std::string> kept;
+    Lines kept;
     bool in_headers = false;
     bool past_headers = false;
     uint32_t header_count = 0;
@@ -566,11 +602,12 @@ static std::string filter_http_response(const std::string& output) {
         in_headers = false;
         past_headers = true;
         if (header_count > 2) {
-            kept.push_back("[" + std::to_string(header_count - 2) + " headers stripped]");
+            kept.push_back(arena.add("[" + std::to_string(header_count - 2) +
+                                     " headers stripped]"));
         }
     };
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         // curl -v: lines starting with > or * are request headers / connection info
         if (starts_with(line, "> ") || starts_with(line, "* ") ||
             line == ">" || line == "*") {
@@ -583,7 +620,7 @@ static std::string filter_http_response(const std::string& output) {
                 continue;
             }
             // Response header — keep status line and content-type only
-            std::string hdr = line.substr(2);
+            auto hdr = line.substr(2);
             if (starts_with(hdr, "HTTP/") ||
                 contains(hdr, "content-type") || contains(hdr, "Content-Type")) {
                 kept.push_back(hdr);
@@ -616,28 +653,25 @@ static std::string filter_http_response(const std::string& output) {
         kept.push_back(line);
     }
 
-    std::string result = join_lines(kept);
-
     // Try JSON schema extraction on the body
-    std::string schema = extract_json_schema(result);
-    if (!schema.empty()) return schema;
+    std::string schema = extract_json_schema(join_lines(kept));
+    if (!schema.empty()) return own_lines(std::move(schema), arena);
 
-    return result;
+    return kept;
 }
 
 // ── Container output filter ─────────────────────────────────────
 // Compacts docker/kubectl output: truncates wide table columns,
 // strips verbose YAML/JSON metadata.
 
-static std::string filter_container_output(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 3) return output;
+static Lines filter_container_output(const Lines& lines, LineArena& arena) {
+    if (lines.size() < 3) return lines;
 
-    std::vector<std::string> kept;
+    Lines kept;
     bool in_yaml_metadata = false;
     uint32_t metadata_skipped = 0;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         // kubectl: skip verbose metadata blocks in YAML output
         if (line == "metadata:" || starts_with(line, "  metadata:")) {
             in_yaml_metadata = true;
@@ -657,7 +691,8 @@ static std::string filter_container_output(const std::string& output) {
             }
             in_yaml_metadata = false;
             if (metadata_skipped > 0) {
-                kept.push_back("    [" + std::to_string(metadata_skipped) + " metadata fields stripped]");
+                kept.push_back(arena.add("    [" + std::to_string(metadata_skipped) +
+                                         " metadata fields stripped]"));
                 metadata_skipped = 0;
             }
         }
@@ -665,31 +700,31 @@ static std::string filter_container_output(const std::string& output) {
         // docker ps/images: truncate wide COMMAND columns and IMAGE IDs
         // Keep line but cap its length for table output
         if (line.size() > 200) {
-            kept.push_back(line.substr(0, 200) + "...");
+            kept.push_back(arena.add(std::string(line.substr(0, 200)) + "..."));
         } else {
             kept.push_back(line);
         }
     }
 
     if (metadata_skipped > 0) {
-        kept.push_back("    [" + std::to_string(metadata_skipped) + " metadata fields stripped]");
+        kept.push_back(arena.add("    [" + std::to_string(metadata_skipped) +
+                                 " metadata fields stripped]"));
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
 // ── Package manager filter ──────────────────────────────────────
 // Collapses dependency trees, strips progress bars.
 
-static std::string filter_package_output(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 10) return output;
+static Lines filter_package_output(const Lines& lines, LineArena& arena) {
+    if (lines.size() < 10) return lines;
 
-    std::vector<std::string> kept;
+    Lines kept;
     uint32_t deep_deps = 0;
     int max_depth = 2; // Keep top 2 levels of dep tree
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         // Determine tree depth by counting "│   " or "    " prefix groups.
         // Tree output uses 4-char columns per level: "│   ", "├── ", "└── ", "    "
         // Each level contributes ~4 visible columns of prefix.
@@ -717,7 +752,7 @@ static std::string filter_package_output(const std::string& output) {
         // npm/pnpm indentation: pure spaces, 2 per level
         if (pos == 0) {
             size_t leading_spaces = line.find_first_not_of(' ');
-            if (leading_spaces != std::string::npos && leading_spaces > 0) {
+            if (leading_spaces != std::string_view::npos && leading_spaces > 0) {
                 depth = static_cast<int>(leading_spaces / 2);
             }
         }
@@ -731,20 +766,20 @@ static std::string filter_package_output(const std::string& output) {
     }
 
     if (deep_deps > 0) {
-        kept.push_back("[" + std::to_string(deep_deps) + " transitive dependencies hidden]");
+        kept.push_back(arena.add("[" + std::to_string(deep_deps) +
+                                 " transitive dependencies hidden]"));
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
 // ── Git operations filter ───────────────────────────────────────
 // Compress verbose git add/commit/push/pull/fetch/clone output.
 
-static std::string filter_git_ops(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> kept;
+static Lines filter_git_ops(const Lines& lines) {
+    Lines kept;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         // Skip progress indicators from push/pull/fetch/clone
         if (contains(line, "Enumerating objects:") ||
             contains(line, "Counting objects:") ||
@@ -762,43 +797,42 @@ static std::string filter_git_ops(const std::string& output) {
         kept.push_back(line);
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
 // ── GitHub CLI filter ───────────────────────────────────────────
 // Compact gh pr/issue/run list output.
 
-static std::string filter_github_cli(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 3) return output;
+static Lines filter_github_cli(const Lines& lines, LineArena& arena) {
+    if (lines.size() < 3) return lines;
 
-    std::vector<std::string> kept;
+    Lines kept;
     constexpr uint32_t max_items = 15;
     uint32_t item_count = 0;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         // Truncate wide table rows (gh outputs are tab-separated)
         if (line.size() > 150) {
-            kept.push_back(line.substr(0, 150) + "...");
+            kept.push_back(arena.add(std::string(line.substr(0, 150)) + "..."));
         } else {
             kept.push_back(line);
         }
         item_count++;
         if (item_count > max_items + 1) { // +1 for header row
-            kept.push_back("[..." + std::to_string(lines.size() - max_items - 1) + " more items]");
+            kept.push_back(arena.add("[..." + std::to_string(lines.size() - max_items - 1) +
+                                     " more items]"));
             break;
         }
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
 // ── Environment variable filter ─────────────────────────────────
 // Strips noisy env vars, keeps project-relevant ones.
 
-static std::string filter_env_vars(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 10) return output;
+static Lines filter_env_vars(const Lines& lines, LineArena& arena) {
+    if (lines.size() < 10) return lines;
 
     // Noisy env var prefixes to strip
     static const char* const noise_prefixes[] = {
@@ -809,10 +843,10 @@ static std::string filter_env_vars(const std::string& output) {
         "COLORTERM=", "TERM_PROGRAM_VERSION=",
     };
 
-    std::vector<std::string> kept;
+    Lines kept;
     uint32_t stripped = 0;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         bool is_noise = false;
         for (const char* prefix : noise_prefixes) {
             if (starts_with(line, prefix)) {
@@ -824,7 +858,8 @@ static std::string filter_env_vars(const std::string& output) {
         if (!is_noise && line.size() > 200) {
             auto eq = line.find('=');
             if (eq < 40) {  // npos is always > 40
-                kept.push_back(line.substr(0, eq + 1) + line.substr(eq + 1, 100) + "...");
+                kept.push_back(arena.add(std::string(line.substr(0, eq + 1)) +
+                                         std::string(line.substr(eq + 1, 100)) + "..."));
                 continue;
             }
         }
@@ -836,25 +871,25 @@ static std::string filter_env_vars(const std::string& output) {
     }
 
     if (stripped > 0) {
-        kept.push_back("[" + std::to_string(stripped) + " noise env vars stripped]");
+        kept.push_back(arena.add("[" + std::to_string(stripped) + " noise env vars stripped]"));
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
 // ── Dependency file summarizer ──────────────────────────────────
 // Summarize package.json, Cargo.toml, requirements.txt, etc.
 
-static std::string summarize_dep_file(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 15) return output;
+static Lines summarize_dep_file(const Lines& lines, std::string_view output,
+                                LineArena& arena) {
+    if (lines.size() < 15) return lines;
 
     // Detect format and summarize
     bool is_json = !output.empty() && (output[0] == '{' || output[0] == '[');
     bool is_toml = false;
     bool is_requirements = false;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         if (starts_with(line, "[dependencies]") || starts_with(line, "[package]")) {
             is_toml = true;
             break;
@@ -868,17 +903,17 @@ static std::string summarize_dep_file(const std::string& output) {
     if (is_json) {
         // Try JSON schema extraction for package.json
         std::string schema = extract_json_schema(output);
-        if (!schema.empty()) return schema;
+        if (!schema.empty()) return own_lines(std::move(schema), arena);
     }
 
     if (is_toml) {
         // Show section headers + first N entries per section
-        std::vector<std::string> kept;
+        Lines kept;
         constexpr uint32_t max_per_section = 10;
         uint32_t section_count = 0;
         uint32_t hidden = 0;
 
-        for (const auto& line : lines) {
+        for (auto line : lines) {
             if (starts_with(line, "[")) {
                 section_count = 0;
                 kept.push_back(line);
@@ -892,50 +927,51 @@ static std::string summarize_dep_file(const std::string& output) {
             }
         }
         if (hidden > 0) {
-            kept.push_back("[" + std::to_string(hidden) + " more entries hidden]");
+            kept.push_back(arena.add("[" + std::to_string(hidden) + " more entries hidden]"));
         }
-        return join_lines(kept);
+        return kept;
     }
 
     if (is_requirements) {
         // Show first 15 packages
         constexpr uint32_t max_pkgs = 15;
-        if (lines.size() <= max_pkgs) return output;
-        std::vector<std::string> kept(lines.begin(), lines.begin() + max_pkgs);
-        kept.push_back("[..." + std::to_string(lines.size() - max_pkgs) + " more packages]");
-        return join_lines(kept);
+        if (lines.size() <= max_pkgs) return lines;
+        Lines kept(lines.begin(), lines.begin() + max_pkgs);
+        kept.push_back(arena.add("[..." + std::to_string(lines.size() - max_pkgs) +
+                                 " more packages]"));
+        return kept;
     }
 
     // go.mod or unknown: show first 20 lines
     constexpr uint32_t max_lines_dep = 20;
-    if (lines.size() <= max_lines_dep) return output;
-    std::vector<std::string> kept(lines.begin(), lines.begin() + max_lines_dep);
-    kept.push_back("[..." + std::to_string(lines.size() - max_lines_dep) + " more lines]");
-    return join_lines(kept);
+    if (lines.size() <= max_lines_dep) return lines;
+    Lines kept(lines.begin(), lines.begin() + max_lines_dep);
+    kept.push_back(arena.add("[..." + std::to_string(lines.size() - max_lines_dep) +
+                             " more lines]"));
+    return kept;
 }
 
 // ── Diff file-level summary ─────────────────────────────────────
 // For very long diffs, add per-file +/-/~ summary at the top.
 
-static std::string enhance_git_diff(const std::string& filtered_diff) {
-    auto lines = split_lines(filtered_diff);
+static Lines enhance_git_diff(const Lines& lines, LineArena& arena) {
     // Only enhance if diff is large
-    if (lines.size() < 50) return filtered_diff;
+    if (lines.size() < 50) return lines;
 
     // Count changes per file
     struct FileStats {
         uint32_t added = 0;
         uint32_t removed = 0;
     };
-    std::vector<std::string> file_order;
-    std::unordered_map<std::string, FileStats> stats;
-    std::string current_file;
+    std::vector<std::string_view> file_order;
+    std::unordered_map<std::string_view, FileStats> stats;
+    std::string_view current_file;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         if (starts_with(line, "diff --git")) {
             // Extract file name: "diff --git a/foo b/foo" -> "foo"
             auto b_pos = line.find(" b/");
-            if (b_pos != std::string::npos) {
+            if (b_pos != std::string_view::npos) {
                 current_file = line.substr(b_pos + 3);
                 if (stats.find(current_file) == stats.end()) {
                     file_order.push_back(current_file);
@@ -951,28 +987,29 @@ static std::string enhance_git_diff(const std::string& filtered_diff) {
         }
     }
 
-    if (file_order.size() < 2) return filtered_diff;
+    if (file_order.size() < 2) return lines;
 
     // Prepend summary
-    std::string summary = "Files changed:\n";
-    for (const auto& file : file_order) {
+    Lines result;
+    result.reserve(lines.size() + file_order.size() + 2);
+    result.emplace_back("Files changed:");
+    for (auto file : file_order) {
         const auto& s = stats[file];
-        summary += "  " + file + " (+" + std::to_string(s.added) +
-                   "/-" + std::to_string(s.removed) + ")\n";
+        result.push_back(arena.add("  " + std::string(file) + " (+" + std::to_string(s.added) +
+                                   "/-" + std::to_string(s.removed) + ")"));
     }
-    summary += "\n";
-
-    return summary + filtered_diff;
+    result.emplace_back("");
+    result.insert(result.end(), lines.begin(), lines.end());
+    return result;
 }
 
 // ── npm/pnpm boilerplate stripping ──────────────────────────────
 // Called within the PackageManager filter for npm/pnpm commands.
 
-static std::string strip_npm_boilerplate(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> kept;
+static Lines strip_npm_boilerplate(const Lines& lines) {
+    Lines kept;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         // Strip script header lines: "> project@version script"
         if (starts_with(line, "> ") && contains(line, "@")) continue;
         // Strip npm WARN/notice
@@ -984,7 +1021,7 @@ static std::string strip_npm_boilerplate(const std::string& output) {
         kept.push_back(line);
     }
 
-    return join_lines(kept);
+    return kept;
 }
 
 // ── Short-circuit rules ─────────────────────────────────────────
@@ -993,7 +1030,7 @@ static std::string strip_npm_boilerplate(const std::string& output) {
 
 // Check if output matches a known success pattern without any blocker keywords.
 // Returns the replacement message, or empty string if no match.
-static std::string try_build_short_circuit(const std::string& output) {
+static std::string try_build_short_circuit(std::string_view output) {
     // Blockers: if any of these appear, don't short-circuit
     if (contains(output, "error") || contains(output, "warning") ||
         contains(output, "FAILED")) {
@@ -1008,13 +1045,23 @@ static std::string try_build_short_circuit(const std::string& output) {
 
 // ── Public API ──────────────────────────────────────────────────
 
+static bool dedupe_lines(Lines& lines, LineArena& arena);
+static Lines truncate_lines(const Lines& lines, uint32_t max_lines, LineArena& arena);
+static Lines fit_lines(const Lines& lines, const OutputFilterConfig& config, LineArena& arena);
+static bool filter_noise_lines(Lines& lines, LineArena& arena);
+
+// One split of the (ANSI-stripped) output, then each stage over views:
+// log dedup, the command-specific filter, smart truncation and the
+// generic limits, which write the result.
 std::string filter_shell_output(const std::string& command,
                                 const std::string& output,
                                 const OutputFilterConfig& config) {
     if (output.empty()) return output;
 
     // Strip ANSI first
-    std::string cleaned = config.strip_ansi ? strip_ansi_codes(output) : output;
+    std::string stripped;
+    std::string_view cleaned = config.strip_ansi ? strip_ansi_view(output, stripped)
+                                                 : std::string_view(output);
 
     auto cmd_type = classify_command(command);
 
@@ -1024,51 +1071,58 @@ std::string filter_shell_output(const std::string& command,
         if (!sc.empty()) return sc;
     }
 
+    LineArena arena;
+    Lines lines = split_lines(cleaned);
+    bool deduped = config.dedupe_log_lines && dedupe_lines(lines, arena);
+    // Filters that look at the text as a whole see the deduplicated text
+    std::string rejoined;
+    auto whole_text = [&]() -> std::string_view {
+        if (!deduped) return cleaned;
+        if (rejoined.empty()) rejoined = join_lines(lines);
+        return rejoined;
+    };
+
     // Apply command-specific filter
-    std::string filtered;
     switch (cmd_type) {
         case ShellCommandType::GitDiff:
-            filtered = filter_git_diff(cleaned);
-            filtered = enhance_git_diff(filtered);
+            lines = enhance_git_diff(filter_git_diff(lines), arena);
             break;
-        case ShellCommandType::GitStatus:  filtered = filter_git_status(cleaned);  break;
-        case ShellCommandType::GitLog:     filtered = cleaned; break;
-        case ShellCommandType::GitOps:     filtered = filter_git_ops(cleaned);     break;
-        case ShellCommandType::TestRunner: filtered = filter_test_output(cleaned); break;
+        case ShellCommandType::GitStatus:  lines = filter_git_status(lines);  break;
+        case ShellCommandType::GitLog:     break;
+        case ShellCommandType::GitOps:     lines = filter_git_ops(lines);     break;
+        case ShellCommandType::TestRunner: lines = filter_test_output(lines); break;
         case ShellCommandType::BuildLog:
-            filtered = filter_build_log(cleaned);
-            filtered = group_diagnostics(filtered);
+            lines = filter_build_log(lines);
+            group_diagnostic_lines(lines, arena);
             break;
-        case ShellCommandType::DirListing:     filtered = filter_noise_dirs(cleaned);       break;
-        case ShellCommandType::Linter:         filtered = filter_linter_output(cleaned);    break;
-        case ShellCommandType::SearchResult:   filtered = filter_search_results(cleaned);   break;
-        case ShellCommandType::HttpResponse:   filtered = filter_http_response(cleaned);    break;
-        case ShellCommandType::ContainerOps:   filtered = filter_container_output(cleaned); break;
+        case ShellCommandType::DirListing:     filter_noise_lines(lines, arena);            break;
+        case ShellCommandType::Linter:         lines = filter_linter_output(lines, arena);    break;
+        case ShellCommandType::SearchResult:   lines = filter_search_results(lines, arena);   break;
+        case ShellCommandType::HttpResponse:   lines = filter_http_response(lines, arena);    break;
+        case ShellCommandType::ContainerOps:   lines = filter_container_output(lines, arena); break;
         case ShellCommandType::PackageManager:
-            filtered = strip_npm_boilerplate(cleaned);
-            filtered = filter_package_output(filtered);
+            lines = filter_package_output(strip_npm_boilerplate(lines), arena);
+            break;
+        case ShellCommandType::GitHubCli:      lines = filter_github_cli(lines, arena);       break;
+        case ShellCommandType::EnvVars:        lines = filter_env_vars(lines, arena);         break;
+        case ShellCommandType::DepFile:
+            lines = summarize_dep_file(lines, whole_text(), arena);
             break;
-        case ShellCommandType::GitHubCli:      filtered = filter_github_cli(cleaned);       break;
-        case ShellCommandType::EnvVars:        filtered = filter_env_vars(cleaned);          break;
-        case ShellCommandType::DepFile:        filtered = summarize_dep_file(cleaned);       break;
         case ShellCommandType::Other: {
             // Try JSON schema extraction for API/curl responses
-            std::string schema = extract_json_schema(cleaned);
-            filtered = schema.empty() ? cleaned : schema;
+            std::string schema = extract_json_schema(whole_text());
+            if (!schema.empty()) lines = own_lines(std::move(schema), arena);
             break;
         }
     }
 
     // Apply generic limits as final pass.
     // Smart truncation replaces the naive line-count cut, so disable max_lines
-    // in filter_tool_output to avoid double truncation.
-    if (config.max_lines > 0) {
-        filtered = smart_truncate(filtered, config.max_lines);
-    }
+    // in the final pass to avoid double truncation.
+    lines = fit_lines(lines, config, arena);
     OutputFilterConfig final_config = config;
-    final_config.strip_ansi = false;  // already stripped
-    final_config.max_lines = 0;       // already handled by smart_truncate
-    return filter_tool_output(filtered, final_config);
+    final_config.max_lines = 0;       // already handled by smart truncation
+    return finish_lines(lines, final_config);
 }
 
 // ── JSON schema extraction ───────────────────────────────────────
@@ -1112,14 +1166,14 @@ static std::string schema_for_value(const nlohmann::json& val, int depth) {
     return json_type_name(val);
 }
 
-std::string extract_json_schema(const std::string& json_str) {
+std::string extract_json_schema(std::string_view json_str) {
     // Quick check: must start with { or [
     auto start = json_str.find_first_not_of(" \t\n\r");
-    if (start == std::string::npos) return "";
+    if (start == std::string_view::npos) return "";
     if (json_str[start] != '{' && json_str[start] != '[') return "";
 
     try {
-        auto j = nlohmann::json::parse(json_str);
+        auto j = nlohmann::json::parse(json_str.begin(), json_str.end());
         std::string schema = schema_for_value(j, 0);
 
         // Only use schema if it's meaningfully shorter
@@ -1137,11 +1191,9 @@ bool is_sensitive_command(const std::string& command) {
     if (classify_command(command) == ShellCommandType::EnvVars) return true;
 
     // Auth/token/secret-related commands not caught by classifier
-    if (contains_icase(command, "token") || contains_icase(command, "secret") ||
-        contains_icase(command, "password") || contains_icase(command, "credential") ||
-        contains_icase(command, "auth") || contains_icase(command, "login")) {
-        return true;
-    }
+    static const AhoCorasick secret_words({"token", "secret", "password", "credential",
+                                           "auth", "login"}, /*ignore_case=*/true);
+    if (secret_words.contains_any(command)) return true;
     // .env files
     if (contains(command, ".env")) return true;
 
@@ -1150,17 +1202,18 @@ bool is_sensitive_command(const std::string& command) {
 
 // Redact lines that look like key=value secrets
 static std::string redact_sensitive_output(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> result;
+    static const AhoCorasick secret_keys({"key", "secret", "token", "password",
+                                          "credential", "auth"}, /*ignore_case=*/true);
+    LineArena arena;
+    Lines lines = split_lines(output);
+    Lines result;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         auto eq = line.find('=');
-        if (eq != std::string::npos && eq > 0 && eq < line.size() - 1) {
-            std::string key = line.substr(0, eq);
-            if (contains_icase(key, "key") || contains_icase(key, "secret") ||
-                contains_icase(key, "token") || contains_icase(key, "password") ||
-                contains_icase(key, "credential") || contains_icase(key, "auth")) {
-                result.push_back(key + "=[REDACTED]");
+        if (eq != std::string_view::npos && eq > 0 && eq < line.size() - 1) {
+            std::string_view key = line.substr(0, eq);
+            if (secret_keys.contains_any(key)) {
+                result.push_back(arena.add(std::string(key) + "=[REDACTED]"));
                 continue;
             }
         }
@@ -1274,7 +1327,7 @@ static bool is_path_char(char c) {
 }
 
 // Match exactly N hex chars at pos, return true if matched
-static bool match_hex_n(const std::string& s, size_t pos, size_t n) {
+static bool match_hex_n(std::string_view s, size_t pos, size_t n) {
     if (pos + n > s.size()) return false;
     for (size_t i = 0; i < n; i++) {
         if (!is_hex(s[pos + i])) return false;
@@ -1284,7 +1337,7 @@ static bool match_hex_n(const std::string& s, size_t pos, size_t n) {
 
 // Try to match a timestamp at pos: YYYY[-/]MM[-/]DD[T ]HH:MM:SS[.,]digits
 // Returns length consumed, or 0 if no match.
-static size_t match_timestamp(const std::string& s, size_t pos) {
+static size_t match_timestamp(std::string_view s, size_t pos) {
     // Need at least "YYYY-MM-DDTHH:MM:SS" = 19 chars
     if (pos + 19 > s.size()) return 0;
     size_t i = pos;
@@ -1314,7 +1367,7 @@ static size_t match_timestamp(const std::string& s, size_t pos) {
 }
 
 // Try to match UUID at pos: 8-4-4-4-12 hex
-static size_t match_uuid(const std::string& s, size_t pos) {
+static size_t match_uuid(std::string_view s, size_t pos) {
     // 8-4-4-4-12 = 36 chars
     if (pos + 36 > s.size()) return 0;
     size_t i = pos;
@@ -1330,11 +1383,12 @@ static size_t match_uuid(const std::string& s, size_t pos) {
     return 36;
 }
 
-// Normalize a log line by stripping timestamps, UUIDs, hex, and large numbers.
+// Normalize a log line into `out` by stripping timestamps, UUIDs, hex, and
+// large numbers. `out` is reused across lines, so this does not allocate
+// once it has grown to the longest line.
 // Uses hand-written matchers instead of std::regex to avoid binary bloat.
-static std::string normalize_log_line(const std::string& line) {
-    std::string out;
-    out.reserve(line.size());
+static void normalize_log_line(std::string_view line, std::string& out) {
+    out.clear();
     size_t i = 0;
 
     while (i < line.size()) {
@@ -1364,7 +1418,7 @@ static std::string normalize_log_line(const std::string& line) {
             if (at_boundary && (i - start) >= 4) {
                 out += "<N>";
             } else {
-                out.append(line, start, i - start);
+                out.append(line.substr(start, i - start));
             }
             continue;
         }
@@ -1377,57 +1431,67 @@ static std::string normalize_log_line(const std::string& line) {
             continue;
         }
 
-        out += line[i];
-        i++;
+        // Copy up to the next character a matcher could start at
+        size_t next = i + 1;
+        while (next < line.size() && !is_digit(line[next]) && line[next] != '/') next++;
+        out.append(line.substr(i, next - i));
+        i = next;
     }
-    return out;
 }
 
-std::string deduplicate_log_lines(const std::string& output) {
-    if (output.empty()) return output;
-
-    auto lines = split_lines(output);
-    if (lines.size() < 10) return output;  // not worth deduplicating short output
-
-    // Group consecutive identical (normalized) lines
-    struct Group {
-        std::string original;  // first occurrence (un-normalized)
-        std::string normalized;
-        uint32_t count = 1;
+// Collapse runs of lines that are equal once normalized into the first of
+// them, prefixed "[xN] ". Returns false, leaving `lines` alone, when the
+// output is short or nothing repeats.
+static bool dedupe_lines(Lines& lines, LineArena& arena) {
+    if (lines.size() < 10) return false;  // not worth deduplicating short output
+
+    std::string prev_norm;
+    std::string norm;
+    Lines result;
+    size_t group_start = 0;
+    bool collapsed = false;
+
+    auto close_group = [&](size_t end) {
+        size_t count = end - group_start;
+        if (count > 1) {
+            result.push_back(arena.add("[x" + std::to_string(count) + "] " +
+                                       std::string(lines[group_start])));
+            collapsed = true;
+        } else {
+            result.push_back(lines[group_start]);
+        }
     };
 
-    std::vector<Group> groups;
-    for (const auto& line : lines) {
-        std::string norm = normalize_log_line(line);
-        if (!groups.empty() && groups.back().normalized == norm) {
-            groups.back().count++;
-        } else {
-            groups.push_back({line, norm, 1});
+    for (size_t i = 0; i < lines.size(); i++) {
+        normalize_log_line(lines[i], norm);
+        if (i > 0 && norm != prev_norm) {
+            close_group(i);
+            group_start = i;
         }
+        std::swap(norm, prev_norm);
     }
+    close_group(lines.size());
 
-    // If no deduplication happened, return original
-    if (groups.size() == lines.size()) return output;
+    if (!collapsed) return false;
+    lines = std::move(result);
+    return true;
+}
 
-    std::vector<std::string> result;
-    result.reserve(groups.size());
-    for (const auto& g : groups) {
-        if (g.count > 1) {
-            result.push_back("[x" + std::to_string(g.count) + "] " + g.original);
-        } else {
-            result.push_back(g.original);
-        }
-    }
+std::string deduplicate_log_lines(const std::string& output) {
+    if (output.empty()) return output;
 
-    return join_lines(result);
+    LineArena arena;
+    Lines lines = split_lines(output);
+    if (!dedupe_lines(lines, arena)) return output;
+    return join_lines(lines);
 }
 
 // ── Smart truncation ────────────────────────────────────────────
 
-static bool is_structural_line(const std::string& line) {
-    std::string trimmed = line;
+static bool is_structural_line(std::string_view line) {
+    std::string_view trimmed = line;
     auto start = trimmed.find_first_not_of(" \t");
-    if (start != std::string::npos) trimmed = trimmed.substr(start);
+    if (start != std::string_view::npos) trimmed = trimmed.substr(start);
 
     // Function/method signatures
     if (starts_with(trimmed, "def ") || starts_with(trimmed, "fn ") ||
@@ -1459,16 +1523,14 @@ static bool is_structural_line(const std::string& line) {
     return false;
 }
 
-std::string smart_truncate(const std::string& output, uint32_t max_lines) {
-    auto lines = split_lines(output);
-    if (lines.size() <= max_lines) return output;
-
+// Callers check lines.size() > max_lines first
+static Lines truncate_lines(const Lines& lines, uint32_t max_lines, LineArena& arena) {
     // Reserve slots: first 20% for head, last 20% for tail, middle for important lines
     uint32_t head_count = max_lines / 5;
     uint32_t tail_count = max_lines / 5;
     uint32_t middle_budget = max_lines - head_count - tail_count - 1; // -1 for marker
 
-    std::vector<std::string> result;
+    Lines result;
     result.reserve(max_lines + 2);
 
     // Head section
@@ -1486,7 +1548,7 @@ std::string smart_truncate(const std::string& output, uint32_t max_lines) {
         if (is_structural_line(lines[i])) {
             if (i > last_kept_idx + 1) {
                 auto skipped = static_cast<uint32_t>(i - last_kept_idx - 1);
-                result.push_back("[..." + std::to_string(skipped) + " lines omitted]");
+                result.push_back(arena.add("[..." + std::to_string(skipped) + " lines omitted]"));
             }
             result.push_back(lines[i]);
             structural_kept++;
@@ -1497,7 +1559,7 @@ std::string smart_truncate(const std::string& output, uint32_t max_lines) {
     // Omission marker for remaining middle
     if (middle_end > last_kept_idx + 1) {
         auto skipped = static_cast<uint32_t>(middle_end - last_kept_idx - 1);
-        result.push_back("[..." + std::to_string(skipped) + " lines omitted]");
+        result.push_back(arena.add("[..." + std::to_string(skipped) + " lines omitted]"));
     }
 
     // Tail section
@@ -1505,7 +1567,50 @@ std::string smart_truncate(const std::string& output, uint32_t max_lines) {
         result.push_back(lines[i]);
     }
 
-    return join_lines(result);
+    return result;
+}
+
+// Characters finish_lines would emit for `lines`, before its own limits
+static size_t rendered_size(const Lines& lines, uint32_t max_line_length) {
+    size_t total = 0;
+    for (auto line : lines) {
+        bool cut = max_line_length > 0 && line.size() > max_line_length;
+        total += (cut ? max_line_length + 3 : line.size()) + 1;
+    }
+    return total;
+}
+
+// Smart truncation to both max_lines and max_total_chars. Without the
+// character target a tight budget would leave finish_lines to cut off
+// everything past the first max_total_chars, losing the tail; instead the
+// line target shrinks until the kept head, tail and structural lines fit.
+static Lines fit_lines(const Lines& lines, const OutputFilterConfig& config, LineArena& arena) {
+    constexpr uint32_t kMinLines = 10;  // below this the plain cut is as good
+    auto target = static_cast<uint32_t>(lines.size());
+    Lines fitted = lines;
+    if (config.max_lines > 0 && lines.size() > config.max_lines) {
+        target = config.max_lines;
+        fitted = truncate_lines(lines, target, arena);
+    }
+    for (int attempt = 0; attempt < 4 && config.max_total_chars > 0; attempt++) {
+        size_t size = rendered_size(fitted, config.max_line_length);
+        if (size <= config.max_total_chars) break;
+        // Scale by the overshoot, with 10% slack for uneven line lengths
+        auto next = static_cast<uint32_t>(static_cast<uint64_t>(target) *
+                                          config.max_total_chars / size * 9 / 10);
+        if (next < kMinLines || next >= target) break;
+        target = next;
+        fitted = truncate_lines(lines, target, arena);
+    }
+    return fitted;
+}
+
+std::string smart_truncate(const std::string& output, uint32_t max_lines) {
+    Lines lines = split_lines(output);
+    if (lines.size() <= max_lines) return output;
+
+    LineArena arena;
+    return join_lines(truncate_lines(lines, max_lines, arena));
 }
 
 // ── Diagnostic grouping ─────────────────────────────────────────
@@ -1513,104 +1618,91 @@ std::string smart_truncate(const std::string& output, uint32_t max_lines) {
 // Extract the diagnostic message from a compiler line, stripping location.
 // E.g. "src/foo.cpp:10:5: warning: unused variable 'x'" -> "warning: unused variable 'x'"
 // Returns empty if the line doesn't look like a diagnostic.
-static std::string extract_diagnostic_key(const std::string& line) {
+static std::string_view extract_diagnostic_key(std::string_view line) {
     // Match patterns like "file:line:col: type: message" or "file(line): type: message"
     // Look for "error:" or "warning:" after a location prefix
-    for (const char* tag : {"error:", "warning:", "note:"}) {
+    for (std::string_view tag : {"error:", "warning:", "note:"}) {
         auto pos = line.find(tag);
-        if (pos != std::string::npos && pos > 0) {
+        if (pos != std::string_view::npos && pos > 0) {
             return line.substr(pos);
         }
     }
-    return "";
+    return {};
 }
 
 // Extract just the file path from a diagnostic line.
-static std::string extract_diagnostic_file(const std::string& line) {
+static std::string_view extract_diagnostic_file(std::string_view line) {
     // "src/foo.cpp:10:5: ..." or "src/foo.cpp(10): ..."
     auto colon = line.find(':');
     auto paren = line.find('(');
-    size_t end = std::string::npos;
-    if (colon != std::string::npos && paren != std::string::npos) {
+    size_t end = std::string_view::npos;
+    if (colon != std::string_view::npos && paren != std::string_view::npos) {
         end = std::min(colon, paren);
-    } else if (colon != std::string::npos) {
+    } else if (colon != std::string_view::npos) {
         end = colon;
-    } else if (paren != std::string::npos) {
+    } else if (paren != std::string_view::npos) {
         end = paren;
     }
-    if (end != std::string::npos && end > 0) {
+    if (end != std::string_view::npos && end > 0) {
         return line.substr(0, end);
     }
-    return "";
+    return {};
 }
 
-std::string group_diagnostics(const std::string& output) {
-    auto lines = split_lines(output);
-    if (lines.size() < 5) return output;  // too short to benefit
+// Returns false, leaving `lines` alone, when no diagnostic repeats
+static bool group_diagnostic_lines(Lines& lines, LineArena& arena) {
+    if (lines.size() < 5) return false;  // too short to benefit
 
     // First pass: count each unique diagnostic message
     struct DiagInfo {
-        std::string first_line;  // full line of first occurrence
-        std::vector<std::string> files;  // files where it appears
+        std::string_view first_line;  // full line of first occurrence
+        std::vector<std::string_view> files;  // files where it appears
         uint32_t count = 0;
     };
-    std::unordered_map<std::string, DiagInfo> diag_counts;
-    std::vector<std::string> diag_order;  // preserve first-seen order
+    std::unordered_map<std::string_view, DiagInfo> diag_counts;
+    bool has_duplicates = false;
 
-    for (const auto& line : lines) {
-        std::string key = extract_diagnostic_key(line);
+    for (auto line : lines) {
+        auto key = extract_diagnostic_key(line);
         if (key.empty()) continue;
 
-        auto it = diag_counts.find(key);
-        if (it == diag_counts.end()) {
-            DiagInfo info;
+        auto [it, inserted] = diag_counts.try_emplace(key);
+        auto& info = it->second;
+        info.count++;
+        auto file = extract_diagnostic_file(line);
+        if (inserted) {
             info.first_line = line;
-            info.count = 1;
-            std::string file = extract_diagnostic_file(line);
             if (!file.empty()) info.files.push_back(file);
-            diag_counts[key] = std::move(info);
-            diag_order.push_back(key);
-        } else {
-            it->second.count++;
-            std::string file = extract_diagnostic_file(line);
-            if (!file.empty() && it->second.files.size() < 5) {
-                // Avoid duplicate file names
-                bool found = false;
-                for (const auto& f : it->second.files) {
-                    if (f == file) { found = true; break; }
-                }
-                if (!found) it->second.files.push_back(file);
-            }
+            continue;
+        }
+        has_duplicates = true;
+        if (!file.empty() && info.files.size() < 5 &&
+            std::find(info.files.begin(), info.files.end(), file) == info.files.end()) {
+            // Avoid duplicate file names
+            info.files.push_back(file);
         }
     }
 
     // If no grouping benefit (all unique), return as-is
-    bool has_duplicates = false;
-    for (const auto& key : diag_order) {
-        if (diag_counts[key].count > 1) { has_duplicates = true; break; }
-    }
-    if (!has_duplicates) return output;
+    if (!has_duplicates) return false;
 
     // Second pass: rebuild output, replacing duplicate diagnostics with grouped form
-    std::unordered_set<std::string> emitted;
-    std::vector<std::string> result;
+    std::unordered_set<std::string_view> emitted;
+    Lines result;
 
-    for (const auto& line : lines) {
-        std::string key = extract_diagnostic_key(line);
+    for (auto line : lines) {
+        auto key = extract_diagnostic_key(line);
         if (key.empty()) {
             // Non-diagnostic line — keep as-is
             result.push_back(line);
             continue;
         }
 
-        if (emitted.count(key) > 0) continue;  // already grouped
-        emitted.insert(key);
+        if (!emitted.insert(key).second) continue;  // already grouped
 
         const auto& info = diag_counts[key];
-        if (info.count == 1) {
-            result.push_back(info.first_line);
-        } else {
-            result.push_back(info.first_line);
+        result.push_back(info.first_line);
+        if (info.count > 1) {
             std::string summary = "  (" + std::to_string(info.count - 1) + " more";
             if (info.files.size() > 1) {
                 summary += " in ";
@@ -1623,48 +1715,52 @@ std::string group_diagnostics(const std::string& output) {
                 }
             }
             summary += ")";
-            result.push_back(summary);
+            result.push_back(arena.add(std::move(summary)));
         }
     }
 
-    return join_lines(result);
+    lines = std::move(result);
+    return true;
+}
+
+std::string group_diagnostics(const std::string& output) {
+    LineArena arena;
+    Lines lines = split_lines(output);
+    if (!group_diagnostic_lines(lines, arena)) return output;
+    return join_lines(lines);
 }
 
 // ── Noise directory filtering ───────────────────────────────────
 
-static const char* const noise_dirs[] = {
+static const std::vector<std::string_view> noise_dirs = {
     "node_modules", ".git", "__pycache__", ".next",
     ".cache", ".turbo", ".vercel", ".pytest_cache", ".mypy_cache",
     ".tox", ".venv", "venv", ".env", "coverage", ".nyc_output",
     ".DS_Store", "Thumbs.db", ".idea", ".vscode", ".vs",
 };
 
-static bool is_noise_path(const std::string& line) {
-    for (const char* dir : noise_dirs) {
-        size_t dir_len = strlen(dir);
-        // Find all occurrences of the noise dir name in the line
-        size_t pos = 0;
-        while ((pos = line.find(dir, pos)) != std::string::npos) {
-            // Check boundary: must be preceded by non-alnum (/, space, tree decoration, start)
-            bool left_ok = (pos == 0) ||
-                           !std::isalnum(static_cast<unsigned char>(line[pos - 1]));
-            // Check boundary: must be followed by non-alnum (/, end, space, tree decoration)
-            size_t end = pos + dir_len;
-            bool right_ok = (end == line.size()) ||
-                            !std::isalnum(static_cast<unsigned char>(line[end]));
-            if (left_ok && right_ok) return true;
-            pos = end;
-        }
-    }
-    return false;
+static bool is_noise_path(std::string_view line) {
+    static const AhoCorasick matcher(noise_dirs);
+
+    // Any occurrence of a noise dir name that stands alone as a path component
+    return matcher.scan(line, [&](uint32_t dir, size_t pos) {
+        // Check boundary: must be preceded by non-alnum (/, space, tree decoration, start)
+        bool left_ok = (pos == 0) ||
+                       !std::isalnum(static_cast<unsigned char>(line[pos - 1]));
+        // Check boundary: must be followed by non-alnum (/, end, space, tree decoration)
+        size_t end = pos + noise_dirs[dir].size();
+        bool right_ok = (end == line.size()) ||
+                        !std::isalnum(static_cast<unsigned char>(line[end]));
+        return left_ok && right_ok;
+    });
 }
 
-std::string filter_noise_dirs(const std::string& output) {
-    auto lines = split_lines(output);
-    std::vector<std::string> kept;
+// Returns false, leaving `lines` alone, when nothing was stripped
+static bool filter_noise_lines(Lines& lines, LineArena& arena) {
+    Lines kept;
     uint32_t stripped = 0;
 
-    for (const auto& line : lines) {
+    for (auto line : lines) {
         if (is_noise_path(line)) {
             stripped++;
         } else {
@@ -1672,11 +1768,20 @@ std::string filter_noise_dirs(const std::string& output) {
         }
     }
 
-    if (stripped == 0) return output;
+    if (stripped == 0) return false;
 
-    std::string result = join_lines(kept);
-    result += "\n[" + std::to_string(stripped) + " noise entries stripped]";
-    return result;
+    // The marker goes on a line of its own, after an empty one if nothing is left
+    if (kept.empty()) kept.emplace_back("");
+    kept.push_back(arena.add("[" + std::to_string(stripped) + " noise entries stripped]"));
+    lines = std::move(kept);
+    return true;
+}
+
+std::string filter_noise_dirs(const std::string& output) {
+    LineArena arena;
+    Lines lines = split_lines(output);
+    if (!filter_noise_lines(lines, arena)) return output;
+    return join_lines(lines);
 }
 
 } // namespace ptrclaw
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 namespace ptrclaw {
@@ -10,8 +11,13 @@ struct OutputFilterConfig {
     uint32_t max_total_chars = 20000;  // hard character limit
     bool strip_ansi = true;            // remove ANSI escape codes
     bool collapse_blank_lines = true;  // consecutive blank lines -> one
+    bool dedupe_log_lines = false;     // collapse repeated log lines first (see deduplicate_log_lines)
 };
 
+// Limits sized for output of about `tokens` tokens; 5000 tokens gives the
+// defaults above. Used to fit tool results into the context still free.
+OutputFilterConfig filter_config_for_tokens(uint32_t tokens);
+
 // Filter tool output to reduce token consumption.
 // Returns the (possibly truncated) output string.
 std::string filter_tool_output(const std::string& output,
@@ -41,7 +47,7 @@ bool is_sensitive_command(const std::string& command);
 // Extract a compact JSON schema from a JSON value.
 // E.g. {"name":"John","age":42} -> {name: string, age: number}
 // Returns empty string if input is not valid JSON or schema is longer.
-std::string extract_json_schema(const std::string& json_str);
+std::string extract_json_schema(std::string_view json_str);
 
 // Deduplicate repeated log lines. Normalizes timestamps, UUIDs, hex, and
 // large numbers before grouping. Returns output with counts, e.g. "[x3] msg".
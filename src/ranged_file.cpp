@@ -0,0 +1,203 @@
+#include "ranged_file.hpp"
+#include "text_scan.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace ptrclaw {
+
+// ── RangedFile ──────────────────────────────────────────────────
+
+static int64_t file_mtime_ns(const struct stat& st) {
+#ifdef __APPLE__
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+RangedFile::~RangedFile() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool RangedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || S_ISDIR(st.st_mode)) {
+        int err = S_ISDIR(st.st_mode) ? EISDIR : errno;
+        ::close(fd);
+        errno = err;
+        return false;
+    }
+    device_ = static_cast<uint64_t>(st.st_dev);
+    inode_ = static_cast<uint64_t>(st.st_ino);
+    mtime_ns_ = file_mtime_ns(st);
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        fd_ = fd;
+        size_ = static_cast<uint64_t>(st.st_size);
+        return true;
+    }
+
+    // No size to go by (pipe, /proc file): read what there is
+    buffered_ = true;
+    char chunk[65536];
+    while (buffer_.size() < kMaxBufferedBytes) {
+        size_t want = std::min(sizeof(chunk), kMaxBufferedBytes - buffer_.size());
+        ssize_t n = ::read(fd, chunk, want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer_.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    size_ = buffer_.size();
+    return true;
+}
+
+bool RangedFile::read(uint64_t offset, size_t length, std::string& out) const {
+    if (offset >= size_) return true;
+    length = static_cast<size_t>(std::min<uint64_t>(length, size_ - offset));
+    if (buffered_) {
+        out.append(buffer_, static_cast<size_t>(offset), length);
+        return true;
+    }
+
+    size_t start = out.size();
+    out.resize(start + length);
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(fd_, &out[start + done], length - done,
+                            static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            out.resize(start + done);
+            return false;
+        }
+        if (n == 0) break;  // truncated since open()
+        done += static_cast<size_t>(n);
+    }
+    out.resize(start + done);
+    return true;
+}
+
+// ── LineIndex ───────────────────────────────────────────────────
+
+static constexpr size_t kIndexBlockBytes = 1u << 20;  // read while building
+static constexpr size_t kScanBlockBytes = 64u << 10;  // read past a checkpoint
+
+LineIndex::LineIndex(const RangedFile& file) : size_(file.size()) {
+    checkpoints_.push_back(0);
+    uint64_t newlines = 0;
+    char last = '\n';
+    std::string block;
+    uint64_t pos = 0;
+    while (pos < size_) {
+        block.clear();
+        if (!file.read(pos, kIndexBlockBytes, block) || block.empty()) break;
+
+        // Walk the newlines only in blocks where a checkpoint falls
+        size_t count = count_byte(block, '\n');
+        uint64_t next = checkpoints_.size() * kStride;
+        if (newlines + count >= next) {
+            uint64_t seen = newlines;
+            for (size_t p = find_byte(block, '\n'); p != std::string::npos;
+                 p = find_byte(block, '\n', p + 1)) {
+                if (++seen == checkpoints_.size() * kStride) checkpoints_.push_back(pos + p + 1);
+            }
+        }
+        newlines += count;
+        last = block.back();
+        pos += block.size();
+    }
+    size_ = pos;  // short if the file shrank or a read failed
+    lines_ = newlines + (last != '\n' ? 1 : 0);
+}
+
+uint64_t LineIndex::line_start(const RangedFile& file, uint64_t line) const {
+    if (line >= lines_) return size_;
+    uint64_t pos = checkpoints_[line / kStride];
+    uint64_t skip = line % kStride;
+    std::string chunk;
+    while (skip > 0) {
+        chunk.clear();
+        if (!file.read(pos, kScanBlockBytes, chunk) || chunk.empty()) return size_;
+        for (size_t p = find_byte(chunk, '\n'); p != std::string::npos;
+             p = find_byte(chunk, '\n', p + 1)) {
+            if (--skip == 0) return pos + p + 1;
+        }
+        pos += chunk.size();
+    }
+    return pos;
+}
+
+uint64_t LineIndex::line_at(const RangedFile& file, uint64_t offset) const {
+    offset = std::min(offset, size_);
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset);
+    auto k = static_cast<uint64_t>(it - checkpoints_.begin() - 1);
+    uint64_t line = k * kStride;
+    uint64_t pos = checkpoints_[k];
+    std::string chunk;
+    while (pos < offset) {
+        chunk.clear();
+        auto want = static_cast<size_t>(std::min<uint64_t>(kScanBlockBytes, offset - pos));
+        if (!file.read(pos, want, chunk) || chunk.empty()) break;
+        line += count_byte(chunk, '\n');
+        pos += chunk.size();
+    }
+    return line;
+}
+
+// ── Index cache ─────────────────────────────────────────────────
+
+namespace {
+
+struct CachedIndex {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    std::shared_ptr<const LineIndex> index;
+    uint64_t last_use = 0;
+};
+
+constexpr size_t kMaxCachedIndexes = 8;
+
+std::mutex cache_mutex;
+std::unordered_map<std::string, CachedIndex> cache;  // by path
+uint64_t cache_clock = 0;
+
+} // namespace
+
+std::shared_ptr<const LineIndex> line_index_for(const RangedFile& file, const std::string& path) {
+    if (file.size() < kCachedIndexBytes) return std::make_shared<LineIndex>(file);
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(path);
+        if (it != cache.end() && it->second.device == file.device() &&
+            it->second.inode == file.inode() && it->second.size == file.size() &&
+            it->second.mtime_ns == file.mtime_ns()) {
+            it->second.last_use = ++cache_clock;
+            return it->second.index;
+        }
+    }
+
+    // Build outside the lock: it reads the whole file
+    auto index = std::make_shared<const LineIndex>(file);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache[path] = CachedIndex{file.device(), file.inode(), file.size(), file.mtime_ns(),
+                              index, ++cache_clock};
+    while (cache.size() > kMaxCachedIndexes) {
+        auto oldest = std::min_element(cache.begin(), cache.end(),
+            [](const auto& a, const auto& b) { return a.second.last_use < b.second.last_use; });
+        cache.erase(oldest);
+    }
+    return index;
+}
+
+} // namespace ptrclaw
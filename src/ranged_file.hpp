@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ptrclaw {
+
+// Random access to a file's bytes. Regular files are read with pread, so
+// only the ranges asked for are read and memory does not grow with the
+// file (unlike mmap, a file truncated underneath cannot fault the process).
+// Pipes and /proc-style files that report no size are read into memory
+// once, up to kMaxBufferedBytes.
+class RangedFile {
+public:
+    static constexpr size_t kMaxBufferedBytes = 16u << 20;
+
+    RangedFile() = default;
+    ~RangedFile();
+    RangedFile(const RangedFile&) = delete;
+    RangedFile& operator=(const RangedFile&) = delete;
+
+    // Returns false with errno set if the file cannot be opened or is a
+    // directory
+    bool open(const std::string& path);
+
+    uint64_t size() const { return size_; }
+
+    // Append up to `length` bytes starting at `offset` to `out`; fewer at
+    // the end of the file. Returns false on a read error.
+    bool read(uint64_t offset, size_t length, std::string& out) const;
+
+    // Identity of the opened version, for caches keyed by path
+    uint64_t device() const { return device_; }
+    uint64_t inode() const { return inode_; }
+    int64_t mtime_ns() const { return mtime_ns_; }
+
+private:
+    int fd_ = -1;
+    bool buffered_ = false;
+    std::string buffer_;
+    uint64_t size_ = 0;
+    uint64_t device_ = 0;
+    uint64_t inode_ = 0;
+    int64_t mtime_ns_ = 0;
+};
+
+// Start offsets of every kStride-th line of a file, so that finding a line
+// reads at most kStride lines past the nearest checkpoint: a line range
+// costs O(range) rather than O(offset). Building it is one pass over the
+// file, counting newlines a block at a time.
+class LineIndex {
+public:
+    static constexpr uint64_t kStride = 1024;
+
+    explicit LineIndex(const RangedFile& file);
+
+    // Lines in the file; a last line without '\n' counts
+    uint64_t line_count() const { return lines_; }
+
+    // Offset of the first byte of 0-based `line`; file.size() for lines
+    // past the end
+    uint64_t line_start(const RangedFile& file, uint64_t line) const;
+
+    // 0-based line containing byte `offset`
+    uint64_t line_at(const RangedFile& file, uint64_t offset) const;
+
+private:
+    uint64_t size_ = 0;
+    uint64_t lines_ = 0;
+    std::vector<uint64_t> checkpoints_;  // start of line k * kStride
+};
+
+// Index of `file` (opened from `path`). Indexes of files of at least
+// kCachedIndexBytes are kept for the next call on the same version of the
+// file (device, inode, size and mtime unchanged).
+constexpr uint64_t kCachedIndexBytes = 1u << 20;
+std::shared_ptr<const LineIndex> line_index_for(const RangedFile& file, const std::string& path);
+
+} // namespace ptrclaw
@@ -4,9 +4,16 @@
 #include "onboard.hpp"
 #include "event.hpp"
 #include "event_bus.hpp"
+#include "metrics.hpp"
 #include "tool_manager.hpp"
 #include "plugin.hpp"
 #include "util.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
 #ifdef PTRCLAW_HAS_OPENAI
 #include "providers/oauth_openai.hpp"
 #endif
@@ -15,19 +22,28 @@ namespace ptrclaw {
 
 SessionManager::SessionManager(Config& config, HttpClient& http)
     : config_(config), http_(http)
+    , wheel_tick_(epoch_seconds())
+    , idle_timeout_(config.sessions.max_idle_seconds)
 {}
 
-Session SessionManager::create_session(const std::string& session_id) {
+SessionManager::~SessionManager() {
+    stop_workers();
+}
+
+SessionManager::Shard& SessionManager::shard_for(const std::string& session_id) {
+    return shards_[std::hash<std::string>{}(session_id) % kShardCount];
+}
+
+void SessionManager::create_session(Session& session) {
+    std::shared_lock<std::shared_mutex> config_lock(config_mutex_);
     auto sr = switch_provider(
         config_.provider, config_.model, config_.model, config_, http_);
     if (!sr.provider) {
         throw std::runtime_error("Cannot create provider: " + sr.error);
     }
 
-    Session session;
-    session.id = session_id;
+    const std::string& session_id = session.id;
     session.agent = std::make_unique<Agent>(std::move(sr.provider), config_);
-    session.last_active = epoch_seconds();
 
     if (!binary_path_.empty()) {
         session.agent->set_binary_path(binary_path_);
@@ -51,52 +67,404 @@ Session SessionManager::create_session(const std::string& session_id) {
     if (embedder_) {
         session.agent->set_embedder(embedder_);
     }
+}
 
-    return session;
+std::string SessionManager::snapshot_path(const std::string& session_id) const {
+    std::string dir = config_.sessions.hibernate_dir.empty()
+        ? expand_home("~/.ptrclaw/sessions")
+        : expand_home(config_.sessions.hibernate_dir);
+
+    // Session IDs come from channels (chat IDs, phone numbers) — keep
+    // filename-safe characters and percent-encode the rest.
+    static const char* hex = "0123456789abcdef";
+    std::string name;
+    name.reserve(session_id.size());
+    for (unsigned char c : session_id) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.') {
+            name += static_cast<char>(c);
+        } else {
+            name += '%';
+            name += hex[c >> 4];
+            name += hex[c & 0xF];
+        }
+    }
+    if (name.empty() || name[0] == '.') name = "%" + name;
+    return dir + "/" + name + ".json";
 }
 
-Agent& SessionManager::get_session(const std::string& session_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void SessionManager::rehydrate(Session& session) {
+    if (!config_.sessions.hibernate) return;
+
+    // Evicted moments ago: its snapshot may still be on its way to disk
+    {
+        std::unique_lock<std::mutex> lock(hibernating_mutex_);
+        hibernating_cv_.wait(lock, [&] { return !hibernating_.count(session.id); });
+    }
+
+    std::string path = snapshot_path(session.id);
+    nlohmann::json snap;
+    {
+        std::ifstream file(path);
+        if (!file.is_open()) return;
+        try {
+            snap = nlohmann::json::parse(file);
+        } catch (...) {
+            std::cerr << "[session] Discarding corrupt snapshot: " << path << "\n";
+            std::remove(path.c_str());
+            return;
+        }
+    }
+    std::remove(path.c_str());
+
+    // Restore the provider the session was using if it differs from default
+    std::string prov = snap.value("provider", "");
+    if (!prov.empty() && prov != session.agent->provider_name()) {
+        std::shared_lock<std::shared_mutex> config_lock(config_mutex_);
+        auto sr = switch_provider(prov, snap.value("model", ""),
+                                  session.agent->model(), config_, http_);
+        if (sr.provider) {
+            session.agent->set_provider(std::move(sr.provider));
+        } else {
+            // Provider no longer usable — keep history on the default provider
+            snap.erase("model");
+        }
+    }
+
+    session.agent->restore(snap);
+}
+
+// ── Eviction index ──────────────────────────────────────────────
+
+void SessionManager::lru_unlink(Session& session) {
+    if (session.lru_prev) session.lru_prev->lru_next = session.lru_next;
+    else lru_head_ = session.lru_next;
+    if (session.lru_next) session.lru_next->lru_prev = session.lru_prev;
+    else lru_tail_ = session.lru_prev;
+    session.lru_prev = session.lru_next = nullptr;
+}
+
+void SessionManager::lru_push_front(Session& session) {
+    session.lru_prev = nullptr;
+    session.lru_next = lru_head_;
+    if (lru_head_) lru_head_->lru_prev = &session;
+    lru_head_ = &session;
+    if (!lru_tail_) lru_tail_ = &session;
+}
+
+void SessionManager::wheel_link(Session& session, uint64_t due) {
+    // Already-due entries land on the next processed tick
+    session.wheel_due = std::max(due, wheel_tick_ + 1);
+    auto& head = wheel_[session.wheel_due % kWheelSlots];
+    session.wheel_prev = nullptr;
+    session.wheel_next = head;
+    if (head) head->wheel_prev = &session;
+    head = &session;
+    session.on_wheel = true;
+}
+
+void SessionManager::wheel_unlink(Session& session) {
+    // Expired entries are already off the wheel when they are evicted
+    if (!session.on_wheel) return;
+    session.on_wheel = false;
+    if (session.wheel_prev) {
+        session.wheel_prev->wheel_next = session.wheel_next;
+    } else {
+        wheel_[session.wheel_due % kWheelSlots] = session.wheel_next;
+    }
+    if (session.wheel_next) session.wheel_next->wheel_prev = session.wheel_prev;
+    session.wheel_prev = session.wheel_next = nullptr;
+}
+
+void SessionManager::index_insert(Session& session) {
+    lru_push_front(session);
+    wheel_link(session, session.last_active.load(std::memory_order_relaxed)
+                        + idle_timeout_ + 1);
+    session.indexed = true;
+}
+
+void SessionManager::index_remove(Session& session) {
+    if (!session.indexed) return;
+    lru_unlink(session);
+    wheel_unlink(session);
+    history_bytes_ -= session.history_bytes;
+    session.history_bytes = 0;
+    session.indexed = false;
+}
+
+void SessionManager::wheel_rebuild(uint64_t now) {
+    wheel_.fill(nullptr);
+    for (Session* s = lru_head_; s; s = s->lru_next) s->on_wheel = false;
+    wheel_tick_ = now - 1; // entries already past due fire on this pass
+    for (Session* s = lru_head_; s; s = s->lru_next) {
+        wheel_link(*s, s->last_active.load(std::memory_order_relaxed)
+                       + idle_timeout_ + 1);
+    }
+}
+
+std::vector<Session*> SessionManager::wheel_advance(uint64_t now) {
+    std::vector<Session*> expired;
+    if (now <= wheel_tick_) return expired;
+
+    // A gap longer than the wheel visits every bucket exactly once
+    uint64_t last = std::min<uint64_t>(now, wheel_tick_ + kWheelSlots);
+    for (uint64_t tick = wheel_tick_ + 1; tick <= last; ++tick) {
+        Session* s = wheel_[tick % kWheelSlots];
+        while (s) {
+            Session* next = s->wheel_next;
+            if (s->wheel_due <= now) {
+                wheel_unlink(*s);
+                uint64_t due = s->last_active.load(std::memory_order_relaxed)
+                               + idle_timeout_ + 1;
+                if (due > now) {
+                    wheel_link(*s, due); // touched since scheduling
+                } else {
+                    expired.push_back(s);
+                }
+            }
+            s = next;
+        }
+    }
+    wheel_tick_ = now;
+    return expired;
+}
+
+void SessionManager::touch(Session& session) {
+    uint64_t now = clock_();
+    // LRU order only needs second resolution — repeated lookups within the
+    // same second skip the index lock entirely.
+    if (session.last_active.exchange(now, std::memory_order_relaxed) == now) return;
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (!session.indexed) return;
+    lru_unlink(session);
+    lru_push_front(session);
+}
+
+void SessionManager::update_footprint(Session& session) {
+    size_t bytes = session.agent->history_bytes();
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (!session.indexed) return;
+    history_bytes_ = history_bytes_ - session.history_bytes + bytes;
+    session.history_bytes = bytes;
+}
+
+size_t SessionManager::history_bytes() const {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    return history_bytes_;
+}
+
+// ── Eviction ────────────────────────────────────────────────────
+
+SessionManager::Evicted SessionManager::detach(Shard& shard, SessionMap::iterator it) {
+    Evicted evicted{it->first, std::move(it->second), {}};
+    Session& session = *evicted.session;
+    if (config_.sessions.hibernate && session.agent->history_size() > 0) {
+        evicted.snapshot = session.agent->snapshot().dump();
+        std::lock_guard<std::mutex> lock(hibernating_mutex_);
+        hibernating_.insert(evicted.id);
+    }
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        index_remove(session);
+    }
+    shard.sessions.erase(it);
+    resident_.fetch_sub(1, std::memory_order_relaxed);
+    metrics().sessions_resident.unlabeled().add(-1);
+    return evicted;
+}
+
+void SessionManager::finish_eviction(Evicted evicted) {
+    if (!evicted.snapshot.empty()) {
+        std::string path = snapshot_path(evicted.id);
+        if (!atomic_write_file(path, evicted.snapshot)) {
+            std::cerr << "[session] Failed to write snapshot: " << path << "\n";
+        }
+        {
+            std::lock_guard<std::mutex> lock(hibernating_mutex_);
+            hibernating_.erase(evicted.id);
+        }
+        hibernating_cv_.notify_all();
+    }
+    if (event_bus_) {
+        SessionEvictedEvent ev;
+        ev.session_id = evicted.id;
+        event_bus_->publish(ev);
+    }
+}
+
+bool SessionManager::over_limits() const {
+    uint32_t cap = config_.sessions.max_resident;
+    uint64_t budget = config_.sessions.memory_budget_bytes;
+    return (cap > 0 && resident_.load(std::memory_order_relaxed) > cap) ||
+           (budget > 0 && history_bytes_ > budget);
+}
+
+void SessionManager::enforce_limits(const std::string& keep_id) {
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        if (!over_limits()) return;
+    }
+
+    std::lock_guard<std::mutex> evict_lock(evict_mutex_);
+    std::unordered_set<const Session*> skipped;
+    while (true) {
+        // Least recently active idle session, walking from the LRU tail
+        std::string victim_id;
+        const Session* victim = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            if (!over_limits()) break;
+            for (Session* s = lru_tail_; s; s = s->lru_prev) {
+                if (s->id == keep_id || skipped.count(s) ||
+                    s->busy.load(std::memory_order_acquire) > 0) continue;
+                victim = s;
+                victim_id = s->id;
+                break;
+            }
+        }
+        if (!victim) break;
+
+        auto& shard = shard_for(victim_id);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.sessions.find(victim_id);
+        if (it != shard.sessions.end() && it->second.get() == victim &&
+            it->second->busy.load(std::memory_order_acquire) == 0) {
+            Evicted evicted = detach(shard, it);
+            lock.unlock();
+            finish_eviction(std::move(evicted));
+        } else {
+            skipped.insert(victim); // became busy or vanished concurrently
+        }
+    }
+}
+
+std::shared_ptr<Session> SessionManager::acquire(const std::string& session_id,
+                                                  bool pin) {
+    auto& shard = shard_for(session_id);
+    std::shared_ptr<Session> session;
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.sessions.find(session_id);
+        if (it != shard.sessions.end()) {
+            session = it->second;
+            // Pin under the shard lock so eviction (exclusive lock) sees it
+            if (pin) session->busy.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+
+    // Fast path: existing, fully constructed session
+    if (session && session->ready.load(std::memory_order_acquire)) {
+        touch(*session);
+        return session;
+    }
+
+    if (!session) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto& slot = shard.sessions[session_id];
+        if (!slot) {
+            slot = std::make_shared<Session>();
+            slot->id = session_id;
+        }
+        session = slot;
+        if (pin) session->busy.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    // Construction (provider, memory DB, skills scan, tools) runs without
+    // holding any map lock. A failed attempt leaves the placeholder in
+    // place so the next message retries.
+    bool created = false;
+    try {
+        std::call_once(session->init_once, [&] {
+            create_session(*session);
+            rehydrate(*session);
+            session->last_active.store(clock_(), std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(index_mutex_);
+                index_insert(*session);
+            }
+            update_footprint(*session);
+            session->ready.store(true, std::memory_order_release);
+            resident_.fetch_add(1, std::memory_order_relaxed);
+            metrics().sessions_resident.unlabeled().add(1);
+            created = true;
+        });
+    } catch (...) {
+        if (pin) session->busy.fetch_sub(1, std::memory_order_acq_rel);
+        throw;
+    }
 
-    auto it = sessions_.find(session_id);
-    if (it != sessions_.end()) {
-        it->second.last_active = epoch_seconds();
-        return *(it->second.agent);
+    if (created) {
+        enforce_limits(session_id);
+    } else {
+        touch(*session);
     }
+    return session;
+}
 
-    auto [inserted, _] = sessions_.emplace(session_id, create_session(session_id));
-    return *(inserted->second.agent);
+Agent& SessionManager::get_session(const std::string& session_id) {
+    return *acquire(session_id, false)->agent;
 }
 
 void SessionManager::remove_session(const std::string& session_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    sessions_.erase(session_id);
+    auto& shard = shard_for(session_id);
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.sessions.find(session_id);
+        if (it != shard.sessions.end()) {
+            if (it->second->ready.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> index_lock(index_mutex_);
+                index_remove(*it->second);
+                resident_.fetch_sub(1, std::memory_order_relaxed);
+                metrics().sessions_resident.unlabeled().add(-1);
+            }
+            shard.sessions.erase(it);
+        }
+    }
+    std::remove(snapshot_path(session_id).c_str());
 }
 
 void SessionManager::evict_idle(uint64_t max_idle_seconds) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    uint64_t now = epoch_seconds();
-
-    for (auto it = sessions_.begin(); it != sessions_.end(); ) {
-        if ((now - it->second.last_active) > max_idle_seconds) {
-            if (event_bus_) {
-                SessionEvictedEvent ev;
-                ev.session_id = it->first;
-                event_bus_->publish(ev);
-            }
-            it = sessions_.erase(it);
+    std::lock_guard<std::mutex> evict_lock(evict_mutex_);
+    uint64_t now = clock_();
+
+    std::vector<std::pair<std::string, const Session*>> expired;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        if (max_idle_seconds != idle_timeout_) {
+            idle_timeout_ = max_idle_seconds;
+            wheel_rebuild(now);
+        }
+        for (Session* s : wheel_advance(now)) expired.emplace_back(s->id, s);
+    }
+
+    for (const auto& [id, expected] : expired) {
+        auto& shard = shard_for(id);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.sessions.find(id);
+        if (it == shard.sessions.end() || it->second.get() != expected) continue;
+
+        Session& session = *it->second;
+        uint64_t last = session.last_active.load(std::memory_order_relaxed);
+        if (session.busy.load(std::memory_order_acquire) == 0 &&
+            last < now && (now - last) > max_idle_seconds) {
+            Evicted evicted = detach(shard, it);
+            lock.unlock();
+            finish_eviction(std::move(evicted));
         } else {
-            ++it;
+            // Touched or busy since the wheel fired — schedule again
+            std::lock_guard<std::mutex> index_lock(index_mutex_);
+            wheel_link(session, std::max(last + idle_timeout_, now) + 1);
         }
     }
 }
 
 std::vector<std::string> SessionManager::list_sessions() const {
-    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<std::string> ids;
-    ids.reserve(sessions_.size());
-    for (const auto& [id, _] : sessions_) {
-        ids.push_back(id);
+    ids.reserve(resident_.load(std::memory_order_relaxed));
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& [id, session] : shard.sessions) {
+            if (session->ready.load(std::memory_order_acquire)) ids.push_back(id);
+        }
     }
     return ids;
 }
@@ -125,8 +493,228 @@ void SessionManager::clear_pending_oauth(const std::string& session_id) {
 }
 #endif
 
+// ── Turn dispatch ───────────────────────────────────────────────
+
+void SessionManager::start_workers(uint32_t count) {
+    std::lock_guard<std::mutex> lock(lanes_mutex_);
+    stopping_ = false;
+    for (uint32_t i = 0; i < count; i++) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+static Gauge& queue_depth() {
+    static Gauge& gauge = metrics().queued_messages.unlabeled();
+    return gauge;
+}
+
+void SessionManager::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(lanes_mutex_);
+        if (workers_.empty()) return;
+        stopping_ = true;
+        for (auto& [id, lane] : lanes_) {
+            queue_depth().add(-static_cast<int64_t>(lane.inbox.size()));
+            lane.inbox.clear();
+            cancel(lane.active);
+        }
+        ready_.clear();
+    }
+    lanes_cv_.notify_all();
+    coalesce_cv_.notify_all();
+    for (auto& t : workers_) t.join();
+    workers_.clear();
+    lanes_.clear();
+}
+
+static bool is_plain_message(const MessageReceivedEvent& ev) {
+    return !ev.message.content.empty() && ev.message.content[0] != '/';
+}
+
+void SessionManager::coalesce(const std::string& id, Lane& lane,
+                              MessageReceivedEvent& ev,
+                              std::unique_lock<std::mutex>& lock) {
+    // Debounce: let a burst of short messages finish before the turn starts
+    auto window = std::chrono::milliseconds(config_.sessions.coalesce_ms);
+    while (!stopping_) {
+        auto until = lane.last_arrival + window;
+        if (std::chrono::steady_clock::now() >= until) break;
+        coalesce_cv_.wait_until(lock, until);
+    }
+
+    // Everything queued up to the next command becomes one user turn
+    size_t merged = 0;
+    while (!lane.inbox.empty() && is_plain_message(lane.inbox.front())) {
+        ev.message.content += "\n\n" + lane.inbox.front().message.content;
+        lane.inbox.pop_front();
+        merged++;
+    }
+    queue_depth().add(-static_cast<int64_t>(merged));
+    if (merged > 0) {
+        std::cerr << "[session] Coalesced " << (merged + 1)
+                  << " messages for " << id << "\n";
+    }
+}
+
+void SessionManager::worker_loop() {
+    std::unique_lock<std::mutex> lock(lanes_mutex_);
+    while (true) {
+        lanes_cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+        if (stopping_) return;
+
+        std::string id = std::move(ready_.front());
+        ready_.pop_front();
+        auto& lane = lanes_[id]; // references survive rehashing
+        MessageReceivedEvent ev = std::move(lane.inbox.front());
+        lane.inbox.pop_front();
+        queue_depth().add(-1);
+        if (config_.sessions.coalesce_ms > 0 && is_plain_message(ev)) {
+            coalesce(id, lane, ev, lock);
+            if (stopping_) return;
+        }
+        auto token = make_cancellation_token();
+        lane.active = token;
+        lock.unlock();
+
+        try {
+            run_message(ev, token);
+        } catch (const std::exception& e) {
+            std::cerr << "[session] " << id << ": " << e.what() << "\n";
+        }
+
+        lock.lock();
+        lane.active.reset();
+        if (stopping_) return;
+        if (lane.inbox.empty()) {
+            lanes_.erase(id);
+        } else {
+            ready_.push_back(id); // requeue behind other sessions
+            lanes_cv_.notify_one();
+        }
+    }
+}
+
 void SessionManager::handle_message(const MessageReceivedEvent& ev) {
-    auto& agent = get_session(ev.session_id);
+    std::unique_lock<std::mutex> lock(lanes_mutex_);
+    if (workers_.empty()) {
+        lock.unlock();
+        run_message(ev, nullptr);
+        return;
+    }
+
+    const std::string& content = ev.message.content;
+    if (is_read_only_command(content)) {
+        lock.unlock();
+        run_read_only_command(ev);
+        return;
+    }
+
+    auto it = lanes_.find(ev.session_id);
+    bool running = it != lanes_.end() && it->second.active &&
+                   !is_cancelled(it->second.active);
+
+    if (content == "/stop") {
+        if (running) {
+            // The cancelled turn replies with Agent::kStoppedReply
+            cancel(it->second.active);
+            return;
+        }
+        lock.unlock();
+        MessageReadyEvent reply;
+        reply.session_id = ev.session_id;
+        reply.reply_target = ev.message.reply_target.value_or("");
+        reply.content = "Nothing to stop.";
+        event_bus_->publish(reply);
+        return;
+    }
+
+    // Interrupt mode: a new (non-command) message supersedes the running turn
+    if (running && config_.agent.interrupt &&
+        !content.empty() && content[0] != '/') {
+        cancel(it->second.active);
+    }
+
+    queue_depth().add(1);
+    if (it == lanes_.end()) {
+        auto& lane = lanes_[ev.session_id];
+        lane.inbox.push_back(ev);
+        lane.last_arrival = std::chrono::steady_clock::now();
+        ready_.push_back(ev.session_id);
+        lanes_cv_.notify_one();
+    } else {
+        // Lane already owned by a worker (or queued) — it drains in order
+        it->second.inbox.push_back(ev);
+        it->second.last_arrival = std::chrono::steady_clock::now();
+    }
+}
+
+void SessionManager::run_message(const MessageReceivedEvent& ev,
+                                 const CancellationToken& token) {
+    auto session = acquire(ev.session_id, true);
+    struct Unpin {
+        Session& s;
+        ~Unpin() {
+            s.agent->set_cancellation_token(nullptr);
+            s.busy.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    } unpin{*session};
+
+    session->agent->set_cancellation_token(token);
+    uint64_t turn_id = 0;
+    if (is_plain_message(ev)) {
+        TurnStartEvent start;
+        start.session_id = ev.session_id;
+        start.reply_target = ev.message.reply_target.value_or("");
+        start.turn_id = turn_id = next_turn_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+        event_bus_->publish(start);
+    }
+    dispatch_message(ev, *session->agent, turn_id);
+
+    update_footprint(*session);
+    enforce_limits(ev.session_id);
+}
+
+bool SessionManager::is_read_only_command(const std::string& content) {
+    return content == "/status" || content == "/help" ||
+           content == "/models" || content == "/memory";
+}
+
+std::optional<std::string> SessionManager::read_only_command(
+        const MessageReceivedEvent& ev, const Agent& agent) {
+    const std::string& content = ev.message.content;
+    if (content == "/status") return cmd_status(agent);
+    if (content == "/memory") return cmd_memory(agent);
+    if (content == "/help") {
+        bool is_channel = (ev.session_id != kCliSessionId);
+        return cmd_help(config_.dev, is_channel);
+    }
+    if (content == "/models") {
+        std::shared_lock<std::shared_mutex> config_lock(config_mutex_);
+        return cmd_models(agent, config_);
+    }
+    return std::nullopt;
+}
+
+void SessionManager::run_read_only_command(const MessageReceivedEvent& ev) {
+    // Pinned so eviction cannot hibernate the agent mid-read; no token and
+    // no set_channel — the session's turn may be running on a worker
+    auto session = acquire(ev.session_id, true);
+    struct Unpin {
+        Session& s;
+        ~Unpin() { s.busy.fetch_sub(1, std::memory_order_acq_rel); }
+    } unpin{*session};
+
+    auto reply_text = read_only_command(ev, *session->agent);
+    if (!reply_text) return;
+    MessageReadyEvent reply;
+    reply.session_id = ev.session_id;
+    reply.reply_target = ev.message.reply_target.value_or("");
+    reply.content = std::move(*reply_text);
+    event_bus_->publish(reply);
+}
+
+void SessionManager::dispatch_message(const MessageReceivedEvent& ev, Agent& agent,
+                                      uint64_t turn_id) {
     if (!ev.message.channel.empty()) {
         agent.set_channel(ev.message.channel);
     }
@@ -137,6 +725,7 @@ void SessionManager::handle_message(const MessageReceivedEvent& ev) {
         reply.session_id = ev.session_id;
         reply.reply_target = chat_id;
         reply.content = content;
+        reply.turn_id = turn_id;
         event_bus_->publish(reply);
     };
 
@@ -158,6 +747,13 @@ void SessionManager::handle_message(const MessageReceivedEvent& ev) {
         return;
     }
 
+    // Handle /stop — only meaningful while a worker runs a turn (see
+    // handle_message); inline dispatch never has a turn in flight here
+    if (ev.message.content == "/stop") {
+        send_reply("Nothing to stop.");
+        return;
+    }
+
     // Handle /new and /clear commands
     if (ev.message.content == "/new" || ev.message.content == "/clear") {
         agent.clear_history();
@@ -177,24 +773,21 @@ void SessionManager::handle_message(const MessageReceivedEvent& ev) {
         return;
     }
 
-    // Handle /status command
-    if (ev.message.content == "/status") {
-        send_reply(cmd_status(agent));
+    // Handle /status, /help, /models and /memory
+    if (auto reply = read_only_command(ev, agent)) {
+        send_reply(*reply);
         return;
     }
 
     // Handle /model command
     if (ev.message.content.rfind("/model ", 0) == 0) {
+        std::unique_lock<std::shared_mutex> config_lock(config_mutex_);
         send_reply(cmd_model(trim(ev.message.content.substr(7)),
                              agent, config_, http_));
         return;
     }
 
-    // Handle /memory commands
-    if (ev.message.content == "/memory") {
-        send_reply(cmd_memory(agent));
-        return;
-    }
+    // Handle /memory subcommands
     if (ev.message.content == "/memory export") {
         send_reply(cmd_memory_export(agent));
         return;
@@ -213,21 +806,9 @@ void SessionManager::handle_message(const MessageReceivedEvent& ev) {
         return;
     }
 
-    // Handle /help command
-    if (ev.message.content == "/help") {
-        bool is_channel = (ev.session_id != kCliSessionId);
-        send_reply(cmd_help(config_.dev, is_channel));
-        return;
-    }
-
-    // Handle /models command
-    if (ev.message.content == "/models") {
-        send_reply(cmd_models(agent, config_));
-        return;
-    }
-
     // Handle /provider command
     if (ev.message.content.rfind("/provider ", 0) == 0) {
+        std::unique_lock<std::shared_mutex> config_lock(config_mutex_);
         send_reply(cmd_provider(ev.message.content.substr(10),
                                 agent, config_, http_));
         return;
@@ -239,6 +820,7 @@ void SessionManager::handle_message(const MessageReceivedEvent& ev) {
         || get_pending_oauth(ev.session_id).has_value()
 #endif
     ) {
+        std::unique_lock<std::shared_mutex> config_lock(config_mutex_);
         if (handle_auth_command(ev, agent, send_reply)) return;
     }
 
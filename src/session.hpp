@@ -2,27 +2,55 @@
 #include "agent.hpp"
 #include "tool_manager.hpp"
 #include "config.hpp"
+#include "event.hpp"
 #include "http.hpp"
+#include "util.hpp"
 #ifdef PTRCLAW_HAS_OPENAI
 #include "oauth.hpp"
 #endif
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
+#include <shared_mutex>
 #include <optional>
 #include <functional>
+#include <thread>
 
 namespace ptrclaw {
 
 class EventBus; // forward declaration
-struct MessageReceivedEvent; // forward declaration
 
 struct Session {
     std::string id;
     std::unique_ptr<Agent> agent;
     std::unique_ptr<ToolManager> tool_manager;
-    uint64_t last_active = 0;
+    std::atomic<uint64_t> last_active{0};
+
+    // Per-key once-guard: concurrent first messages for the same ID build
+    // the session exactly once, outside the shard lock.
+    std::once_flag init_once;
+    std::atomic<bool> ready{false};
+
+    // Messages currently being handled; busy sessions are never evicted
+    std::atomic<uint32_t> busy{0};
+
+    // Intrusive eviction hooks (LRU list + timer wheel bucket), guarded by
+    // SessionManager::index_mutex_
+    Session* lru_prev = nullptr;
+    Session* lru_next = nullptr;
+    Session* wheel_prev = nullptr;
+    Session* wheel_next = nullptr;
+    uint64_t wheel_due = 0;
+    bool on_wheel = false;
+    bool indexed = false;
+    size_t history_bytes = 0;
 };
 
 class SessionManager {
@@ -30,6 +58,10 @@ public:
     static constexpr const char* kCliSessionId = "cli";
 
     SessionManager(Config& config, HttpClient& http);
+    ~SessionManager();
+
+    SessionManager(const SessionManager&) = delete;
+    SessionManager& operator=(const SessionManager&) = delete;
 
     // Get or create a session
     Agent& get_session(const std::string& session_id);
@@ -37,10 +69,23 @@ public:
     // Remove a session
     void remove_session(const std::string& session_id);
 
-    // Evict idle sessions (older than max_idle_seconds)
-    void evict_idle(uint64_t max_idle_seconds = 3600);
+    // Evict idle sessions (older than max_idle_seconds). When hibernation is
+    // enabled, evicted sessions are snapshotted to disk and rehydrated lazily
+    // by the next get_session() for the same ID.
+    void evict_idle(uint64_t max_idle_seconds);
+    void evict_idle() { evict_idle(config_.sessions.max_idle_seconds); }
+
+    // Clock (epoch seconds) for activity and idle expiry; tests substitute
+    // one that can jump ahead
+    void set_clock(uint64_t (*clock)()) { clock_ = clock; }
+
+    // Estimated history bytes across resident sessions (memory budget input)
+    size_t history_bytes() const;
+
+    // On-disk snapshot location for a session ID (sanitized filename)
+    std::string snapshot_path(const std::string& session_id) const;
 
-    // List active session IDs
+    // List active (resident) session IDs
     std::vector<std::string> list_sessions() const;
 
     // Binary path — propagated to new agents for cron scheduling
@@ -55,21 +100,152 @@ public:
     // Subscribe to MessageReceivedEvent on the event bus
     void subscribe_events();
 
+    // Run turns on a pool of worker threads instead of the publishing
+    // thread. Messages for one session still run in arrival order; /stop
+    // (and a new message, when agent.interrupt is set) cancels the
+    // session's in-flight turn. Without workers, messages run inline.
+    void start_workers(uint32_t count);
+
+    // Cancel in-flight turns, drop queued messages and join the workers.
+    // Call before tearing down event subscribers the workers publish to.
+    void stop_workers();
+
 private:
+    // Sessions are spread over independently locked shards. Lookups of
+    // existing sessions take a shard read lock only; construction runs
+    // outside any map lock (see Session::init_once).
+    static constexpr size_t kShardCount = 16;
+    using SessionMap = std::unordered_map<std::string, std::shared_ptr<Session>>;
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        SessionMap sessions;
+    };
+
     Config& config_;
     HttpClient& http_;
-    std::unordered_map<std::string, Session> sessions_;
-    mutable std::mutex mutex_;
+    std::array<Shard, kShardCount> shards_;
+    std::atomic<size_t> resident_{0};  // sessions with ready == true
+    std::mutex evict_mutex_;           // serializes eviction passes
+    // Sessions whose snapshot is being written; rehydrate() waits for it
+    std::mutex hibernating_mutex_;
+    std::condition_variable hibernating_cv_;
+    std::unordered_set<std::string> hibernating_;
+
+    // Eviction index over ready sessions: an intrusive LRU list (memory
+    // budget / resident cap victims) and a hashed timer wheel with one-second
+    // ticks (idle expiry). Touches only reorder the LRU; wheel entries are
+    // rescheduled lazily when their bucket comes due, so an eviction pass
+    // costs O(expired + rescheduled) instead of O(sessions).
+    // Lock order: evict_mutex_ -> shard mutex -> index_mutex_.
+    static constexpr size_t kWheelSlots = 512;
+    mutable std::mutex index_mutex_;
+    Session* lru_head_ = nullptr;  // most recently active
+    Session* lru_tail_ = nullptr;  // least recently active
+    std::array<Session*, kWheelSlots> wheel_{};
+    uint64_t wheel_tick_ = 0;      // last processed tick (epoch seconds)
+    uint64_t idle_timeout_ = 0;    // timeout the wheel is scheduled for
+    size_t history_bytes_ = 0;     // sum of Session::history_bytes
+    uint64_t (*clock_)() = epoch_seconds;
+    mutable std::mutex mutex_;         // guards pending_oauth_
+    // Guards config_ provider/model/credentials: exclusive for /model,
+    // /provider and /auth, shared for session creation and /models
+    mutable std::shared_mutex config_mutex_;
     std::string binary_path_;
     EventBus* event_bus_ = nullptr;
     Embedder* embedder_ = nullptr;
 
-    // Create a new session with provider, tools, event bus, embedder
-    Session create_session(const std::string& session_id);
+    Shard& shard_for(const std::string& session_id);
+
+    // Look up or build a session. pin = true marks it busy (caller unpins).
+    std::shared_ptr<Session> acquire(const std::string& session_id, bool pin);
+
+    // Populate a session with provider, tools, event bus, embedder
+    void create_session(Session& session);
 
-    // Dispatch a slash command or regular message
+    // Restore a hibernated snapshot into a freshly created session (if any)
+    void rehydrate(Session& session);
+
+    // A session taken out of its shard, with its serialized snapshot
+    // (empty if not hibernated) still to be written
+    struct Evicted {
+        std::string id;
+        std::shared_ptr<Session> session;
+        std::string snapshot;
+    };
+    // Drop a resident session from its shard and the eviction index and
+    // serialize its snapshot (if enabled). Caller holds the shard's
+    // exclusive lock.
+    Evicted detach(Shard& shard, SessionMap::iterator it);
+    // Write the snapshot and publish SessionEvictedEvent, with no map lock
+    // held so other sessions in the shard are not kept waiting on disk I/O
+    void finish_eviction(Evicted evicted);
+
+    // Keep resident sessions within config_.sessions.max_resident and
+    // config_.sessions.memory_budget_bytes by hibernating the least
+    // recently active ones.
+    void enforce_limits(const std::string& keep_id);
+    bool over_limits() const; // caller holds index_mutex_
+
+    // Eviction index maintenance (caller holds index_mutex_)
+    void index_insert(Session& session);
+    void index_remove(Session& session);
+    void lru_unlink(Session& session);
+    void lru_push_front(Session& session);
+    void wheel_link(Session& session, uint64_t due);
+    void wheel_unlink(Session& session);
+    void wheel_rebuild(uint64_t now);
+    std::vector<Session*> wheel_advance(uint64_t now);
+
+    // Mark activity: bump last_active and move to the LRU front
+    void touch(Session& session);
+
+    // Re-measure a session's history after a turn
+    void update_footprint(Session& session);
+
+    // Dispatch a slash command or regular message for a pinned session;
+    // replies carry `turn_id` (0 for commands)
+    void dispatch_message(const MessageReceivedEvent& ev, Agent& agent, uint64_t turn_id);
+
+    // Run one message to completion (token cancels the turn, may be null).
+    // Plain messages publish a TurnStartEvent first.
+    void run_message(const MessageReceivedEvent& ev, const CancellationToken& token);
+
+    // Read-only commands (/status, /help, /models, /memory). They only touch
+    // Agent::status() and internally locked memory, so in worker mode they
+    // bypass the lane and answer while a turn is in flight.
+    // is_read_only_command: whether `content` is one of them.
+    // read_only_command: the reply, or nullopt if `ev` is not one of them.
+    static bool is_read_only_command(const std::string& content);
+    std::optional<std::string> read_only_command(const MessageReceivedEvent& ev,
+                                                 const Agent& agent);
+    void run_read_only_command(const MessageReceivedEvent& ev);
+
+    // Bus entry point: run inline, or queue on the session's lane
     void handle_message(const MessageReceivedEvent& ev);
 
+    // Worker mode: one lane per session with queued messages or a running
+    // turn. A lane is owned by at most one worker at a time.
+    struct Lane {
+        std::deque<MessageReceivedEvent> inbox;
+        CancellationToken active;  // token of the running turn, if any
+        std::chrono::steady_clock::time_point last_arrival;
+    };
+    std::unordered_map<std::string, Lane> lanes_;
+    std::deque<std::string> ready_;  // lanes waiting for a worker
+    std::mutex lanes_mutex_;
+    std::condition_variable lanes_cv_;
+    std::condition_variable coalesce_cv_;  // only signalled on shutdown
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> next_turn_id_{0};
+
+    void worker_loop();
+
+    // Merge queued plain-text messages into `ev`, first waiting until the
+    // lane has been quiet for sessions.coalesce_ms. Caller holds `lock`.
+    void coalesce(const std::string& id, Lane& lane, MessageReceivedEvent& ev,
+                  std::unique_lock<std::mutex>& lock);
+
     // Handle /auth commands (API key setting + OAuth if available)
     bool handle_auth_command(const MessageReceivedEvent& ev,
                              Agent& agent,
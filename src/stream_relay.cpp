@@ -1,56 +1,189 @@
 #include "stream_relay.hpp"
 #include "event.hpp"
 #include "event_bus.hpp"
+#include <optional>
 
 namespace ptrclaw {
 
+static std::string format_progress(const std::string& tool_name, uint32_t elapsed_ms,
+                                   const std::string& tail) {
+    std::string text = "[" + tool_name + " running, " +
+                       std::to_string(elapsed_ms / 1000) + "s]";
+    if (!tail.empty()) text += "\n" + tail;
+    return text;
+}
+
 StreamRelay::StreamRelay(Channel& channel, EventBus& bus)
     : channel_(channel), bus_(bus)
 {}
 
+StreamRelay::~StreamRelay() {
+    if (progress_sub_ != 0) bus_.unsubscribe(progress_sub_);
+}
+
+StreamRelay::StreamState* StreamRelay::find_state(const std::string& session_id,
+                                                  uint64_t turn_id) {
+    auto it = stream_states_.find(session_id);
+    if (it == stream_states_.end() || it->second.turn_id != turn_id) return nullptr;
+    return &it->second;
+}
+
 void StreamRelay::subscribe_events() {
-    // MessageReady → send via channel (skip if already delivered via streaming)
+    // Channel calls are network round trips: each handler copies what it
+    // needs under mutex_ and calls the channel after releasing it, so one
+    // session's slow edit does not hold up the others.
+
+    // MessageReady → send via channel (skip if already delivered via streaming).
+    // Command replies (turn_id 0) may arrive while a turn is in flight and
+    // leave its stream state alone.
     ptrclaw::subscribe<MessageReadyEvent>(bus_,
         [this](const MessageReadyEvent& ev) {
-            auto it = stream_states_.find(ev.session_id);
-            if (it != stream_states_.end()) {
-                bool delivered = it->second.delivered;
-                auto chat_id = it->second.chat_id;
-                auto msg_id = it->second.message_id;
-                auto accumulated = it->second.accumulated;
-                stream_states_.erase(it);
-                if (delivered) {
-                    // Content was replaced after streaming (e.g. soul extraction) —
-                    // edit the streamed message with the final content
-                    if (msg_id != 0 && ev.content != accumulated) {
-                        channel_.edit_message(chat_id, msg_id, ev.content);
-                    }
-                    return;
+            std::optional<StreamState> state;
+            if (ev.turn_id != 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = stream_states_.find(ev.session_id);
+                if (it != stream_states_.end() && it->second.turn_id == ev.turn_id) {
+                    state = std::move(it->second);
+                    stream_states_.erase(it);
                 }
             }
+            if (state && state->delivered) {
+                // Content was replaced after streaming (e.g. soul extraction) —
+                // edit the streamed message with the final content
+                if (state->message_id != 0 && ev.content != state->accumulated) {
+                    channel_.edit_message(state->chat_id, state->message_id, ev.content);
+                }
+                return;
+            }
             if (!ev.reply_target.empty()) {
                 channel_.send_message(ev.reply_target, ev.content);
             }
         });
 
-    // MessageReceived → typing indicator + stream state (skip commands)
+    // MessageReceived → typing indicator (skip commands). Messages that
+    // arrive while the session already shows one (a burst the session
+    // coalesces into one turn, or a message behind a running turn) send
+    // nothing; stream state is set up once the merged turn starts.
     ptrclaw::subscribe<MessageReceivedEvent>(bus_,
         [this](const MessageReceivedEvent& ev) {
             if (!ev.message.content.empty() && ev.message.content[0] == '/') return;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stream_states_.count(ev.session_id) ||
+                    !typing_shown_.insert(ev.session_id).second) return;
+            }
+            channel_.send_typing_indicator(ev.message.reply_target.value_or(""));
+        });
 
-            std::string chat_id = ev.message.reply_target.value_or("");
-            channel_.send_typing_indicator(chat_id);
-            stream_states_[ev.session_id] = {chat_id, 0, {},
-                                              std::chrono::steady_clock::now(), false};
+    // TurnStart → stream state for the turn; typing indicator unless one
+    // went out when its first message arrived
+    ptrclaw::subscribe<TurnStartEvent>(bus_,
+        [this](const TurnStartEvent& ev) {
+            bool shown;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                shown = typing_shown_.erase(ev.session_id) > 0;
+                StreamState state;
+                state.chat_id = ev.reply_target;
+                state.turn_id = ev.turn_id;
+                state.last_edit = std::chrono::steady_clock::now();
+                stream_states_[ev.session_id] = std::move(state);
+            }
+            if (!shown) channel_.send_typing_indicator(ev.reply_target);
         });
 
     // Refresh typing indicator on each tool call
     ptrclaw::subscribe<ToolCallRequestEvent>(bus_,
         [this](const ToolCallRequestEvent& ev) {
-            auto it = stream_states_.find(ev.session_id);
-            if (it != stream_states_.end() && !it->second.chat_id.empty()) {
-                channel_.send_typing_indicator(it->second.chat_id);
+            std::string chat_id;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = stream_states_.find(ev.session_id);
+                if (it != stream_states_.end()) {
+                    chat_id = it->second.chat_id;
+                    it->second.running_calls.insert(ev.tool_call_id);
+                }
             }
+            if (!chat_id.empty()) channel_.send_typing_indicator(chat_id);
+        });
+
+    // Long-running tool call: keep the typing indicator alive and, on
+    // streaming channels, show the tail of its output in a message edited
+    // as progress arrives (ToolManager throttles these events). Progress is
+    // published from the tool's read loop, so it is handled on its own
+    // thread: the tool keeps draining its output while the edits are sent.
+    // Events that arrive after the call's result are dropped.
+    progress_sub_ = ptrclaw::subscribe_async<ToolCallProgressEvent>(bus_,
+        [this](const ToolCallProgressEvent& ev) {
+            std::lock_guard<std::mutex> io_lock(progress_mutex_);
+            std::string chat_id;
+            uint64_t turn_id = 0;
+            bool new_call = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = stream_states_.find(ev.session_id);
+                if (it == stream_states_.end() || it->second.chat_id.empty() ||
+                    !it->second.running_calls.count(ev.tool_call_id)) return;
+                chat_id = it->second.chat_id;
+                turn_id = it->second.turn_id;
+                new_call = it->second.progress_call_id != ev.tool_call_id;
+            }
+            channel_.send_typing_indicator(chat_id);
+            if (!channel_.supports_streaming_display()) return;
+
+            int64_t placeholder = new_call ? channel_.send_streaming_placeholder(chat_id) : 0;
+            int64_t message_id = 0;
+            std::string text;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                StreamState* state = find_state(ev.session_id, turn_id);
+                if (!state) return;
+                if (new_call) {
+                    state->progress_call_id = ev.tool_call_id;
+                    state->progress_tail.clear();
+                    state->progress_message_id = placeholder;
+                }
+                auto& tail = state->progress_tail;
+                tail += ev.delta;
+                if (tail.size() > kProgressTailBytes) {
+                    // Start at a line boundary when one is close enough
+                    size_t cut = tail.size() - kProgressTailBytes;
+                    size_t nl = tail.find('\n', cut);
+                    cut = nl != std::string::npos && nl - cut < 200 ? nl + 1 : cut;
+                    while (cut < tail.size() &&
+                           (static_cast<unsigned char>(tail[cut]) & 0xC0) == 0x80) {
+                        cut++;
+                    }
+                    tail.erase(0, cut);
+                }
+                message_id = state->progress_message_id;
+                if (message_id != 0) text = format_progress(ev.tool_name, ev.elapsed_ms, tail);
+            }
+            if (message_id != 0) channel_.edit_message(chat_id, message_id, text);
+        }, AsyncOptions{kProgressQueue, OverflowPolicy::Block, "stream_relay_progress"});
+
+    ptrclaw::subscribe<ToolCallResultEvent>(bus_,
+        [this](const ToolCallResultEvent& ev) {
+            std::lock_guard<std::mutex> io_lock(progress_mutex_);
+            std::string chat_id;
+            int64_t message_id = 0;
+            std::string text;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = stream_states_.find(ev.session_id);
+                if (it == stream_states_.end()) return;
+                auto& state = it->second;
+                state.running_calls.erase(ev.tool_call_id);
+                if (state.progress_call_id != ev.tool_call_id) return;
+                chat_id = state.chat_id;
+                message_id = state.progress_message_id;
+                text = "[" + ev.tool_name + (ev.success ? " finished]" : " failed]");
+                if (!state.progress_tail.empty()) text += "\n" + state.progress_tail;
+                state.progress_call_id.clear();
+                state.progress_message_id = 0;
+                state.progress_tail.clear();
+            }
+            if (message_id != 0) channel_.edit_message(chat_id, message_id, text);
         });
 
     // Stream event subscribers (progressive message editing)
@@ -58,41 +191,63 @@ void StreamRelay::subscribe_events() {
 
     ptrclaw::subscribe<StreamStartEvent>(bus_,
         [this](const StreamStartEvent& ev) {
-            auto it = stream_states_.find(ev.session_id);
-            if (it == stream_states_.end()) return;
-            int64_t msg_id = channel_.send_streaming_placeholder(
-                it->second.chat_id);
-            it->second.message_id = msg_id;
-            it->second.last_edit = std::chrono::steady_clock::now();
+            std::string chat_id;
+            uint64_t turn_id = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = stream_states_.find(ev.session_id);
+                if (it == stream_states_.end()) return;
+                chat_id = it->second.chat_id;
+                turn_id = it->second.turn_id;
+            }
+            int64_t msg_id = channel_.send_streaming_placeholder(chat_id);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (StreamState* state = find_state(ev.session_id, turn_id)) {
+                state->message_id = msg_id;
+                state->last_edit = std::chrono::steady_clock::now();
+            }
         });
 
     ptrclaw::subscribe<StreamChunkEvent>(bus_,
         [this](const StreamChunkEvent& ev) {
-            auto it = stream_states_.find(ev.session_id);
-            if (it == stream_states_.end() || it->second.message_id == 0)
-                return;
-            it->second.accumulated += ev.delta;
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<
-                std::chrono::milliseconds>(
-                now - it->second.last_edit).count();
-            if (elapsed >= 1000) {
-                channel_.edit_message(it->second.chat_id,
-                                      it->second.message_id,
-                                      it->second.accumulated);
-                it->second.last_edit = now;
+            std::string chat_id;
+            int64_t msg_id = 0;
+            std::string text;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = stream_states_.find(ev.session_id);
+                if (it == stream_states_.end() || it->second.message_id == 0)
+                    return;
+                auto& state = it->second;
+                state.accumulated += ev.delta;
+                auto now = std::chrono::steady_clock::now();
+                auto elapsed = std::chrono::duration_cast<
+                    std::chrono::milliseconds>(now - state.last_edit).count();
+                if (elapsed < 1000) return;
+                state.last_edit = now;
+                chat_id = state.chat_id;
+                msg_id = state.message_id;
+                text = state.accumulated;
             }
+            channel_.edit_message(chat_id, msg_id, text);
         });
 
     ptrclaw::subscribe<StreamEndEvent>(bus_,
         [this](const StreamEndEvent& ev) {
-            auto it = stream_states_.find(ev.session_id);
-            if (it == stream_states_.end() || it->second.message_id == 0)
-                return;
-            channel_.edit_message(it->second.chat_id,
-                                  it->second.message_id,
-                                  it->second.accumulated);
-            it->second.delivered = true;
+            std::string chat_id;
+            int64_t msg_id = 0;
+            std::string text;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = stream_states_.find(ev.session_id);
+                if (it == stream_states_.end() || it->second.message_id == 0)
+                    return;
+                it->second.delivered = true;
+                chat_id = it->second.chat_id;
+                msg_id = it->second.message_id;
+                text = it->second.accumulated;
+            }
+            channel_.edit_message(chat_id, msg_id, text);
         });
 }
 
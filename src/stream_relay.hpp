@@ -2,8 +2,10 @@
 #include "channel.hpp"
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <chrono>
 #include <cstdint>
+#include <mutex>
 
 namespace ptrclaw {
 
@@ -11,9 +13,15 @@ class EventBus;
 
 // Bridges channel display concerns with the event bus.
 // Owns stream state and subscribes to message, typing, and stream events.
+// A session has stream state while one of its turns runs: from its
+// TurnStartEvent to the MessageReadyEvent with the same turn_id.
 class StreamRelay {
 public:
     StreamRelay(Channel& channel, EventBus& bus);
+    // Unsubscribes the async progress handler, waiting for a running one
+    ~StreamRelay();
+    StreamRelay(const StreamRelay&) = delete;
+    StreamRelay& operator=(const StreamRelay&) = delete;
 
     // Subscribe all event handlers. Call once after other handlers that
     // must run first (e.g. SessionManager) are already subscribed.
@@ -22,15 +30,44 @@ public:
 private:
     struct StreamState {
         std::string chat_id;
+        uint64_t turn_id = 0;
         int64_t message_id = 0;
         std::string accumulated;
         std::chrono::steady_clock::time_point last_edit;
         bool delivered = false;
+        // Calls of the turn that have not reported a result yet; progress
+        // is only shown for these
+        std::unordered_set<std::string> running_calls;
+        // Live output of the running tool call (streaming channels only)
+        std::string progress_call_id;
+        int64_t progress_message_id = 0;
+        std::string progress_tail;
     };
 
+    // State of `session_id` if it still belongs to `turn_id` (caller holds
+    // mutex_)
+    StreamState* find_state(const std::string& session_id, uint64_t turn_id);
+
+    // Output shown in a tool progress message
+    static constexpr size_t kProgressTailBytes = 800;
+    // Progress events waiting for the relay's progress thread; publishers
+    // (the tool's own read loop) wait when it is full
+    static constexpr size_t kProgressQueue = 8;
+
     Channel& channel_;
     EventBus& bus_;
+    // Handlers run on whichever thread publishes (session workers included),
+    // except tool progress, which has its own thread.
+    // Guards stream_states_ only; never held across channel calls.
+    std::mutex mutex_;
     std::unordered_map<std::string, StreamState> stream_states_;
+    // Sessions sent a typing indicator for a message whose turn has not
+    // started yet
+    std::unordered_set<std::string> typing_shown_;
+    // Held across progress message edits so a call's final edit lands
+    // after its last progress edit
+    std::mutex progress_mutex_;
+    uint64_t progress_sub_ = 0;
 };
 
 } // namespace ptrclaw
@@ -0,0 +1,325 @@
+#include "text_scan.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PTRCLAW_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ptrclaw {
+
+namespace {
+
+// Each kernel scans p[0, n) and returns an offset, or n when it finds nothing
+struct Kernels {
+    const char* name;
+    size_t (*count_byte)(const char* p, size_t n, char c);
+    size_t (*find_byte)(const char* p, size_t n, char c);
+    size_t (*skip_blanks)(const char* p, size_t n);
+    void (*split_lines)(const char* p, size_t n, std::vector<std::string_view>& lines);
+};
+
+// ── Scalar ──────────────────────────────────────────────────────
+
+bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+size_t count_byte_scalar(const char* p, size_t n, char c) {
+    return static_cast<size_t>(std::count(p, p + n, c));
+}
+
+// memchr is already vectorized by most C libraries
+size_t find_byte_scalar(const char* p, size_t n, char c) {
+    const void* hit = std::memchr(p, c, n);
+    return hit ? static_cast<size_t>(static_cast<const char*>(hit) - p) : n;
+}
+
+size_t skip_blanks_scalar(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && is_blank(p[i])) i++;
+    return i;
+}
+
+void split_lines_scalar(const char* p, size_t n, std::vector<std::string_view>& lines) {
+    lines.reserve(lines.size() + count_byte_scalar(p, n, '\n') + 1);
+    size_t start = 0;
+    while (start < n) {
+        size_t eol = find_byte_scalar(p + start, n - start, '\n');
+        lines.emplace_back(p + start, eol);
+        start += eol + 1;
+    }
+}
+
+const Kernels kScalar = {
+    "scalar", count_byte_scalar, find_byte_scalar, skip_blanks_scalar, split_lines_scalar,
+};
+
+#ifdef PTRCLAW_SCAN_X86
+
+// ── SSE2 (baseline on x86-64) ───────────────────────────────────
+// 16 bytes per step; movemask turns a lane compare into one bit per byte.
+
+// Lines ending in p[from, n), the current line having started at `start`
+void split_tail(const char* p, size_t n, size_t from, size_t start,
+                std::vector<std::string_view>& lines) {
+    for (size_t i = from; i < n; i++) {
+        if (p[i] == '\n') {
+            lines.emplace_back(p + start, i - start);
+            start = i + 1;
+        }
+    }
+    if (start < n) lines.emplace_back(p + start, n - start);
+}
+
+// Lines ending at the set bits of `mask`, a block of newline flags at p + base
+inline void emit_lines(uint32_t mask, const char* p, size_t base, size_t& start,
+                       std::vector<std::string_view>& lines) {
+    while (mask) {
+        size_t eol = base + static_cast<size_t>(__builtin_ctz(mask));
+        lines.emplace_back(p + start, eol - start);
+        start = eol + 1;
+        mask &= mask - 1;
+    }
+}
+
+inline __m128i load16(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline uint32_t mask16(__m128i lanes) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(lanes));
+}
+
+inline __m128i blank16(__m128i v) {
+    return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+}
+
+size_t count_byte_sse2(const char* p, size_t n, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t total = 0;
+    size_t i = 0;
+    while (i + 16 <= n) {
+        // Per-lane byte counters; fold them before they can overflow
+        size_t blocks = std::min<size_t>((n - i) / 16, 255);
+        __m128i acc = _mm_setzero_si128();
+        for (size_t b = 0; b < blocks; b++, i += 16) {
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(load16(p + i), needle));
+        }
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        total += static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+    }
+    return total + count_byte_scalar(p + i, n - i, c);
+}
+
+// Matchers give one bit per byte of a 16-byte block
+struct Eq16 {
+    __m128i c;
+    uint32_t operator()(__m128i v) const { return mask16(_mm_cmpeq_epi8(v, c)); }
+};
+struct Blank16 {
+    uint32_t operator()(__m128i v) const { return mask16(blank16(v)); }
+};
+
+// Offset of the first byte `match` flags (or, with kSkip, does not flag), or
+// n. Needs n >= 16: a partial last block is re-read as the final 16 bytes,
+// with the bytes already scanned shifted out.
+template <bool kSkip, typename Match>
+size_t scan16(const char* p, size_t n, Match match) {
+    auto hits = [&](const char* at) {
+        uint32_t m = match(load16(at));
+        return kSkip ? ~m & 0xFFFFu : m;
+    };
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint32_t m = hits(p + i);
+        if (m) return i + static_cast<size_t>(__builtin_ctz(m));
+    }
+    if (i < n) {
+        uint32_t m = hits(p + n - 16) >> (16 - (n - i));
+        if (m) return i + static_cast<size_t>(__builtin_ctz(m));
+    }
+    return n;
+}
+
+size_t find_byte_sse2(const char* p, size_t n, char c) {
+    if (n < 16) return find_byte_scalar(p, n, c);
+    return scan16<false>(p, n, Eq16{_mm_set1_epi8(c)});
+}
+
+size_t skip_blanks_sse2(const char* p, size_t n) {
+    if (n < 16) return skip_blanks_scalar(p, n);
+    return scan16<true>(p, n, Blank16{});
+}
+
+void split_lines_sse2(const char* p, size_t n, std::vector<std::string_view>& lines) {
+    lines.reserve(lines.size() + count_byte_sse2(p, n, '\n') + 1);
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t start = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        emit_lines(mask16(_mm_cmpeq_epi8(load16(p + i), nl)), p, i, start, lines);
+    }
+    split_tail(p, n, i, start, lines);
+}
+
+const Kernels kSse2 = {
+    "sse2", count_byte_sse2, find_byte_sse2, skip_blanks_sse2, split_lines_sse2,
+};
+
+// ── AVX2 ────────────────────────────────────────────────────────
+// Same shape at 32 bytes per step; inputs shorter than a block go to SSE2.
+
+#define PTRCLAW_AVX2 __attribute__((target("avx2")))
+
+PTRCLAW_AVX2 inline __m256i load32(const char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+PTRCLAW_AVX2 inline uint32_t mask32(__m256i lanes) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(lanes));
+}
+
+PTRCLAW_AVX2 inline __m256i blank32(__m256i v) {
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+}
+
+PTRCLAW_AVX2 size_t count_byte_avx2(const char* p, size_t n, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t total = 0;
+    size_t i = 0;
+    while (i + 32 <= n) {
+        size_t blocks = std::min<size_t>((n - i) / 32, 255);
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t b = 0; b < blocks; b++, i += 32) {
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(load32(p + i), needle));
+        }
+        alignas(32) uint64_t sums[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(sums), _mm256_sad_epu8(acc, _mm256_setzero_si256()));
+        total += static_cast<size_t>(sums[0] + sums[1] + sums[2] + sums[3]);
+    }
+    return total + count_byte_sse2(p + i, n - i, c);
+}
+
+struct Eq32 {
+    __m256i c;
+    PTRCLAW_AVX2 uint32_t operator()(__m256i v) const { return mask32(_mm256_cmpeq_epi8(v, c)); }
+};
+struct Blank32 {
+    PTRCLAW_AVX2 uint32_t operator()(__m256i v) const { return mask32(blank32(v)); }
+};
+
+// scan16 at 32 bytes per step; needs n >= 32
+template <bool kSkip, typename Match>
+PTRCLAW_AVX2 size_t scan32(const char* p, size_t n, Match match) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        uint32_t m = match(load32(p + i));
+        if (kSkip) m = ~m;
+        if (m) return i + static_cast<size_t>(__builtin_ctz(m));
+    }
+    if (i < n) {
+        uint32_t m = match(load32(p + n - 32));
+        if (kSkip) m = ~m;
+        m >>= 32 - (n - i);
+        if (m) return i + static_cast<size_t>(__builtin_ctz(m));
+    }
+    return n;
+}
+
+PTRCLAW_AVX2 size_t find_byte_avx2(const char* p, size_t n, char c) {
+    if (n < 32) return find_byte_sse2(p, n, c);
+    return scan32<false>(p, n, Eq32{_mm256_set1_epi8(c)});
+}
+
+PTRCLAW_AVX2 size_t skip_blanks_avx2(const char* p, size_t n) {
+    if (n < 32) return skip_blanks_sse2(p, n);
+    return scan32<true>(p, n, Blank32{});
+}
+
+PTRCLAW_AVX2 void split_lines_avx2(const char* p, size_t n, std::vector<std::string_view>& lines) {
+    lines.reserve(lines.size() + count_byte_avx2(p, n, '\n') + 1);
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t start = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        emit_lines(mask32(_mm256_cmpeq_epi8(load32(p + i), nl)), p, i, start, lines);
+    }
+    split_tail(p, n, i, start, lines);
+}
+
+#undef PTRCLAW_AVX2
+
+const Kernels kAvx2 = {
+    "avx2", count_byte_avx2, find_byte_avx2, skip_blanks_avx2, split_lines_avx2,
+};
+
+bool cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // PTRCLAW_SCAN_X86
+
+// ── Dispatch ────────────────────────────────────────────────────
+
+const Kernels* detect_kernels() {
+#ifdef PTRCLAW_SCAN_X86
+    return cpu_has_avx2() ? &kAvx2 : &kSse2;
+#else
+    return &kScalar;
+#endif
+}
+
+std::atomic<const Kernels*>& active_kernels() {
+    static std::atomic<const Kernels*> active{detect_kernels()};
+    return active;
+}
+
+const Kernels& kernels() {
+    return *active_kernels().load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+const char* scan_kernels() {
+    return kernels().name;
+}
+
+bool set_scan_kernels(std::string_view name) {
+    const Kernels* next = nullptr;
+    if (name == "scalar") next = &kScalar;
+#ifdef PTRCLAW_SCAN_X86
+    if (name == "sse2") next = &kSse2;
+    if (name == "avx2" && cpu_has_avx2()) next = &kAvx2;
+#endif
+    if (!next) return false;
+    active_kernels().store(next, std::memory_order_relaxed);
+    return true;
+}
+
+size_t count_byte(std::string_view text, char c) {
+    return kernels().count_byte(text.data(), text.size(), c);
+}
+
+size_t find_byte(std::string_view text, char c, size_t pos) {
+    if (pos >= text.size()) return std::string_view::npos;
+    size_t hit = pos + kernels().find_byte(text.data() + pos, text.size() - pos, c);
+    return hit < text.size() ? hit : std::string_view::npos;
+}
+
+size_t skip_blanks(std::string_view text, size_t pos) {
+    if (pos >= text.size()) return text.size();
+    return pos + kernels().skip_blanks(text.data() + pos, text.size() - pos);
+}
+
+void split_lines_into(std::string_view text, std::vector<std::string_view>& lines) {
+    kernels().split_lines(text.data(), text.size(), lines);
+}
+
+} // namespace ptrclaw
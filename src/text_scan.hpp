@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace ptrclaw {
+
+// Byte-scanning kernels behind the output filters. On x86-64 each kernel
+// has an SSE2 and an AVX2 version and the best one the CPU supports is
+// picked on first use; other targets use the portable scalar versions.
+// Positions are offsets into `text`; a search that finds nothing returns
+// std::string_view::npos, a skip that runs off the end returns text.size().
+
+// Kernel set in use: "avx2", "sse2" or "scalar"
+const char* scan_kernels();
+
+// Switch to the named kernel set. Returns false, changing nothing, if the
+// name is unknown or the CPU lacks the instructions. For tests and benchmarks.
+bool set_scan_kernels(std::string_view name);
+
+// Occurrences of `c` in `text`
+size_t count_byte(std::string_view text, char c);
+
+// First `c` at or after `pos`
+size_t find_byte(std::string_view text, char c, size_t pos = 0);
+
+// First byte at or after `pos` that is not ' ', '\t' or '\r'
+size_t skip_blanks(std::string_view text, size_t pos = 0);
+
+// Append the lines of `text`, split on '\n', to `lines`. A trailing newline
+// does not start another line.
+void split_lines_into(std::string_view text, std::vector<std::string_view>& lines);
+
+} // namespace ptrclaw
@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 #include <atomic>
+#include <functional>
 
 namespace ptrclaw {
 
@@ -22,6 +23,10 @@ inline void cancel(const CancellationToken& token) {
     if (token) token->store(true, std::memory_order_relaxed);
 }
 
+// Receives output as a running tool produces it. ToolManager throttles the
+// deltas and publishes them as ToolCallProgressEvents.
+using ToolProgress = std::function<void(const std::string& delta)>;
+
 struct ToolSpec {
     std::string name;
     std::string description;
@@ -33,6 +38,13 @@ struct ToolResult {
     std::string output;
 };
 
+// Memoization contract a tool opts into (see ToolManager):
+//   Pure       - same canonical arguments and memo_stamp(), same result,
+//                as long as no side-effecting tool has run since
+//   FileBacked - as Pure, and the files named by memo_paths() still have
+//                the size and mtime they had when the result was computed
+enum class ToolPurity { Impure, Pure, FileBacked };
+
 class Tool {
 public:
     virtual ~Tool() = default;
@@ -41,11 +53,29 @@ public:
                                const CancellationToken& /*token*/) {
         return execute(args_json);
     }
+    // Tools with incremental output override this to report it
+    virtual ToolResult execute(const std::string& args_json,
+                               const CancellationToken& token,
+                               const ToolProgress& /*progress*/) {
+        return execute(args_json, token);
+    }
     virtual std::string tool_name() const = 0;
     virtual std::string description() const = 0;
     virtual std::string parameters_json() const = 0;
     virtual void reset() {}
 
+    virtual ToolPurity purity() const { return ToolPurity::Impure; }
+    // Files a FileBacked result depends on
+    virtual std::vector<std::string> memo_paths(const std::string& /*args_json*/) const {
+        return {};
+    }
+    // Other state the result depends on (empty = none)
+    virtual std::string memo_stamp(const std::string& /*args_json*/) const { return {}; }
+
+    // ToolPool concurrency class; agent.tool_class_limits caps how many
+    // calls of one class run at once per session
+    virtual std::string concurrency_class() const { return "default"; }
+
     ToolSpec spec() const {
         return ToolSpec{tool_name(), description(), parameters_json()};
     }
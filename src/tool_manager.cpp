@@ -1,10 +1,14 @@
 #include "tool_manager.hpp"
 #include "memory.hpp"
+#include "metrics.hpp"
 #include "output_filter.hpp"
+#include "trace.hpp"
 #include "util.hpp"
+#include "tools/shell.hpp"
 #include <nlohmann/json.hpp>
 #include <iostream>
-#include <future>
+#include <algorithm>
+#include <sys/stat.h>
 
 namespace ptrclaw {
 
@@ -32,6 +36,25 @@ bool BatchCollector::wait(std::chrono::seconds timeout) {
         [this] { return results_.size() >= expected_; });
 }
 
+bool BatchCollector::wait(std::chrono::seconds timeout, const CancellationToken& token) {
+    if (!token) return wait(timeout);
+
+    auto done = [this] { return results_.size() >= expected_; };
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!done()) {
+        if (is_cancelled(token)) return false;
+        auto slice = std::chrono::steady_clock::now() +
+                     std::chrono::milliseconds(kCancelPollMs);
+        if (timeout.count() != 0) {
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            slice = std::min(slice, deadline);
+        }
+        cv_.wait_until(lock, slice, done);
+    }
+    return true;
+}
+
 std::vector<ToolCallResultEvent> BatchCollector::results() const {
     std::lock_guard<std::mutex> lock(mutex_);
     return results_;
@@ -42,6 +65,28 @@ size_t BatchCollector::missing() const {
     return expected_ > results_.size() ? expected_ - results_.size() : 0;
 }
 
+void BatchCollector::on_progress(const ToolCallProgressEvent& ev) {
+    if (ev.batch_id != batch_id_) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& partial = partial_[ev.tool_call_id];
+    partial += ev.delta;
+    if (partial.size() > kMaxPartialBytes) {
+        size_t cut = partial.size() - kMaxPartialBytes;
+        // Don't start in the middle of a UTF-8 sequence
+        while (cut < partial.size() &&
+               (static_cast<unsigned char>(partial[cut]) & 0xC0) == 0x80) {
+            cut++;
+        }
+        partial.erase(0, cut);
+    }
+}
+
+std::string BatchCollector::partial_output(const std::string& tool_call_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = partial_.find(tool_call_id);
+    return it == partial_.end() ? std::string() : it->second;
+}
+
 // ── ToolManager ─────────────────────────────────────────────────
 
 ToolManager::ToolManager(std::vector<std::unique_ptr<Tool>> tools,
@@ -49,6 +94,12 @@ ToolManager::ToolManager(std::vector<std::unique_ptr<Tool>> tools,
                          EventBus& bus,
                          const std::string& session_id)
     : tools_(std::move(tools)), config_(config), bus_(bus), session_id_(session_id) {
+    ToolPoolOptions pool_options;
+    pool_options.workers = config_.agent.tool_workers;
+    pool_options.max_queued = config_.agent.tool_queue;
+    pool_options.class_limits = config_.agent.tool_class_limits;
+    pool_ = ToolPool::shared(pool_options);
+
     request_sub_id_ = subscribe<ToolCallRequestEvent>(bus_,
         std::function<void(const ToolCallRequestEvent&)>(
             [this](const ToolCallRequestEvent& ev) { on_tool_call_request(ev); }));
@@ -63,6 +114,16 @@ ToolManager::ToolManager(std::vector<std::unique_ptr<Tool>> tools,
             ebt->set_event_bus(&bus_);
             ebt->set_session_id(session_id_);
         }
+        if (auto* shell = dynamic_cast<ShellTool*>(tool.get())) {
+            ShellLimits limits;
+            limits.cpu_seconds = config_.agent.shell_cpu_seconds;
+            limits.memory_mb = config_.agent.shell_memory_mb;
+            limits.open_files = config_.agent.shell_open_files;
+            limits.output_bytes = config_.agent.shell_output_bytes;
+            limits.cgroup = config_.agent.shell_cgroup;
+            shell->set_limits(limits);
+            shell->set_persistent(config_.agent.shell_persistent);
+        }
     }
 }
 
@@ -108,10 +169,10 @@ ToolManager::~ToolManager() {
             cancel(call.token);
         }
     }
-    std::lock_guard<std::mutex> lock(futures_mutex_);
-    for (auto& f : pending_futures_) {
-        if (f.valid()) f.wait();
-    }
+
+    // Queued calls still run (and see their cancelled token); wait for all
+    std::unique_lock<std::mutex> lock(calls_mutex_);
+    idle_cv_.wait(lock, [this] { return in_flight_ == 0; });
 }
 
 void ToolManager::on_tool_call_request(const ToolCallRequestEvent& ev) {
@@ -126,17 +187,36 @@ void ToolManager::on_tool_call_request(const ToolCallRequestEvent& ev) {
         active_calls_[ev.tool_call_id] = {token, ev.batch_id};
     }
 
-    cleanup_futures();
-    std::lock_guard<std::mutex> lock(futures_mutex_);
-    pending_futures_.push_back(
-        std::async(std::launch::async,
-            [this, ev, token]() noexcept { // NOLINT(bugprone-exception-escape)
-                try {
+    Tool* tool = find_tool(ev.tool_name);
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        in_flight_++;
+    }
+    pool_->submit(tool ? tool->concurrency_class() : "default", ev.session_id,
+        [this, ev, token]() noexcept { // NOLINT(bugprone-exception-escape)
+            try {
+                if (is_cancelled(token)) {
+                    publish_cancelled(ev);
+                } else {
                     execute_and_publish(ev, token);
-                } catch (...) {} // NOLINT(bugprone-empty-catch)
-                std::lock_guard<std::mutex> clock(calls_mutex_);
-                active_calls_.erase(ev.tool_call_id);
-            }));
+                }
+            } catch (...) {} // NOLINT(bugprone-empty-catch)
+            std::lock_guard<std::mutex> lock(calls_mutex_);
+            active_calls_.erase(ev.tool_call_id);
+            // Notify under the lock: the destructor may run as soon as it drops
+            if (--in_flight_ == 0) idle_cv_.notify_all();
+        });
+}
+
+void ToolManager::publish_cancelled(const ToolCallRequestEvent& ev) {
+    ToolCallResultEvent rev;
+    rev.session_id = ev.session_id;
+    rev.batch_id = ev.batch_id;
+    rev.tool_call_id = ev.tool_call_id;
+    rev.tool_name = ev.tool_name;
+    rev.success = false;
+    rev.output = "Cancelled before start";
+    bus_.publish(rev);
 }
 
 void ToolManager::on_tool_call_cancel(const ToolCallCancelEvent& ev) {
@@ -156,12 +236,72 @@ void ToolManager::on_tool_call_cancel(const ToolCallCancelEvent& ev) {
 
 void ToolManager::execute_and_publish(const ToolCallRequestEvent& ev,
                                       const CancellationToken& token) {
-    auto result = execute_tool(ev.tool_name, ev.arguments_json, token);
+    auto& m = metrics();
+    ToolCallResultEvent rev;
+    rev.session_id = ev.session_id;
+    rev.batch_id = ev.batch_id;
+    rev.tool_call_id = ev.tool_call_id;
+    rev.tool_name = ev.tool_name;
+
+    Tool* tool = find_tool(ev.tool_name);
+    uint32_t token_budget = result_token_budget(ev);
+    bool impure = tool && tool->purity() == ToolPurity::Impure;
+    bool memoize = tool && !impure && config_.agent.tool_memo_entries > 0;
+    std::string memo_key;
+    std::string stamp;
+    uint64_t epoch = 0;
+    if (memoize) {
+        // Canonical arguments: parsed objects dump with sorted keys
+        auto args = nlohmann::json::parse(ev.arguments_json, nullptr, false);
+        memoize = !args.is_discarded();
+        if (memoize) {
+            memo_key = ev.tool_name + '\n' + args.dump();
+            {
+                std::lock_guard<std::mutex> lock(memo_mutex_);
+                epoch = memo_epoch_;
+            }
+            stamp = memo_stamp(*tool, ev.arguments_json);
+            auto hit = memo_lookup(memo_key, stamp, token_budget);
+            m.tool_memo.labels(metric_labels("tool", ev.tool_name,
+                                             "result", hit ? "hit" : "miss")).inc();
+            if (hit) {
+                std::cerr << "[tool] " << ev.tool_name << ": memoized result of "
+                          << hit->tool_call_id << '\n';
+                rev.success = hit->success;
+                rev.output = std::move(hit->output);
+                rev.raw_tokens = hit->raw_tokens;
+                rev.filtered_tokens = hit->filtered_tokens;
+                rev.memoized = true;
+                rev.memo_of = hit->tool_call_id;
+                bus_.publish(rev);
+                return;
+            }
+        }
+    }
+
+    // Before and after, so pure calls overlapping it are not stored either
+    if (impure) memo_invalidate();
+    ScopedTimer timer(m.tool_seconds.labels(metric_label("tool", ev.tool_name)));
+    auto result = execute_tool(tool, ev.tool_name, ev.arguments_json, token,
+                               progress_publisher(ev));
+    if (impure) memo_invalidate();
 
     uint32_t raw_tokens = estimate_tokens(result.output);
-    result.output = apply_filters(ev.tool_name, ev.arguments_json,
-                                   result.success, std::move(result.output));
-    uint32_t filtered_tokens = estimate_tokens(result.output);
+    uint32_t filtered_tokens = 0;
+    {
+        TraceSpan span("filter", ev.session_id, "tool");
+        result.output = apply_filters(ev.tool_name, ev.arguments_json,
+                                       result.success, std::move(result.output),
+                                       token_budget);
+        filtered_tokens = estimate_tokens(result.output);
+        span.arg("token_budget", token_budget);
+        span.arg("raw_tokens", raw_tokens);
+        span.arg("filtered_tokens", filtered_tokens);
+    }
+    m.tool_output_tokens.labels(metric_labels("tool", ev.tool_name, "stage", "raw"))
+        .inc(raw_tokens);
+    m.tool_output_tokens.labels(metric_labels("tool", ev.tool_name, "stage", "filtered"))
+        .inc(filtered_tokens);
 
     if (raw_tokens > filtered_tokens + 10) {
         std::cerr << "[filter] " << ev.tool_name << ": "
@@ -169,41 +309,148 @@ void ToolManager::execute_and_publish(const ToolCallRequestEvent& ev,
                   << (raw_tokens - filtered_tokens) << " saved)\n";
     }
 
-    ToolCallResultEvent rev;
-    rev.session_id = ev.session_id;
-    rev.batch_id = ev.batch_id;
-    rev.tool_call_id = ev.tool_call_id;
-    rev.tool_name = ev.tool_name;
     rev.success = result.success;
     rev.output = std::move(result.output);
     rev.raw_tokens = raw_tokens;
     rev.filtered_tokens = filtered_tokens;
+    if (memoize && result.success && !is_cancelled(token)) {
+        MemoEntry entry;
+        entry.stamp = std::move(stamp);
+        entry.tool_call_id = ev.tool_call_id;
+        entry.success = true;
+        entry.output = rev.output;
+        entry.raw_tokens = raw_tokens;
+        entry.filtered_tokens = filtered_tokens;
+        entry.token_budget = token_budget;
+        memo_store(memo_key, std::move(entry), epoch);
+    }
     bus_.publish(rev);
 }
 
-ToolResult ToolManager::execute_tool(const std::string& name,
-                                     const std::string& args_json,
-                                     const CancellationToken& token) {
+Tool* ToolManager::find_tool(const std::string& name) const {
     for (const auto& tool : tools_) {
-        if (tool->tool_name() == name) return tool->execute(args_json, token);
+        if (tool->tool_name() == name) return tool.get();
+    }
+    return nullptr;
+}
+
+uint32_t ToolManager::result_token_budget(const ToolCallRequestEvent& ev) const {
+    if (ev.token_budget == 0) return kDefaultResultTokens;
+    uint32_t share = ev.token_budget / std::max<uint32_t>(ev.batch_size, 1);
+    share = std::min(share, config_.agent.tool_output_max_tokens);
+    return std::max(share, config_.agent.tool_output_min_tokens);
+}
+
+ToolResult ToolManager::execute_tool(Tool* tool, const std::string& name,
+                                     const std::string& args_json,
+                                     const CancellationToken& token,
+                                     const ToolProgress& progress) {
+    if (!tool) return ToolResult{false, "Unknown tool: " + name};
+    return tool->execute(args_json, token, progress);
+}
+
+ToolProgress ToolManager::progress_publisher(const ToolCallRequestEvent& ev) {
+    // Deltas are buffered and published at most once per interval, when the
+    // next one arrives; the final result carries anything still buffered.
+    // Calls that finish within the first interval publish nothing.
+    struct State {
+        ToolCallProgressEvent event;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point last = start;
+    };
+    auto state = std::make_shared<State>();
+    state->event.session_id = ev.session_id;
+    state->event.batch_id = ev.batch_id;
+    state->event.tool_call_id = ev.tool_call_id;
+    state->event.tool_name = ev.tool_name;
+    return [this, state](const std::string& delta) {
+        auto& pev = state->event;
+        pev.delta += delta;
+        pev.total_bytes += delta.size();
+        if (pev.delta.size() > kMaxProgressBytes) {
+            pev.delta.erase(0, pev.delta.size() - kMaxProgressBytes);
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - state->last < std::chrono::milliseconds(kProgressIntervalMs)) return;
+        state->last = now;
+        pev.elapsed_ms = static_cast<uint32_t>(std::chrono::duration_cast<
+            std::chrono::milliseconds>(now - state->start).count());
+        bus_.publish(pev);
+        pev.delta.clear();
+    };
+}
+
+// ── Memoization ─────────────────────────────────────────────────
+
+static int64_t file_mtime_ns(const struct stat& st) {
+#ifdef __APPLE__
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+std::string ToolManager::memo_stamp(const Tool& tool, const std::string& args_json) {
+    std::string stamp = tool.memo_stamp(args_json);
+    if (tool.purity() != ToolPurity::FileBacked) return stamp;
+    for (const auto& path : tool.memo_paths(args_json)) {
+        stamp += '\n';
+        stamp += path;
+        struct stat st{};
+        if (::stat(path.c_str(), &st) != 0) {
+            stamp += ":missing";
+            continue;
+        }
+        stamp += ':' + std::to_string(st.st_dev) + ':' + std::to_string(st.st_ino) +
+                 ':' + std::to_string(st.st_size) + ':' + std::to_string(file_mtime_ns(st));
+    }
+    return stamp;
+}
+
+std::optional<ToolManager::MemoEntry> ToolManager::memo_lookup(const std::string& key,
+                                                               const std::string& stamp,
+                                                               uint32_t token_budget) {
+    std::lock_guard<std::mutex> lock(memo_mutex_);
+    auto it = memo_.find(key);
+    if (it == memo_.end()) return std::nullopt;
+    if (it->second.stamp != stamp) {
+        memo_.erase(it);
+        return std::nullopt;
+    }
+    // Cut more than this budget needs, or too large for it: filter afresh
+    if (it->second.token_budget < token_budget ||
+        it->second.filtered_tokens > token_budget) {
+        return std::nullopt;
+    }
+    it->second.last_use = ++memo_clock_;
+    return it->second;
+}
+
+void ToolManager::memo_store(const std::string& key, MemoEntry entry, uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(memo_mutex_);
+    // An impure tool ran while this one executed: the result may be stale
+    if (epoch != memo_epoch_) return;
+    entry.last_use = ++memo_clock_;
+    memo_[key] = std::move(entry);
+    while (memo_.size() > config_.agent.tool_memo_entries) {
+        auto oldest = std::min_element(memo_.begin(), memo_.end(),
+            [](const auto& a, const auto& b) { return a.second.last_use < b.second.last_use; });
+        memo_.erase(oldest);
     }
-    return ToolResult{false, "Unknown tool: " + name};
 }
 
-void ToolManager::cleanup_futures() {
-    std::lock_guard<std::mutex> lock(futures_mutex_);
-    pending_futures_.erase(
-        std::remove_if(pending_futures_.begin(), pending_futures_.end(),
-            [](const std::future<void>& f) {
-                return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
-            }),
-        pending_futures_.end());
+void ToolManager::memo_invalidate() {
+    std::lock_guard<std::mutex> lock(memo_mutex_);
+    memo_epoch_++;
+    memo_.clear();
 }
 
 std::string ToolManager::apply_filters(const std::string& tool_name,
                                        const std::string& args_json,
                                        bool success,
-                                       std::string output) {
+                                       std::string output,
+                                       uint32_t token_budget) {
+    OutputFilterConfig filter_config = filter_config_for_tokens(token_budget);
     if (tool_name == "shell") {
         std::string command;
         try {
@@ -221,14 +468,14 @@ std::string ToolManager::apply_filters(const std::string& tool_name,
             }
         }
 
-        output = deduplicate_log_lines(output);
-        output = filter_shell_output(command, output);
+        filter_config.dedupe_log_lines = true;
+        output = filter_shell_output(command, output, filter_config);
 
         if (!tee_path.empty()) {
             output += "\n[Full output saved to " + tee_path + "]";
         }
     } else {
-        output = filter_tool_output(output);
+        output = filter_tool_output(output, filter_config);
     }
     return output;
 }
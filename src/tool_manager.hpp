@@ -3,6 +3,7 @@
 #include "event.hpp"
 #include "event_bus.hpp"
 #include "config.hpp"
+#include "tool_pool.hpp"
 #include <string>
 #include <vector>
 #include <memory>
@@ -10,7 +11,7 @@
 #include <condition_variable>
 #include <chrono>
 #include <cstdint>
-#include <future>
+#include <optional>
 #include <unordered_map>
 
 namespace ptrclaw {
@@ -31,6 +32,11 @@ public:
     // A zero timeout means wait indefinitely.
     bool wait(std::chrono::seconds timeout = std::chrono::seconds{0});
 
+    // As above, but also returns false as soon as `token` is cancelled.
+    // Cancellation is polled every kCancelPollMs.
+    bool wait(std::chrono::seconds timeout, const CancellationToken& token);
+    static constexpr int kCancelPollMs = 20;
+
     // Retrieve collected results (valid after wait() returns).
     // On timeout, contains only the results received so far.
     std::vector<ToolCallResultEvent> results() const;
@@ -38,17 +44,38 @@ public:
     // Number of results still missing after wait() returns.
     size_t missing() const;
 
+    // Called by EventBus handler when a ToolCallProgressEvent arrives.
+    // Keeps the last kMaxPartialBytes of each call's output.
+    void on_progress(const ToolCallProgressEvent& ev);
+    static constexpr size_t kMaxPartialBytes = 4000;
+
+    // Output a call reported before finishing (empty if none), e.g. to
+    // explain a timeout.
+    std::string partial_output(const std::string& tool_call_id) const;
+
 private:
     std::string batch_id_;
     size_t expected_;
     mutable std::mutex mutex_;
     std::condition_variable cv_;
     std::vector<ToolCallResultEvent> results_;
+    std::unordered_map<std::string, std::string> partial_;  // by tool_call_id
 };
 
 // Event-driven tool executor. Subscribes to ToolCallRequestEvents on the bus,
-// executes tools (with output filtering), and publishes ToolCallResultEvents.
-// Publishes ToolsAvailableEvent when the set of available tools changes.
+// executes tools (with output filtering) on the shared ToolPool, and
+// publishes ToolCallResultEvents. Publishes ToolsAvailableEvent when the set
+// of available tools changes.
+//
+// Results of tools that declare a ToolPurity other than Impure are memoized
+// by (tool, canonical arguments) for up to agent.tool_memo_entries calls.
+// An entry is reused while its stamp (memo_stamp() plus the size/mtime of
+// any memo_paths()) is unchanged; running any impure tool drops them all.
+//
+// Output is filtered to the call's share of the batch's token budget (see
+// ToolCallRequestEvent::token_budget), clamped to agent.tool_output_min_tokens
+// .. agent.tool_output_max_tokens; requests without a budget get
+// kDefaultResultTokens.
 class ToolManager {
 public:
     ToolManager(std::vector<std::unique_ptr<Tool>> tools,
@@ -57,6 +84,13 @@ public:
                 const std::string& session_id = "");
     ~ToolManager();
 
+    // Minimum spacing of ToolCallProgressEvents for one call
+    static constexpr int kProgressIntervalMs = 1000;
+    // Output buffered between two events; older bytes are dropped
+    static constexpr size_t kMaxProgressBytes = 8192;
+    // Result size for requests without a budget (the OutputFilterConfig defaults)
+    static constexpr uint32_t kDefaultResultTokens = 5000;
+
     // Publish current tool specs as ToolsAvailableEvent.
     void publish_tool_specs(const std::string& session_id = "");
 
@@ -70,15 +104,41 @@ public:
 private:
     void on_tool_call_request(const ToolCallRequestEvent& ev);
     void on_tool_call_cancel(const ToolCallCancelEvent& ev);
+    // Result for a call cancelled while it waited in the pool queue
+    void publish_cancelled(const ToolCallRequestEvent& ev);
     void execute_and_publish(const ToolCallRequestEvent& ev,
                              const CancellationToken& token);
-    ToolResult execute_tool(const std::string& name, const std::string& args_json,
-                            const CancellationToken& token);
+    ToolResult execute_tool(Tool* tool, const std::string& name,
+                            const std::string& args_json, const CancellationToken& token,
+                            const ToolProgress& progress);
+    // Throttled ToolCallProgressEvent publisher for one call
+    ToolProgress progress_publisher(const ToolCallRequestEvent& ev);
+    Tool* find_tool(const std::string& name) const;
+    // Tokens one result of `ev`'s batch may take (see class comment)
+    uint32_t result_token_budget(const ToolCallRequestEvent& ev) const;
     std::string apply_filters(const std::string& tool_name,
                               const std::string& args_json,
                               bool success,
-                              std::string output);
-    void cleanup_futures();
+                              std::string output,
+                              uint32_t token_budget);
+
+    // Memoization (see class comment)
+    struct MemoEntry {
+        std::string stamp;
+        std::string tool_call_id;  // call that produced the result
+        bool success = false;
+        std::string output;        // filtered
+        uint32_t raw_tokens = 0;
+        uint32_t filtered_tokens = 0;
+        uint32_t token_budget = 0;  // the output was filtered to
+        uint64_t last_use = 0;
+    };
+    static std::string memo_stamp(const Tool& tool, const std::string& args_json);
+    // Only entries filtered with at least `token_budget` that still fit in it
+    std::optional<MemoEntry> memo_lookup(const std::string& key, const std::string& stamp,
+                                         uint32_t token_budget);
+    void memo_store(const std::string& key, MemoEntry entry, uint64_t epoch);
+    void memo_invalidate();
 
     std::vector<std::unique_ptr<Tool>> tools_;
     Config config_;
@@ -87,14 +147,19 @@ private:
     uint64_t request_sub_id_ = 0;
     uint64_t cancel_sub_id_ = 0;
     bool memory_active_ = false;
-    std::vector<std::future<void>> pending_futures_;
-    std::mutex futures_mutex_;
+    std::shared_ptr<ToolPool> pool_;
     struct ActiveCall {
         CancellationToken token;
         std::string batch_id;
     };
     std::unordered_map<std::string, ActiveCall> active_calls_;  // keyed by tool_call_id
+    size_t in_flight_ = 0;               // submitted to the pool, not yet finished
+    std::condition_variable idle_cv_;    // in_flight_ reached 0
     std::mutex calls_mutex_;
+    std::unordered_map<std::string, MemoEntry> memo_;  // keyed by name + canonical args
+    uint64_t memo_epoch_ = 0;  // bumped when an impure tool starts or finishes
+    uint64_t memo_clock_ = 0;
+    std::mutex memo_mutex_;
 };
 
 } // namespace ptrclaw
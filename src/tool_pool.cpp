@@ -0,0 +1,111 @@
+#include "tool_pool.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+
+namespace ptrclaw {
+
+ToolPool::ToolPool(ToolPoolOptions options) : options_(std::move(options)) {
+    uint32_t count = std::max<uint32_t>(options_.workers, 1);
+    workers_.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+ToolPool::~ToolPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    room_cv_.notify_all();
+    // Workers drain the queue before exiting: every job's owner waits for it
+    for (auto& t : workers_) t.join();
+}
+
+std::shared_ptr<ToolPool> ToolPool::shared(const ToolPoolOptions& options) {
+    static std::mutex registry_mutex;
+    static std::weak_ptr<ToolPool> registry;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto pool = registry.lock();
+    if (!pool) {
+        pool = std::make_shared<ToolPool>(options);
+        registry = pool;
+    }
+    return pool;
+}
+
+uint32_t ToolPool::limit_for(const std::string& concurrency_class) const {
+    auto it = options_.class_limits.find(concurrency_class);
+    return it == options_.class_limits.end() || it->second == 0 ? UINT32_MAX : it->second;
+}
+
+void ToolPool::submit(const std::string& concurrency_class, const std::string& session_id,
+                      std::function<void()> run) {
+    Job job;
+    job.cls = concurrency_class;
+    job.slot = concurrency_class + '\n' + session_id;
+    job.run = std::move(run);
+    job.queued_at = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (options_.max_queued > 0) {
+            room_cv_.wait(lock, [this] {
+                return stopping_ || queue_.size() < options_.max_queued;
+            });
+        }
+        queue_.push_back(std::move(job));
+    }
+    metrics().tool_pool_queued.labels(metric_label("class", concurrency_class)).add(1);
+    work_cv_.notify_one();
+}
+
+ToolPoolStats ToolPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ToolPoolStats{queue_.size(), running_total_, completed_};
+}
+
+std::deque<ToolPool::Job>::iterator ToolPool::next_runnable() {
+    return std::find_if(queue_.begin(), queue_.end(), [this](const Job& job) {
+        auto it = running_.find(job.slot);
+        return it == running_.end() || it->second < limit_for(job.cls);
+    });
+}
+
+void ToolPool::worker_loop() {
+    auto& m = metrics();
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        auto it = queue_.end();
+        work_cv_.wait(lock, [this, &it] {
+            it = next_runnable();
+            return it != queue_.end() || (stopping_ && queue_.empty());
+        });
+        if (it == queue_.end()) return;
+
+        Job job = std::move(*it);
+        queue_.erase(it);
+        running_[job.slot]++;
+        running_total_++;
+        lock.unlock();
+        room_cv_.notify_one();
+
+        auto label = metric_label("class", job.cls);
+        m.tool_pool_queued.labels(label).add(-1);
+        m.tool_pool_wait_seconds.labels(label).observe(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - job.queued_at).count());
+        auto& running = m.tool_pool_running.labels(label);
+        running.add(1);
+        job.run();  // owners wrap their work; nothing escapes
+        running.add(-1);
+
+        lock.lock();
+        if (--running_[job.slot] == 0) running_.erase(job.slot);
+        running_total_--;
+        completed_++;
+        // A slot freed up: a queued job of that class may be runnable now
+        work_cv_.notify_all();
+    }
+}
+
+} // namespace ptrclaw
@@ -0,0 +1,80 @@
+#pragma once
+#include "tool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ptrclaw {
+
+struct ToolPoolOptions {
+    uint32_t workers = 8;        // threads shared by every ToolManager
+    uint32_t max_queued = 256;   // submit() blocks while this many are waiting
+    // Per-session running limit for a concurrency class (missing = no limit)
+    std::unordered_map<std::string, uint32_t> class_limits = {{"shell", 1}, {"write", 1}};
+};
+
+struct ToolPoolStats {
+    size_t queued = 0;
+    size_t running = 0;
+    uint64_t completed = 0;
+};
+
+// Bounded pool that runs tool calls for all sessions.
+//
+// Each job carries a concurrency class (Tool::concurrency_class()) and a
+// session. At most class_limits[class] jobs of one class run at once for a
+// session; others stay queued, in order, while later runnable jobs are
+// picked up. Jobs never block a worker waiting for a class slot.
+class ToolPool {
+public:
+    explicit ToolPool(ToolPoolOptions options);
+    ~ToolPool();
+    ToolPool(const ToolPool&) = delete;
+    ToolPool& operator=(const ToolPool&) = delete;
+
+    // Process-wide pool, created on first use. Later callers get the same
+    // pool; options come from the first one. Lives while anyone holds it.
+    static std::shared_ptr<ToolPool> shared(const ToolPoolOptions& options);
+
+    // Queue `run`. Blocks while max_queued jobs are already waiting. A job
+    // whose token is cancelled while queued still runs (so it can report a
+    // result); check the token first thing.
+    void submit(const std::string& concurrency_class, const std::string& session_id,
+                std::function<void()> run);
+
+    ToolPoolStats stats() const;
+    uint32_t limit_for(const std::string& concurrency_class) const;
+
+private:
+    struct Job {
+        std::string cls;
+        std::string slot;        // class + session: the unit limits apply to
+        std::function<void()> run;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+
+    void worker_loop();
+    // First queued job whose slot has room, or queue_.end(). Caller holds mutex_.
+    std::deque<Job>::iterator next_runnable();
+
+    ToolPoolOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;    // a job may have become runnable
+    std::condition_variable room_cv_;    // the queue has room
+    std::deque<Job> queue_;
+    std::unordered_map<std::string, uint32_t> running_;  // by slot
+    size_t running_total_ = 0;
+    uint64_t completed_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace ptrclaw
@@ -1,6 +1,9 @@
 #include "file_edit.hpp"
 #include "tool_util.hpp"
 #include "../plugin.hpp"
+#include "../text_scan.hpp"
+#include "../util.hpp"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -9,16 +12,69 @@ static ptrclaw::ToolRegistrar reg_file_edit("file_edit",
 
 namespace ptrclaw {
 
+namespace {
+
+struct Edit {
+    std::string old_text;
+    std::string new_text;
+    int index = -1;   // in `edits`, -1 for the single old_text/new_text form
+    size_t pos = 0;   // of old_text in the original contents
+
+    // Prefix for errors about this edit
+    std::string label() const {
+        return index < 0 ? "" : "edits[" + std::to_string(index) + "]: ";
+    }
+};
+
+// The single old_text/new_text pair, or each entry of `edits`
+std::optional<ToolResult> parse_edits(const nlohmann::json& args, std::vector<Edit>& edits) {
+    if (!args.contains("edits")) {
+        if (auto err = require_string(args, "old_text")) return err;
+        if (auto err = require_string(args, "new_text")) return err;
+        edits.push_back({args["old_text"].get<std::string>(),
+                         args["new_text"].get<std::string>(), -1, 0});
+        return std::nullopt;
+    }
+    if (args.contains("old_text") || args.contains("new_text")) {
+        return ToolResult{false, "Use either old_text/new_text or edits, not both"};
+    }
+    const auto& list = args["edits"];
+    if (!list.is_array() || list.empty()) {
+        return ToolResult{false, "edits must be a non-empty array"};
+    }
+    for (size_t i = 0; i < list.size(); i++) {
+        std::string label = "edits[" + std::to_string(i) + "]: ";
+        const auto& entry = list[i];
+        if (!entry.is_object()) {
+            return ToolResult{false, label + "expected an object with old_text and new_text"};
+        }
+        for (const char* field : {"old_text", "new_text"}) {
+            if (auto err = require_string(entry, field)) {
+                return ToolResult{false, label + err->output};
+            }
+        }
+        edits.push_back({entry["old_text"].get<std::string>(),
+                         entry["new_text"].get<std::string>(), static_cast<int>(i), 0});
+    }
+    return std::nullopt;
+}
+
+// Lines a piece of text spans
+size_t line_span(std::string_view text) {
+    if (text.empty()) return 0;
+    return count_byte(text, '\n') + (text.back() == '\n' ? 0 : 1);
+}
+
+} // namespace
+
 ToolResult FileEditTool::execute(const std::string& args_json) {
     nlohmann::json args;
     if (auto err = parse_tool_json(args_json, args)) return *err;
     if (auto err = require_string(args, "path")) return *err;
-    if (auto err = require_string(args, "old_text")) return *err;
-    if (auto err = require_string(args, "new_text")) return *err;
+    std::vector<Edit> edits;
+    if (auto err = parse_edits(args, edits)) return *err;
 
     std::string path = args["path"].get<std::string>();
-    std::string old_text = args["old_text"].get<std::string>();
-    std::string new_text = args["new_text"].get<std::string>();
     if (auto err = validate_safe_path(path)) return *err;
 
     // Read file
@@ -32,43 +88,98 @@ ToolResult FileEditTool::execute(const std::string& args_json) {
     std::string contents = ss.str();
     infile.close();
 
-    // Find old_text
-    size_t first_pos = contents.find(old_text);
-    if (first_pos == std::string::npos) {
-        return ToolResult{false, "old_text not found in file"};
+    // Every edit must match exactly once in the original text, and no two
+    // may overlap; otherwise nothing is changed
+    for (auto& edit : edits) {
+        if (edit.old_text.empty()) {
+            return ToolResult{false, edit.label() + "old_text must not be empty"};
+        }
+        edit.pos = contents.find(edit.old_text);
+        if (edit.pos == std::string::npos) {
+            return ToolResult{false, edit.label() + "old_text not found in file"};
+        }
+        if (contents.find(edit.old_text, edit.pos + 1) != std::string::npos) {
+            return ToolResult{false, edit.label() +
+                "old_text found multiple times in file (ambiguous edit); include more "
+                "surrounding text"};
+        }
     }
-
-    // Check for ambiguity
-    size_t second_pos = contents.find(old_text, first_pos + 1);
-    if (second_pos != std::string::npos) {
-        return ToolResult{false, "old_text found multiple times in file (ambiguous edit)"};
+    std::stable_sort(edits.begin(), edits.end(),
+                     [](const Edit& a, const Edit& b) { return a.pos < b.pos; });
+    for (size_t i = 1; i < edits.size(); i++) {
+        const auto& prev = edits[i - 1];
+        if (prev.pos + prev.old_text.size() > edits[i].pos) {
+            int a = std::min(prev.index, edits[i].index);
+            int b = std::max(prev.index, edits[i].index);
+            return ToolResult{false, "edits[" + std::to_string(a) + "] and edits[" +
+                                     std::to_string(b) + "] overlap"};
+        }
     }
 
-    // Replace
-    contents.replace(first_pos, old_text.size(), new_text);
-
-    // Write back
-    std::ofstream outfile(path);
-    if (!outfile.is_open()) {
-        return ToolResult{false, "Failed to open file for writing: " + path};
+    // Apply all edits in one pass over the original, noting where each
+    // replacement lands in the new file
+    std::string result;
+    result.reserve(contents.size());
+    std::string changes;
+    size_t copied = 0;
+    size_t line = 1;
+    size_t removed_total = 0;
+    size_t added_total = 0;
+    constexpr size_t kMaxListed = 20;
+    for (size_t i = 0; i < edits.size(); i++) {
+        const auto& edit = edits[i];
+        std::string_view before(contents.data() + copied, edit.pos - copied);
+        result.append(before);
+        line += count_byte(before, '\n');
+        result += edit.new_text;
+        copied = edit.pos + edit.old_text.size();
+
+        size_t removed = line_span(edit.old_text);
+        size_t added = line_span(edit.new_text);
+        removed_total += removed;
+        added_total += added;
+        if (i < kMaxListed) {
+            changes += added > 1 ? "\n  lines " + std::to_string(line) + "-" +
+                                       std::to_string(line + added - 1)
+                                 : "\n  line " + std::to_string(line);
+            changes += ": -" + std::to_string(removed) + " +" + std::to_string(added);
+        }
+        line += count_byte(edit.new_text, '\n');
+    }
+    result.append(contents, copied, std::string::npos);
+    if (edits.size() > kMaxListed) {
+        changes += "\n  ... " + std::to_string(edits.size() - kMaxListed) + " more";
     }
 
-    outfile << contents;
-    outfile.close();
-
-    if (outfile.fail()) {
+    // Write back via a temp file, so a failure leaves the original intact
+    if (result != contents && !atomic_write_file(path, result)) {
         return ToolResult{false, "Failed to write to file: " + path};
     }
 
-    return ToolResult{true, "File edited: " + path};
+    return ToolResult{true, "File edited: " + path + " (" + std::to_string(edits.size()) +
+                            (edits.size() == 1 ? " edit" : " edits") + ", -" +
+                            std::to_string(removed_total) + " +" +
+                            std::to_string(added_total) + " lines)" + changes};
 }
 
 std::string FileEditTool::description() const {
-    return "Edit a file by replacing exact text";
+    return "Edit a file by replacing exact text. Pass old_text/new_text for one edit, or "
+           "edits (a list of old_text/new_text pairs) to make several in one call. Each "
+           "old_text must occur exactly once and edits must not overlap; if any edit fails, "
+           "the file is left unchanged. Returns the line range of each change in the new file.";
 }
 
 std::string FileEditTool::parameters_json() const {
-    return R"({"type":"object","properties":{"path":{"type":"string","description":"The path of the file to edit"},"old_text":{"type":"string","description":"The exact text to find and replace"},"new_text":{"type":"string","description":"The replacement text"}},"required":["path","old_text","new_text"]})";
+    return R"({"type":"object","properties":{)"
+           R"("path":{"type":"string","description":"The path of the file to edit"},)"
+           R"("old_text":{"type":"string","description":"The exact text to find and replace"},)"
+           R"("new_text":{"type":"string","description":"The replacement text"},)"
+           R"("edits":{"type":"array","description":"Several replacements, applied together instead of old_text/new_text",)"
+           R"("items":{"type":"object","properties":{)"
+           R"("old_text":{"type":"string","description":"The exact text to find and replace"},)"
+           R"("new_text":{"type":"string","description":"The replacement text"}},)"
+           R"("required":["old_text","new_text"]}})"
+           R"(},"required":["path"]})";
 }
 
 } // namespace ptrclaw
@@ -1,8 +1,8 @@
 #include "file_read.hpp"
 #include "tool_util.hpp"
 #include "../plugin.hpp"
-#include <fstream>
-#include <sstream>
+#include "../ranged_file.hpp"
+#include <algorithm>
 
 static ptrclaw::ToolRegistrar reg_file_read("file_read",
     []() { return std::make_unique<ptrclaw::FileReadTool>(); });
@@ -17,29 +17,122 @@ ToolResult FileReadTool::execute(const std::string& args_json) {
     std::string path = args["path"].get<std::string>();
     if (auto err = validate_safe_path(path)) return *err;
 
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    std::optional<uint64_t> offset, limit, start_line, end_line;
+    if (auto err = get_optional_uint(args, "offset", offset)) return *err;
+    if (auto err = get_optional_uint(args, "limit", limit)) return *err;
+    if (auto err = get_optional_uint(args, "start_line", start_line)) return *err;
+    if (auto err = get_optional_uint(args, "end_line", end_line)) return *err;
+
+    bool by_line = start_line || end_line;
+    if (by_line && offset) {
+        return ToolResult{false, "Use either offset or start_line/end_line, not both"};
+    }
+    if (start_line && *start_line == 0) {
+        return ToolResult{false, "start_line is 1-based"};
+    }
+    if (end_line && *end_line < start_line.value_or(1)) {
+        return ToolResult{false, "end_line must not be before start_line"};
+    }
+    if (limit && *limit == 0) {
+        return ToolResult{false, "limit must be positive"};
+    }
+    size_t max_bytes = static_cast<size_t>(std::min<uint64_t>(limit.value_or(kMaxBytes), kMaxBytes));
+
+    RangedFile file;
+    if (!file.open(path)) {
         return ToolResult{false, "Failed to open file: " + path};
     }
+    uint64_t size = file.size();
+
+    // A whole file that fits comes back as it is
+    if (!by_line && !offset && !limit && size <= kMaxBytes) {
+        std::string contents;
+        if (!file.read(0, kMaxBytes, contents)) {
+            return ToolResult{false, "Failed to read file: " + path};
+        }
+        return ToolResult{true, contents};
+    }
 
-    std::ostringstream ss;
-    ss << file.rdbuf();
-    std::string contents = ss.str();
+    auto index = line_index_for(file, path);
+    uint64_t lines = index->line_count();
+    uint64_t begin = 0;
+    uint64_t end = size;
+    if (by_line) {
+        uint64_t first = start_line.value_or(1) - 1;
+        if (first > 0 && first >= lines) {
+            return ToolResult{false, "start_line " + std::to_string(first + 1) +
+                                     " is past the end of the file (" +
+                                     std::to_string(lines) + " lines)"};
+        }
+        begin = index->line_start(file, first);
+        if (end_line) end = index->line_start(file, *end_line);
+    } else if (offset) {
+        begin = *offset;
+        if (begin > size) {
+            return ToolResult{false, "offset " + std::to_string(begin) +
+                                     " is past the end of the file (" +
+                                     std::to_string(size) + " bytes)"};
+        }
+    }
+    bool cut = end - begin > max_bytes;
+    if (cut) end = begin + max_bytes;
 
-    constexpr size_t max_size = 50000;
-    if (contents.size() > max_size) {
-        contents = contents.substr(0, max_size) + "\n[truncated]";
+    std::string data;
+    if (!file.read(begin, static_cast<size_t>(end - begin), data)) {
+        return ToolResult{false, "Failed to read file: " + path};
     }
+    // Byte ranges are returned exactly; otherwise stop at the last whole line
+    bool by_byte = !by_line && (offset || limit);
+    if (cut && !by_byte) {
+        size_t last_newline = data.rfind('\n');
+        if (last_newline != std::string::npos) data.resize(last_newline + 1);
+    }
+    end = begin + data.size();
 
-    return ToolResult{true, contents};
+    // Where this page is, so the model can ask for the next without a
+    // separate call to size up the file
+    std::string header;
+    if (data.empty()) {
+        header = "[nothing to show: the file has " + std::to_string(size) + " bytes, " +
+                 std::to_string(lines) + " lines]";
+    } else {
+        uint64_t first_line = index->line_at(file, begin) + 1;
+        uint64_t last_line = index->line_at(file, end - 1) + 1;
+        header = "[lines " + std::to_string(first_line) + "-" + std::to_string(last_line) +
+                 " of " + std::to_string(lines) + ", bytes " + std::to_string(begin) + "-" +
+                 std::to_string(end) + " of " + std::to_string(size);
+        if (end >= size) {
+            header += "; end of file]";
+        } else if (!by_byte && data.back() == '\n') {
+            header += "; next: start_line=" + std::to_string(last_line + 1) + "]";
+        } else {
+            header += "; next: offset=" + std::to_string(end) + "]";
+        }
+    }
+    return ToolResult{true, header + "\n" + data};
+}
+
+std::vector<std::string> FileReadTool::memo_paths(const std::string& args_json) const {
+    nlohmann::json args;
+    if (parse_tool_json(args_json, args) || require_string(args, "path")) return {};
+    return {args["path"].get<std::string>()};
 }
 
 std::string FileReadTool::description() const {
-    return "Read the contents of a file";
+    return "Read the contents of a file. Files over 50000 bytes are returned a page at a "
+           "time: pass start_line/end_line or offset/limit to read a range. Partial reads "
+           "start with a line giving the lines and bytes shown, the file's total line count "
+           "and size, and where the next page starts.";
 }
 
 std::string FileReadTool::parameters_json() const {
-    return R"({"type":"object","properties":{"path":{"type":"string","description":"The path of the file to read"}},"required":["path"]})";
+    return R"({"type":"object","properties":{)"
+           R"("path":{"type":"string","description":"The path of the file to read"},)"
+           R"("start_line":{"type":"integer","description":"First line to read, 1-based"},)"
+           R"("end_line":{"type":"integer","description":"Last line to read, inclusive"},)"
+           R"("offset":{"type":"integer","description":"Byte offset to start reading at, instead of start_line"},)"
+           R"("limit":{"type":"integer","description":"Maximum bytes to return, at most 50000"})"
+           R"(},"required":["path"]})";
 }
 
 } // namespace ptrclaw
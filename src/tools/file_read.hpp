@@ -3,12 +3,20 @@
 
 namespace ptrclaw {
 
+// Reads a file, or a range of it by bytes or lines, through RangedFile:
+// memory use depends on the range returned, not on the file's size.
 class FileReadTool : public Tool {
 public:
+    // Most bytes returned by one call
+    static constexpr size_t kMaxBytes = 50000;
+
     ToolResult execute(const std::string& args_json) override;
     std::string tool_name() const override { return "file_read"; }
     std::string description() const override;
     std::string parameters_json() const override;
+    std::string concurrency_class() const override { return "read"; }
+    ToolPurity purity() const override { return ToolPurity::FileBacked; }
+    std::vector<std::string> memo_paths(const std::string& args_json) const override;
 };
 
 } // namespace ptrclaw
@@ -9,6 +9,7 @@ public:
     std::string tool_name() const override { return "file_write"; }
     std::string description() const override;
     std::string parameters_json() const override;
+    std::string concurrency_class() const override { return "write"; }
 };
 
 } // namespace ptrclaw
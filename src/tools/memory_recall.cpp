@@ -70,6 +70,10 @@ ToolResult MemoryRecallTool::execute(const std::string& args_json) {
     return ToolResult{true, ss.str()};
 }
 
+std::string MemoryRecallTool::memo_stamp(const std::string& /*args_json*/) const {
+    return memory_ ? std::to_string(memory_->generation()) : std::string();
+}
+
 std::string MemoryRecallTool::description() const {
     return "Search and recall stored memories by query";
 }
@@ -9,6 +9,10 @@ public:
     std::string tool_name() const override { return "memory_recall"; }
     std::string description() const override;
     std::string parameters_json() const override;
+    std::string concurrency_class() const override { return "read"; }
+    // Memory written outside tools (auto-save, synthesis) changes the count
+    ToolPurity purity() const override { return ToolPurity::Pure; }
+    std::string memo_stamp(const std::string& args_json) const override;
 };
 
 } // namespace ptrclaw
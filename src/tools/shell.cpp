@@ -1,23 +1,227 @@
 #include "shell.hpp"
 #include "tool_util.hpp"
+#include "../metrics.hpp"
 #include "../plugin.hpp"
+#include "../util.hpp"
+#include <algorithm>
 #include <array>
+#include <cerrno>
 #include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <fcntl.h>
 #include <poll.h>
+#include <fstream>
+#include <spawn.h>
+#include <sstream>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+extern char** environ;
+
 static ptrclaw::ToolRegistrar reg_shell("shell",
     []() { return std::make_unique<ptrclaw::ShellTool>(); });
 
 namespace ptrclaw {
 
+namespace {
+
+// Pipe whose ends are not inherited by spawned commands; spawn_shell dups
+// the child's ends onto its stdio
+bool make_pipe(int fds[2]) {
+#ifdef __linux__
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+// Start /bin/sh in a new session with stdin on one pipe and stdout+stderr
+// on another. posix_spawn creates the child vfork-style, so unlike fork()
+// its cost does not grow with the parent's heap and thread count.
+pid_t spawn_shell(const std::vector<const char*>& argv, int& stdin_fd, int& stdout_fd) {
+    int in[2];
+    int out[2];
+    if (!make_pipe(in)) return -1;
+    if (!make_pipe(out)) {
+        close(in[0]);
+        close(in[1]);
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDERR_FILENO);
+
+    // Detach from the controlling terminal; commands get an unblocked
+    // signal mask and default SIGPIPE whatever the calling thread has
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#else
+    flags |= POSIX_SPAWN_SETPGROUP;  // process group 0: its own
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+
+    pid_t pid = -1;
+    int rc = posix_spawn(&pid, "/bin/sh", &actions, &attr,
+                         const_cast<char* const*>(argv.data()), environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    close(in[0]);
+    close(out[1]);
+    if (rc != 0) {
+        close(in[1]);
+        close(out[0]);
+        return -1;
+    }
+    stdin_fd = in[1];
+    stdout_fd = out[0];
+    return pid;
+}
+
+bool write_all(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+double tv_seconds(const struct timeval& tv) {
+    return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+}
+
+uint64_t max_rss_bytes(const struct rusage& usage) {
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);          // bytes
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;   // kilobytes
+#endif
+}
+
+std::string shell_quote(const std::string& s) {
+    std::string quoted = "'";
+    for (char c : s) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+} // namespace
+
+// ── HeadTailBuffer ──────────────────────────────────────────────
+
+HeadTailBuffer::HeadTailBuffer(size_t head_limit, size_t tail_limit)
+    : head_limit_(head_limit), ring_(tail_limit) {
+    head_.reserve(std::min<size_t>(head_limit, 4096));
+}
+
+void HeadTailBuffer::append(const char* data, size_t n) {
+    total_ += n;
+    if (head_.size() < head_limit_) {
+        size_t take = std::min(n, head_limit_ - head_.size());
+        head_.append(data, take);
+        data += take;
+        n -= take;
+    }
+    if (n == 0 || ring_.empty()) return;
+    // Only the last ring_.size() bytes of this chunk can survive
+    if (n > ring_.size()) {
+        data += n - ring_.size();
+        n = ring_.size();
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t idx = (ring_pos_ + ring_size_) % ring_.size();
+        ring_[idx] = data[i];
+        if (ring_size_ < ring_.size()) {
+            ring_size_++;
+        } else {
+            ring_pos_ = (ring_pos_ + 1) % ring_.size();
+        }
+    }
+}
+
+uint64_t HeadTailBuffer::skipped() const {
+    return total_ - head_.size() - ring_size_;
+}
+
+std::string HeadTailBuffer::str() const {
+    std::string tail;
+    tail.reserve(ring_size_);
+    for (size_t i = 0; i < ring_size_; i++) {
+        tail += ring_[(ring_pos_ + i) % ring_.size()];
+    }
+    uint64_t omitted = skipped();
+    if (omitted == 0) return head_ + tail;
+
+    // Cut at UTF-8 character boundaries and, when one is near, at line
+    // starts, so the marker sits on its own line between whole lines
+    std::string head = head_;
+    while (!head.empty() && (static_cast<unsigned char>(head.back()) & 0xC0) == 0x80) {
+        head.pop_back();
+        omitted++;
+    }
+    if (!head.empty() && (static_cast<unsigned char>(head.back()) & 0xC0) == 0xC0) {
+        head.pop_back();
+        omitted++;
+    }
+    size_t nl = head.rfind('\n');
+    if (nl != std::string::npos && head.size() - nl <= 200) {
+        omitted += head.size() - nl - 1;
+        head.resize(nl + 1);
+    } else if (!head.empty()) {
+        head += '\n';
+    }
+    size_t start = 0;
+    while (start < tail.size() &&
+           (static_cast<unsigned char>(tail[start]) & 0xC0) == 0x80) {
+        start++;
+    }
+    size_t tail_nl = tail.find('\n', start);
+    if (tail_nl != std::string::npos && tail_nl - start < 200 && tail_nl + 1 < tail.size()) {
+        start = tail_nl + 1;
+    }
+    omitted += start;
+    return head + "[... " + std::to_string(omitted) + " bytes omitted ...]\n" +
+           tail.substr(start);
+}
+
+// ── ShellTool ───────────────────────────────────────────────────
+
 ShellTool::~ShellTool() {
     kill_all_processes();
+    std::lock_guard<std::mutex> lock(shell_mutex_);
+    stop_shell();
 }
 
 void ShellTool::reset() {
     kill_all_processes();
+    std::lock_guard<std::mutex> lock(shell_mutex_);
+    stop_shell();
 }
 
 ToolResult ShellTool::execute(const std::string& args_json) {
@@ -26,6 +230,12 @@ ToolResult ShellTool::execute(const std::string& args_json) {
 
 ToolResult ShellTool::execute(const std::string& args_json,
                                const CancellationToken& token) {
+    return execute(args_json, token, nullptr);
+}
+
+ToolResult ShellTool::execute(const std::string& args_json,
+                               const CancellationToken& token,
+                               const ToolProgress& progress) {
     nlohmann::json args;
     if (auto err = parse_tool_json(args_json, args)) return *err;
 
@@ -38,7 +248,8 @@ ToolResult ShellTool::execute(const std::string& args_json,
     // Resume existing process (ignore empty string — some clients send all schema fields)
     if (args.contains("process_id") && args["process_id"].is_string()
         && !args["process_id"].get<std::string>().empty()) {
-        return resume_process(args["process_id"].get<std::string>(), stdin_data, token);
+        return resume_process(args["process_id"].get<std::string>(), stdin_data, token,
+                              progress);
     }
 
     // New command
@@ -46,48 +257,27 @@ ToolResult ShellTool::execute(const std::string& args_json,
         return ToolResult{false, "Missing required parameter: command (or process_id to resume)"};
     }
 
-    return run_new_command(args["command"].get<std::string>(), stdin_data, has_stdin, token);
+    return run_new_command(args["command"].get<std::string>(), stdin_data, has_stdin, token,
+                           progress);
 }
 
 ToolResult ShellTool::run_new_command(const std::string& command,
                                      const std::string& stdin_data,
                                      bool has_stdin,
-                                     const CancellationToken& token) {
-    std::string cmd = command + " 2>&1";
-
-    int stdin_pipe[2];
-    int stdout_pipe[2];
-
-    if (pipe(stdin_pipe) != 0 || pipe(stdout_pipe) != 0) {
-        return ToolResult{false, "Failed to create pipes"};
+                                     const CancellationToken& token,
+                                     const ToolProgress& progress) {
+    if (persistent_ && !has_stdin) {
+        return run_persistent(command, token, progress);
     }
 
-    pid_t pid = fork();
+    std::string cmd = limits_prefix() + command + " 2>&1";
+
+    int stdin_fd = -1;
+    int stdout_fd = -1;
+    pid_t pid = spawn_shell({"sh", "-c", cmd.c_str(), nullptr}, stdin_fd, stdout_fd);
     if (pid < 0) {
-        close(stdin_pipe[0]);
-        close(stdin_pipe[1]);
-        close(stdout_pipe[0]);
-        close(stdout_pipe[1]);
-        return ToolResult{false, "Failed to fork process"};
-    }
-
-    if (pid == 0) {
-        // Child process — detach from controlling terminal
-        setsid();
-        close(stdin_pipe[1]);
-        close(stdout_pipe[0]);
-        dup2(stdin_pipe[0], STDIN_FILENO);
-        dup2(stdout_pipe[1], STDOUT_FILENO);
-        dup2(stdout_pipe[1], STDERR_FILENO);
-        close(stdin_pipe[0]);
-        close(stdout_pipe[1]);
-        execl("/bin/sh", "sh", "-c", cmd.c_str(), nullptr);
-        _exit(127);
-    }
-
-    // Parent process
-    close(stdin_pipe[0]);
-    close(stdout_pipe[1]);
+        return ToolResult{false, "Failed to start process"};
+    }
 
     // Write stdin data if provided; close stdin when caller explicitly supplied
     // the parameter (even if empty) so the child gets EOF. When no stdin param
@@ -95,46 +285,46 @@ ToolResult ShellTool::run_new_command(const std::string& command,
     // block on input and return them as interactive processes.
     if (has_stdin) {
         if (!stdin_data.empty()) {
-            size_t written = 0;
-            while (written < stdin_data.size()) {
-                ssize_t n = write(stdin_pipe[1], stdin_data.data() + written,
-                                  stdin_data.size() - written);
-                if (n <= 0) break;
-                written += static_cast<size_t>(n);
-            }
+            write_all(stdin_fd, stdin_data);
         }
-        close(stdin_pipe[1]);
-        stdin_pipe[1] = -1;
+        close(stdin_fd);
+        stdin_fd = -1;
     }
 
     // Read output with stall detection
-    constexpr size_t max_output = 10000;
-    auto result = read_with_timeout(stdout_pipe[0], pid, kStallTimeoutMs, token);
-
-    if (result.output.size() > max_output) {
-        result.output = result.output.substr(0, max_output) + "\n[truncated]";
-    }
+    auto result = read_with_timeout(stdout_fd, pid, kStallTimeoutMs, token, progress);
 
     if (result.cancelled) {
         // Cancelled — kill child and report
-        if (stdin_pipe[1] >= 0) close(stdin_pipe[1]);
+        if (stdin_fd >= 0) close(stdin_fd);
         kill(pid, SIGKILL);
-        close(stdout_pipe[0]);
+        close(stdout_fd);
         int status = 0;
         waitpid(pid, &status, 0);
         return ToolResult{false, result.output + "\n[cancelled]"};
     }
 
+    if (result.output_limited) {
+        // The command leads its own session: kill its pipeline too
+        if (stdin_fd >= 0) close(stdin_fd);
+        kill(-pid, SIGKILL);
+        close(stdout_fd);
+        int status = 0;
+        struct rusage usage = {};
+        wait4(pid, &status, 0, &usage);
+        return finish_command(status, usage, result.output + output_limit_note());
+    }
+
     if (!result.still_running) {
         // Process finished
-        if (stdin_pipe[1] >= 0) close(stdin_pipe[1]);
-        close(stdout_pipe[0]);
+        if (stdin_fd >= 0) close(stdin_fd);
+        close(stdout_fd);
         int status = result.exit_status;
+        struct rusage usage = result.usage;
         if (!result.reaped) {
-            waitpid(pid, &status, 0);
+            wait4(pid, &status, 0, &usage);
         }
-        bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
-        return ToolResult{success, result.output};
+        return finish_command(status, usage, result.output);
     }
 
     // Process is stalled — waiting for input
@@ -146,8 +336,7 @@ ToolResult ShellTool::run_new_command(const std::string& command,
     }
 
     std::string proc_id = "proc_" + std::to_string(next_id_++);
-    int stored_stdin = stdin_pipe[1] >= 0 ? stdin_pipe[1] : -1;
-    processes_[proc_id] = ProcessState{pid, stored_stdin, stdout_pipe[0]};
+    processes_[proc_id] = ProcessState{pid, stdin_fd, stdout_fd};
 
     result.output += "\n[WAITING FOR INPUT - process_id:" + proc_id + "]";
     return ToolResult{true, result.output};
@@ -155,7 +344,10 @@ ToolResult ShellTool::run_new_command(const std::string& command,
 
 ToolResult ShellTool::resume_process(const std::string& proc_id,
                                      const std::string& stdin_data,
-                                     const CancellationToken& token) {
+                                     const CancellationToken& token,
+                                     const ToolProgress& progress) {
+    if (proc_id == kShellProcessId) return resume_persistent(stdin_data, token, progress);
+
     std::unique_lock<std::mutex> proc_lock(mutex_);
     auto it = processes_.find(proc_id);
     if (it == processes_.end()) {
@@ -172,23 +364,13 @@ ToolResult ShellTool::resume_process(const std::string& proc_id,
         if (data.back() != '\n') {
             data += '\n';
         }
-        size_t written = 0;
-        while (written < data.size()) {
-            ssize_t n = write(proc.stdin_fd, data.data() + written,
-                              data.size() - written);
-            if (n <= 0) break;
-            written += static_cast<size_t>(n);
-        }
+        write_all(proc.stdin_fd, data);
     }
 
     // Read new output — use longer timeout since we just sent data and
     // the process may need time for network/IO before responding
-    constexpr size_t max_output = 10000;
-    auto result = read_with_timeout(proc.stdout_fd, proc.pid, kResumeTimeoutMs, token);
-
-    if (result.output.size() > max_output) {
-        result.output = result.output.substr(0, max_output) + "\n[truncated]";
-    }
+    auto result = read_with_timeout(proc.stdout_fd, proc.pid, kResumeTimeoutMs, token,
+                                    progress);
 
     if (result.cancelled) {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -196,17 +378,23 @@ ToolResult ShellTool::resume_process(const std::string& proc_id,
         return ToolResult{false, result.output + "\n[cancelled]"};
     }
 
+    if (result.output_limited) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cleanup_process(proc_id);
+        return ToolResult{false, result.output + output_limit_note()};
+    }
+
     if (!result.still_running) {
         if (proc.stdin_fd >= 0) close(proc.stdin_fd);
         close(proc.stdout_fd);
         int status = result.exit_status;
+        struct rusage usage = result.usage;
         if (!result.reaped) {
-            waitpid(proc.pid, &status, 0);
+            wait4(proc.pid, &status, 0, &usage);
         }
         std::lock_guard<std::mutex> lock(mutex_);
         processes_.erase(proc_id);
-        bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
-        return ToolResult{success, result.output};
+        return finish_command(status, usage, result.output);
     }
 
     // Still waiting
@@ -214,10 +402,315 @@ ToolResult ShellTool::resume_process(const std::string& proc_id,
     return ToolResult{true, result.output};
 }
 
+// ── Resource limits ─────────────────────────────────────────────
+
+void ShellTool::set_limits(const ShellLimits& limits) {
+    std::lock_guard<std::mutex> lock(shell_mutex_);
+    limits_ = limits;
+    if (!limits_.cgroup.empty() &&
+        access((limits_.cgroup + "/cgroup.procs").c_str(), W_OK) != 0) {
+        std::cerr << "[shell] cgroup " << limits_.cgroup
+                  << " is not a writable cgroup v2 directory; not using it\n";
+        limits_.cgroup.clear();
+    }
+    stop_shell();  // a persistent shell picks the new limits up on restart
+}
+
+// Shell commands run before each one-shot command (and once when the
+// persistent shell starts). The shell applies the limits to itself and
+// everything it starts; failures (e.g. above the hard limit) are ignored.
+// The persistent shell gets no CPU limit here: a fixed budget would be
+// spent across all its commands (see arm_shell_cpu_limit).
+std::string ShellTool::limits_prefix(bool with_cpu) const {
+    std::string prefix;
+    if (with_cpu && limits_.cpu_seconds > 0) {
+        // SIGXCPU at the soft limit; SIGKILL a little later for commands
+        // that catch it
+        prefix += "ulimit -H -t " + std::to_string(limits_.cpu_seconds + kCpuGraceSeconds) +
+                  "; ulimit -S -t " + std::to_string(limits_.cpu_seconds) + "; ";
+    }
+    if (limits_.memory_mb > 0) {
+        prefix += "ulimit -v " + std::to_string(uint64_t{limits_.memory_mb} * 1024) + "; ";
+    }
+    if (limits_.open_files > 0) {
+        prefix += "ulimit -n " + std::to_string(limits_.open_files) + "; ";
+    }
+    if (!limits_.cgroup.empty()) {
+        prefix += "echo $$ > " + shell_quote(limits_.cgroup + "/cgroup.procs") + "; ";
+    }
+    if (prefix.empty()) return prefix;
+    return "{ " + prefix + "} 2>/dev/null; ";
+}
+
+std::string ShellTool::cpu_limit_note() const {
+    metrics().shell_limit_kills.labels(metric_label("limit", "cpu")).inc();
+    return "\n[cpu limit of " + std::to_string(limits_.cpu_seconds) +
+           " s reached; command killed]";
+}
+
+std::string ShellTool::output_limit_note() const {
+    metrics().shell_limit_kills.labels(metric_label("limit", "output")).inc();
+    return "\n[output limit of " + std::to_string(limits_.output_bytes) +
+           " bytes reached; command killed]";
+}
+
+// Exit status to result, with wait4() resource use exported as metrics.
+// Commands that used noticeable CPU, or hit the CPU limit, get a usage
+// line the model can see.
+ToolResult ShellTool::finish_command(int status, const struct rusage& usage,
+                                     const std::string& output) const {
+    double user = tv_seconds(usage.ru_utime);
+    double sys = tv_seconds(usage.ru_stime);
+    uint64_t rss = max_rss_bytes(usage);
+    auto& m = metrics();
+    m.shell_cpu_seconds.labels(metric_label("mode", "user")).observe(user);
+    m.shell_cpu_seconds.labels(metric_label("mode", "sys")).observe(sys);
+    m.shell_max_rss_bytes.unlabeled().observe(static_cast<double>(rss));
+
+    // A command the shell started reports the signal as the shell's exit
+    // status (128 + signal) rather than killing the shell itself
+    int signal = WIFSIGNALED(status) ? WTERMSIG(status)
+               : WIFEXITED(status) && WEXITSTATUS(status) > 128 ? WEXITSTATUS(status) - 128
+               : 0;
+    std::string text = output;
+    bool cpu_killed = limits_.cpu_seconds > 0 &&
+        (signal == SIGXCPU || (signal == SIGKILL && user + sys >= limits_.cpu_seconds));
+    if (cpu_killed) text += cpu_limit_note();
+    if (cpu_killed || user + sys >= kUsageNoteCpuSeconds) {
+        char note[96];
+        std::snprintf(note, sizeof(note), "\n[cpu %.2fs user, %.2fs sys; max rss %llu MB]",
+                      user, sys, static_cast<unsigned long long>(rss >> 20));
+        text += note;
+    }
+    bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return ToolResult{success, text};
+}
+
+// ── Persistent shell ────────────────────────────────────────────
+
+void ShellTool::set_persistent(bool persistent) {
+    std::lock_guard<std::mutex> lock(shell_mutex_);
+    persistent_ = persistent;
+    if (!persistent) stop_shell();
+}
+
+bool ShellTool::start_shell() {
+    shell_pid_ = spawn_shell({"sh", nullptr}, shell_stdin_, shell_stdout_);
+    if (shell_pid_ < 0) return false;
+    shell_marker_ = "__ptrclaw_done_" + generate_id() + "_";
+    shell_seq_ = 0;
+    std::string prefix = limits_prefix(false);
+    if (!prefix.empty()) write_all(shell_stdin_, prefix + "\n");
+    return true;
+}
+
+// Before each command, set the shell's soft RLIMIT_CPU to the CPU time it
+// has used so far plus cpu_seconds. Builtins and loops running in the
+// shell get cpu_seconds more; commands it starts inherit the limit with
+// their own CPU time starting at zero. The hard limit is left alone, as
+// the shell could not raise it again for the next command. Needs
+// prlimit(2), so other systems run persistent commands without a CPU
+// limit.
+void ShellTool::arm_shell_cpu_limit() {
+#ifdef __linux__
+    if (limits_.cpu_seconds == 0) return;
+    // utime and stime are the 12th and 13th fields after the ") " that
+    // ends the command name, in clock ticks
+    std::ifstream stat("/proc/" + std::to_string(shell_pid_) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+    size_t pos = line.rfind(')');
+    if (pos == std::string::npos) return;
+    std::istringstream fields(line.substr(pos + 2));
+    std::string skip;
+    for (int i = 0; i < 11; i++) fields >> skip;
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    if (!(fields >> utime >> stime)) return;
+    auto ticks = static_cast<unsigned long long>(sysconf(_SC_CLK_TCK));
+    rlim_t used = static_cast<rlim_t>((utime + stime + ticks - 1) / ticks);
+
+    struct rlimit lim{};
+    if (prlimit(shell_pid_, RLIMIT_CPU, nullptr, &lim) != 0) return;
+    lim.rlim_cur = used + limits_.cpu_seconds;
+    if (lim.rlim_max != RLIM_INFINITY) lim.rlim_cur = std::min(lim.rlim_cur, lim.rlim_max);
+    prlimit(shell_pid_, RLIMIT_CPU, &lim, nullptr);
+#endif
+}
+
+int ShellTool::stop_shell() {
+    if (shell_pid_ < 0) return 0;
+    // An idle shell exits at end of input; give it a moment, then kill its
+    // session (it leads one) so running commands go with it
+    close(shell_stdin_);
+    close(shell_stdout_);
+    int status = 0;
+    pid_t reaped = 0;
+    for (int i = 0; i < 25 && reaped == 0; i++) {
+        reaped = waitpid(shell_pid_, &status, WNOHANG);
+        if (reaped == 0) usleep(20000);
+    }
+    if (reaped == 0) {
+        kill(-shell_pid_, SIGKILL);
+        waitpid(shell_pid_, &status, 0);
+    }
+    shell_pid_ = -1;
+    shell_stdin_ = -1;
+    shell_stdout_ = -1;
+    shell_running_.clear();
+    shell_pending_.clear();
+    return status;
+}
+
+// The command runs through eval in the long-lived shell, followed by a
+// printf of a sentinel line carrying its exit status. Output up to the
+// sentinel is the command's; a shell that exits (exit, syntax error in
+// eval) is reaped and replaced on the next call.
+ToolResult ShellTool::run_persistent(const std::string& command,
+                                     const CancellationToken& token,
+                                     const ToolProgress& progress) {
+    std::lock_guard<std::mutex> lock(shell_mutex_);
+    // A new command instead of resuming one left running: the shell is
+    // busy with it, so both go
+    std::string note;
+    if (!shell_running_.empty()) {
+        kill(-shell_pid_, SIGKILL);
+        stop_shell();
+        note = "[the previous command was still running; it was killed and the shell "
+               "restarted]\n";
+    }
+    if (shell_pid_ > 0) {
+        int status = 0;
+        if (waitpid(shell_pid_, &status, WNOHANG) != 0) {
+            close(shell_stdin_);
+            close(shell_stdout_);
+            shell_pid_ = -1;
+        }
+    }
+    if (shell_pid_ < 0 && !start_shell()) {
+        return ToolResult{false, "Failed to start shell"};
+    }
+    arm_shell_cpu_limit();
+
+    std::string marker = shell_marker_ + std::to_string(shell_seq_++) + " ";
+    std::string script = "eval " + shell_quote(command) + " </dev/null; printf '\\n%s%d\\n' '" +
+                         marker + "' \"$?\"\n";
+    if (!write_all(shell_stdin_, script)) {
+        stop_shell();
+        return ToolResult{false, "Failed to send command to shell"};
+    }
+    shell_running_ = marker;
+    shell_pending_.clear();
+
+    ToolResult result = read_persistent(kStallTimeoutMs, token, progress);
+    result.output = note + result.output;
+    return result;
+}
+
+ToolResult ShellTool::resume_persistent(const std::string& stdin_data,
+                                        const CancellationToken& token,
+                                        const ToolProgress& progress) {
+    std::lock_guard<std::mutex> lock(shell_mutex_);
+    if (shell_running_.empty()) {
+        return ToolResult{false, "No command is running in the persistent shell"};
+    }
+    ToolResult result = read_persistent(kResumeTimeoutMs, token, progress);
+    if (!stdin_data.empty()) {
+        result.output = "[stdin ignored: persistent shell commands read /dev/null]\n" +
+                        result.output;
+    }
+    return result;
+}
+
+// Reads the running command's output up to its sentinel. A command that
+// prints nothing for stall_timeout_ms is left running in the shell and
+// reported with process_id "shell", like a one-shot command waiting for
+// input, so a long silent command does not hold the tool until
+// tool_timeout (whose cancel would cost the shell and its state).
+ToolResult ShellTool::read_persistent(int stall_timeout_ms, const CancellationToken& token,
+                                      const ToolProgress& progress) {
+    // Output is passed on as it arrives except for the last needle-sized
+    // stretch, which may be the start of a sentinel split across reads
+    HeadTailBuffer output(kHeadBytes, kTailBytes);
+    std::string& pending = shell_pending_;
+    const std::string needle = "\n" + shell_running_;
+    auto flush = [&](size_t n) {
+        if (n == 0) return;
+        output.append(pending.data(), n);
+        if (progress) progress(pending.substr(0, n));
+        pending.erase(0, n);
+    };
+
+    std::array<char, 4096> buffer;
+    constexpr int kPollIntervalMs = 200;
+    int stall_elapsed_ms = 0;
+    while (true) {
+        if (is_cancelled(token)) {
+            flush(pending.size());
+            kill(-shell_pid_, SIGKILL);
+            stop_shell();
+            return ToolResult{false, output.str() + "\n[cancelled]"};
+        }
+
+        struct pollfd pfd;
+        pfd.fd = shell_stdout_;
+        pfd.events = POLLIN;
+        int ret = poll(&pfd, 1, kPollIntervalMs);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret == 0) {
+            stall_elapsed_ms += kPollIntervalMs;
+            if (stall_elapsed_ms >= stall_timeout_ms) {
+                // The sentinel is one small write, so what has waited this
+                // long is the command's output
+                flush(pending.size());
+                return ToolResult{true, output.str() + "\n[STILL RUNNING - process_id:" +
+                                        std::string(kShellProcessId) + "]"};
+            }
+            continue;
+        }
+        stall_elapsed_ms = 0;
+
+        ssize_t n = ret > 0 ? read(shell_stdout_, buffer.data(), buffer.size()) : -1;
+        if (n <= 0) break;  // the shell exited
+        pending.append(buffer.data(), static_cast<size_t>(n));
+
+        size_t pos = pending.find(needle);
+        if (pos != std::string::npos) {
+            size_t end = pending.find('\n', pos + needle.size());
+            if (end == std::string::npos) continue;  // status not complete yet
+            int exit_code = std::atoi(pending.c_str() + pos + needle.size());
+            flush(pos);
+            pending.clear();
+            shell_running_.clear();
+            std::string text = output.str();
+            if (limits_.cpu_seconds > 0 && exit_code == 128 + SIGXCPU) text += cpu_limit_note();
+            return ToolResult{exit_code == 0, text};
+        }
+        if (pending.size() > needle.size()) {
+            flush(pending.size() - needle.size());
+        }
+        if (limits_.output_bytes > 0 && output.total() > limits_.output_bytes) {
+            kill(-shell_pid_, SIGKILL);
+            stop_shell();
+            return ToolResult{false, output.str() + output_limit_note()};
+        }
+    }
+
+    flush(pending.size());
+    int status = stop_shell();
+    bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    std::string text = output.str();
+    if (limits_.cpu_seconds > 0 && WIFSIGNALED(status) && WTERMSIG(status) == SIGXCPU) {
+        text += cpu_limit_note();
+    }
+    return ToolResult{success, text + "\n[shell exited; the next command starts a new shell]"};
+}
+
 ShellTool::ReadResult ShellTool::read_with_timeout(int stdout_fd, pid_t pid,
                                                     int timeout_ms,
-                                                    const CancellationToken& token) {
-    std::string output;
+                                                    const CancellationToken& token,
+                                                    const ToolProgress& progress) {
+    HeadTailBuffer output(kHeadBytes, kTailBytes);
     std::array<char, 4096> buffer;
     // Use short poll intervals to check cancellation, but track total stall time
     constexpr int kPollIntervalMs = 200;
@@ -226,7 +719,7 @@ ShellTool::ReadResult ShellTool::read_with_timeout(int stdout_fd, pid_t pid,
 
     while (true) {
         if (is_cancelled(token)) {
-            return {output, true, true, 0, false};
+            return {output.str(), true, true, 0, false};
         }
 
         struct pollfd pfd;
@@ -248,16 +741,19 @@ ShellTool::ReadResult ShellTool::read_with_timeout(int stdout_fd, pid_t pid,
             stall_elapsed_ms += poll_ms;
             // Check cancellation on every poll timeout
             if (is_cancelled(token)) {
-                return {output, true, true, 0, false};
+                return {output.str(), true, true, 0, false};
             }
             // Check if we've exceeded the stall timeout
             if (timeout_ms > 0 && stall_elapsed_ms >= timeout_ms) {
                 int status = 0;
-                pid_t result = waitpid(pid, &status, WNOHANG);
+                struct rusage usage = {};
+                pid_t result = wait4(pid, &status, WNOHANG, &usage);
                 if (result == 0) {
-                    return {output, true, false, 0, false};
+                    return {output.str(), true, false, 0, false};
                 }
-                return {output, false, false, status, result > 0};
+                ReadResult done{output.str(), false, false, status, result > 0};
+                done.usage = usage;
+                return done;
             }
             continue;
         }
@@ -269,17 +765,23 @@ ShellTool::ReadResult ShellTool::read_with_timeout(int stdout_fd, pid_t pid,
             ssize_t n = read(stdout_fd, buffer.data(), buffer.size());
             if (n > 0) {
                 output.append(buffer.data(), static_cast<size_t>(n));
+                if (progress) progress(std::string(buffer.data(), static_cast<size_t>(n)));
+                if (limits_.output_bytes > 0 && output.total() > limits_.output_bytes) {
+                    ReadResult limited{output.str(), true};
+                    limited.output_limited = true;
+                    return limited;
+                }
                 continue;
             }
-            return {output, false};
+            return {output.str(), false};
         }
 
         if ((pfd.revents & (POLLHUP | POLLERR)) != 0) {
-            return {output, false};
+            return {output.str(), false};
         }
     }
 
-    return {output, false};
+    return {output.str(), false};
 }
 
 void ShellTool::cleanup_process(const std::string& id) {
@@ -308,9 +810,18 @@ void ShellTool::kill_all_processes() {
 }
 
 std::string ShellTool::description() const {
-    return "Execute a shell command. For interactive commands that wait for input, "
-           "the tool returns partial output with a process_id. Use process_id with "
-           "stdin to send follow-up input to the waiting process.";
+    std::string text =
+        "Execute a shell command. For interactive commands that wait for input, "
+        "the tool returns partial output with a process_id. Use process_id with "
+        "stdin to send follow-up input to the waiting process.";
+    if (persistent_) {
+        text += " Commands share one shell, so cd and exported variables carry over; "
+                "a cd does not change the directory file_read, file_write and file_edit "
+                "resolve relative paths against. A command that prints nothing for a few "
+                "seconds is left running and returns process_id \"shell\": resume it to "
+                "wait for more output, or run a new command to kill it.";
+    }
+    return text;
 }
 
 std::string ShellTool::parameters_json() const {
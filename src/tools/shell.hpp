@@ -1,8 +1,12 @@
 #pragma once
 #include "../tool.hpp"
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
 #include <sys/types.h>
 
 namespace ptrclaw {
@@ -13,6 +17,38 @@ struct ProcessState {
     int stdout_fd;
 };
 
+// Fixed-memory capture of a byte stream: keeps the first head_limit bytes
+// and a ring of the last tail_limit bytes, and only counts what falls in
+// between. str() joins head and tail with an omission marker line.
+class HeadTailBuffer {
+public:
+    HeadTailBuffer(size_t head_limit, size_t tail_limit);
+
+    void append(const char* data, size_t n);
+    void append(const std::string& data) { append(data.data(), data.size()); }
+
+    uint64_t total() const { return total_; }
+    uint64_t skipped() const;
+    std::string str() const;
+
+private:
+    size_t head_limit_;
+    std::string head_;
+    std::vector<char> ring_;  // capacity tail_limit, oldest byte at ring_pos_
+    size_t ring_pos_ = 0;
+    size_t ring_size_ = 0;
+    uint64_t total_ = 0;
+};
+
+// Budgets applied to every command ShellTool runs (0 / empty = none)
+struct ShellLimits {
+    uint32_t cpu_seconds = 0;    // RLIMIT_CPU per process
+    uint32_t memory_mb = 0;      // RLIMIT_AS per process
+    uint32_t open_files = 0;     // RLIMIT_NOFILE
+    uint64_t output_bytes = 0;   // output read before the command is killed
+    std::string cgroup;          // cgroup v2 directory commands are moved into
+};
+
 class ShellTool : public Tool {
 public:
     ~ShellTool() override;
@@ -20,20 +56,43 @@ public:
     ToolResult execute(const std::string& args_json) override;
     ToolResult execute(const std::string& args_json,
                        const CancellationToken& token) override;
+    ToolResult execute(const std::string& args_json,
+                       const CancellationToken& token,
+                       const ToolProgress& progress) override;
     std::string tool_name() const override { return "shell"; }
     std::string description() const override;
     std::string parameters_json() const override;
+    std::string concurrency_class() const override { return "shell"; }
     void reset() override;
 
+    // Run commands in one long-lived /bin/sh instead of a new one per call,
+    // so cwd and exported variables carry over (agent.shell_persistent).
+    // Calls with stdin still get their own process.
+    void set_persistent(bool persistent);
+    // Call before the tool runs commands. A cgroup that cannot be joined is
+    // dropped with a warning.
+    void set_limits(const ShellLimits& limits);
+
 private:
     static constexpr int kStallTimeoutMs = 3000;
     static constexpr int kResumeTimeoutMs = 30000;
+    // process_id of a command left running in the persistent shell
+    static constexpr const char* kShellProcessId = "shell";
     static constexpr size_t kMaxProcesses = 4;
+    // Output kept per call: build errors are usually at the end, so a tail
+    // is kept as well as the head
+    static constexpr size_t kHeadBytes = 6000;
+    static constexpr size_t kTailBytes = 4000;
+    // CPU time (user + sys) above which the result reports resource use
+    static constexpr double kUsageNoteCpuSeconds = 1.0;
+    // Hard CPU limit beyond ShellLimits::cpu_seconds (the soft limit)
+    static constexpr uint32_t kCpuGraceSeconds = 5;
 
     ToolResult run_new_command(const std::string& command, const std::string& stdin_data,
-                              bool has_stdin, const CancellationToken& token);
+                              bool has_stdin, const CancellationToken& token,
+                              const ToolProgress& progress);
     ToolResult resume_process(const std::string& proc_id, const std::string& stdin_data,
-                              const CancellationToken& token);
+                              const CancellationToken& token, const ToolProgress& progress);
 
     struct ReadResult {
         std::string output;
@@ -41,16 +100,49 @@ private:
         bool cancelled = false;
         int exit_status = 0;  // valid when !still_running && reaped by WNOHANG
         bool reaped = false;  // true if waitpid was already called
+        bool output_limited = false;  // hit limits_.output_bytes, still running
+        struct rusage usage = {};     // valid when reaped
     };
     ReadResult read_with_timeout(int stdout_fd, pid_t pid, int timeout_ms,
-                                 const CancellationToken& token);
+                                 const CancellationToken& token,
+                                 const ToolProgress& progress);
 
     void cleanup_process(const std::string& id);
     void kill_all_processes();
 
+    ToolResult run_persistent(const std::string& command, const CancellationToken& token,
+                              const ToolProgress& progress);
+    ToolResult resume_persistent(const std::string& stdin_data, const CancellationToken& token,
+                                 const ToolProgress& progress);
+    // Caller holds shell_mutex_
+    ToolResult read_persistent(int stall_timeout_ms, const CancellationToken& token,
+                               const ToolProgress& progress);
+    std::string limits_prefix(bool with_cpu = true) const;
+    void arm_shell_cpu_limit();
+    std::string cpu_limit_note() const;
+    ToolResult finish_command(int status, const struct rusage& usage,
+                              const std::string& output) const;
+    std::string output_limit_note() const;
+    bool start_shell();
+    int stop_shell();  // returns the shell's wait status
+
     std::mutex mutex_;  // guards processes_ and next_id_
     std::unordered_map<std::string, ProcessState> processes_;
     uint32_t next_id_ = 0;
+    ShellLimits limits_;
+
+    // Persistent shell; shell_mutex_ serializes commands sent to it
+    std::mutex shell_mutex_;
+    std::atomic<bool> persistent_{false};
+    pid_t shell_pid_ = -1;
+    int shell_stdin_ = -1;
+    int shell_stdout_ = -1;
+    std::string shell_marker_;  // per-shell sentinel prefix
+    uint64_t shell_seq_ = 0;
+    // Sentinel of a command still running after a stall ("" when idle) and
+    // output read past what was returned, which may start the sentinel
+    std::string shell_running_;
+    std::string shell_pending_;
 };
 
 } // namespace ptrclaw
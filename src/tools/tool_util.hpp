@@ -50,4 +50,17 @@ inline std::string get_optional_string(const nlohmann::json& args,
     return default_value;
 }
 
+// Get an optional non-negative integer field into `out` (left empty if
+// missing). Returns error ToolResult if present with another type.
+inline std::optional<ToolResult> get_optional_uint(const nlohmann::json& args,
+                                                   const char* field,
+                                                   std::optional<uint64_t>& out) {
+    if (!args.contains(field) || args[field].is_null()) return std::nullopt;
+    if (!args[field].is_number_unsigned()) {
+        return ToolResult{false, std::string("Parameter must be a non-negative integer: ") + field};
+    }
+    out = args[field].get<uint64_t>();
+    return std::nullopt;
+}
+
 } // namespace ptrclaw
@@ -0,0 +1,293 @@
+#include "trace.hpp"
+#include "event.hpp"
+#include "event_bus.hpp"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+namespace ptrclaw {
+
+// ── TraceRing ───────────────────────────────────────────────────
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+TraceRing::TraceRing(size_t capacity)
+    : slots_(new Slot[round_up_pow2(capacity)])
+    , mask_(round_up_pow2(capacity) - 1)
+{
+    for (size_t i = 0; i <= mask_; i++) {
+        slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool TraceRing::push(const TraceRecord& rec) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = slots_[pos & mask_];
+        size_t seq = slot.seq.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.rec = rec;
+                slot.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // full: the consumer has not freed this slot yet
+        } else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool TraceRing::pop(TraceRecord& out) {
+    Slot& slot = slots_[tail_ & mask_];
+    size_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != tail_ + 1) return false;
+    out = slot.rec;
+    slot.seq.store(tail_ + mask_ + 1, std::memory_order_release);
+    tail_++;
+    return true;
+}
+
+// ── Record helpers ──────────────────────────────────────────────
+
+static void set_text(std::array<char, 48>& buf, std::string_view a,
+                     std::string_view b = {}) {
+    size_t n = std::min(a.size(), buf.size() - 1);
+    std::memcpy(buf.data(), a.data(), n);
+    size_t m = std::min(b.size(), buf.size() - 1 - n);
+    std::memcpy(buf.data() + n, b.data(), m);
+    buf[n + m] = '\0';
+}
+
+static TraceRecord make_record(char phase, const char* category,
+                               std::string_view name, std::string_view session) {
+    TraceRecord rec;
+    rec.phase = phase;
+    rec.category = category;
+    set_text(rec.name, name);
+    set_text(rec.session, session);
+    return rec;
+}
+
+static uint64_t span_id(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+// ── TraceRecorder ───────────────────────────────────────────────
+
+std::atomic<TraceRecorder*> TraceRecorder::active_{nullptr};
+
+TraceRecorder::TraceRecorder(const std::string& path, size_t capacity)
+    : ring_(capacity)
+    , out_(path, std::ios::trunc)
+    , start_(std::chrono::steady_clock::now())
+{
+    if (!out_.is_open()) {
+        std::cerr << "[trace] Cannot open " << path << "\n";
+        return;
+    }
+    out_ << "[\n";
+    writer_ = std::thread([this] { writer_loop(); });
+    std::cerr << "[trace] Writing timeline to " << path << "\n";
+}
+
+TraceRecorder::~TraceRecorder() {
+    stop();
+}
+
+void TraceRecorder::attach(EventBus& bus) {
+    detach();
+    bus_ = &bus;
+
+    sub_ids_.push_back(subscribe<ProviderRequestEvent>(bus,
+        [this](const ProviderRequestEvent& ev) {
+            auto rec = make_record('B', "provider", "", ev.session_id);
+            set_text(rec.name, "provider ", ev.model);
+            rec.arg_names = {"messages", "tools"};
+            rec.args = {static_cast<int64_t>(ev.message_count),
+                        static_cast<int64_t>(ev.tool_count)};
+            record(rec);
+        }));
+    sub_ids_.push_back(subscribe<ProviderResponseEvent>(bus,
+        [this](const ProviderResponseEvent& ev) {
+            auto rec = make_record('E', "provider", "", ev.session_id);
+            set_text(rec.name, "provider ", ev.model);
+            if (ev.failed) {
+                rec.arg_names = {"failed"};
+                rec.args = {1};
+            } else {
+                rec.arg_names = {"prompt_tokens", "completion_tokens"};
+                rec.args = {ev.usage.prompt_tokens, ev.usage.completion_tokens};
+            }
+            record(rec);
+        }));
+    // Streams end after the provider call returns, so they get their own
+    // async track instead of nesting inside the provider slice
+    sub_ids_.push_back(subscribe<StreamStartEvent>(bus,
+        [this](const StreamStartEvent& ev) {
+            record(make_record('i', "stream", "first_token", ev.session_id));
+            auto rec = make_record('b', "stream", "stream", ev.session_id);
+            rec.id = span_id(ev.session_id);
+            record(rec);
+        }));
+    sub_ids_.push_back(subscribe<StreamEndEvent>(bus,
+        [this](const StreamEndEvent& ev) {
+            auto rec = make_record('e', "stream", "stream", ev.session_id);
+            rec.id = span_id(ev.session_id);
+            record(rec);
+        }));
+    // Tool calls in a batch overlap, so each is an async span keyed by call id
+    sub_ids_.push_back(subscribe<ToolCallRequestEvent>(bus,
+        [this](const ToolCallRequestEvent& ev) {
+            auto rec = make_record('b', "tool", ev.tool_name, ev.session_id);
+            rec.id = span_id(ev.tool_call_id);
+            record(rec);
+        }));
+    sub_ids_.push_back(subscribe<ToolCallResultEvent>(bus,
+        [this](const ToolCallResultEvent& ev) {
+            auto rec = make_record('e', "tool", ev.tool_name, ev.session_id);
+            rec.id = span_id(ev.tool_call_id);
+            rec.arg_names = {"raw_tokens", "filtered_tokens"};
+            rec.args = {ev.raw_tokens, ev.filtered_tokens};
+            record(rec);
+        }));
+}
+
+void TraceRecorder::detach() {
+    if (!bus_) return;
+    for (uint64_t id : sub_ids_) bus_->unsubscribe(id);
+    sub_ids_.clear();
+    bus_ = nullptr;
+}
+
+void TraceRecorder::install() {
+    active_.store(this, std::memory_order_release);
+}
+
+void TraceRecorder::stop() {
+    detach();
+    TraceRecorder* self = this;
+    active_.compare_exchange_strong(self, nullptr);
+
+    if (!writer_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_all();
+    writer_.join();
+    out_ << "\n]\n";
+    out_.close();
+    if (dropped() > 0) {
+        std::cerr << "[trace] Ring full, dropped " << dropped() << " records\n";
+    }
+}
+
+void TraceRecorder::record(const TraceRecord& rec) {
+    TraceRecord stamped = rec;
+    if (stamped.phase != 'X') stamped.ts_us = now_us();
+    if (!ring_.push(stamped)) dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t TraceRecorder::now_us() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_).count());
+}
+
+void TraceRecorder::writer_loop() {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (!stopping_) {
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(100));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+    lock.unlock();
+    drain();
+}
+
+void TraceRecorder::drain() {
+    TraceRecord rec;
+    bool wrote = false;
+    while (ring_.pop(rec)) {
+        write_record(rec);
+        wrote = true;
+    }
+    if (wrote) out_.flush();
+}
+
+void TraceRecorder::write_record(const TraceRecord& rec) {
+    std::string session(rec.session.data());
+    auto [it, inserted] = tids_.emplace(session, static_cast<uint32_t>(tids_.size() + 1));
+    uint32_t tid = it->second;
+
+    auto emit = [this](const nlohmann::json& j) {
+        if (!first_) out_ << ",\n";
+        first_ = false;
+        out_ << j.dump();
+    };
+
+    if (inserted) {
+        // Name the session's track
+        emit({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", tid},
+              {"args", {{"name", session.empty() ? "(no session)" : session}}}});
+    }
+
+    nlohmann::json j = {
+        {"name", rec.name.data()},
+        {"cat", rec.category},
+        {"ph", std::string(1, rec.phase)},
+        {"ts", rec.ts_us},
+        {"pid", 1},
+        {"tid", tid},
+    };
+    if (rec.phase == 'X') j["dur"] = rec.dur_us;
+    if (rec.phase == 'i') j["s"] = "t";
+    // String ids: JSON numbers above 2^53 lose precision in the viewers
+    if (rec.phase == 'b' || rec.phase == 'e') j["id"] = std::to_string(rec.id);
+    nlohmann::json args = nlohmann::json::object();
+    for (size_t i = 0; i < rec.arg_names.size(); i++) {
+        if (rec.arg_names[i]) args[rec.arg_names[i]] = rec.args[i];
+    }
+    if (!args.empty()) j["args"] = std::move(args);
+    emit(j);
+}
+
+// ── TraceSpan ───────────────────────────────────────────────────
+
+TraceSpan::TraceSpan(const char* name, const std::string& session_id,
+                     const char* category)
+    : recorder_(TraceRecorder::active())
+{
+    if (!recorder_) return;
+    rec_ = make_record('X', category, name, session_id);
+    rec_.ts_us = recorder_->now_us();
+}
+
+TraceSpan::~TraceSpan() {
+    if (!recorder_) return;
+    rec_.dur_us = recorder_->now_us() - rec_.ts_us;
+    recorder_->record(rec_);
+}
+
+void TraceSpan::arg(const char* name, int64_t value) {
+    if (!recorder_) return;
+    for (size_t i = 0; i < rec_.arg_names.size(); i++) {
+        if (!rec_.arg_names[i] || std::strcmp(rec_.arg_names[i], name) == 0) {
+            rec_.arg_names[i] = name;
+            rec_.args[i] = value;
+            return;
+        }
+    }
+}
+
+} // namespace ptrclaw
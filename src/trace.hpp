@@ -0,0 +1,125 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ptrclaw {
+
+class EventBus;
+
+// One timeline entry. Fixed-size so recording never allocates; names and
+// session ids longer than the buffers are truncated.
+struct TraceRecord {
+    char phase = 'i';               // Chrome trace phase: B E X i b e
+    const char* category = "";      // static string
+    uint64_t ts_us = 0;             // since recorder start
+    uint64_t dur_us = 0;            // 'X' only
+    uint64_t id = 0;                // async span id ('b'/'e')
+    std::array<char, 48> name{};
+    std::array<char, 48> session{};
+    std::array<const char*, 2> arg_names{};
+    std::array<int64_t, 2> args{};
+};
+
+// Bounded lock-free multi-producer / single-consumer ring (Vyukov).
+// push() fails instead of blocking when the ring is full.
+class TraceRing {
+public:
+    explicit TraceRing(size_t capacity);  // rounded up to a power of two
+
+    bool push(const TraceRecord& rec);
+    bool pop(TraceRecord& out);           // single consumer only
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        TraceRecord rec;
+    };
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    std::atomic<size_t> head_{0};
+    size_t tail_ = 0;
+};
+
+// Per-session span timelines written as Chrome/Perfetto trace JSON
+// (load in chrome://tracing or ui.perfetto.dev). Producers push records
+// into a TraceRing; a background thread drains it to the file. Each
+// session gets its own track. The file stays valid JSON-array format even
+// if the process dies before stop() (the closing bracket is optional).
+class TraceRecorder {
+public:
+    explicit TraceRecorder(const std::string& path, size_t capacity = 16384);
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    bool is_open() const { return out_.is_open(); }
+
+    // Record provider, stream and tool events from the bus
+    void attach(EventBus& bus);
+    void detach();
+
+    // Make this the process-wide recorder used by TraceSpan
+    void install();
+
+    // Flush, close the JSON array and stop the writer. Idempotent.
+    void stop();
+
+    void record(const TraceRecord& rec);
+    uint64_t now_us() const;
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static TraceRecorder* active() { return active_.load(std::memory_order_acquire); }
+
+private:
+    void writer_loop();
+    void drain();
+    void write_record(const TraceRecord& rec);
+
+    TraceRing ring_;
+    std::ofstream out_;
+    std::chrono::steady_clock::time_point start_;
+    std::atomic<uint64_t> dropped_{0};
+    bool first_ = true;
+    std::unordered_map<std::string, uint32_t> tids_;  // writer thread only
+
+    EventBus* bus_ = nullptr;
+    std::vector<uint64_t> sub_ids_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stopping_ = false;
+    std::thread writer_;
+
+    static std::atomic<TraceRecorder*> active_;
+};
+
+// RAII 'X' (complete) span on the active recorder; a single atomic load
+// when tracing is off.
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const std::string& session_id,
+              const char* category = "agent");
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Attach a numeric argument shown in the span details (max two)
+    void arg(const char* name, int64_t value);
+
+private:
+    TraceRecorder* recorder_;
+    TraceRecord rec_;
+};
+
+} // namespace ptrclaw
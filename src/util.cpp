@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
@@ -10,6 +11,8 @@
 #include <iomanip>
 #include <random>
 #include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace ptrclaw {
 
@@ -154,6 +157,15 @@ uint32_t estimate_tokens(const std::string& text) {
     return static_cast<uint32_t>(text.size() / 4);
 }
 
+uint64_t fnv1a(std::string_view data, uint64_t seed) {
+    uint64_t hash = seed;
+    for (unsigned char byte : data) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 std::string expand_home(const std::string& path) {
     if (!path.empty() && path[0] == '~') {
         const char* home = std::getenv("HOME");
@@ -164,19 +176,59 @@ std::string expand_home(const std::string& path) {
     return path;
 }
 
+// The umask can only be read by setting it; do that once
+static mode_t process_umask() {
+    static const mode_t mask = [] {
+        mode_t m = umask(0);
+        umask(m);
+        return m;
+    }();
+    return mask;
+}
+
 bool atomic_write_file(const std::string& path, const std::string& content) {
-    auto parent = std::filesystem::path(path).parent_path();
+    // Replace the file a symlink points to, not the link
+    std::error_code ec;
+    std::filesystem::path target = path;
+    if (std::filesystem::is_symlink(target, ec)) {
+        auto resolved = std::filesystem::canonical(target, ec);
+        if (!ec) target = resolved;
+    }
+
+    auto parent = target.parent_path();
     if (!parent.empty()) {
         std::filesystem::create_directories(parent);
     }
 
-    std::string tmp_path = path + ".tmp";
-    {
-        std::ofstream file(tmp_path, std::ios::trunc);
-        if (!file.is_open()) return false;
-        file << content;
+    // A unique temp file next to the target: never an existing file (say
+    // the user's own "config.tmp"), and not shared by concurrent writers
+    std::string tmp_path = target.string() + ".XXXXXX";
+    int fd = mkstemp(tmp_path.data());
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = write(fd, content.data() + written, content.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
+
+    // mkstemp creates the file 0600: a replaced file keeps its
+    // permissions, a new one gets the usual 0666 less the umask
+    auto status = std::filesystem::status(target, ec);
+    mode_t mode = !ec && std::filesystem::exists(status)
+        ? static_cast<mode_t>(status.permissions()) & 07777
+        : 0666 & ~process_umask();
+    fchmod(fd, mode);
+
+    // A short write (e.g. disk full) must not replace the original
+    bool ok = written == content.size();
+    if (close(fd) != 0) ok = false;
+    if (!ok || std::rename(tmp_path.c_str(), target.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
     }
-    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+    return true;
 }
 
 std::string resolve_binary_path(const char* argv0) {
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
@@ -35,10 +36,18 @@ std::string generate_id();
 // Estimate token count from text (~4 chars per token)
 uint32_t estimate_tokens(const std::string& text);
 
+// 64-bit FNV-1a. Pass a previous result as `seed` to extend it, so the
+// hash of a concatenation can be built up piece by piece.
+constexpr uint64_t kFnvOffset = 14695981039346656037ULL;
+uint64_t fnv1a(std::string_view data, uint64_t seed = kFnvOffset);
+
 // Expand ~ to home directory
 std::string expand_home(const std::string& path);
 
-// Atomic file write: create parent dirs, write to .tmp, rename into place
+// Atomic file write: create parent dirs, write to a unique temp file
+// beside the target (<target>.XXXXXX), rename into place. A replaced file
+// keeps its permissions; through a symlink, the file it points to is
+// replaced.
 bool atomic_write_file(const std::string& path, const std::string& content);
 
 // Resolve argv[0] to an absolute binary path (searches PATH if bare name)
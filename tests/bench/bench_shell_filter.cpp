@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+#include "output_filter.hpp"
+#include "../shell_logs.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Built as its own binary (ptrclaw_bench_alloc, run by `make bench`): it
+// replaces the global operator new to count heap allocations, which the
+// unit test binary must not inherit.
+
+using namespace ptrclaw;
+
+// Counts heap allocations made while enabled
+static std::atomic<bool> g_count_allocs{false};
+static std::atomic<uint64_t> g_allocs{0};
+
+void* operator new(std::size_t size) {
+    if (g_count_allocs.load(std::memory_order_relaxed)) {
+        g_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+static void bench_filter(const char* name, const std::string& command, const std::string& log) {
+    constexpr int kIterations = 5;
+    OutputFilterConfig config;
+    config.dedupe_log_lines = true;
+    size_t out_size = 0;
+    g_allocs = 0;
+    g_count_allocs = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+        std::string out = filter_shell_output(command, log, config);
+        out_size = out.size();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    g_count_allocs = false;
+    std::cout << name << ": " << (log.size() >> 10) << " KiB in, " << out_size << " bytes out, "
+              << static_cast<uint64_t>(static_cast<double>(log.size()) * kIterations / elapsed / (1 << 20))
+              << " MiB/s, " << g_allocs / kIterations << " allocations/call\n";
+    REQUIRE(out_size > 0);
+}
+
+TEST_CASE("filter_shell_output: throughput on large logs", "[.][bench]") {
+    bench_filter("build log", "ninja -C build", make_build_log(100000));
+    bench_filter("test log", "pytest -q", make_test_log(200000));
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+
+// Synthetic shell output shared by the filter tests and benchmarks
+
+// A noisy CMake/Ninja build: progress lines, repeated warnings across
+// files, timestamped log lines and a failing link at the end
+inline std::string make_build_log(int units) {
+    std::string log;
+    for (int i = 0; i < units; i++) {
+        log += "[" + std::to_string(i * 100 / units) + "%] Building CXX object src/CMakeFiles/app.dir/module_" +
+               std::to_string(i) + ".cpp.o\n";
+        log += "\033[1msrc/module_" + std::to_string(i) + ".cpp:" + std::to_string(10 + i % 90) +
+               ":5: \033[35mwarning:\033[0m unused variable 'tmp' [-Wunused-variable]\n";
+        log += "2024-05-01T12:00:" + std::to_string(10 + i % 50) + ".123 cache hit for object " +
+               std::to_string(100000 + i) + "\n";
+    }
+    log += "/usr/bin/ld: src/main.cpp:42: undefined reference to `start()'\n";
+    log += "collect2: error: ld returned 1 exit status\n";
+    log += "ninja: build stopped: subcommand failed.\n";
+    return log;
+}
+
+// A long test run with a couple of failures among many passing tests
+inline std::string make_test_log(int tests) {
+    std::string log;
+    for (int i = 0; i < tests; i++) {
+        log += "tests/test_module.py::test_case_" + std::to_string(i) + " PASSED" +
+               std::string(static_cast<size_t>(i % 40), ' ') + "[" +
+               std::to_string(i * 100 / tests) + "%]\n";
+        if (i % 5000 == 4999) {
+            log += "tests/test_module.py::test_case_" + std::to_string(i) + " FAILED\n";
+            log += "E   AssertionError: expected 3, got 4\n";
+        }
+    }
+    log += "=== 2 failed, " + std::to_string(tests - 2) + " passed in 12.34s ===\n";
+    return log;
+}
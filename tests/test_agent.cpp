@@ -2,11 +2,13 @@
 #include "agent.hpp"
 #include "dispatcher.hpp"
 #include "memory/json_memory.hpp"
+#include "memory/response_cache.hpp"
 #include "tool_manager.hpp"
 #include "event_bus.hpp"
 #include <stdexcept>
 #include <filesystem>
 #include <fstream>
+#include <thread>
 #include <unistd.h>
 
 using namespace ptrclaw;
@@ -297,6 +299,309 @@ TEST_CASE("Agent: set_provider switches provider", "[agent]") {
     REQUIRE(reply == "from new");
 }
 
+// ── Cancellation ─────────────────────────────────────────────────
+
+// Provider that cancels the turn token while "generating"
+class CancellingProvider : public MockProvider {
+public:
+    CancellationToken token;
+    ChatResponse chat(const std::vector<ChatMessage>& messages,
+                      const std::vector<ToolSpec>& tool_specs,
+                      const std::string& model, double temperature) override {
+        auto r = MockProvider::chat(messages, tool_specs, model, temperature);
+        if (chat_call_count >= cancel_on_call) cancel(token);
+        return r;
+    }
+    int cancel_on_call = 1;
+};
+
+TEST_CASE("Agent: cancelled turn returns stopped reply and rolls back", "[agent]") {
+    auto provider = std::make_unique<CancellingProvider>();
+    auto* mock = provider.get();
+    mock->token = make_cancellation_token();
+    mock->next_response.content = "should not be kept";
+    Config cfg;
+    TestAgentSetup setup(std::move(provider), {}, cfg);
+    setup.agent.set_cancellation_token(mock->token);
+
+    REQUIRE(setup.agent.process("hi") == Agent::kStoppedReply);
+    // Only the system prompt survives
+    REQUIRE(setup.agent.history_size() == 1);
+}
+
+TEST_CASE("Agent: cancellation stops the tool loop", "[agent]") {
+    auto provider = std::make_unique<CancellingProvider>();
+    auto* mock = provider.get();
+    mock->token = make_cancellation_token();
+    mock->cancel_on_call = 2;
+    ChatResponse tool_resp;
+    tool_resp.tool_calls = {{"call-1", "mock_tool", "{}"}};
+    mock->next_response = tool_resp; // keeps asking for tools
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<MockTool>());
+    Config cfg;
+    cfg.agent.max_tool_iterations = 50;
+    TestAgentSetup setup(std::move(provider), std::move(tools), cfg);
+    setup.agent.set_cancellation_token(mock->token);
+
+    REQUIRE(setup.agent.process("loop") == Agent::kStoppedReply);
+    REQUIRE(mock->chat_call_count == 2);
+    REQUIRE(setup.agent.history_size() == 1);
+}
+
+TEST_CASE("Agent: pre-cancelled token never calls provider", "[agent]") {
+    auto [setup, mock] = make_agent();
+    auto token = make_cancellation_token();
+    cancel(token);
+    setup.agent.set_cancellation_token(token);
+    REQUIRE(setup.agent.process("hi") == Agent::kStoppedReply);
+    REQUIRE(mock->chat_call_count == 0);
+
+    // Clearing the token restores normal turns
+    setup.agent.set_cancellation_token(nullptr);
+    mock->next_response.content = "back";
+    REQUIRE(setup.agent.process("hi") == "back");
+}
+
+// ── Hibernation snapshot ─────────────────────────────────────────
+
+TEST_CASE("Agent: snapshot excludes system prompt", "[agent]") {
+    auto [setup, mock] = make_agent();
+    auto& agent = setup.agent;
+    mock->next_response.content = "reply";
+    agent.process("hi");
+
+    auto snap = agent.snapshot();
+    REQUIRE(snap["provider"] == "mock");
+    REQUIRE(snap["history"].size() == 2);
+    REQUIRE(snap["history"][0]["role"] == "user");
+    REQUIRE(snap["history"][1]["role"] == "assistant");
+}
+
+TEST_CASE("Agent: restore round-trips history and model", "[agent]") {
+    auto [setup, mock] = make_agent();
+    auto& agent = setup.agent;
+    mock->next_response.content = "reply";
+    agent.set_model("snap-model");
+    agent.process("hi");
+    auto snap = agent.snapshot();
+
+    auto [setup2, mock2] = make_agent();
+    auto& restored = setup2.agent;
+    restored.restore(snap);
+    REQUIRE(restored.model() == "snap-model");
+    REQUIRE(restored.history_size() == 2);
+
+    // System prompt is re-injected lazily on the next turn
+    mock2->next_response.content = "again";
+    restored.process("second");
+    REQUIRE(mock2->last_messages.front().role == Role::System);
+    REQUIRE(restored.history_size() == 5);
+}
+
+TEST_CASE("Agent: restore ignores malformed snapshot", "[agent]") {
+    auto [setup, mock] = make_agent();
+    auto& agent = setup.agent;
+    agent.restore(nlohmann::json::array());
+    agent.restore({{"history", {{{"role", "user"}}}}});
+    REQUIRE(agent.history_size() == 0);
+}
+
+// ── History hash and provider-call replay ───────────────────────
+
+class CountingTool : public Tool {
+public:
+    int calls = 0;
+    ToolResult execute(const std::string&) override {
+        calls++;
+        return ToolResult{true, "counted"};
+    }
+    std::string tool_name() const override { return "counting_tool"; }
+    std::string description() const override { return "Counts executions"; }
+    std::string parameters_json() const override { return R"({"type":"object"})"; }
+};
+
+struct ReplayAgent {
+    MockProvider* mock;
+    CountingTool* tool;
+    TestAgentSetup setup;
+};
+
+static std::unique_ptr<ReplayAgent> make_replay_agent(
+        double temperature, const std::shared_ptr<ResponseCache>& cache) {
+    auto provider = std::make_unique<MockProvider>();
+    auto* mock = provider.get();
+    ChatResponse call;
+    call.tool_calls = {ToolCall{"call1", "counting_tool", "{}"}};
+    ChatResponse done;
+    done.content = "workflow done";
+    mock->responses = {call, done};
+
+    auto tool = std::make_unique<CountingTool>();
+    auto* tool_ptr = tool.get();
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(tool));
+
+    Config cfg;
+    cfg.temperature = temperature;
+    cfg.memory.backend = "none";
+    cfg.agent.max_tool_iterations = 5;
+    auto agent = std::unique_ptr<ReplayAgent>(new ReplayAgent{
+        mock, tool_ptr, TestAgentSetup(std::move(provider), std::move(tools), cfg)});
+    if (cache) agent->setup.agent.set_response_cache(cache);
+    return agent;
+}
+
+struct ReplayCacheFixture {
+    std::string path = "/tmp/ptrclaw_test_replay_" + std::to_string(getpid()) + ".json";
+    std::shared_ptr<ResponseCache> cache = std::make_shared<ResponseCache>(path, 3600, 100);
+    ~ReplayCacheFixture() { std::filesystem::remove(path); }
+};
+
+TEST_CASE("Agent: history_hash follows appends, restores and truncation", "[agent]") {
+    auto a = make_replay_agent(0.7, nullptr);
+    auto& agent = a->setup.agent;
+    uint64_t empty = agent.history_hash();
+    agent.process("run it");
+    uint64_t after_turn = agent.history_hash();
+    REQUIRE(after_turn != empty);
+
+    // A restored agent that re-injects the system prompt converges on the
+    // same history, so the incrementally maintained hash must match
+    auto b = make_replay_agent(0.7, nullptr);
+    b->setup.agent.restore(agent.snapshot());
+    uint64_t before_inject = b->setup.agent.history_hash();
+    a->mock->responses = {a->mock->responses.back()};
+    b->mock->responses = {b->mock->responses.back()};
+    agent.process("again");
+    b->setup.agent.process("again");
+    REQUIRE(b->setup.agent.history_hash() != before_inject);
+    REQUIRE(b->setup.agent.history_hash() == agent.history_hash());
+
+    agent.clear_history();
+    REQUIRE(agent.history_hash() == empty);
+}
+
+TEST_CASE("Agent: temperature 0 replays a repeated tool workflow", "[agent][cache]") {
+    ReplayCacheFixture fx;
+    auto first = make_replay_agent(0.0, fx.cache);
+    REQUIRE(first->setup.agent.process("nightly report") == "workflow done");
+    REQUIRE(first->mock->chat_call_count == 2);
+    REQUIRE(first->tool->calls == 1);
+
+    // Same workflow in a fresh session: every provider call is served from
+    // the cache, but the tool still runs
+    auto second = make_replay_agent(0.0, fx.cache);
+    REQUIRE(second->setup.agent.process("nightly report") == "workflow done");
+    REQUIRE(second->mock->chat_call_count == 0);
+    REQUIRE(second->tool->calls == 1);
+}
+
+TEST_CASE("Agent: replay is keyed by the whole history", "[agent][cache]") {
+    ReplayCacheFixture fx;
+    auto first = make_replay_agent(0.0, fx.cache);
+    first->setup.agent.process("nightly report");
+
+    auto second = make_replay_agent(0.0, fx.cache);
+    second->setup.agent.process("weekly report");
+    REQUIRE(second->mock->chat_call_count == 2);
+}
+
+TEST_CASE("Agent: non-zero temperature never replays", "[agent][cache]") {
+    ReplayCacheFixture fx;
+    auto first = make_replay_agent(0.7, fx.cache);
+    first->setup.agent.process("nightly report");
+
+    // Turn-level cache still answers the repeated message, without tools
+    auto second = make_replay_agent(0.7, fx.cache);
+    second->setup.agent.process("nightly report");
+    REQUIRE(second->tool->calls == 0);
+    REQUIRE(fx.cache->size() == 1);
+}
+
+TEST_CASE("Agent: memoized tool result refers to the earlier identical one", "[agent]") {
+    class LookupTool : public Tool {
+    public:
+        ToolResult execute(const std::string&) override {
+            return ToolResult{true, std::string(200, 'x')};
+        }
+        std::string tool_name() const override { return "lookup"; }
+        std::string description() const override { return "Pure lookup"; }
+        std::string parameters_json() const override { return R"({"type":"object"})"; }
+        ToolPurity purity() const override { return ToolPurity::Pure; }
+    };
+
+    auto provider = std::make_unique<MockProvider>();
+    auto* mock = provider.get();
+    ChatResponse r1;
+    r1.tool_calls = {ToolCall{"first", "lookup", R"({"q":"a"})"}};
+    ChatResponse r2;
+    r2.tool_calls = {ToolCall{"second", "lookup", R"({"q":"a"})"}};
+    ChatResponse r3;
+    r3.content = "done";
+    mock->responses = {r1, r2, r3};
+
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<LookupTool>());
+    Config cfg;
+    cfg.memory.backend = "none";
+    TestAgentSetup setup(std::move(provider), std::move(tools), cfg);
+    setup.agent.process("look it up twice");
+
+    std::vector<std::string> tool_messages;
+    for (const auto& msg : mock->last_messages) {
+        if (msg.role == Role::Tool) tool_messages.push_back(msg.content);
+    }
+    REQUIRE(tool_messages.size() == 2);
+    REQUIRE(tool_messages[0] == std::string(200, 'x'));
+    REQUIRE(tool_messages[1] == "[Same result as tool call first above]");
+}
+
+TEST_CASE("Agent: timed-out tool call reports the output it produced", "[agent]") {
+    // Prints a line every 50 ms for ~4 s unless cancelled
+    class BuildTool : public Tool {
+    public:
+        ToolResult execute(const std::string& args) override {
+            return execute(args, nullptr, nullptr);
+        }
+        ToolResult execute(const std::string&, const CancellationToken& token,
+                           const ToolProgress& progress) override {
+            for (int i = 0; i < 80 && !is_cancelled(token); i++) {
+                if (progress) progress("compiling unit " + std::to_string(i) + "\n");
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            return ToolResult{false, "cancelled"};
+        }
+        std::string tool_name() const override { return "build"; }
+        std::string description() const override { return "Slow build"; }
+        std::string parameters_json() const override { return R"({"type":"object"})"; }
+    };
+
+    auto provider = std::make_unique<MockProvider>();
+    auto* mock = provider.get();
+    ChatResponse call;
+    call.tool_calls = {ToolCall{"b1", "build", "{}"}};
+    ChatResponse done;
+    done.content = "build timed out";
+    mock->responses = {call, done};
+
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<BuildTool>());
+    Config cfg;
+    cfg.memory.backend = "none";
+    cfg.agent.tool_timeout = 2;
+    TestAgentSetup setup(std::move(provider), std::move(tools), cfg);
+    setup.agent.process("build it");
+
+    const ChatMessage* tool_msg = nullptr;
+    for (const auto& msg : mock->last_messages) {
+        if (msg.role == Role::Tool) tool_msg = &msg;
+    }
+    REQUIRE(tool_msg != nullptr);
+    REQUIRE(tool_msg->content.find("timed out after 2s") != std::string::npos);
+    REQUIRE(tool_msg->content.find("compiling unit 0\n") != std::string::npos);
+}
+
 // ── dispatch_tool ────────────────────────────────────────────────
 
 TEST_CASE("dispatch_tool: finds and executes matching tool", "[dispatcher]") {
@@ -355,6 +660,67 @@ TEST_CASE("Agent: tool call triggers second chat round", "[agent]") {
     REQUIRE(mock->chat_call_count == 2);
 }
 
+TEST_CASE("Agent: tool calls carry the batch's token budget", "[agent]") {
+    auto provider = std::make_unique<MockProvider>();
+    auto* mock = provider.get();
+
+    ChatResponse r1;
+    r1.content = "";
+    r1.tool_calls = {ToolCall{"call1", "mock_tool", "{}"}, ToolCall{"call2", "mock_tool", "{}"}};
+    ChatResponse r2;
+    r2.content = "Done";
+    mock->responses = {r1, r2};
+
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<MockTool>());
+    Config cfg;
+    cfg.agent.token_limit = 10000;  // compaction starts at 7500
+    TestAgentSetup setup(std::move(provider), std::move(tools), cfg);
+
+    std::vector<ToolCallRequestEvent> requests;
+    subscribe<ToolCallRequestEvent>(setup.bus,
+        std::function<void(const ToolCallRequestEvent&)>(
+            [&requests](const ToolCallRequestEvent& ev) { requests.push_back(ev); }));
+
+    REQUIRE(setup.agent.process("do something") == "Done");
+    REQUIRE(requests.size() == 2);
+    for (const auto& req : requests) {
+        REQUIRE(req.batch_size == 2);
+        // Less the system prompt and the messages so far
+        REQUIRE(req.token_budget > 5000);
+        REQUIRE(req.token_budget < 7500);
+    }
+}
+
+TEST_CASE("Agent: tool calls past the compaction threshold get the minimum budget",
+          "[agent]") {
+    auto provider = std::make_unique<MockProvider>();
+    auto* mock = provider.get();
+
+    ChatResponse r1;
+    r1.content = "";
+    r1.tool_calls = {ToolCall{"call1", "mock_tool", "{}"}};
+    ChatResponse r2;
+    r2.content = "Done";
+    mock->responses = {r1, r2};
+
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<MockTool>());
+    Config cfg;
+    cfg.agent.token_limit = 100;  // the system prompt alone is past 75
+    TestAgentSetup setup(std::move(provider), std::move(tools), cfg);
+
+    std::vector<ToolCallRequestEvent> requests;
+    subscribe<ToolCallRequestEvent>(setup.bus,
+        std::function<void(const ToolCallRequestEvent&)>(
+            [&requests](const ToolCallRequestEvent& ev) { requests.push_back(ev); }));
+
+    REQUIRE(setup.agent.process("do something") == "Done");
+    REQUIRE(requests.size() == 1);
+    // Not 0, which would mean "unknown" and get the default limits
+    REQUIRE(requests[0].token_budget == 1);
+}
+
 TEST_CASE("Agent: max tool iterations reached", "[agent]") {
     auto provider = std::make_unique<MockProvider>();
     auto* mock = provider.get();
@@ -394,6 +760,44 @@ TEST_CASE("Agent: provider exception returns error message", "[agent]") {
     REQUIRE(reply.find("provider error") != std::string::npos);
 }
 
+TEST_CASE("Agent: failed provider call still publishes a response event", "[agent]") {
+    auto provider = std::make_unique<MockProvider>();
+    provider->should_throw = true;
+    Config cfg;
+    TestAgentSetup setup(std::move(provider), {}, cfg);
+
+    std::vector<std::string> events;
+    subscribe<ProviderRequestEvent>(setup.bus,
+        std::function<void(const ProviderRequestEvent&)>(
+            [&](const ProviderRequestEvent&) { events.push_back("request"); }));
+    subscribe<ProviderResponseEvent>(setup.bus,
+        std::function<void(const ProviderResponseEvent&)>(
+            [&](const ProviderResponseEvent& ev) {
+                events.push_back(ev.failed ? "failed" : "response");
+            }));
+
+    setup.agent.process("trigger error");
+    REQUIRE(events == std::vector<std::string>{"request", "failed"});
+}
+
+TEST_CASE("Agent: stopped provider call still publishes a response event", "[agent]") {
+    auto provider = std::make_unique<CancellingProvider>();
+    auto* mock = provider.get();
+    mock->token = make_cancellation_token();
+    mock->next_response.content = "should not be kept";
+    Config cfg;
+    TestAgentSetup setup(std::move(provider), {}, cfg);
+    setup.agent.set_cancellation_token(mock->token);
+
+    std::vector<bool> failed;
+    subscribe<ProviderResponseEvent>(setup.bus,
+        std::function<void(const ProviderResponseEvent&)>(
+            [&](const ProviderResponseEvent& ev) { failed.push_back(ev.failed); }));
+
+    REQUIRE(setup.agent.process("hi") == Agent::kStoppedReply);
+    REQUIRE(failed == std::vector<bool>{true});
+}
+
 // ── Tool result in history (native provider) ────────────────────
 
 TEST_CASE("Agent: tool result appears in history for native provider", "[agent]") {
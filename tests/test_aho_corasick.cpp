@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+#include "aho_corasick.hpp"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace ptrclaw;
+
+namespace {
+
+using Hits = std::vector<std::pair<uint32_t, size_t>>;  // (pattern, begin)
+
+Hits all_hits(const AhoCorasick& ac, std::string_view text) {
+    Hits hits;
+    ac.scan(text, [&](uint32_t pattern, size_t begin) {
+        hits.emplace_back(pattern, begin);
+        return false;
+    });
+    return hits;
+}
+
+} // namespace
+
+TEST_CASE("AhoCorasick: reports every occurrence in end order", "[aho_corasick]") {
+    AhoCorasick ac({"he", "she", "his", "hers"});
+    REQUIRE(ac.pattern_count() == 4);
+    // "ushers": she ends at 3, he ends at 3, hers ends at 5
+    Hits hits = all_hits(ac, "ushers");
+    REQUIRE(hits == Hits{{1, 1}, {0, 2}, {3, 2}});
+    REQUIRE(all_hits(ac, "xyz").empty());
+    REQUIRE(all_hits(ac, "").empty());
+}
+
+TEST_CASE("AhoCorasick: overlapping and repeated patterns", "[aho_corasick]") {
+    AhoCorasick ac({"aa", "a", "aa"});
+    REQUIRE(all_hits(ac, "aaa") ==
+            Hits{{1, 0}, {0, 0}, {2, 0}, {1, 1}, {0, 1}, {2, 1}, {1, 2}});
+}
+
+TEST_CASE("AhoCorasick: scan stops when the callback says so", "[aho_corasick]") {
+    AhoCorasick ac({"b"});
+    int calls = 0;
+    REQUIRE(ac.scan("abcabc", [&](uint32_t, size_t begin) {
+        calls++;
+        return begin == 1;
+    }));
+    REQUIRE(calls == 1);
+    REQUIRE(ac.contains_any("xxb"));
+    REQUIRE_FALSE(ac.contains_any("xxx"));
+}
+
+TEST_CASE("AhoCorasick: ignore_case folds ASCII letters", "[aho_corasick]") {
+    AhoCorasick ac({"Token", "auth"}, /*ignore_case=*/true);
+    REQUIRE(all_hits(ac, "GH_TOKEN=x AUTH") == Hits{{0, 3}, {1, 11}});
+    AhoCorasick exact({"Token"});
+    REQUIRE_FALSE(exact.contains_any("GH_TOKEN"));
+}
+
+TEST_CASE("AhoCorasick: rejects empty patterns", "[aho_corasick]") {
+    REQUIRE_THROWS_AS(AhoCorasick({"a", ""}), std::invalid_argument);
+}
+
+TEST_CASE("AhoCorasick: matches naive search on random text", "[aho_corasick]") {
+    std::mt19937 rng(1);
+    auto random_string = [&](size_t len) {
+        std::string s;
+        for (size_t i = 0; i < len; i++) s += static_cast<char>('a' + rng() % 3);
+        return s;
+    };
+
+    std::vector<std::string> storage;
+    for (int i = 0; i < 30; i++) storage.push_back(random_string(1 + rng() % 5));
+    std::vector<std::string_view> patterns(storage.begin(), storage.end());
+    AhoCorasick ac(patterns);
+    std::string text = random_string(2000);
+
+    Hits expected;
+    for (size_t end = 1; end <= text.size(); end++) {
+        for (uint32_t p = 0; p < patterns.size(); p++) {
+            size_t len = patterns[p].size();
+            if (len <= end && text.compare(end - len, len, patterns[p]) == 0) {
+                expected.emplace_back(p, end - len);
+            }
+        }
+    }
+    // Order within one end offset is not specified; compare as sets
+    Hits hits = all_hits(ac, text);
+    std::sort(hits.begin(), hits.end());
+    std::sort(expected.begin(), expected.end());
+    REQUIRE(hits == expected);
+}
@@ -1,5 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
 #include "event_bus.hpp"
+#include "metrics.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
 
 using namespace ptrclaw;
 
@@ -92,6 +100,92 @@ TEST_CASE("EventBus: unsubscribe returns false for unknown id", "[event_bus]") {
     REQUIRE_FALSE(bus.unsubscribe(999));
 }
 
+TEST_CASE("EventBus: unsubscribe only removes the given id", "[event_bus]") {
+    EventBus bus;
+    int a = 0;
+    int b = 0;
+    uint64_t id_a = subscribe<StreamChunkEvent>(bus, [&](const StreamChunkEvent&) { a++; });
+    subscribe<StreamChunkEvent>(bus, [&](const StreamChunkEvent&) { b++; });
+
+    REQUIRE(bus.unsubscribe(id_a));
+    REQUIRE_FALSE(bus.unsubscribe(id_a));
+    StreamChunkEvent ev;
+    bus.publish(ev);
+    REQUIRE(a == 0);
+    REQUIRE(b == 1);
+}
+
+TEST_CASE("EventBus: handler may unsubscribe itself during publish", "[event_bus]") {
+    EventBus bus;
+    int count = 0;
+    int after = 0;
+    uint64_t id = 0;
+    id = bus.subscribe(MessageReceivedEvent::TAG, [&](const Event&) {
+        count++;
+        bus.unsubscribe(id);
+    });
+    bus.subscribe(MessageReceivedEvent::TAG, [&](const Event&) { after++; });
+
+    MessageReceivedEvent ev;
+    bus.publish(ev);
+    bus.publish(ev);
+    REQUIRE(count == 1);
+    REQUIRE(after == 2); // snapshot in flight still reaches later handlers
+}
+
+TEST_CASE("EventBus: subscribe during publish takes effect next publish", "[event_bus]") {
+    EventBus bus;
+    int inner = 0;
+    bool added = false;
+    bus.subscribe(MessageReadyEvent::TAG, [&](const Event&) {
+        if (added) return;
+        added = true;
+        bus.subscribe(MessageReadyEvent::TAG, [&](const Event&) { inner++; });
+    });
+
+    MessageReadyEvent ev;
+    bus.publish(ev);
+    REQUIRE(inner == 0);
+    bus.publish(ev);
+    REQUIRE(inner == 1);
+}
+
+TEST_CASE("EventBus: unknown tag is rejected", "[event_bus]") {
+    EventBus bus;
+    REQUIRE(bus.subscribe("NoSuchEvent", [](const Event&) {}) == 0);
+    REQUIRE(bus.subscriber_count("NoSuchEvent") == 0);
+    REQUIRE(event_id_from_tag(StreamEndEvent::TAG) == StreamEndEvent::ID);
+    REQUIRE(event_id_from_tag(ToolCallProgressEvent::TAG) == ToolCallProgressEvent::ID);
+    REQUIRE(event_id_from_tag(TurnStartEvent::TAG) == TurnStartEvent::ID);
+}
+
+TEST_CASE("EventBus: concurrent publish and subscribe", "[event_bus]") {
+    EventBus bus;
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<bool> done{false};
+    subscribe<StreamChunkEvent>(bus, [&](const StreamChunkEvent&) { delivered++; });
+
+    std::vector<std::thread> publishers;
+    for (int t = 0; t < 4; t++) {
+        publishers.emplace_back([&] {
+            StreamChunkEvent ev;
+            while (!done.load()) bus.publish(ev);
+        });
+    }
+    for (int i = 0; i < 500; i++) {
+        uint64_t id = subscribe<StreamChunkEvent>(bus, [](const StreamChunkEvent&) {});
+        REQUIRE(bus.unsubscribe(id));
+    }
+    for (int i = 0; i < 1000 && delivered.load() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done = true;
+    for (auto& t : publishers) t.join();
+
+    REQUIRE(delivered.load() > 0);
+    REQUIRE(bus.subscriber_count(StreamChunkEvent::TAG) == 1);
+}
+
 // ── Clear ───────────────────────────────────────────────────────
 
 TEST_CASE("EventBus: clear removes all subscriptions", "[event_bus]") {
@@ -199,3 +293,229 @@ TEST_CASE("EventBus: session events carry session_id", "[event_bus]") {
     REQUIRE(created_id == "abc");
     REQUIRE(evicted_id == "xyz");
 }
+
+// ── Async subscriptions ─────────────────────────────────────────
+
+// Holds async handlers until opened, recording what they received
+struct Gate {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool open = false;
+    std::vector<std::string> seen;
+
+    void handle(const std::string& value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        seen.push_back(value);
+        cv.notify_all();
+        cv.wait(lock, [&] { return open; });
+    }
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+        cv.notify_all();
+    }
+    bool wait_seen(size_t n) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(5),
+                           [&] { return seen.size() >= n; });
+    }
+};
+
+static void publish_chunk(EventBus& bus, const std::string& session,
+                          const std::string& delta) {
+    StreamChunkEvent ev;
+    ev.session_id = session;
+    ev.delta = delta;
+    bus.publish(ev);
+}
+
+TEST_CASE("EventBus: async handler runs off the publishing thread", "[event_bus]") {
+    EventBus bus;
+    Gate gate;
+    gate.release();
+    std::thread::id handler_thread;
+    uint64_t id = subscribe_async<StreamChunkEvent>(bus, [&](const StreamChunkEvent& ev) {
+        handler_thread = std::this_thread::get_id();
+        gate.handle(ev.delta);
+    });
+
+    publish_chunk(bus, "s", "hello");
+    REQUIRE(gate.wait_seen(1));
+    REQUIRE(gate.seen[0] == "hello");
+    REQUIRE(handler_thread != std::this_thread::get_id());
+
+    auto stats = bus.async_stats(id);
+    REQUIRE(stats.has_value());
+    REQUIRE(stats->capacity == 256);
+    REQUIRE_FALSE(bus.async_stats(999).has_value());
+}
+
+TEST_CASE("EventBus: async drop-oldest keeps the newest events", "[event_bus]") {
+    EventBus bus;
+    Gate gate;
+    uint64_t id = subscribe_async<StreamChunkEvent>(bus,
+        [&](const StreamChunkEvent& ev) { gate.handle(ev.delta); },
+        AsyncOptions{2, OverflowPolicy::DropOldest, ""});
+
+    publish_chunk(bus, "s", "1");
+    REQUIRE(gate.wait_seen(1)); // worker is now parked in the handler
+    for (const char* d : {"2", "3", "4", "5"}) publish_chunk(bus, "s", d);
+
+    auto stats = bus.async_stats(id);
+    REQUIRE(stats->depth == 2);
+    REQUIRE(stats->dropped == 2);
+
+    gate.release();
+    REQUIRE(gate.wait_seen(3));
+    REQUIRE(gate.seen == std::vector<std::string>{"1", "4", "5"});
+}
+
+TEST_CASE("EventBus: async coalesce-by-key replaces queued events", "[event_bus]") {
+    EventBus bus;
+    Gate gate;
+    uint64_t id = subscribe_async<StreamChunkEvent>(bus,
+        [&](const StreamChunkEvent& ev) { gate.handle(ev.session_id + ev.delta); },
+        AsyncOptions{4, OverflowPolicy::CoalesceByKey, ""},
+        [](const StreamChunkEvent& ev) { return ev.session_id; });
+
+    publish_chunk(bus, "a", "0");
+    REQUIRE(gate.wait_seen(1));
+    publish_chunk(bus, "a", "1");
+    publish_chunk(bus, "b", "1");
+    publish_chunk(bus, "a", "2");
+    publish_chunk(bus, "b", "2");
+
+    auto stats = bus.async_stats(id);
+    REQUIRE(stats->depth == 2);
+    REQUIRE(stats->coalesced == 2);
+    REQUIRE(stats->dropped == 0);
+
+    gate.release();
+    REQUIRE(gate.wait_seen(3));
+    REQUIRE(gate.seen == std::vector<std::string>{"a0", "a2", "b2"});
+}
+
+TEST_CASE("EventBus: async block policy applies backpressure", "[event_bus]") {
+    EventBus bus;
+    Gate gate;
+    uint64_t id = subscribe_async<StreamChunkEvent>(bus,
+        [&](const StreamChunkEvent& ev) { gate.handle(ev.delta); },
+        AsyncOptions{1, OverflowPolicy::Block, ""});
+
+    publish_chunk(bus, "s", "1");
+    REQUIRE(gate.wait_seen(1));
+    publish_chunk(bus, "s", "2"); // fills the queue
+
+    std::atomic<bool> published{false};
+    std::thread publisher([&] {
+        publish_chunk(bus, "s", "3");
+        published = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(published.load());
+
+    gate.release();
+    publisher.join();
+    REQUIRE(published.load());
+    REQUIRE(gate.wait_seen(3));
+    REQUIRE(gate.seen == std::vector<std::string>{"1", "2", "3"});
+    REQUIRE(bus.async_stats(id)->dropped == 0);
+}
+
+TEST_CASE("EventBus: unsubscribe stops an async subscription", "[event_bus]") {
+    EventBus bus;
+    Gate gate;
+    gate.release();
+    uint64_t id = subscribe_async<StreamChunkEvent>(bus,
+        [&](const StreamChunkEvent& ev) { gate.handle(ev.delta); });
+
+    publish_chunk(bus, "s", "1");
+    REQUIRE(gate.wait_seen(1));
+    REQUIRE(bus.unsubscribe(id));
+    REQUIRE_FALSE(bus.async_stats(id).has_value());
+    publish_chunk(bus, "s", "2");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(gate.seen.size() == 1);
+}
+
+TEST_CASE("EventBus: unsubscribe waits for a running async handler", "[event_bus]") {
+    EventBus bus;
+    Gate gate;
+    uint64_t id = subscribe_async<StreamChunkEvent>(bus,
+        [&](const StreamChunkEvent& ev) { gate.handle(ev.delta); });
+
+    publish_chunk(bus, "s", "1");
+    REQUIRE(gate.wait_seen(1));  // parked in the handler
+    std::atomic<bool> returned{false};
+    std::thread unsubscriber([&] {
+        bus.unsubscribe(id);
+        returned = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(returned.load());
+    gate.release();
+    unsubscriber.join();
+    REQUIRE(returned.load());
+}
+
+TEST_CASE("EventBus: coalesce-by-key needs a key function", "[event_bus]") {
+    EventBus bus;
+    REQUIRE_THROWS_AS(subscribe_async<StreamChunkEvent>(bus,
+        [](const StreamChunkEvent&) {},
+        AsyncOptions{4, OverflowPolicy::CoalesceByKey, ""}), std::invalid_argument);
+    REQUIRE(bus.subscriber_count(StreamChunkEvent::TAG) == 0);
+}
+
+TEST_CASE("EventBus: named async subscriptions export queue metrics", "[event_bus]") {
+    EventBus bus;
+    Gate gate;
+    AsyncOptions options{1, OverflowPolicy::DropOldest, "test_export"};
+    subscribe_async<StreamChunkEvent>(bus,
+        [&](const StreamChunkEvent& ev) { gate.handle(ev.delta); }, options);
+    auto& depth = metrics().event_queue_depth.labels(metric_label("subscriber", "test_export"));
+    auto counter = [](const char* result) -> Counter& {
+        return metrics().event_queue_events.labels(
+            metric_labels("subscriber", "test_export", "result", result));
+    };
+    uint64_t delivered = counter("delivered").value();
+    uint64_t dropped = counter("dropped").value();
+
+    publish_chunk(bus, "s", "1");
+    REQUIRE(gate.wait_seen(1));
+    publish_chunk(bus, "s", "2");
+    publish_chunk(bus, "s", "3");  // drops "2"
+    REQUIRE(depth.value() == 1);
+    REQUIRE(counter("dropped").value() == dropped + 1);
+
+    gate.release();
+    REQUIRE(gate.wait_seen(2));
+    bus.clear();  // waits for the worker, so the counts are final
+    REQUIRE(depth.value() == 0);
+    REQUIRE(counter("delivered").value() == delivered + 2);
+}
+
+// ── Benchmark (hidden; run with `make bench`) ───────────────────
+
+TEST_CASE("EventBus: publish throughput", "[.][bench]") {
+    EventBus bus;
+    uint64_t sink = 0;
+    for (int i = 0; i < 3; i++) {
+        subscribe<StreamChunkEvent>(bus, [&](const StreamChunkEvent& ev) {
+            sink += ev.delta.size();
+        });
+    }
+    StreamChunkEvent ev;
+    ev.session_id = "bench";
+    ev.delta = "token";
+
+    constexpr int kIterations = 5'000'000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) bus.publish(ev);
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "EventBus publish (3 subscribers): "
+              << static_cast<uint64_t>(kIterations / elapsed) << " events/s, "
+              << (elapsed * 1e9 / kIterations) << " ns/event\n";
+    REQUIRE(sink == uint64_t{kIterations} * 3 * ev.delta.size());
+}
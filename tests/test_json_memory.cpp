@@ -53,6 +53,27 @@ TEST_CASE("JsonMemory: upsert on same key", "[json_memory]") {
     REQUIRE(f.mem.count(std::nullopt) == 1);
 }
 
+TEST_CASE("JsonMemory: generation changes on writes, not reads", "[json_memory]") {
+    JsonMemoryFixture f;
+    f.mem.store("language", "Python", MemoryCategory::Knowledge, "");
+    f.mem.store("editor", "Vim", MemoryCategory::Knowledge, "");
+    auto gen = f.mem.generation();
+
+    f.mem.recall("Python", 5, std::nullopt);
+    f.mem.get("language");
+    REQUIRE(f.mem.generation() == gen);
+
+    // Upsert keeps the count but changes the content
+    f.mem.store("language", "Rust", MemoryCategory::Knowledge, "");
+    REQUIRE(f.mem.generation() != gen);
+    gen = f.mem.generation();
+    REQUIRE(f.mem.link("language", "editor"));
+    REQUIRE(f.mem.generation() != gen);
+    gen = f.mem.generation();
+    REQUIRE(f.mem.forget("editor"));
+    REQUIRE(f.mem.generation() != gen);
+}
+
 // ── Recall ───────────────────────────────────────────────────
 
 TEST_CASE("JsonMemory: recall finds matching entries", "[json_memory]") {
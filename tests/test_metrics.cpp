@@ -0,0 +1,130 @@
+#include <catch2/catch_test_macros.hpp>
+#include "metrics.hpp"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace ptrclaw;
+
+static bool contains(const std::string& haystack, const std::string& needle) {
+    return haystack.find(needle) != std::string::npos;
+}
+
+// ── Metric types ────────────────────────────────────────────────
+
+TEST_CASE("Metrics: counter renders with HELP and TYPE", "[metrics]") {
+    MetricsRegistry registry;
+    auto& requests = registry.counter("test_requests_total", "Requests served");
+    requests.unlabeled().inc();
+    requests.unlabeled().inc(4);
+
+    auto text = registry.render();
+    REQUIRE(contains(text, "# HELP test_requests_total Requests served\n"));
+    REQUIRE(contains(text, "# TYPE test_requests_total counter\n"));
+    REQUIRE(contains(text, "test_requests_total 5\n"));
+}
+
+TEST_CASE("Metrics: labelled children are distinct and escaped", "[metrics]") {
+    MetricsRegistry registry;
+    auto& tokens = registry.counter("test_tokens_total", "Tokens");
+    tokens.labels(metric_labels("model", "m1", "direction", "in")).inc(10);
+    tokens.labels(metric_labels("model", "m1", "direction", "out")).inc(3);
+    tokens.labels(metric_labels("model", "m1", "direction", "in")).inc(5);
+    tokens.labels(metric_label("model", "a\"b\\c")).inc();
+
+    auto text = registry.render();
+    REQUIRE(contains(text, "test_tokens_total{model=\"m1\",direction=\"in\"} 15\n"));
+    REQUIRE(contains(text, "test_tokens_total{model=\"m1\",direction=\"out\"} 3\n"));
+    REQUIRE(contains(text, "test_tokens_total{model=\"a\\\"b\\\\c\"} 1\n"));
+}
+
+TEST_CASE("Metrics: gauge goes up and down", "[metrics]") {
+    MetricsRegistry registry;
+    auto& depth = registry.gauge("test_depth", "Depth");
+    depth.unlabeled().add(3);
+    depth.unlabeled().add(-1);
+    REQUIRE(depth.unlabeled().value() == 2);
+    REQUIRE(contains(registry.render(), "# TYPE test_depth gauge\ntest_depth 2\n"));
+}
+
+TEST_CASE("Metrics: histogram buckets are cumulative", "[metrics]") {
+    MetricsRegistry registry;
+    auto& latency = registry.histogram("test_seconds", "Latency", {0.1, 1});
+    auto& h = latency.labels(metric_label("tool", "shell"));
+    h.observe(0.05);
+    h.observe(0.5);
+    h.observe(0.5);
+    h.observe(7);
+
+    REQUIRE(h.count() == 4);
+    REQUIRE(h.sum() == 8.05);
+
+    auto text = registry.render();
+    REQUIRE(contains(text, "# TYPE test_seconds histogram\n"));
+    REQUIRE(contains(text, "test_seconds_bucket{tool=\"shell\",le=\"0.1\"} 1\n"));
+    REQUIRE(contains(text, "test_seconds_bucket{tool=\"shell\",le=\"1\"} 3\n"));
+    REQUIRE(contains(text, "test_seconds_bucket{tool=\"shell\",le=\"+Inf\"} 4\n"));
+    REQUIRE(contains(text, "test_seconds_count{tool=\"shell\"} 4\n"));
+}
+
+TEST_CASE("Metrics: label sets beyond the table share an overflow child", "[metrics]") {
+    MetricsRegistry registry;
+    auto& family = registry.counter("test_wide_total", "Wide");
+    for (size_t i = 0; i < MetricFamily<Counter>::kSlots + 5; i++) {
+        family.labels(metric_label("id", std::to_string(i))).inc();
+    }
+    auto text = registry.render();
+    REQUIRE(contains(text, "test_wide_total{overflow=\"true\"} 5\n"));
+}
+
+TEST_CASE("Metrics: concurrent updates are not lost", "[metrics]") {
+    MetricsRegistry registry;
+    auto& family = registry.counter("test_concurrent_total", "Concurrent");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&family, t] {
+            for (int i = 0; i < 10000; i++) {
+                // Every thread races to create the same two children
+                family.labels(metric_label("parity", (i + t) % 2 ? "odd" : "even")).inc();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    uint64_t total = family.labels(metric_label("parity", "odd")).value() +
+                     family.labels(metric_label("parity", "even")).value();
+    REQUIRE(total == 40000);
+}
+
+TEST_CASE("Metrics: ScopedTimer observes elapsed time", "[metrics]") {
+    MetricsRegistry registry;
+    auto& h = registry.histogram("test_timer_seconds", "Timer", {0.001, 10}).unlabeled();
+    {
+        ScopedTimer timer(h);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    REQUIRE(h.count() == 1);
+    REQUIRE(h.sum() >= 0.002);
+    REQUIRE(h.bucket(0) == 0);
+}
+
+TEST_CASE("Metrics: process-wide families are registered", "[metrics]") {
+    auto text = metrics().registry.render();
+    REQUIRE(contains(text, "# TYPE ptrclaw_turn_seconds histogram"));
+    REQUIRE(contains(text, "# TYPE ptrclaw_provider_tokens_total counter"));
+    REQUIRE(contains(text, "# TYPE ptrclaw_sessions_resident gauge"));
+    REQUIRE(contains(text, "# TYPE ptrclaw_memory_recall_seconds histogram"));
+}
+
+// ── Benchmark ───────────────────────────────────────────────────
+
+TEST_CASE("Metrics: counter increment cost", "[.][bench]") {
+    auto& counter = metrics().stream_chunks.unlabeled();
+    constexpr int kIterations = 10'000'000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) counter.inc();
+    auto ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count();
+    WARN("counter inc: " << ns / kIterations << " ns/op");
+    REQUIRE(counter.value() >= static_cast<uint64_t>(kIterations));
+}
@@ -90,6 +90,25 @@ TEST_CASE("filter_tool_output: respects max_total_chars", "[output_filter]") {
     REQUIRE(result.find("truncated") != std::string::npos);
 }
 
+// ── filter_config_for_tokens ────────────────────────────────────
+
+TEST_CASE("filter_config_for_tokens: scales limits with the budget", "[output_filter]") {
+    OutputFilterConfig defaults;
+    auto standard = filter_config_for_tokens(5000);
+    REQUIRE(standard.max_total_chars == defaults.max_total_chars);
+    REQUIRE(standard.max_lines == defaults.max_lines);
+
+    auto large = filter_config_for_tokens(20000);
+    REQUIRE(large.max_total_chars == 80000);
+    REQUIRE(large.max_lines == 800);
+
+    auto tiny = filter_config_for_tokens(100);
+    REQUIRE(tiny.max_total_chars == 400);
+    REQUIRE(tiny.max_lines == 20);
+
+    REQUIRE(filter_config_for_tokens(UINT32_MAX).max_total_chars == UINT32_MAX);
+}
+
 // ── filter_tool_output: config overrides ────────────────────────
 
 TEST_CASE("filter_tool_output: strip_ansi=false preserves codes", "[output_filter]") {
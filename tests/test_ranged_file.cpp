@@ -0,0 +1,164 @@
+#include <catch2/catch_test_macros.hpp>
+#include "ranged_file.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace ptrclaw;
+
+namespace {
+
+// Temp file removed at the end of the test
+struct TempFile {
+    std::string path = "/tmp/ptrclaw_test_ranged_" + std::to_string(getpid()) + "_" +
+                       std::to_string(counter++);
+    static inline int counter = 0;
+    explicit TempFile(const std::string& content) { write(content); }
+    ~TempFile() { std::remove(path.c_str()); }
+    void write(const std::string& content) const {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    }
+};
+
+// Lines of random length, some empty, some past a scan block
+std::string random_lines(std::mt19937& rng, size_t count, bool trailing_newline) {
+    std::string text;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = rng() % 8 == 0 ? 0 : rng() % 60;
+        if (rng() % 500 == 0) len = 70000;
+        text += std::string(len, static_cast<char>('a' + i % 26));
+        if (i + 1 < count || trailing_newline) text += '\n';
+    }
+    return text;
+}
+
+std::vector<uint64_t> ref_line_starts(const std::string& text) {
+    std::vector<uint64_t> starts;
+    if (text.empty()) return starts;
+    starts.push_back(0);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n' && i + 1 < text.size()) starts.push_back(i + 1);
+    }
+    return starts;
+}
+
+} // namespace
+
+TEST_CASE("RangedFile: reads ranges and stops at the end", "[ranged_file]") {
+    TempFile tmp("0123456789");
+    RangedFile file;
+    REQUIRE(file.open(tmp.path));
+    REQUIRE(file.size() == 10);
+
+    std::string out;
+    REQUIRE(file.read(2, 3, out));
+    REQUIRE(out == "234");
+    REQUIRE(file.read(8, 100, out));
+    REQUIRE(out == "23489");
+    REQUIRE(file.read(10, 5, out));
+    REQUIRE(out == "23489");
+}
+
+TEST_CASE("RangedFile: files without a size are buffered", "[ranged_file]") {
+    RangedFile file;
+    REQUIRE(file.open("/proc/self/status"));
+    REQUIRE(file.size() > 0);
+    std::string out;
+    REQUIRE(file.read(0, 5, out));
+    REQUIRE(out == "Name:");
+}
+
+TEST_CASE("RangedFile: directories and missing files do not open", "[ranged_file]") {
+    RangedFile dir;
+    REQUIRE_FALSE(dir.open("/tmp"));
+    RangedFile missing;
+    REQUIRE_FALSE(missing.open("/tmp/ptrclaw_test_no_such_file_ever.txt"));
+}
+
+TEST_CASE("LineIndex: matches a naive scan", "[ranged_file]") {
+    std::mt19937 rng(3);
+    for (size_t count : {0, 1, 2, 1023, 1024, 1025, 5000}) {
+        for (bool trailing : {true, false}) {
+            std::string text = random_lines(rng, count, trailing);
+            TempFile tmp(text);
+            RangedFile file;
+            REQUIRE(file.open(tmp.path));
+            LineIndex index(file);
+
+            auto starts = ref_line_starts(text);
+            INFO("lines: " << count << ", trailing newline: " << trailing);
+            REQUIRE(index.line_count() == starts.size());
+            for (uint64_t line = 0; line < starts.size(); line++) {
+                REQUIRE(index.line_start(file, line) == starts[line]);
+            }
+            REQUIRE(index.line_start(file, starts.size()) == text.size());
+
+            uint64_t line = 0;
+            for (uint64_t offset = 0; offset < text.size(); offset += 1 + rng() % 97) {
+                while (line + 1 < starts.size() && starts[line + 1] <= offset) line++;
+                REQUIRE(index.line_at(file, offset) == line);
+            }
+        }
+    }
+}
+
+TEST_CASE("line_index_for: reuses the index of an unchanged large file", "[ranged_file]") {
+    std::string text;
+    while (text.size() < kCachedIndexBytes) text += "a line of some length\n";
+    TempFile tmp(text);
+
+    RangedFile first;
+    REQUIRE(first.open(tmp.path));
+    auto index = line_index_for(first, tmp.path);
+    RangedFile again;
+    REQUIRE(again.open(tmp.path));
+    REQUIRE(line_index_for(again, tmp.path) == index);
+
+    tmp.write(text + "one more\n");
+    RangedFile changed;
+    REQUIRE(changed.open(tmp.path));
+    auto rebuilt = line_index_for(changed, tmp.path);
+    REQUIRE(rebuilt != index);
+    REQUIRE(rebuilt->line_count() == index->line_count() + 1);
+}
+
+// ── Benchmark (hidden; run with `make bench`) ───────────────────
+
+TEST_CASE("LineIndex: build and range throughput", "[.][bench]") {
+    std::mt19937 rng(11);
+    std::string text;
+    while (text.size() < (256u << 20)) {
+        text += "2024-01-01T00:00:00Z worker " + std::to_string(rng() % 1000) +
+                " handled request " + std::to_string(rng()) + "\n";
+    }
+    TempFile tmp(text);
+    RangedFile file;
+    REQUIRE(file.open(tmp.path));
+
+    auto start = std::chrono::steady_clock::now();
+    LineIndex index(file);
+    auto build = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    constexpr int kReads = 1000;
+    size_t sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kReads; i++) {
+        uint64_t first = rng() % index.line_count();
+        uint64_t begin = index.line_start(file, first);
+        uint64_t end = index.line_start(file, first + 100);
+        std::string out;
+        file.read(begin, static_cast<size_t>(end - begin), out);
+        sink += out.size();
+    }
+    auto reads = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "index build: " << static_cast<uint64_t>(text.size() / build / (1 << 20))
+              << " MiB/s, 100-line range read: " << static_cast<uint64_t>(reads / kReads * 1e6)
+              << " us\n";
+    REQUIRE(sink > 0);
+}
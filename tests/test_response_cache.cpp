@@ -1,6 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include "memory/response_cache.hpp"
 #include <filesystem>
+#include <fstream>
 #include <thread>
 #include <chrono>
 #include <unistd.h>
@@ -139,3 +140,261 @@ TEST_CASE("ResponseCache: persists across instances", "[cache]") {
 
     std::filesystem::remove(path);
 }
+
+// ── Semantic layer ───────────────────────────────────────────
+
+namespace {
+
+// "weather" questions point one way, "recipe" questions another;
+// "rain" tilts a weather question away from the pure weather direction
+class KeywordEmbedder : public Embedder {
+public:
+    Embedding embed(const std::string& text) override {
+        calls++;
+        Embedding e(3, 0.0f);
+        if (text.find("weather") != std::string::npos) e[0] = 1.0f;
+        if (text.find("rain") != std::string::npos) e[1] = 0.5f;
+        if (text.find("recipe") != std::string::npos) e[2] = 1.0f;
+        return e;
+    }
+    uint32_t dimensions() const override { return 3; }
+    std::string embedder_name() const override { return "keyword"; }
+
+    int calls = 0;
+};
+
+} // namespace
+
+TEST_CASE("ResponseCache: semantic hit for a paraphrase", "[cache]") {
+    CacheFixture f;
+    KeywordEmbedder embedder;
+    f.cache.set_embedder(&embedder);
+
+    f.cache.put("m", "sys", "what's the weather like", "sunny");
+    auto result = f.cache.get("m", "sys", "how is the weather");
+    REQUIRE(result.value_or("") == "sunny");
+
+    REQUIRE_FALSE(f.cache.get("m", "sys", "a soup recipe").has_value());
+}
+
+TEST_CASE("ResponseCache: semantic hits stay within model and system prompt", "[cache]") {
+    CacheFixture f;
+    KeywordEmbedder embedder;
+    f.cache.set_embedder(&embedder);
+
+    f.cache.put("m", "sys", "what's the weather like", "sunny");
+    REQUIRE_FALSE(f.cache.get("m", "other sys", "how is the weather").has_value());
+    REQUIRE_FALSE(f.cache.get("m2", "sys", "how is the weather").has_value());
+}
+
+TEST_CASE("ResponseCache: near hit below threshold misses", "[cache]") {
+    CacheFixture f;
+    KeywordEmbedder embedder;
+    SemanticCacheOptions options;
+    options.threshold = 0.95;
+    options.near_hit = 0.5;
+    f.cache.set_embedder(&embedder, options);
+
+    f.cache.put("m", "sys", "weather", "sunny");
+    // cos = 1/sqrt(1.25) ~ 0.89: logged as a near hit, not served
+    REQUIRE_FALSE(f.cache.get("m", "sys", "weather with rain").has_value());
+}
+
+TEST_CASE("ResponseCache: semantic query ignores extra context", "[cache]") {
+    CacheFixture f;
+    KeywordEmbedder embedder;
+    f.cache.set_embedder(&embedder);
+
+    f.cache.put("m", "sys", "[ctx: recipe]\nweather?", "sunny", "weather?");
+    REQUIRE(f.cache.get("m", "sys", "[ctx: none]\nthe weather", "the weather").has_value());
+}
+
+TEST_CASE("ResponseCache: put reuses the embedding from a missed get", "[cache]") {
+    CacheFixture f;
+    KeywordEmbedder embedder;
+    f.cache.set_embedder(&embedder);
+
+    REQUIRE_FALSE(f.cache.get("m", "sys", "weather").has_value());
+    REQUIRE(embedder.calls == 1);
+    f.cache.put("m", "sys", "weather", "sunny");
+    REQUIRE(embedder.calls == 1);
+}
+
+TEST_CASE("ResponseCache: semantic index persists", "[cache]") {
+    std::string path = cache_test_path() + "_semantic";
+    KeywordEmbedder embedder;
+    {
+        ResponseCache cache(path, 3600, 100);
+        cache.set_embedder(&embedder);
+        cache.put("m", "s", "what's the weather like", "sunny");
+    }
+    {
+        ResponseCache cache(path, 3600, 100);
+        cache.set_embedder(&embedder);
+        REQUIRE(cache.get("m", "s", "how is the weather").value_or("") == "sunny");
+    }
+    std::filesystem::remove(path);
+}
+
+// ── Categories ───────────────────────────────────────────────
+
+TEST_CASE("ResponseCache: cache_category spots time-sensitive questions", "[cache]") {
+    REQUIRE(cache_category("What's the Weather in Oslo?") == "realtime");
+    REQUIRE(cache_category("latest news please") == "realtime");
+    REQUIRE(cache_category("explain RAII") == "default");
+}
+
+TEST_CASE("ResponseCache: per-category TTL", "[cache]") {
+    std::string path = cache_test_path() + "_category";
+    ResponseCache cache(path, 3600, 100);
+    cache.set_category_ttl("realtime", 1);
+
+    cache.put("m", "s", "weather today", "sunny");
+    cache.put("m", "s", "explain RAII", "scopes");
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    REQUIRE_FALSE(cache.get("m", "s", "weather today").has_value());
+    REQUIRE(cache.get("m", "s", "explain RAII").has_value());
+    std::filesystem::remove(path);
+}
+
+// ── Sharing, LRU and the append-only log ─────────────────────
+
+static size_t count_lines(const std::string& path) {
+    std::ifstream f(path);
+    size_t n = 0;
+    std::string line;
+    while (std::getline(f, line)) n++;
+    return n;
+}
+
+TEST_CASE("ResponseCache: evicts the least recently used entry", "[cache]") {
+    std::string path = cache_test_path() + "_exact_lru";
+    {
+        ResponseCache cache(path, 3600, 3);
+        cache.put("m", "s", "q1", "r1");
+        cache.put("m", "s", "q2", "r2");
+        cache.put("m", "s", "q3", "r3");
+        REQUIRE(cache.get("m", "s", "q1").has_value()); // q2 is now the LRU
+
+        cache.put("m", "s", "q4", "r4");
+        REQUIRE(cache.size() == 3);
+        REQUIRE_FALSE(cache.get("m", "s", "q2").has_value());
+        REQUIRE(cache.get("m", "s", "q1").has_value());
+        REQUIRE(cache.get("m", "s", "q3").has_value());
+        REQUIRE(cache.get("m", "s", "q4").has_value());
+    }
+    {
+        // The eviction was logged, so it stays evicted after a reload
+        ResponseCache cache(path, 3600, 3);
+        REQUIRE(cache.size() == 3);
+        REQUIRE_FALSE(cache.get("m", "s", "q2").has_value());
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("ResponseCache: put appends one log line", "[cache]") {
+    CacheFixture f;
+    f.cache.put("m", "s", "q1", "r1");
+    f.cache.put("m", "s", "q2", "r2");
+    f.cache.put("m", "s", "q1", "r1b");
+    REQUIRE(f.cache.log_lines() == 3);
+    REQUIRE(count_lines(f.path) == 3);
+
+    ResponseCache reloaded(f.path, 3600, 100);
+    REQUIRE(reloaded.size() == 2);
+    REQUIRE(reloaded.get("m", "s", "q1").value_or("") == "r1b");
+}
+
+TEST_CASE("ResponseCache: log is compacted to live entries", "[cache]") {
+    std::string path = cache_test_path() + "_compact";
+    {
+        ResponseCache cache(path, 3600, 4);
+        for (int i = 0; i < 200; i++) {
+            cache.put("m", "s", "q" + std::to_string(i), "r" + std::to_string(i));
+        }
+        REQUIRE(cache.size() == 4);
+        REQUIRE(cache.log_lines() <= 65);
+    }
+    ResponseCache reloaded(path, 3600, 4);
+    REQUIRE(reloaded.size() == 4);
+    REQUIRE(reloaded.get("m", "s", "q199").value_or("") == "r199");
+    REQUIRE_FALSE(reloaded.get("m", "s", "q100").has_value());
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("ResponseCache: migrates a legacy JSON array file", "[cache]") {
+    std::string path = cache_test_path() + "_legacy";
+    {
+        ResponseCache cache(path, 3600, 100);
+        cache.put("m", "s", "q", "r");
+    }
+    // Rewrite what was logged as the old single-array format
+    std::string line;
+    {
+        std::ifstream f(path);
+        std::getline(f, line);
+    }
+    {
+        std::ofstream f(path, std::ios::trunc);
+        f << "[\n" << line << "\n]\n";
+    }
+
+    ResponseCache cache(path, 3600, 100);
+    REQUIRE(cache.get("m", "s", "q").value_or("") == "r");
+    std::ifstream f(path);
+    REQUIRE(f.peek() == '{');
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("ResponseCache: skips a torn trailing log line", "[cache]") {
+    CacheFixture f;
+    f.cache.put("m", "s", "q", "r");
+    {
+        std::ofstream out(f.path, std::ios::app);
+        out << "{\"key_hash\": 12, \"resp";
+    }
+    ResponseCache reloaded(f.path, 3600, 100);
+    REQUIRE(reloaded.size() == 1);
+    REQUIRE(reloaded.get("m", "s", "q").has_value());
+}
+
+TEST_CASE("ResponseCache: shared() returns one instance per path", "[cache]") {
+    std::string path = cache_test_path() + "_shared";
+    auto a = ResponseCache::shared(path, 3600, 100);
+    auto b = ResponseCache::shared(path, 60, 1);
+    auto c = ResponseCache::shared(path + "_other", 3600, 100);
+    REQUIRE(a == b);
+    REQUIRE(a != c);
+
+    a->put("m", "s", "q", "r");
+    REQUIRE(b->get("m", "s", "q").has_value());
+
+    a.reset();
+    b.reset();
+    c.reset();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + "_other");
+}
+
+TEST_CASE("ResponseCache: concurrent sessions stay within capacity", "[cache]") {
+    std::string path = cache_test_path() + "_concurrent";
+    {
+        ResponseCache cache(path, 3600, 50);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; t++) {
+            threads.emplace_back([&cache, t] {
+                for (int i = 0; i < 100; i++) {
+                    std::string q = "t" + std::to_string(t) + "q" + std::to_string(i);
+                    cache.put("m", "s", q, "r");
+                    cache.get("m", "s", q);
+                }
+            });
+        }
+        for (auto& th : threads) th.join();
+        REQUIRE(cache.size() == 50);
+    }
+    ResponseCache reloaded(path, 3600, 50);
+    REQUIRE(reloaded.size() == 50);
+    std::filesystem::remove(path);
+}
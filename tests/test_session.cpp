@@ -1,7 +1,17 @@
 #include <catch2/catch_test_macros.hpp>
 #include "mock_http_client.hpp"
+#include "test_helpers.hpp"
 #include "session.hpp"
 #include "plugin.hpp"
+#include "event.hpp"
+#include "event_bus.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 
 using namespace ptrclaw;
 
@@ -82,3 +92,413 @@ TEST_CASE("SessionManager: evict_idle keeps recent sessions", "[session]") {
     mgr.evict_idle(999999);
     REQUIRE(mgr.list_sessions().size() == 1);
 }
+
+TEST_CASE("SessionManager: concurrent first access builds one session", "[session]") {
+    auto cfg = make_test_config();
+    EventBus bus;
+    SessionManager mgr(cfg, test_http);
+    mgr.set_event_bus(&bus);
+
+    std::atomic<int> created{0};
+    subscribe<SessionCreatedEvent>(bus, [&](const SessionCreatedEvent&) {
+        created++;
+    });
+
+    std::vector<Agent*> agents(8, nullptr);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < agents.size(); i++) {
+        threads.emplace_back([&, i] { agents[i] = &mgr.get_session("same"); });
+    }
+    for (auto& t : threads) t.join();
+
+    REQUIRE(created.load() == 1);
+    for (auto* a : agents) REQUIRE(a == agents[0]);
+    REQUIRE(mgr.list_sessions().size() == 1);
+}
+
+TEST_CASE("SessionManager: sessions spread across shards are all listed", "[session]") {
+    auto cfg = make_test_config();
+    SessionManager mgr(cfg, test_http);
+    for (int i = 0; i < 40; i++) mgr.get_session("user" + std::to_string(i));
+    REQUIRE(mgr.list_sessions().size() == 40);
+    mgr.remove_session("user7");
+    REQUIRE(mgr.list_sessions().size() == 39);
+}
+
+// ── Hibernation ─────────────────────────────────────────────────
+
+static nlohmann::json make_snapshot() {
+    return {
+        {"provider", "anthropic"},
+        {"model", "claude-sonnet-4-6"},
+        {"history", {
+            {{"role", "user"}, {"content", "remember me"}},
+            {{"role", "assistant"}, {"content", "sure"}}
+        }}
+    };
+}
+
+TEST_CASE("SessionManager: snapshot_path sanitizes session IDs", "[session]") {
+    auto cfg = make_test_config();
+    cfg.sessions.hibernate_dir = "/tmp/ptrclaw_sessions";
+    SessionManager mgr(cfg, test_http);
+    REQUIRE(mgr.snapshot_path("12345") == "/tmp/ptrclaw_sessions/12345.json");
+    REQUIRE(mgr.snapshot_path("+358 40/..") ==
+            "/tmp/ptrclaw_sessions/%2b358%2040%2f...json");
+    REQUIRE(mgr.snapshot_path("..") == "/tmp/ptrclaw_sessions/%...json");
+}
+
+TEST_CASE("SessionManager: resident cap hibernates least recently active", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.sessions.max_resident = 1;
+    SessionManager mgr(cfg, test_http);
+
+    mgr.get_session("a").restore(make_snapshot());
+    mgr.get_session("b");
+
+    auto sessions = mgr.list_sessions();
+    REQUIRE(sessions.size() == 1);
+    REQUIRE(sessions[0] == "b");
+    REQUIRE(std::filesystem::exists(mgr.snapshot_path("a")));
+}
+
+TEST_CASE("SessionManager: hibernated session rehydrates on next access", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.sessions.max_resident = 1;
+    SessionManager mgr(cfg, test_http);
+
+    mgr.get_session("a").restore(make_snapshot());
+    mgr.get_session("b");
+
+    Agent& a = mgr.get_session("a");
+    REQUIRE(a.history_size() == 2);
+    REQUIRE_FALSE(std::filesystem::exists(mgr.snapshot_path("a")));
+    // "b" had no history, so nothing was written for it
+    REQUIRE_FALSE(std::filesystem::exists(mgr.snapshot_path("b")));
+}
+
+TEST_CASE("SessionManager: eviction writes and publishes outside the shard lock",
+          "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.sessions.max_resident = 1;
+    EventBus bus;
+    SessionManager mgr(cfg, test_http);
+    mgr.set_event_bus(&bus);
+
+    // A subscriber that looks sessions up would deadlock on the shard lock
+    std::vector<std::string> resident;
+    bool snapshot_written = false;
+    subscribe<SessionEvictedEvent>(bus,
+        std::function<void(const SessionEvictedEvent&)>(
+            [&](const SessionEvictedEvent& ev) {
+                resident = mgr.list_sessions();
+                snapshot_written = std::filesystem::exists(mgr.snapshot_path(ev.session_id));
+            }));
+
+    mgr.get_session("a").restore(make_snapshot());
+    mgr.get_session("b");
+    REQUIRE(resident == std::vector<std::string>{"b"});
+    REQUIRE(snapshot_written);
+    REQUIRE(mgr.get_session("a").history_size() == 2);
+}
+
+TEST_CASE("SessionManager: hibernate disabled drops evicted sessions", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.sessions.max_resident = 1;
+    cfg.sessions.hibernate = false;
+    SessionManager mgr(cfg, test_http);
+
+    mgr.get_session("a").restore(make_snapshot());
+    mgr.get_session("b");
+
+    REQUIRE_FALSE(std::filesystem::exists(mgr.snapshot_path("a")));
+    REQUIRE(mgr.get_session("a").history_size() == 0);
+}
+
+TEST_CASE("SessionManager: remove_session discards snapshot", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.sessions.max_resident = 1;
+    SessionManager mgr(cfg, test_http);
+
+    mgr.get_session("a").restore(make_snapshot());
+    mgr.get_session("b");
+    REQUIRE(std::filesystem::exists(mgr.snapshot_path("a")));
+
+    mgr.remove_session("a");
+    REQUIRE_FALSE(std::filesystem::exists(mgr.snapshot_path("a")));
+}
+
+// ── Eviction index ──────────────────────────────────────────────
+
+TEST_CASE("SessionManager: idle eviction skips recently touched sessions", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    SessionManager mgr(cfg, test_http);
+    mgr.get_session("a").restore(make_snapshot());
+    mgr.get_session("b");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    mgr.get_session("b");
+    mgr.evict_idle(1);
+
+    auto sessions = mgr.list_sessions();
+    REQUIRE(sessions.size() == 1);
+    REQUIRE(sessions[0] == "b");
+    REQUIRE(std::filesystem::exists(mgr.snapshot_path("a")));
+
+    // Wheel rescheduled "b": a later pass with a long timeout keeps it
+    mgr.evict_idle(3600);
+    REQUIRE(mgr.list_sessions().size() == 1);
+}
+
+namespace {
+std::atomic<uint64_t> clock_skew{0};
+uint64_t skewed_clock() { return epoch_seconds() + clock_skew.load(); }
+} // namespace
+
+TEST_CASE("SessionManager: idle eviction keeps later laps of a wheel bucket", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    SessionManager mgr(cfg, test_http);
+    clock_skew = 0;
+    mgr.set_clock(skewed_clock);
+    mgr.get_session("a");
+    mgr.evict_idle(10);
+
+    // "b" is due one full lap after "a", in the same bucket
+    clock_skew = 512;
+    mgr.get_session("b");
+    mgr.evict_idle(10);
+    auto sessions = mgr.list_sessions();
+    REQUIRE(sessions.size() == 1);
+    REQUIRE(sessions[0] == "b");
+
+    // Evicting "a" must not have dropped "b" from the bucket
+    clock_skew = 512 + 12;
+    mgr.evict_idle(10);
+    REQUIRE(mgr.list_sessions().empty());
+}
+
+TEST_CASE("SessionManager: memory budget hibernates least recently active", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.sessions.memory_budget_bytes = 1000;
+    SessionManager mgr(cfg, test_http);
+
+    // Pre-existing snapshot with a large history is counted on rehydrate
+    auto snap = make_snapshot();
+    snap["history"][0]["content"] = std::string(2000, 'x');
+    {
+        std::filesystem::create_directories(
+            std::filesystem::path(mgr.snapshot_path("a")).parent_path());
+        std::ofstream f(mgr.snapshot_path("a"));
+        f << snap.dump();
+    }
+    REQUIRE(mgr.get_session("a").history_size() == 2);
+    REQUIRE(mgr.history_bytes() > 2000);
+    // The session being accessed is never its own victim
+    REQUIRE(mgr.list_sessions().size() == 1);
+
+    mgr.get_session("b");
+    auto sessions = mgr.list_sessions();
+    REQUIRE(sessions.size() == 1);
+    REQUIRE(sessions[0] == "b");
+    REQUIRE(mgr.history_bytes() == 0);
+    REQUIRE(std::filesystem::exists(mgr.snapshot_path("a")));
+}
+
+// ── Worker dispatch and /stop ───────────────────────────────────
+
+// HTTP client that blocks until the calling thread's abort flag is raised,
+// emulating an in-flight provider request.
+class BlockingHttpClient : public HttpClient {
+public:
+    std::atomic<int> started{0};
+    HttpResponse post(const std::string&, const std::string&,
+                      const std::vector<Header>&, long) override {
+        started++;
+        const auto* flag = http_thread_abort_flag();
+        while (!(flag && flag->load())) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return {0, ""};
+    }
+};
+
+struct ReplyCollector {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::string> replies;
+
+    explicit ReplyCollector(EventBus& bus) {
+        subscribe<MessageReadyEvent>(bus, [this](const MessageReadyEvent& ev) {
+            std::lock_guard<std::mutex> lock(mutex);
+            replies.push_back(ev.content);
+            cv.notify_all();
+        });
+    }
+
+    bool wait_for(size_t n) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(5),
+                           [&] { return replies.size() >= n; });
+    }
+};
+
+static void publish_message(EventBus& bus, const std::string& session,
+                            const std::string& content) {
+    MessageReceivedEvent ev;
+    ev.session_id = session;
+    ev.message.sender = session;
+    ev.message.content = content;
+    bus.publish(ev);
+}
+
+TEST_CASE("SessionManager: workers run messages off the publishing thread", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    EventBus bus;
+    ReplyCollector replies(bus);
+    SessionManager mgr(cfg, test_http);
+    mgr.set_event_bus(&bus);
+    mgr.subscribe_events();
+    mgr.start_workers(2);
+
+    publish_message(bus, "w1", "/stop");
+    REQUIRE(replies.wait_for(1));
+    REQUIRE(replies.replies[0] == "Nothing to stop.");
+
+    publish_message(bus, "w1", "/new");
+    REQUIRE(replies.wait_for(2));
+    mgr.stop_workers();
+}
+
+TEST_CASE("SessionManager: /stop aborts an in-flight provider call", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.agent.disable_streaming = true;
+    BlockingHttpClient http;
+    EventBus bus;
+    ReplyCollector replies(bus);
+    SessionManager mgr(cfg, http);
+    mgr.set_event_bus(&bus);
+    mgr.subscribe_events();
+    mgr.start_workers(1);
+
+    publish_message(bus, "s", "hello");
+    for (int i = 0; i < 500 && http.started.load() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(http.started.load() == 1);
+
+    publish_message(bus, "s", "/stop");
+    REQUIRE(replies.wait_for(1));
+    REQUIRE(replies.replies[0] == Agent::kStoppedReply);
+    mgr.stop_workers();
+}
+
+TEST_CASE("SessionManager: interrupt mode cancels turn on new message", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.agent.disable_streaming = true;
+    cfg.agent.interrupt = true;
+    BlockingHttpClient http;
+    EventBus bus;
+    ReplyCollector replies(bus);
+    SessionManager mgr(cfg, http);
+    mgr.set_event_bus(&bus);
+    mgr.subscribe_events();
+    mgr.start_workers(1);
+
+    publish_message(bus, "s", "first");
+    for (int i = 0; i < 500 && http.started.load() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    publish_message(bus, "s", "second");
+    REQUIRE(replies.wait_for(1));
+    REQUIRE(replies.replies[0] == Agent::kStoppedReply);
+    // The second message is now blocked in its own provider call
+    for (int i = 0; i < 500 && http.started.load() < 2; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(http.started.load() == 2);
+    mgr.stop_workers();
+}
+
+TEST_CASE("SessionManager: coalesces a burst of messages into one turn", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.agent.disable_streaming = true;
+    cfg.sessions.coalesce_ms = 200;
+    MockHttpClient http;
+    http.next_response = {200,
+        R"({"model":"claude-sonnet-4-6","content":[{"type":"text","text":"ok"}],"usage":{"input_tokens":10,"output_tokens":2}})"};
+    EventBus bus;
+    ReplyCollector replies(bus);
+    std::vector<uint64_t> turns;
+    subscribe<TurnStartEvent>(bus, [&](const TurnStartEvent& ev) {
+        turns.push_back(ev.turn_id);
+    });
+    uint64_t reply_turn = 0;
+    subscribe<MessageReadyEvent>(bus, [&](const MessageReadyEvent& ev) {
+        reply_turn = ev.turn_id;
+    });
+    SessionManager mgr(cfg, http);
+    mgr.set_event_bus(&bus);
+    mgr.subscribe_events();
+    mgr.start_workers(1);
+
+    publish_message(bus, "s", "part one");
+    publish_message(bus, "s", "part two");
+    publish_message(bus, "s", "part three");
+    REQUIRE(replies.wait_for(1));
+    mgr.stop_workers();
+
+    REQUIRE(replies.replies.size() == 1);
+    REQUIRE(http.call_count == 1);
+    REQUIRE(http.last_body.find("part one\\n\\npart two\\n\\npart three")
+            != std::string::npos);
+    // One turn for the burst; its reply names it
+    REQUIRE(turns.size() == 1);
+    REQUIRE(reply_turn == turns[0]);
+}
+
+TEST_CASE("SessionManager: read-only commands answer during a running turn", "[session]") {
+    HomeGuard home;
+    auto cfg = make_test_config();
+    cfg.agent.disable_streaming = true;
+    BlockingHttpClient http;
+    EventBus bus;
+    ReplyCollector replies(bus);
+    SessionManager mgr(cfg, http);
+    mgr.set_event_bus(&bus);
+    mgr.subscribe_events();
+    mgr.start_workers(1);
+
+    publish_message(bus, "s", "hello");
+    for (int i = 0; i < 500 && http.started.load() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(http.started.load() == 1);
+
+    // Answered on the publishing thread while the turn is still blocked
+    publish_message(bus, "s", "/status");
+    REQUIRE(replies.wait_for(1));
+    REQUIRE(replies.replies[0].find("Provider: anthropic") != std::string::npos);
+    // System prompt + the in-flight user message
+    REQUIRE(replies.replies[0].find("History: 2 messages") != std::string::npos);
+
+    publish_message(bus, "s", "/help");
+    REQUIRE(replies.wait_for(2));
+    REQUIRE(replies.replies[1].find("/stop") != std::string::npos);
+
+    publish_message(bus, "s", "/stop");
+    REQUIRE(replies.wait_for(3));
+    REQUIRE(replies.replies[2] == Agent::kStoppedReply);
+    mgr.stop_workers();
+}
@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 #include "output_filter.hpp"
+#include "shell_logs.hpp"
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -537,6 +538,28 @@ TEST_CASE("smart_truncate: preserves error lines", "[shell_filter]") {
     REQUIRE(result.find("error: undefined reference") != std::string::npos);
 }
 
+TEST_CASE("filter_shell_output: smart truncation fits max_total_chars", "[shell_filter]") {
+    std::string input;
+    for (int i = 0; i < 150; i++) {
+        input += "normal line " + std::to_string(i) + " with some padding text\n";
+    }
+    input += "src/foo.cpp:10: error: undefined reference\n";
+    for (int i = 0; i < 150; i++) {
+        input += "more normal " + std::to_string(i) + " with some padding text\n";
+    }
+    input += "last line\n";
+
+    OutputFilterConfig config;
+    config.max_total_chars = 2000;  // binds well before max_lines
+    std::string result = filter_shell_output("./run.sh", input, config);
+    REQUIRE(result.size() <= 2000);
+    // Head, the error and the tail survive, not just the first 2000 chars
+    REQUIRE(result.find("normal line 0 ") != std::string::npos);
+    REQUIRE(result.find("error: undefined reference") != std::string::npos);
+    REQUIRE(result.find("last line") != std::string::npos);
+    REQUIRE(result.find("lines omitted") != std::string::npos);
+}
+
 // ═══ Diagnostic grouping ════════════════════════════════════════
 
 TEST_CASE("group_diagnostics: groups repeated warnings", "[shell_filter]") {
@@ -1237,3 +1260,16 @@ TEST_CASE("filter_shell_output: grep shortens long paths", "[shell_filter]") {
     REQUIRE(result.find("src/...") != std::string::npos);
     REQUIRE(result.find("12 matches") != std::string::npos);
 }
+
+TEST_CASE("filter_shell_output: dedupe_log_lines matches deduplicating first", "[shell_filter]") {
+    OutputFilterConfig config;
+    config.dedupe_log_lines = true;
+    std::string build = strip_ansi_codes(make_build_log(300));
+    std::string tests = make_test_log(20000);
+    REQUIRE(filter_shell_output("ninja", build, config) ==
+            filter_shell_output("ninja", deduplicate_log_lines(build)));
+    REQUIRE(filter_shell_output("pytest -q", tests, config) ==
+            filter_shell_output("pytest -q", deduplicate_log_lines(tests)));
+    REQUIRE(filter_shell_output("cat app.log", tests, config) ==
+            filter_shell_output("cat app.log", deduplicate_log_lines(tests)));
+}
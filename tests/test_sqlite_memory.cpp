@@ -52,6 +52,25 @@ TEST_CASE("SqliteMemory: upsert on same key", "[sqlite_memory]") {
     REQUIRE(f.mem.count(std::nullopt) == 1);
 }
 
+TEST_CASE("SqliteMemory: generation sees writes from other connections", "[sqlite_memory]") {
+    SqliteFixture f;
+    f.mem.store("language", "Python", MemoryCategory::Knowledge, "");
+    auto gen = f.mem.generation();
+    f.mem.recall("Python", 5, std::nullopt);
+    REQUIRE(f.mem.generation() == gen);
+
+    f.mem.store("language", "Rust", MemoryCategory::Knowledge, "");
+    REQUIRE(f.mem.generation() != gen);
+    gen = f.mem.generation();
+
+    // Another session's instance on the same database
+    {
+        SqliteMemory other(f.path);
+        other.store("language", "Go", MemoryCategory::Knowledge, "");
+    }
+    REQUIRE(f.mem.generation() != gen);
+}
+
 // ── Recall (FTS) ─────────────────────────────────────────────
 
 TEST_CASE("SqliteMemory: recall finds matching entries", "[sqlite_memory]") {
@@ -0,0 +1,276 @@
+#include <catch2/catch_test_macros.hpp>
+#include "stream_relay.hpp"
+#include "event.hpp"
+#include "event_bus.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ptrclaw;
+
+namespace {
+
+// Streaming channel that records what the relay sends. Tool progress
+// reaches it from the relay's progress thread; wait_edits() syncs with it.
+class RecordingChannel : public Channel {
+public:
+    std::vector<std::string> sent;
+    std::atomic<int> typing{0};
+    std::vector<std::pair<int64_t, std::string>> edits;
+    std::atomic<int64_t> next_message_id{100};
+    // While set, edit_message blocks (a slow network call)
+    bool hold_edits = false;
+
+    std::string channel_name() const override { return "recording"; }
+    bool health_check() override { return true; }
+    void send_message(const std::string&, const std::string& message) override {
+        sent.push_back(message);
+    }
+    void send_typing_indicator(const std::string&) override { typing++; }
+    bool supports_streaming_display() const override { return true; }
+    int64_t send_streaming_placeholder(const std::string&) override {
+        return next_message_id++;
+    }
+    void edit_message(const std::string&, int64_t message_id,
+                      const std::string& text) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        held_++;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return !hold_edits; });
+        held_--;
+        edits.emplace_back(message_id, text);
+        cv_.notify_all();
+    }
+
+    void hold() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hold_edits = true;
+    }
+    // Wait for an edit to be parked by hold_edits
+    bool wait_held() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(5), [&] { return held_ > 0; });
+    }
+    void release_edits() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hold_edits = false;
+        cv_.notify_all();
+    }
+    bool wait_edits(size_t n) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(5),
+                            [&] { return edits.size() >= n; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int held_ = 0;
+};
+
+struct Fixture {
+    EventBus bus;
+    RecordingChannel channel;
+    StreamRelay relay{channel, bus};
+    Fixture() { relay.subscribe_events(); }
+
+    void received(const std::string& content) {
+        MessageReceivedEvent ev;
+        ev.session_id = "s";
+        ev.message.content = content;
+        ev.message.reply_target = "chat";
+        bus.publish(ev);
+    }
+    void turn_start(uint64_t turn_id) {
+        TurnStartEvent ev;
+        ev.session_id = "s";
+        ev.reply_target = "chat";
+        ev.turn_id = turn_id;
+        bus.publish(ev);
+    }
+    void stream(const std::string& text) {
+        StreamStartEvent start;
+        start.session_id = "s";
+        bus.publish(start);
+        StreamChunkEvent chunk;
+        chunk.session_id = "s";
+        chunk.delta = text;
+        bus.publish(chunk);
+        StreamEndEvent end;
+        end.session_id = "s";
+        bus.publish(end);
+    }
+    void ready(const std::string& content, uint64_t turn_id) {
+        MessageReadyEvent ev;
+        ev.session_id = "s";
+        ev.reply_target = "chat";
+        ev.content = content;
+        ev.turn_id = turn_id;
+        bus.publish(ev);
+    }
+    void tool_call(const std::string& call_id) {
+        ToolCallRequestEvent ev;
+        ev.session_id = "s";
+        ev.tool_call_id = call_id;
+        ev.tool_name = "shell";
+        bus.publish(ev);
+    }
+    void progress(const std::string& call_id, const std::string& delta) {
+        ToolCallProgressEvent ev;
+        ev.session_id = "s";
+        ev.tool_call_id = call_id;
+        ev.tool_name = "shell";
+        ev.delta = delta;
+        ev.elapsed_ms = 2000;
+        bus.publish(ev);
+    }
+    void tool_result(const std::string& call_id) {
+        ToolCallResultEvent ev;
+        ev.session_id = "s";
+        ev.tool_call_id = call_id;
+        ev.tool_name = "shell";
+        ev.success = true;
+        bus.publish(ev);
+    }
+};
+
+} // namespace
+
+TEST_CASE("StreamRelay: streamed reply is not sent again", "[stream_relay]") {
+    Fixture f;
+    f.received("hi");
+    f.turn_start(1);
+    f.stream("Hello");
+    f.ready("Hello", 1);
+
+    REQUIRE(f.channel.sent.empty());
+    REQUIRE(f.channel.edits.back() == std::make_pair(int64_t{100}, std::string("Hello")));
+}
+
+TEST_CASE("StreamRelay: messages queued mid-turn keep the turn's stream", "[stream_relay]") {
+    Fixture f;
+    f.received("first");
+    f.turn_start(1);
+    f.received("second");  // waits behind turn 1
+    f.ready("status text", 0);  // command reply while the turn runs
+    f.stream("One");
+    f.ready("One", 1);
+    REQUIRE(f.channel.sent == std::vector<std::string>{"status text"});
+
+    // The queued message's turn streams into its own message
+    f.turn_start(2);
+    f.stream("Two");
+    f.ready("Two", 2);
+    REQUIRE(f.channel.sent.size() == 1);
+    REQUIRE(f.channel.edits.back() == std::make_pair(int64_t{101}, std::string("Two")));
+}
+
+TEST_CASE("StreamRelay: a coalesced burst shows typing once", "[stream_relay]") {
+    Fixture f;
+    f.received("part one");
+    f.received("part two");
+    f.received("part three");
+    REQUIRE(f.channel.typing == 1);
+    f.turn_start(1);  // the merged turn
+    REQUIRE(f.channel.typing == 1);
+    f.received("later");  // queued behind the running turn
+    REQUIRE(f.channel.typing == 1);
+    f.stream("Reply");
+    f.ready("Reply", 1);
+
+    f.turn_start(2);  // typing for the queued message starts with its turn
+    REQUIRE(f.channel.typing == 2);
+    f.ready("Again", 2);
+    REQUIRE(f.channel.sent == std::vector<std::string>{"Again"});
+}
+
+TEST_CASE("StreamRelay: unstreamed turn reply is sent", "[stream_relay]") {
+    Fixture f;
+    f.turn_start(1);
+    f.ready("Done", 1);
+    REQUIRE(f.channel.sent == std::vector<std::string>{"Done"});
+}
+
+TEST_CASE("StreamRelay: channel calls run outside the relay lock", "[stream_relay]") {
+    // A channel that publishes back into the relay from inside a call
+    // deadlocks if the relay still holds its lock
+    struct ReentrantChannel : RecordingChannel {
+        EventBus* bus = nullptr;
+        int64_t send_streaming_placeholder(const std::string& target) override {
+            ToolCallRequestEvent ev;
+            ev.session_id = "s";
+            bus->publish(ev);
+            return RecordingChannel::send_streaming_placeholder(target);
+        }
+    };
+    EventBus bus;
+    ReentrantChannel channel;
+    channel.bus = &bus;
+    StreamRelay relay(channel, bus);
+    relay.subscribe_events();
+
+    TurnStartEvent start;
+    start.session_id = "s";
+    start.reply_target = "chat";
+    start.turn_id = 1;
+    bus.publish(start);
+    StreamStartEvent stream;
+    stream.session_id = "s";
+    bus.publish(stream);
+    StreamEndEvent end;
+    end.session_id = "s";
+    bus.publish(end);
+    REQUIRE(channel.edits.size() == 1);
+    REQUIRE(channel.edits[0].first == 100);
+}
+
+TEST_CASE("StreamRelay: tool progress is sent off the publishing thread", "[stream_relay]") {
+    Fixture f;
+    f.turn_start(1);
+    f.tool_call("c1");
+    f.channel.hold();
+
+    // A tool's read loop publishes progress; the edit must not block it
+    auto start = std::chrono::steady_clock::now();
+    f.progress("c1", "line 1\n");
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+
+    f.channel.release_edits();
+    REQUIRE(f.channel.wait_edits(1));
+    REQUIRE(f.channel.edits[0] == std::make_pair(int64_t{100},
+                                                 std::string("[shell running, 2s]\nline 1\n")));
+
+    // A result that arrives during a progress edit is shown after it
+    f.channel.hold();
+    f.progress("c1", "line 2\n");
+    REQUIRE(f.channel.wait_held());
+    std::thread result([&f] { f.tool_result("c1"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    f.channel.release_edits();
+    result.join();
+    REQUIRE(f.channel.wait_edits(3));
+    REQUIRE(f.channel.edits.back() ==
+            std::make_pair(int64_t{100}, std::string("[shell finished]\nline 1\nline 2\n")));
+}
+
+TEST_CASE("StreamRelay: progress after the call's result is dropped", "[stream_relay]") {
+    Fixture f;
+    f.turn_start(1);
+    f.tool_call("c1");
+    f.tool_result("c1");
+    f.progress("c1", "late");
+    f.progress("c2", "unknown call");
+
+    // Progress is handled in order, so once c3's edit is in the others
+    // have been processed
+    f.tool_call("c3");
+    f.progress("c3", "out");
+    REQUIRE(f.channel.wait_edits(1));
+    REQUIRE(f.channel.edits.size() == 1);
+    REQUIRE(f.channel.edits[0].first == 100);
+    REQUIRE(f.channel.next_message_id == 101);
+}
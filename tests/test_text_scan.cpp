@@ -0,0 +1,143 @@
+#include <catch2/catch_test_macros.hpp>
+#include "text_scan.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ptrclaw;
+
+namespace {
+
+// Switches kernel sets for the duration of a test, restoring the detected one
+struct KernelGuard {
+    std::string saved = scan_kernels();
+    ~KernelGuard() { set_scan_kernels(saved); }
+};
+
+// Text dense in the bytes the kernels classify, so every block has hits and
+// misses at varying offsets
+std::string random_text(std::mt19937& rng, size_t size) {
+    static const char alphabet[] = "\n\n  \t\r\r09aZ/\033[m\x80\xff";
+    std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+    std::string text;
+    for (size_t i = 0; i < size; i++) text += alphabet[pick(rng)];
+    return text;
+}
+
+size_t ref_skip_blanks(std::string_view s, size_t pos) {
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r')) pos++;
+    return pos;
+}
+
+std::vector<std::string_view> ref_split(std::string_view s) {
+    std::vector<std::string_view> lines;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t eol = s.find('\n', pos);
+        if (eol == std::string_view::npos) eol = s.size();
+        lines.push_back(s.substr(pos, eol - pos));
+        pos = eol + 1;
+    }
+    return lines;
+}
+
+} // namespace
+
+TEST_CASE("text_scan: a kernel set is selected", "[text_scan]") {
+    std::string name = scan_kernels();
+    REQUIRE((name == "avx2" || name == "sse2" || name == "scalar"));
+    KernelGuard guard;
+    REQUIRE(set_scan_kernels("scalar"));
+    REQUIRE(std::string(scan_kernels()) == "scalar");
+    REQUIRE_FALSE(set_scan_kernels("neon64"));
+    REQUIRE(std::string(scan_kernels()) == "scalar");
+}
+
+TEST_CASE("text_scan: every kernel set matches the reference", "[text_scan]") {
+    KernelGuard guard;
+    std::mt19937 rng(42);
+    std::vector<std::string> texts;
+    for (size_t size = 0; size <= 100; size++) texts.push_back(random_text(rng, size));
+    texts.push_back(random_text(rng, 70000));  // past the 255-block count folding
+    texts.push_back(std::string(9000, '\n'));
+    texts.push_back(std::string(100, ' ') + "x");
+
+    for (const char* name : {"scalar", "sse2", "avx2"}) {
+        if (!set_scan_kernels(name)) continue;
+        INFO("kernels: " << name);
+        for (const auto& text : texts) {
+            std::string_view view = text;
+            INFO("size: " << view.size());
+            REQUIRE(count_byte(view, '\n') == static_cast<size_t>(std::count(text.begin(), text.end(), '\n')));
+
+            std::vector<std::string_view> lines;
+            split_lines_into(view, lines);
+            REQUIRE(lines == ref_split(view));
+
+            size_t step = view.size() > 200 ? 997 : 1;
+            for (size_t pos = 0; pos <= view.size(); pos += step) {
+                REQUIRE(find_byte(view, '\033', pos) == view.find('\033', pos));
+                REQUIRE(find_byte(view, '\xff', pos) == view.find('\xff', pos));
+                REQUIRE(skip_blanks(view, pos) == ref_skip_blanks(view, pos));
+            }
+        }
+    }
+}
+
+TEST_CASE("text_scan: positions past the end", "[text_scan]") {
+    REQUIRE(find_byte("abc", 'a', 3) == std::string_view::npos);
+    REQUIRE(skip_blanks(" \t", 5) == 2);
+    REQUIRE(skip_blanks("", 0) == 0);
+    std::vector<std::string_view> lines;
+    split_lines_into("", lines);
+    REQUIRE(lines.empty());
+    split_lines_into("a\n\nb\n", lines);
+    REQUIRE(lines == std::vector<std::string_view>{"a", "", "b"});
+}
+
+// ── Benchmark (hidden; run with `make bench`) ───────────────────
+
+TEST_CASE("text_scan: kernel throughput", "[.][bench]") {
+    KernelGuard guard;
+    std::mt19937 rng(7);
+    std::string text;
+    while (text.size() < (16u << 20)) {
+        // Stack-trace-like lines: deep indentation, the odd blank one
+        text += std::string(4 + rng() % 40, ' ');
+        if (rng() % 8 != 0) {
+            text += "at worker_" + std::to_string(rng() % 100000) + " (src/pool.cpp:" +
+                    std::to_string(rng() % 1000) + ")";
+        }
+        text += "\n";
+    }
+
+    for (const char* name : {"scalar", "sse2", "avx2"}) {
+        if (!set_scan_kernels(name)) continue;
+        constexpr int kIterations = 10;
+        size_t sink = 0;
+        std::vector<std::string_view> lines;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; i++) {
+            lines.clear();
+            split_lines_into(text, lines);
+            sink += lines.size();
+        }
+        auto split_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; i++) {
+            for (auto line : lines) sink += skip_blanks(line) == line.size();
+        }
+        auto blank_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto mib_per_s = [&](double elapsed) {
+            return static_cast<uint64_t>(static_cast<double>(text.size()) * kIterations / elapsed / (1 << 20));
+        };
+        std::cout << name << ": split " << mib_per_s(split_elapsed) << " MiB/s, blank checks "
+                  << mib_per_s(blank_elapsed) << " MiB/s\n";
+        REQUIRE(sink > 0);
+    }
+}
@@ -4,6 +4,9 @@
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
 
 using namespace ptrclaw;
 
@@ -154,6 +157,76 @@ TEST_CASE("ToolManager: multiple tools run concurrently", "[tool_manager]") {
     REQUIRE(max_concurrency.load() == 2);
 }
 
+class SlowShellTool : public SlowMockTool {
+public:
+    using SlowMockTool::SlowMockTool;
+    std::string concurrency_class() const override { return "shell"; }
+};
+
+TEST_CASE("ToolManager: shell-class calls in one session run one at a time",
+          "[tool_manager]") {
+    EventBus bus;
+    std::atomic<int> concurrency{0};
+    std::atomic<int> max_concurrency{0};
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<SlowShellTool>("sh", concurrency, max_concurrency));
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    BatchCollector collector("batch-sh", 3);
+    auto sub = subscribe<ToolCallResultEvent>(bus,
+        std::function<void(const ToolCallResultEvent&)>(
+            [&collector](const ToolCallResultEvent& ev) { collector.on_result(ev); }));
+    for (int i = 0; i < 3; i++) {
+        ToolCallRequestEvent req;
+        req.batch_id = "batch-sh";
+        req.tool_name = "sh";
+        req.tool_call_id = "call-" + std::to_string(i);
+        req.arguments_json = "{}";
+        bus.publish(req);
+    }
+    REQUIRE(collector.wait(std::chrono::seconds{5}));
+    bus.unsubscribe(sub);
+    REQUIRE(max_concurrency.load() == 1);
+}
+
+TEST_CASE("ToolManager: call cancelled while queued reports without running",
+          "[tool_manager]") {
+    EventBus bus;
+    std::atomic<int> concurrency{0};
+    std::atomic<int> max_concurrency{0};
+    auto slow = std::make_unique<SlowShellTool>("sh", concurrency, max_concurrency);
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(slow));
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    BatchCollector collector("batch-q", 2);
+    auto sub = subscribe<ToolCallResultEvent>(bus,
+        std::function<void(const ToolCallResultEvent&)>(
+            [&collector](const ToolCallResultEvent& ev) { collector.on_result(ev); }));
+    for (const char* id : {"running", "queued"}) {
+        ToolCallRequestEvent req;
+        req.batch_id = "batch-q";
+        req.tool_name = "sh";
+        req.tool_call_id = id;
+        req.arguments_json = "{}";
+        bus.publish(req);
+    }
+    ToolCallCancelEvent cancel_ev;
+    cancel_ev.batch_id = "batch-q";
+    bus.publish(cancel_ev);
+    REQUIRE(collector.wait(std::chrono::seconds{5}));
+    bus.unsubscribe(sub);
+
+    bool saw_queued = false;
+    for (const auto& r : collector.results()) {
+        if (r.tool_call_id != "queued") continue;
+        saw_queued = true;
+        REQUIRE_FALSE(r.success);
+        REQUIRE(r.output == "Cancelled before start");
+    }
+    REQUIRE(saw_queued);
+}
+
 TEST_CASE("ToolManager: unknown tool returns error", "[tool_manager]") {
     EventBus bus;
     std::vector<std::unique_ptr<Tool>> tools;
@@ -243,6 +316,34 @@ TEST_CASE("BatchCollector: wait returns false on timeout", "[tool_manager]") {
     REQUIRE(collector.results().empty());
 }
 
+TEST_CASE("BatchCollector: wait returns early when token is cancelled", "[tool_manager]") {
+    BatchCollector collector("cancel-wait", 1);
+    auto token = make_cancellation_token();
+
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cancel(token);
+    });
+    auto start = std::chrono::steady_clock::now();
+    bool completed = collector.wait(std::chrono::seconds{0}, token);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    canceller.join();
+
+    REQUIRE_FALSE(completed);
+    REQUIRE(elapsed < std::chrono::seconds{1});
+    REQUIRE(collector.missing() == 1);
+}
+
+TEST_CASE("BatchCollector: wait with live token completes normally", "[tool_manager]") {
+    BatchCollector collector("token-ok", 1);
+    ToolCallResultEvent ev;
+    ev.batch_id = "token-ok";
+    ev.tool_call_id = "call-1";
+    collector.on_result(ev);
+
+    REQUIRE(collector.wait(std::chrono::seconds{1}, make_cancellation_token()));
+}
+
 TEST_CASE("BatchCollector: wait returns true when results arrive before timeout", "[tool_manager]") {
     BatchCollector collector("fast-batch", 1);
 
@@ -300,6 +401,316 @@ TEST_CASE("ToolManager: ToolCallCancelEvent cancels running tools", "[tool_manag
     REQUIRE(raw_ptr->was_cancelled.load());
 }
 
+// ── Progress ────────────────────────────────────────────────────
+
+static ToolCallResultEvent call_tool(EventBus& bus, const std::string& name,
+                                     const std::string& id,
+                                     const std::string& args = "{}",
+                                     uint32_t token_budget = 0,
+                                     uint32_t batch_size = 1) {
+    BatchCollector collector("batch-" + id, 1);
+    auto sub = subscribe<ToolCallResultEvent>(bus,
+        std::function<void(const ToolCallResultEvent&)>(
+            [&collector](const ToolCallResultEvent& ev) { collector.on_result(ev); }));
+    ToolCallRequestEvent req;
+    req.batch_id = "batch-" + id;
+    req.tool_name = name;
+    req.tool_call_id = id;
+    req.arguments_json = args;
+    req.token_budget = token_budget;
+    req.batch_size = batch_size;
+    bus.publish(req);
+    collector.wait();
+    bus.unsubscribe(sub);
+    return collector.results().at(0);
+}
+
+
+// Reports a line every 50 ms for `lines` lines, stopping early on cancel
+class ChattyTool : public Tool {
+public:
+    explicit ChattyTool(int lines) : lines_(lines) {}
+    ToolResult execute(const std::string& args) override {
+        return execute(args, nullptr, nullptr);
+    }
+    ToolResult execute(const std::string&, const CancellationToken& token,
+                       const ToolProgress& progress) override {
+        std::string output;
+        for (int i = 0; i < lines_ && !is_cancelled(token); i++) {
+            std::string line = "line " + std::to_string(i) + "\n";
+            output += line;
+            if (progress) progress(line);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        return {true, output};
+    }
+    std::string tool_name() const override { return "chatty"; }
+    std::string description() const override { return "chatty tool"; }
+    std::string parameters_json() const override { return R"({"type":"object"})"; }
+private:
+    int lines_;
+};
+
+TEST_CASE("ToolManager: progress is throttled and incremental", "[tool_manager]") {
+    EventBus bus;
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<ChattyTool>(30));  // ~1.5 s
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    std::mutex mutex;
+    std::vector<ToolCallProgressEvent> progress;
+    auto sub = subscribe<ToolCallProgressEvent>(bus,
+        std::function<void(const ToolCallProgressEvent&)>(
+            [&](const ToolCallProgressEvent& ev) {
+                std::lock_guard<std::mutex> lock(mutex);
+                progress.push_back(ev);
+            }));
+    auto result = call_tool(bus, "chatty", "c1");
+    bus.unsubscribe(sub);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    REQUIRE(progress.size() == 1);
+    REQUIRE(progress[0].tool_call_id == "c1");
+    REQUIRE(progress[0].batch_id == "batch-c1");
+    REQUIRE(progress[0].elapsed_ms >= 1000);
+    REQUIRE(progress[0].total_bytes == progress[0].delta.size());
+    REQUIRE(result.output.compare(0, progress[0].delta.size(), progress[0].delta) == 0);
+}
+
+TEST_CASE("ToolManager: quick calls publish no progress", "[tool_manager]") {
+    EventBus bus;
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<ChattyTool>(3));
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    std::atomic<int> events{0};
+    auto sub = subscribe<ToolCallProgressEvent>(bus,
+        std::function<void(const ToolCallProgressEvent&)>(
+            [&events](const ToolCallProgressEvent&) { events++; }));
+    call_tool(bus, "chatty", "c1");
+    bus.unsubscribe(sub);
+    REQUIRE(events == 0);
+}
+
+TEST_CASE("BatchCollector: keeps the tail of each call's progress", "[tool_manager]") {
+    BatchCollector collector("b", 1);
+    ToolCallProgressEvent ev;
+    ev.batch_id = "b";
+    ev.tool_call_id = "c1";
+    ev.delta = std::string(BatchCollector::kMaxPartialBytes, 'a');
+    collector.on_progress(ev);
+    ev.delta = "tail";
+    collector.on_progress(ev);
+    ev.batch_id = "other";
+    ev.delta = "ignored";
+    collector.on_progress(ev);
+
+    auto partial = collector.partial_output("c1");
+    REQUIRE(partial.size() == BatchCollector::kMaxPartialBytes);
+    REQUIRE(partial.substr(partial.size() - 4) == "tail");
+    REQUIRE(collector.partial_output("c2").empty());
+}
+
+// ── Memoization ─────────────────────────────────────────────────
+
+class PureMockTool : public Tool {
+public:
+    PureMockTool(std::string name, ToolPurity purity, std::string path = "")
+        : name_(std::move(name)), purity_(purity), path_(std::move(path)) {}
+    std::atomic<int> calls{0};
+    ToolResult execute(const std::string& args) override {
+        calls++;
+        return {true, name_ + " #" + std::to_string(calls.load()) + " " + args};
+    }
+    std::string tool_name() const override { return name_; }
+    std::string description() const override { return "pure tool"; }
+    std::string parameters_json() const override { return R"({"type":"object"})"; }
+    ToolPurity purity() const override { return purity_; }
+    std::vector<std::string> memo_paths(const std::string&) const override {
+        return {path_};
+    }
+private:
+    std::string name_;
+    ToolPurity purity_;
+    std::string path_;
+};
+
+TEST_CASE("ToolManager: pure tool results are memoized by canonical arguments",
+          "[tool_manager]") {
+    EventBus bus;
+    auto tool = std::make_unique<PureMockTool>("pure", ToolPurity::Pure);
+    auto* pure = tool.get();
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(tool));
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    auto first = call_tool(bus, "pure", "c1", R"({"a":1,"b":2})");
+    auto second = call_tool(bus, "pure", "c2", R"({ "b": 2, "a": 1 })");
+    REQUIRE_FALSE(first.memoized);
+    REQUIRE(second.memoized);
+    REQUIRE(second.memo_of == "c1");
+    REQUIRE(second.tool_call_id == "c2");
+    REQUIRE(second.output == first.output);
+    REQUIRE(pure->calls == 1);
+
+    auto other = call_tool(bus, "pure", "c3", R"({"a":2})");
+    REQUIRE_FALSE(other.memoized);
+    REQUIRE(pure->calls == 2);
+}
+
+TEST_CASE("ToolManager: impure tool call drops memoized results", "[tool_manager]") {
+    EventBus bus;
+    auto tool = std::make_unique<PureMockTool>("pure", ToolPurity::Pure);
+    auto* pure = tool.get();
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(tool));
+    tools.push_back(std::make_unique<MockTool>());
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    call_tool(bus, "pure", "c1");
+    REQUIRE_FALSE(call_tool(bus, "mock_tool", "c2").memoized);
+    REQUIRE_FALSE(call_tool(bus, "mock_tool", "c3").memoized);
+    REQUIRE_FALSE(call_tool(bus, "pure", "c4").memoized);
+    REQUIRE(pure->calls == 2);
+}
+
+TEST_CASE("ToolManager: file-backed results follow the file", "[tool_manager]") {
+    std::string path = "/tmp/ptrclaw_test_memo_" + std::to_string(getpid()) + ".txt";
+    { std::ofstream(path) << "one"; }
+
+    EventBus bus;
+    auto tool = std::make_unique<PureMockTool>("reader", ToolPurity::FileBacked, path);
+    auto* reader = tool.get();
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(tool));
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    call_tool(bus, "reader", "c1");
+    REQUIRE(call_tool(bus, "reader", "c2").memoized);
+
+    { std::ofstream(path) << "changed"; }
+    REQUIRE_FALSE(call_tool(bus, "reader", "c3").memoized);
+    REQUIRE(reader->calls == 2);
+
+    std::filesystem::remove(path);
+    REQUIRE_FALSE(call_tool(bus, "reader", "c4").memoized);
+    REQUIRE(reader->calls == 3);
+}
+
+TEST_CASE("ToolManager: tool_memo_entries = 0 disables memoization", "[tool_manager]") {
+    EventBus bus;
+    auto tool = std::make_unique<PureMockTool>("pure", ToolPurity::Pure);
+    auto* pure = tool.get();
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(tool));
+    auto cfg = make_config();
+    cfg.agent.tool_memo_entries = 0;
+    ToolManager mgr(std::move(tools), cfg, bus);
+
+    call_tool(bus, "pure", "c1");
+    REQUIRE_FALSE(call_tool(bus, "pure", "c2").memoized);
+    REQUIRE(pure->calls == 2);
+}
+
+TEST_CASE("ToolManager: memo keeps the most recently used entries", "[tool_manager]") {
+    EventBus bus;
+    auto tool = std::make_unique<PureMockTool>("pure", ToolPurity::Pure);
+    auto* pure = tool.get();
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(tool));
+    auto cfg = make_config();
+    cfg.agent.tool_memo_entries = 2;
+    ToolManager mgr(std::move(tools), cfg, bus);
+
+    call_tool(bus, "pure", "c1", R"({"n":1})");
+    call_tool(bus, "pure", "c2", R"({"n":2})");
+    REQUIRE(call_tool(bus, "pure", "c3", R"({"n":1})").memoized);
+    call_tool(bus, "pure", "c4", R"({"n":3})");  // evicts n=2
+    REQUIRE(call_tool(bus, "pure", "c5", R"({"n":1})").memoized);
+    REQUIRE_FALSE(call_tool(bus, "pure", "c6", R"({"n":2})").memoized);
+    REQUIRE(pure->calls == 4);
+}
+
+// ── Token budget ────────────────────────────────────────────────
+
+// Returns 20000 numbered lines of about 150 chars, so that the character
+// limit binds before the line limit
+class VerboseTool : public Tool {
+public:
+    explicit VerboseTool(ToolPurity purity = ToolPurity::Impure) : purity_(purity) {}
+    std::atomic<int> calls{0};
+    ToolResult execute(const std::string&) override {
+        calls++;
+        std::string out;
+        for (int i = 0; i < 20000; i++) {
+            out += "output line " + std::to_string(i) + ' ' + std::string(130, 'x') + '\n';
+        }
+        return {true, out};
+    }
+    std::string tool_name() const override { return "verbose"; }
+    std::string description() const override { return "verbose tool"; }
+    std::string parameters_json() const override { return R"({"type":"object"})"; }
+    ToolPurity purity() const override { return purity_; }
+private:
+    ToolPurity purity_;
+};
+
+TEST_CASE("ToolManager: output is filtered to the call's share of the budget",
+          "[tool_manager]") {
+    EventBus bus;
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::make_unique<VerboseTool>());
+    auto cfg = make_config();
+    cfg.agent.tool_output_min_tokens = 1000;
+    cfg.agent.tool_output_max_tokens = 16000;
+    ToolManager mgr(std::move(tools), cfg, bus);
+
+    // No budget: the fixed defaults
+    auto unbudgeted = call_tool(bus, "verbose", "c1");
+    REQUIRE(unbudgeted.filtered_tokens <= ToolManager::kDefaultResultTokens + 10);
+    REQUIRE(unbudgeted.filtered_tokens > ToolManager::kDefaultResultTokens / 2);
+
+    // 12000 tokens over a batch of four
+    auto shared = call_tool(bus, "verbose", "c2", "{}", 12000, 4);
+    REQUIRE(shared.filtered_tokens <= 3000 + 10);
+    REQUIRE(shared.filtered_tokens > 1500);
+
+    // Clamped to tool_output_min_tokens when the context is nearly full
+    auto floor = call_tool(bus, "verbose", "c3", "{}", 100, 2);
+    REQUIRE(floor.filtered_tokens <= 1000 + 10);
+    REQUIRE(floor.filtered_tokens > 500);
+    // Including when it is already full (the agent sends 1, as 0 means
+    // unknown)
+    auto full = call_tool(bus, "verbose", "c5", "{}", 1, 3);
+    REQUIRE(full.filtered_tokens <= 1000 + 10);
+    REQUIRE(full.filtered_tokens > 500);
+
+    // And to tool_output_max_tokens when it is nearly empty (the truncation
+    // marker comes on top of the limit)
+    auto ceiling = call_tool(bus, "verbose", "c4", "{}", 1000000, 1);
+    REQUIRE(ceiling.filtered_tokens <= 16000 + 10);
+    REQUIRE(ceiling.filtered_tokens > unbudgeted.filtered_tokens);
+    REQUIRE(ceiling.raw_tokens == unbudgeted.raw_tokens);
+}
+
+TEST_CASE("ToolManager: memoized results are reused only within their budget",
+          "[tool_manager]") {
+    EventBus bus;
+    auto tool = std::make_unique<VerboseTool>(ToolPurity::Pure);
+    auto* verbose = tool.get();
+    std::vector<std::unique_ptr<Tool>> tools;
+    tools.push_back(std::move(tool));
+    ToolManager mgr(std::move(tools), make_config(), bus);
+
+    REQUIRE_FALSE(call_tool(bus, "verbose", "c1", "{}", 4000).memoized);
+    // Too large for a smaller budget
+    REQUIRE_FALSE(call_tool(bus, "verbose", "c2", "{}", 2000).memoized);
+    REQUIRE(call_tool(bus, "verbose", "c3", "{}", 2000).memoized);
+    // Cut more than a larger budget needs
+    REQUIRE_FALSE(call_tool(bus, "verbose", "c4", "{}", 8000).memoized);
+    REQUIRE(verbose->calls == 3);
+}
+
 TEST_CASE("CancellationToken: basic operations", "[tool_manager]") {
     auto token = make_cancellation_token();
     REQUIRE_FALSE(is_cancelled(token));
@@ -0,0 +1,123 @@
+#include <catch2/catch_test_macros.hpp>
+#include "tool_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace ptrclaw;
+
+// Tracks how many jobs run at once
+struct Concurrency {
+    std::atomic<int> current{0};
+    std::atomic<int> peak{0};
+
+    void run(std::chrono::milliseconds duration) {
+        int cur = ++current;
+        int prev = peak.load();
+        while (cur > prev && !peak.compare_exchange_weak(prev, cur)) {}
+        std::this_thread::sleep_for(duration);
+        --current;
+    }
+};
+
+static ToolPoolOptions pool_options(uint32_t workers) {
+    ToolPoolOptions options;
+    options.workers = workers;
+    return options;
+}
+
+// ── Scheduling ──────────────────────────────────────────────────
+
+TEST_CASE("ToolPool: runs jobs in parallel up to the worker count", "[tool_pool]") {
+    Concurrency c;
+    {
+        ToolPool pool(pool_options(2));
+        for (int i = 0; i < 4; i++) {
+            pool.submit("read", "s1", [&c] { c.run(std::chrono::milliseconds(30)); });
+        }
+    }  // destructor drains the queue
+    REQUIRE(c.peak == 2);
+}
+
+TEST_CASE("ToolPool: class limit serializes one session only", "[tool_pool]") {
+    Concurrency s1;
+    Concurrency all;
+    {
+        ToolPool pool(pool_options(4));
+        for (int i = 0; i < 3; i++) {
+            pool.submit("shell", "s1", [&] {
+                s1.current++;
+                s1.peak = std::max(s1.peak.load(), s1.current.load());
+                all.run(std::chrono::milliseconds(30));
+                s1.current--;
+            });
+        }
+        pool.submit("shell", "s2", [&all] { all.run(std::chrono::milliseconds(30)); });
+    }
+    REQUIRE(s1.peak == 1);
+    REQUIRE(all.peak == 2);
+}
+
+TEST_CASE("ToolPool: a blocked class does not hold up other jobs", "[tool_pool]") {
+    ToolPool pool(pool_options(2));
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    pool.submit("shell", "s1", [released] { released.wait(); });
+
+    // Second shell call must wait for the first; the read behind it must not
+    std::atomic<bool> second_shell{false};
+    std::promise<void> read_done;
+    pool.submit("shell", "s1", [&second_shell] { second_shell = true; });
+    pool.submit("read", "s1", [&read_done] { read_done.set_value(); });
+
+    auto status = read_done.get_future().wait_for(std::chrono::seconds(2));
+    REQUIRE(status == std::future_status::ready);
+    REQUIRE_FALSE(second_shell);
+    release.set_value();
+}
+
+TEST_CASE("ToolPool: unlisted and zero-limit classes are unlimited", "[tool_pool]") {
+    ToolPoolOptions options = pool_options(3);
+    options.class_limits["write"] = 0;
+    ToolPool pool(options);
+    REQUIRE(pool.limit_for("write") == UINT32_MAX);
+    REQUIRE(pool.limit_for("anything") == UINT32_MAX);
+    REQUIRE(pool.limit_for("shell") == 1);
+}
+
+TEST_CASE("ToolPool: submit blocks while the queue is full", "[tool_pool]") {
+    ToolPoolOptions options = pool_options(1);
+    options.max_queued = 1;
+    ToolPool pool(options);
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> started;
+    pool.submit("read", "s", [&started, released] {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+    pool.submit("read", "s", [] {});  // fills the queue
+
+    std::atomic<bool> submitted{false};
+    std::thread producer([&] {
+        pool.submit("read", "s", [] {});
+        submitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(submitted);
+    REQUIRE(pool.stats().queued == 1);
+
+    release.set_value();
+    producer.join();
+    REQUIRE(submitted);
+}
+
+TEST_CASE("ToolPool: shared returns one pool while it is held", "[tool_pool]") {
+    auto a = ToolPool::shared(pool_options(2));
+    auto b = ToolPool::shared(pool_options(5));
+    REQUIRE(a == b);
+}
@@ -3,10 +3,13 @@
 #include "tools/file_write.hpp"
 #include "tools/file_edit.hpp"
 #include "tools/shell.hpp"
+#include <nlohmann/json.hpp>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <chrono>
 #include <cstdlib>
+#include <thread>
 #include <unistd.h>
 
 using namespace ptrclaw;
@@ -83,6 +86,71 @@ TEST_CASE("FileReadTool: tool_name is file_read", "[tools]") {
     REQUIRE(tool.tool_name() == "file_read");
 }
 
+TEST_CASE("FileReadTool: reads a line range", "[tools]") {
+    auto dir = make_temp_dir();
+    auto file = dir + "/lines.txt";
+    write_file(file, "one\ntwo\nthree\nfour\nfive\n");
+
+    FileReadTool tool;
+    auto result = tool.execute(R"({"path":")" + file + R"(","start_line":2,"end_line":3})");
+    REQUIRE(result.success);
+    REQUIRE(result.output == "[lines 2-3 of 5, bytes 4-14 of 24; next: start_line=4]\ntwo\nthree\n");
+
+    result = tool.execute(R"({"path":")" + file + R"(","start_line":4})");
+    REQUIRE(result.output == "[lines 4-5 of 5, bytes 14-24 of 24; end of file]\nfour\nfive\n");
+
+    result = tool.execute(R"({"path":")" + file + R"(","start_line":9})");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("5 lines") != std::string::npos);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("FileReadTool: reads a byte range", "[tools]") {
+    auto dir = make_temp_dir();
+    auto file = dir + "/bytes.txt";
+    write_file(file, "one\ntwo\nthree\n");
+
+    FileReadTool tool;
+    auto result = tool.execute(R"({"path":")" + file + R"(","offset":5,"limit":6})");
+    REQUIRE(result.success);
+    REQUIRE(result.output == "[lines 2-3 of 3, bytes 5-11 of 14; next: offset=11]\nwo\nthr");
+
+    result = tool.execute(R"({"path":")" + file + R"(","offset":99})");
+    REQUIRE_FALSE(result.success);
+    result = tool.execute(R"({"path":")" + file + R"(","offset":1,"start_line":1})");
+    REQUIRE_FALSE(result.success);
+    result = tool.execute(R"({"path":")" + file + R"(","limit":-1})");
+    REQUIRE_FALSE(result.success);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("FileReadTool: pages through a large file", "[tools]") {
+    auto dir = make_temp_dir();
+    auto file = dir + "/large.txt";
+    std::string content;
+    for (int i = 1; i <= 20000; i++) content += "line " + std::to_string(i) + "\n";
+    write_file(file, content);
+
+    FileReadTool tool;
+    auto first = tool.execute(R"({"path":")" + file + R"("})");
+    REQUIRE(first.success);
+    REQUIRE(first.output.size() <= FileReadTool::kMaxBytes + 100);
+    REQUIRE(first.output.rfind("[lines 1-", 0) == 0);
+    REQUIRE(first.output.find("of 20000, bytes 0-") != std::string::npos);
+    REQUIRE(first.output.back() == '\n');  // whole lines only
+
+    auto next = first.output.find("next: start_line=");
+    REQUIRE(next != std::string::npos);
+    std::string start_line = first.output.substr(next + 17, first.output.find(']') - next - 17);
+    auto second = tool.execute(R"({"path":")" + file + R"(","start_line":)" + start_line + "}");
+    REQUIRE(second.success);
+    REQUIRE(second.output.find("\nline " + start_line + "\n") != std::string::npos);
+
+    std::filesystem::remove_all(dir);
+}
+
 // ═══ FileWriteTool ═══════════════════════════════════════════════
 
 TEST_CASE("FileWriteTool: writes new file", "[tools]") {
@@ -189,6 +257,84 @@ TEST_CASE("FileEditTool: fails when old_text not found", "[tools]") {
     std::filesystem::remove_all(dir);
 }
 
+TEST_CASE("FileEditTool: applies a batch of edits in one call", "[tools]") {
+    auto dir = make_temp_dir();
+    REQUIRE_FALSE(dir.empty());
+    auto file = dir + "/batch.cpp";
+    write_file(file, "int a = 1;\nint b = 2;\nint c = 3;\nint d = 4;\n");
+
+    FileEditTool tool;
+    // Listed out of file order; one grows to two lines, one is deleted
+    auto result = tool.execute(R"({"path":")" + file + R"(","edits":[)"
+        R"({"old_text":"int c = 3;\n","new_text":""},)"
+        R"({"old_text":"int a = 1;","new_text":"long a = 1;\nlong a2 = 1;"},)"
+        R"({"old_text":"d = 4","new_text":"d = 40"}]})");
+    REQUIRE(result.success);
+    REQUIRE(read_file(file) == "long a = 1;\nlong a2 = 1;\nint b = 2;\nint d = 40;\n");
+    REQUIRE(result.output == "File edited: " + file + " (3 edits, -3 +3 lines)"
+                             "\n  lines 1-2: -1 +2"
+                             "\n  line 4: -1 +0"
+                             "\n  line 4: -1 +1");
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("FileEditTool: a failing edit in a batch changes nothing", "[tools]") {
+    auto dir = make_temp_dir();
+    REQUIRE_FALSE(dir.empty());
+    auto file = dir + "/keep.txt";
+    const std::string original = "alpha beta gamma beta\n";
+    write_file(file, original);
+
+    FileEditTool tool;
+    auto edit = [&](const std::string& edits) {
+        return tool.execute(R"({"path":")" + file + R"(","edits":)" + edits + "}");
+    };
+
+    auto result = edit(R"([{"old_text":"alpha","new_text":"A"},{"old_text":"beta","new_text":"B"}])");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("edits[1]") != std::string::npos);
+    REQUIRE(result.output.find("multiple") != std::string::npos);
+
+    result = edit(R"([{"old_text":"alpha","new_text":"A"},{"old_text":"zeta","new_text":"Z"}])");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("edits[1]: old_text not found") != std::string::npos);
+
+    result = edit(R"([{"old_text":"beta gamma","new_text":"x"},{"old_text":"alpha beta","new_text":"y"}])");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("edits[0] and edits[1] overlap") != std::string::npos);
+
+    result = edit(R"([{"old_text":"","new_text":"x"}])");
+    REQUIRE_FALSE(result.success);
+    result = edit(R"([{"old_text":"alpha"}])");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("new_text") != std::string::npos);
+    result = edit("[]");
+    REQUIRE_FALSE(result.success);
+    result = tool.execute(R"({"path":")" + file +
+                          R"(","old_text":"a","new_text":"b","edits":[{"old_text":"a","new_text":"b"}]})");
+    REQUIRE_FALSE(result.success);
+
+    REQUIRE(read_file(file) == original);
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("FileEditTool: keeps file permissions", "[tools]") {
+    auto dir = make_temp_dir();
+    REQUIRE_FALSE(dir.empty());
+    auto file = dir + "/run.sh";
+    write_file(file, "echo one\n");
+    std::filesystem::permissions(file, std::filesystem::perms::owner_all);
+
+    FileEditTool tool;
+    auto result = tool.execute(R"({"path":")" + file + R"(","old_text":"one","new_text":"two"})");
+    REQUIRE(result.success);
+    REQUIRE(read_file(file) == "echo two\n");
+    REQUIRE(std::filesystem::status(file).permissions() == std::filesystem::perms::owner_all);
+
+    std::filesystem::remove_all(dir);
+}
+
 TEST_CASE("FileEditTool: missing old_text parameter", "[tools]") {
     FileEditTool tool;
     auto result = tool.execute(R"({"path":"/tmp/x","new_text":"y"})");
@@ -228,6 +374,7 @@ TEST_CASE("FileEditTool: tool_name is file_edit", "[tools]") {
     REQUIRE(tool.tool_name() == "file_edit");
     REQUIRE_FALSE(tool.description().empty());
     REQUIRE(tool.parameters_json().find("old_text") != std::string::npos);
+    REQUIRE(nlohmann::json::parse(tool.parameters_json())["properties"].contains("edits"));
 }
 
 // ═══ ShellTool ═══════════════════════════════════════════════════
@@ -391,6 +538,249 @@ TEST_CASE("ShellTool: stdin parameter still works for one-shot piping", "[tools]
     REQUIRE(result.output.find("[WAITING FOR INPUT") == std::string::npos);
 }
 
+TEST_CASE("HeadTailBuffer: keeps everything under the limits", "[tools]") {
+    HeadTailBuffer buf(10, 10);
+    buf.append("hello ");
+    buf.append("world");
+    REQUIRE(buf.total() == 11);
+    REQUIRE(buf.skipped() == 0);
+    REQUIRE(buf.str() == "hello world");
+}
+
+TEST_CASE("HeadTailBuffer: keeps head and tail with an omission marker", "[tools]") {
+    HeadTailBuffer buf(10, 10);
+    std::string data;
+    for (int i = 0; i < 100; i++) data += static_cast<char>('a' + i % 26);
+    // Odd chunk sizes exercise the ring wrap-around
+    for (size_t pos = 0; pos < data.size(); pos += 7) {
+        buf.append(data.substr(pos, 7));
+    }
+    REQUIRE(buf.total() == 100);
+    REQUIRE(buf.skipped() == 80);
+    REQUIRE(buf.str() == data.substr(0, 10) + "\n[... 80 bytes omitted ...]\n" +
+                         data.substr(90));
+}
+
+TEST_CASE("HeadTailBuffer: cuts at line and UTF-8 boundaries", "[tools]") {
+    HeadTailBuffer buf(12, 12);
+    // "é" is two bytes; the head limit falls inside the second one
+    buf.append("line one\n\xc3\xa9\xc3\xa9");
+    buf.append(std::string(50, 'x') + "\nlast line\n");
+    std::string out = buf.str();
+    REQUIRE(out.rfind("line one\n[... ", 0) == 0);
+    REQUIRE(out.find(" bytes omitted ...]\nlast line\n") != std::string::npos);
+    REQUIRE(out.substr(out.size() - 10) == "last line\n");
+}
+
+TEST_CASE("ShellTool: huge output keeps the head and the tail", "[tools]") {
+    ShellTool tool;
+    auto result = tool.execute(R"({"command":"seq 1 200000"})");
+    REQUIRE(result.success);
+    REQUIRE(result.output.rfind("1\n2\n3\n", 0) == 0);
+    REQUIRE(result.output.find("bytes omitted") != std::string::npos);
+    REQUIRE(result.output.substr(result.output.size() - 7) == "200000\n");
+    REQUIRE(result.output.size() < 10100);
+}
+
+TEST_CASE("ShellTool: persistent shell keeps cwd and environment", "[tools]") {
+    ShellTool tool;
+    tool.set_persistent(true);
+    auto first = tool.execute(R"({"command":"cd /tmp && export PTRCLAW_T=kept"})");
+    REQUIRE(first.success);
+    REQUIRE(first.output.empty());
+
+    auto second = tool.execute(R"({"command":"pwd; echo $PTRCLAW_T"})");
+    REQUIRE(second.success);
+    REQUIRE(second.output == "/tmp\nkept\n");
+
+    auto partial = tool.execute(R"({"command":"printf 'no newline'"})");
+    REQUIRE(partial.output == "no newline");
+}
+
+TEST_CASE("ShellTool: persistent shell reports exit status and quoting", "[tools]") {
+    ShellTool tool;
+    tool.set_persistent(true);
+    auto failed = tool.execute(R"({"command":"echo 'it''s'; false"})");
+    REQUIRE_FALSE(failed.success);
+    REQUIRE(failed.output == "its\n");
+
+    auto quoted = tool.execute(R"({"command":"echo \"a'b\" 1>&2"})");
+    REQUIRE(quoted.success);
+    REQUIRE(quoted.output == "a'b\n");
+}
+
+TEST_CASE("ShellTool: persistent shell restarts after exit", "[tools]") {
+    ShellTool tool;
+    tool.set_persistent(true);
+    REQUIRE(tool.execute(R"({"command":"cd /tmp"})").success);
+
+    auto exited = tool.execute(R"({"command":"echo bye; exit 3"})");
+    REQUIRE_FALSE(exited.success);
+    REQUIRE(exited.output.find("bye") != std::string::npos);
+    REQUIRE(exited.output.find("new shell") != std::string::npos);
+
+    auto again = tool.execute(R"({"command":"echo back"})");
+    REQUIRE(again.success);
+    REQUIRE(again.output == "back\n");
+}
+
+TEST_CASE("ShellTool: cancelling a persistent command kills it", "[tools]") {
+    ShellTool tool;
+    tool.set_persistent(true);
+    auto token = make_cancellation_token();
+    std::thread canceller([token] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        token->store(true);
+    });
+    auto start = std::chrono::steady_clock::now();
+    auto result = tool.execute(R"({"command":"echo started; sleep 30"})", token);
+    canceller.join();
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("[cancelled]") != std::string::npos);
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+    REQUIRE(tool.execute(R"({"command":"true"})").success);
+}
+
+TEST_CASE("ShellTool: silent persistent commands return and can be resumed", "[tools]") {
+    ShellTool tool;
+    tool.set_persistent(true);
+    auto first = tool.execute(R"({"command":"cd /tmp; echo started; sleep 4; echo done"})");
+    REQUIRE(first.success);
+    REQUIRE(first.output == "started\n\n[STILL RUNNING - process_id:shell]");
+
+    auto resumed = tool.execute(R"({"process_id":"shell"})");
+    REQUIRE(resumed.success);
+    REQUIRE(resumed.output == "done\n");
+    // The shell and its cwd survived
+    REQUIRE(tool.execute(R"({"command":"pwd"})").output == "/tmp\n");
+    REQUIRE_FALSE(tool.execute(R"({"process_id":"shell"})").success);
+
+    // A new command replaces one left running
+    auto stalled = tool.execute(R"({"command":"sleep 30"})");
+    REQUIRE(stalled.output.find("[STILL RUNNING") != std::string::npos);
+    auto next = tool.execute(R"({"command":"echo next"})");
+    REQUIRE(next.success);
+    REQUIRE(next.output.find("still running; it was killed") != std::string::npos);
+    REQUIRE(next.output.substr(next.output.size() - 5) == "next\n");
+}
+
+TEST_CASE("ShellTool: persistent mode still runs stdin calls on their own", "[tools]") {
+    ShellTool tool;
+    tool.set_persistent(true);
+    auto result = tool.execute(R"({"command":"cat","stdin":"piped"})");
+    REQUIRE(result.success);
+    REQUIRE(result.output == "piped");
+}
+
+TEST_CASE("ShellTool: applies rlimits before the command", "[tools]") {
+    ShellTool tool;
+    ShellLimits limits;
+    limits.memory_mb = 512;
+    limits.open_files = 64;
+    tool.set_limits(limits);
+    auto result = tool.execute(R"({"command":"ulimit -v; ulimit -n"})");
+    REQUIRE(result.success);
+    REQUIRE(result.output == "524288\n64\n");
+
+    tool.set_persistent(true);
+    auto persistent = tool.execute(R"({"command":"ulimit -n"})");
+    REQUIRE(persistent.output == "64\n");
+}
+
+TEST_CASE("ShellTool: kills commands over the CPU limit and reports usage", "[tools]") {
+    ShellTool tool;
+    ShellLimits limits;
+    limits.cpu_seconds = 1;
+    tool.set_limits(limits);
+    auto result = tool.execute(R"({"command":"while :; do :; done"})");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("[cpu limit of 1 s reached; command killed]") !=
+            std::string::npos);
+    REQUIRE(result.output.find("s user, ") != std::string::npos);
+    REQUIRE(result.output.find("max rss") != std::string::npos);
+
+    // A command the shell starts is killed instead of the shell, which
+    // exits with 128 + SIGXCPU
+    auto child = tool.execute(R"({"command":"sh -c 'while :; do :; done'; exit $?"})");
+    REQUIRE_FALSE(child.success);
+    REQUIRE(child.output.find("[cpu limit of 1 s reached; command killed]") !=
+            std::string::npos);
+    REQUIRE(child.output.find("s user, ") != std::string::npos);
+}
+
+#ifdef __linux__
+TEST_CASE("ShellTool: persistent shell applies the CPU limit per command", "[tools]") {
+    ShellTool tool;
+    ShellLimits limits;
+    limits.cpu_seconds = 1;
+    tool.set_limits(limits);
+    tool.set_persistent(true);
+
+    // The shell's own hard limit is left alone so it can be re-armed
+    auto hard = tool.execute(R"({"command":"ulimit -H -t"})");
+    REQUIRE(hard.output == "unlimited\n");
+    auto result = tool.execute(R"({"command":"sh -c 'while :; do :; done'"})");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("[cpu limit of 1 s reached; command killed]") !=
+            std::string::npos);
+
+    // Re-armed before each command: about one second past what the shell
+    // has used so far
+    auto soft = tool.execute(R"({"command":"ulimit -S -t"})");
+    REQUIRE(soft.output != "unlimited\n");
+    int seconds = std::atoi(soft.output.c_str());
+    REQUIRE(seconds >= 1);
+    REQUIRE(seconds <= 5);
+    REQUIRE(tool.execute(R"({"command":"true"})").success);
+}
+#endif
+
+TEST_CASE("ShellTool: kills commands over the output limit", "[tools]") {
+    ShellTool tool;
+    ShellLimits limits;
+    limits.output_bytes = 100000;
+    tool.set_limits(limits);
+    auto result = tool.execute(R"({"command":"yes"})");
+    REQUIRE_FALSE(result.success);
+    REQUIRE(result.output.find("[output limit of 100000 bytes reached; command killed]") !=
+            std::string::npos);
+    REQUIRE(result.output.find("bytes omitted") != std::string::npos);
+
+    tool.set_persistent(true);
+    auto persistent = tool.execute(R"({"command":"yes"})");
+    REQUIRE_FALSE(persistent.success);
+    REQUIRE(persistent.output.find("output limit") != std::string::npos);
+    REQUIRE(tool.execute(R"({"command":"true"})").success);
+}
+
+TEST_CASE("ShellTool: ignores an unusable cgroup", "[tools]") {
+    ShellTool tool;
+    ShellLimits limits;
+    limits.cgroup = "/nonexistent/ptrclaw-cgroup";
+    tool.set_limits(limits);
+    auto result = tool.execute(R"({"command":"echo ok"})");
+    REQUIRE(result.success);
+    REQUIRE(result.output == "ok\n");
+}
+
+TEST_CASE("ShellTool: quick commands get no usage line", "[tools]") {
+    ShellTool tool;
+    auto result = tool.execute(R"({"command":"echo hi"})");
+    REQUIRE(result.output == "hi\n");
+}
+
+TEST_CASE("ShellTool: reports output through progress as it arrives", "[tools]") {
+    ShellTool tool;
+    std::string streamed;
+    int chunks = 0;
+    auto result = tool.execute(R"({"command":"echo one; sleep 0.2; echo two"})", nullptr,
+        [&](const std::string& delta) { streamed += delta; chunks++; });
+    REQUIRE(result.success);
+    REQUIRE(streamed == result.output);
+    REQUIRE(chunks >= 2);
+}
+
 // ═══ Tool spec ═══════════════════════════════════════════════════
 
 TEST_CASE("Tool::spec builds ToolSpec correctly", "[tools]") {
@@ -0,0 +1,194 @@
+#include <catch2/catch_test_macros.hpp>
+#include "trace.hpp"
+#include "event.hpp"
+#include "event_bus.hpp"
+#include "test_helpers.hpp"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace ptrclaw;
+
+static nlohmann::json read_trace(const std::filesystem::path& path) {
+    std::ifstream f(path);
+    return nlohmann::json::parse(f);
+}
+
+static const nlohmann::json* find_event(const nlohmann::json& trace,
+                                        const std::string& name,
+                                        const std::string& phase) {
+    for (const auto& ev : trace) {
+        if (ev.value("name", "") == name && ev.value("ph", "") == phase) return &ev;
+    }
+    return nullptr;
+}
+
+// ── TraceRing ───────────────────────────────────────────────────
+
+TEST_CASE("TraceRing: push and pop in order", "[trace]") {
+    TraceRing ring(4);
+    REQUIRE(ring.capacity() == 4);
+
+    TraceRecord rec;
+    for (uint64_t i = 0; i < 4; i++) {
+        rec.ts_us = i;
+        REQUIRE(ring.push(rec));
+    }
+    REQUIRE_FALSE(ring.push(rec)); // full
+
+    TraceRecord out;
+    for (uint64_t i = 0; i < 4; i++) {
+        REQUIRE(ring.pop(out));
+        REQUIRE(out.ts_us == i);
+    }
+    REQUIRE_FALSE(ring.pop(out));
+    REQUIRE(ring.push(rec)); // slots are reusable after pop
+}
+
+TEST_CASE("TraceRing: concurrent producers lose nothing when sized", "[trace]") {
+    TraceRing ring(4096);
+    std::atomic<int> failed{0};
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; t++) {
+        producers.emplace_back([&ring, &failed, t] {
+            TraceRecord rec;
+            rec.id = static_cast<uint64_t>(t);
+            for (int i = 0; i < 1000; i++) {
+                if (!ring.push(rec)) failed++;
+            }
+        });
+    }
+    for (auto& p : producers) p.join();
+    REQUIRE(failed.load() == 0);
+
+    std::array<int, 4> per_producer{};
+    TraceRecord out;
+    while (ring.pop(out)) per_producer[out.id]++;
+    for (int n : per_producer) REQUIRE(n == 1000);
+}
+
+// ── TraceRecorder ───────────────────────────────────────────────
+
+TEST_CASE("TraceRecorder: writes Chrome trace JSON from bus events", "[trace]") {
+    HomeGuard home;
+    auto path = home.tmpdir / "trace.json";
+    EventBus bus;
+    {
+        TraceRecorder recorder(path.string());
+        REQUIRE(recorder.is_open());
+        recorder.attach(bus);
+        recorder.install();
+
+        ProviderRequestEvent req;
+        req.session_id = "chat-1";
+        req.model = "m1";
+        bus.publish(req);
+        ProviderResponseEvent resp;
+        resp.session_id = "chat-1";
+        resp.model = "m1";
+        resp.usage.prompt_tokens = 120;
+        bus.publish(resp);
+
+        ToolCallRequestEvent tool_req;
+        tool_req.session_id = "chat-1";
+        tool_req.tool_name = "shell";
+        tool_req.tool_call_id = "call-1";
+        bus.publish(tool_req);
+        ToolCallResultEvent tool_res;
+        tool_res.session_id = "chat-1";
+        tool_res.tool_name = "shell";
+        tool_res.tool_call_id = "call-1";
+        tool_res.raw_tokens = 500;
+        tool_res.filtered_tokens = 50;
+        bus.publish(tool_res);
+
+        {
+            TraceSpan span("memory_enrich", "chat-2", "memory");
+            span.arg("hits", 3);
+        }
+        recorder.stop();
+        REQUIRE(TraceRecorder::active() == nullptr);
+        REQUIRE(recorder.dropped() == 0);
+    }
+
+    auto trace = read_trace(path);
+    REQUIRE(trace.is_array());
+
+    const auto* begin = find_event(trace, "provider m1", "B");
+    const auto* end = find_event(trace, "provider m1", "E");
+    REQUIRE(begin);
+    REQUIRE(end);
+    REQUIRE((*end)["args"]["prompt_tokens"] == 120);
+    REQUIRE((*begin)["tid"] == (*end)["tid"]);
+
+    const auto* tool_b = find_event(trace, "shell", "b");
+    const auto* tool_e = find_event(trace, "shell", "e");
+    REQUIRE(tool_b);
+    REQUIRE(tool_e);
+    REQUIRE((*tool_b)["id"] == (*tool_e)["id"]);
+    REQUIRE((*tool_e)["args"]["filtered_tokens"] == 50);
+
+    const auto* span = find_event(trace, "memory_enrich", "X");
+    REQUIRE(span);
+    REQUIRE(span->contains("dur"));
+    REQUIRE((*span)["args"]["hits"] == 3);
+    REQUIRE((*span)["tid"] != (*begin)["tid"]); // one track per session
+
+    // Each session track is named via thread_name metadata
+    size_t named = 0;
+    for (const auto& ev : trace) {
+        if (ev.value("ph", "") == "M") named++;
+    }
+    REQUIRE(named == 2);
+}
+
+TEST_CASE("TraceRecorder: a failed provider call closes its slice", "[trace]") {
+    HomeGuard home;
+    auto path = home.tmpdir / "trace.json";
+    EventBus bus;
+    {
+        TraceRecorder recorder(path.string());
+        recorder.attach(bus);
+        ProviderRequestEvent req;
+        req.session_id = "chat-1";
+        req.model = "m1";
+        bus.publish(req);
+        ProviderResponseEvent resp;
+        resp.session_id = "chat-1";
+        resp.model = "m1";
+        resp.failed = true;
+        bus.publish(resp);
+        recorder.stop();
+    }
+
+    auto trace = read_trace(path);
+    const auto* end = find_event(trace, "provider m1", "E");
+    REQUIRE(end);
+    REQUIRE((*end)["args"]["failed"] == 1);
+    REQUIRE_FALSE((*end)["args"].contains("prompt_tokens"));
+}
+
+TEST_CASE("TraceSpan: no-op without an active recorder", "[trace]") {
+    REQUIRE(TraceRecorder::active() == nullptr);
+    TraceSpan span("turn", "s");
+    span.arg("x", 1); // must not crash
+}
+
+TEST_CASE("TraceRecorder: detached recorder ignores events", "[trace]") {
+    HomeGuard home;
+    auto path = home.tmpdir / "trace.json";
+    EventBus bus;
+    TraceRecorder recorder(path.string());
+    recorder.attach(bus);
+    recorder.detach();
+
+    ProviderRequestEvent req;
+    req.session_id = "s";
+    bus.publish(req);
+    recorder.stop();
+
+    auto trace = read_trace(path);
+    REQUIRE(trace.empty());
+}
@@ -1,5 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
 #include "util.hpp"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace ptrclaw;
 
@@ -165,3 +173,93 @@ TEST_CASE("expand_home: tilde is expanded", "[util]") {
 TEST_CASE("expand_home: empty string unchanged", "[util]") {
     REQUIRE(expand_home("").empty());
 }
+
+// ── atomic_write_file ───────────────────────────────────────────
+
+namespace {
+
+std::string slurp(const std::string& path) {
+    std::ifstream f(path);
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+} // namespace
+
+TEST_CASE("atomic_write_file: replaces content and keeps permissions", "[util]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / ("ptrclaw_test_atomic_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::string path = (dir / "script.sh").string();
+    { std::ofstream(path) << "old"; }
+    fs::permissions(path, fs::perms::owner_all);
+
+    REQUIRE(atomic_write_file(path, "new"));
+    REQUIRE(slurp(path) == "new");
+    REQUIRE(fs::status(path).permissions() == fs::perms::owner_all);
+    // Only the target is left behind
+    REQUIRE(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) == 1);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("atomic_write_file: leaves a file named <target>.tmp alone", "[util]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / ("ptrclaw_test_atomic_tmp_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::string path = (dir / "config").string();
+    { std::ofstream(path + ".tmp") << "user data"; }
+
+    REQUIRE(atomic_write_file(path, "new"));
+    REQUIRE(slurp(path) == "new");
+    REQUIRE(slurp(path + ".tmp") == "user data");
+    // A new file gets the umask's permissions, not mkstemp's 0600
+    mode_t mask = umask(0);
+    umask(mask);
+    REQUIRE(static_cast<mode_t>(fs::status(path).permissions()) == (0666 & ~mask));
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("atomic_write_file: concurrent writers each replace the file whole", "[util]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / ("ptrclaw_test_atomic_race_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::string path = (dir / "shared.log").string();
+    const std::string a(100000, 'a');
+    const std::string b(100000, 'b');
+
+    std::atomic<bool> failed{false};
+    auto writer = [&](const std::string& content) {
+        for (int i = 0; i < 50; i++) {
+            if (!atomic_write_file(path, content)) failed = true;
+        }
+    };
+    std::thread t1(writer, a);
+    std::thread t2(writer, b);
+    t1.join();
+    t2.join();
+    REQUIRE_FALSE(failed.load());
+    std::string result = slurp(path);
+    REQUIRE((result == a || result == b));
+    REQUIRE(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) == 1);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("atomic_write_file: writes through a symlink", "[util]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / ("ptrclaw_test_atomic_link_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::string target = (dir / "target.txt").string();
+    std::string link = (dir / "link.txt").string();
+    { std::ofstream(target) << "old"; }
+    fs::create_symlink(target, link);
+
+    REQUIRE(atomic_write_file(link, "new"));
+    REQUIRE(fs::is_symlink(link));
+    REQUIRE(slurp(target) == "new");
+
+    fs::remove_all(dir);
+}